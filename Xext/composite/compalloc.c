@@ -317,7 +317,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
 
     if (pPixmap) {
         compRestoreWindow(pWin, pPixmap);
-        dixDestroyPixmap(pPixmap, 0);
+        compReleasePixmap(pPixmap);
     }
 }
 
@@ -537,28 +537,17 @@ compGetBackgroundState(WindowPtr pWin)
     return pWin->backgroundState;
 }
 
-static PixmapPtr
-compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
+/*
+ * Copy the w x h area of the parent at x, y (in screen coordinates) to
+ * dst_x, dst_y in the pixmap, so that it will have "reasonable" contents
+ * in case for background None areas.
+ */
+static void
+compCopyFromParent(WindowPtr pWin, PixmapPtr pPixmap, int x, int y,
+                   int w, int h, int dst_x, int dst_y)
 {
     ScreenPtr pScreen = pWin->drawable.pScreen;
     WindowPtr pParent = pWin->parent;
-    PixmapPtr pPixmap;
-
-    pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h, pWin->drawable.depth,
-                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
-
-    if (!pPixmap)
-        return 0;
-
-    pPixmap->screen_x = x;
-    pPixmap->screen_y = y;
-
-    /*
-     * Copy bits from the parent into the new pixmap so that it will
-     * have "reasonable" contents in case for background None areas.
-     *
-     * This can be very expensive, so we only do it when we absolutely have to.
-     */
 
     if (pParent->drawable.depth == pWin->drawable.depth) {
         GCPtr pGC = GetScratchGC(pWin->drawable.depth, pScreen);
@@ -574,7 +563,7 @@ compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
                                           pGC,
                                           x - pParent->drawable.x,
                                           y - pParent->drawable.y,
-                                          w, h, 0, 0);
+                                          w, h, dst_x, dst_y);
             FreeScratchGC(pGC);
         }
     }
@@ -603,13 +592,207 @@ compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
                              NULL,
                              pDstPicture,
                              x - pParent->drawable.x,
-                             y - pParent->drawable.y, 0, 0, 0, 0, w, h);
+                             y - pParent->drawable.y, 0, 0,
+                             dst_x, dst_y, w, h);
         }
         if (pSrcPicture)
             FreePicture(pSrcPicture, 0);
         if (pDstPicture)
             FreePicture(pDstPicture, 0);
     }
+}
+
+/*
+ * Storage size for a backing pixmap dimension, leaving room to grow by
+ * about an eighth.
+ */
+static int
+compPixmapHeadroom(int n)
+{
+    n += n >> 3;
+    return min((n + 31) & ~31, 32767);
+}
+
+/*
+ * Change the size of a backing pixmap within its storage, if that holds
+ * the new size without wasting more than half of it. The contents stay at
+ * the same pixmap coordinates.
+ */
+static Bool
+compResizePixmapStorage(PixmapPtr pPixmap, int w, int h)
+{
+    ScreenPtr pScreen = pPixmap->drawable.pScreen;
+    CompPixmapPtr cp = GetCompPixmap(pPixmap);
+
+    if (!cp->width || cp->named || pPixmap->refcnt != 1 ||
+        w > cp->width || h > cp->height ||
+        (unsigned long) cp->width * cp->height > 2UL * w * h)
+        return FALSE;
+
+    return (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL);
+}
+
+static int
+compPixmapSizeClass(int w, int h)
+{
+    unsigned long area = ((unsigned long) w * h) >> 16;
+    int c = 0;
+
+    while (area && c < COMP_POOL_CLASSES - 1) {
+        area >>= 2;
+        c++;
+    }
+    return c;
+}
+
+static CARD32
+compPixmapPoolTimeout(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    compFlushPixmapPool(arg);
+    return 0;
+}
+
+void
+compFlushPixmapPool(ScreenPtr pScreen)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    for (int c = 0; c < COMP_POOL_CLASSES; c++) {
+        for (int i = 0; i < COMP_POOL_CLASS_SIZE; i++) {
+            if (cs->pixmapPool[c][i]) {
+                dixDestroyPixmap(cs->pixmapPool[c][i], 0);
+                cs->pixmapPool[c][i] = NULL;
+            }
+        }
+    }
+}
+
+/*
+ * Drop the composite reference to a backing pixmap that is no longer used
+ * by its window. Unless somebody else holds on to it, the pixmap goes to
+ * the pool for a second, in case a window needs one of about that size.
+ */
+void
+compReleasePixmap(PixmapPtr pPixmap)
+{
+    ScreenPtr pScreen = pPixmap->drawable.pScreen;
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    CompPixmapPtr cp = GetCompPixmap(pPixmap);
+    PixmapPtr *pool;
+
+    if (!cs || !cp->width || cp->named || pPixmap->refcnt != 1) {
+        dixDestroyPixmap(pPixmap, 0);
+        return;
+    }
+
+    /* evict the oldest pixmap of the class */
+    pool = cs->pixmapPool[compPixmapSizeClass(cp->width, cp->height)];
+    if (pool[COMP_POOL_CLASS_SIZE - 1])
+        dixDestroyPixmap(pool[COMP_POOL_CLASS_SIZE - 1], 0);
+    memmove(pool + 1, pool, (COMP_POOL_CLASS_SIZE - 1) * sizeof(*pool));
+    pool[0] = pPixmap;
+
+    cs->pixmapPoolTimer = TimerSet(cs->pixmapPoolTimer, 0, 1000,
+                                   compPixmapPoolTimeout, pScreen);
+}
+
+/*
+ * Find a pooled pixmap with storage for w x h. The storage is at least as
+ * large and at most twice as large, so it is in this size class or the
+ * next one.
+ */
+static PixmapPtr
+compTakePooledPixmap(ScreenPtr pScreen, int w, int h, int depth)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    int class = compPixmapSizeClass(w, h);
+
+    for (int c = class; c <= class + 1 && c < COMP_POOL_CLASSES; c++) {
+        for (int i = 0; i < COMP_POOL_CLASS_SIZE; i++) {
+            PixmapPtr pPixmap = cs->pixmapPool[c][i];
+
+            if (pPixmap && pPixmap->drawable.depth == depth &&
+                compResizePixmapStorage(pPixmap, w, h)) {
+                cs->pixmapPool[c][i] = NULL;
+                cs->pixmapsReused++;
+                return pPixmap;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Allocate a backing pixmap. Whether pixmaps of a depth live in CPU
+ * memory, where a smaller pixmap header on larger storage is fine, is
+ * only known once one has been created; from then on they are created
+ * with headroom.
+ */
+static PixmapPtr
+compCreateBackingPixmap(ScreenPtr pScreen, int w, int h, int depth)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    unsigned int depthMask = 1u << (depth - 1);
+    PixmapPtr pPixmap;
+
+    pPixmap = compTakePooledPixmap(pScreen, w, h, depth);
+    if (pPixmap)
+        return pPixmap;
+
+    if (cs->cpuBackingDepths & depthMask) {
+        int storage_w = compPixmapHeadroom(w);
+        int storage_h = compPixmapHeadroom(h);
+
+        pPixmap = (*pScreen->CreatePixmap) (pScreen, storage_w, storage_h,
+                                            depth,
+                                            CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+        if (pPixmap && pPixmap->devPrivate.ptr &&
+            (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL)) {
+            CompPixmapPtr cp = GetCompPixmap(pPixmap);
+
+            cp->width = storage_w;
+            cp->height = storage_h;
+            cs->pixmapsAllocated++;
+            return pPixmap;
+        }
+        if (pPixmap)
+            dixDestroyPixmap(pPixmap, 0);
+        cs->cpuBackingDepths &= ~depthMask;
+    }
+
+    pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h, depth,
+                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    if (!pPixmap)
+        return NULL;
+
+    cs->pixmapsAllocated++;
+    if (pPixmap->devPrivate.ptr &&
+        pScreen->ModifyPixmapHeader == miModifyPixmapHeader)
+        cs->cpuBackingDepths |= depthMask;
+    return pPixmap;
+}
+
+static PixmapPtr
+compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
+{
+    ScreenPtr pScreen = pWin->drawable.pScreen;
+    PixmapPtr pPixmap;
+
+    pPixmap = compCreateBackingPixmap(pScreen, w, h, pWin->drawable.depth);
+
+    if (!pPixmap)
+        return 0;
+
+    pPixmap->screen_x = x;
+    pPixmap->screen_y = y;
+
+    /*
+     * Copy bits from the parent into the new pixmap.
+     *
+     * This can be very expensive, so we only do it when we absolutely have to.
+     */
+    compCopyFromParent(pWin, pPixmap, x, y, w, h, 0, 0);
+
     return pPixmap;
 }
 
@@ -678,9 +861,10 @@ compSetParentPixmap(WindowPtr pWin)
 }
 
 /*
- * Make sure the pixmap is the right size and offset.  Allocate a new
- * pixmap to change size, adjust origin to change offset, leaving the
- * old pixmap in cw->pOldPixmap so bits can be recovered
+ * Make sure the pixmap is the right size and offset.  Resize the pixmap
+ * within its storage or allocate a new one to change size, adjust origin
+ * to change offset, leaving a new pixmap's predecessor in cw->pOldPixmap
+ * so bits can be recovered
  */
 bool compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
                        unsigned int w, unsigned int h, int bw)
@@ -699,11 +883,31 @@ bool compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
     pix_w = w + (bw << 1);
     pix_h = h + (bw << 1);
     if (pix_w != pOld->drawable.width || pix_h != pOld->drawable.height) {
-        pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h);
-        if (!pNew)
-            return FALSE;
-        cw->pOldPixmap = pOld;
-        compSetPixmap(pWin, pNew, bw);
+        int old_w = pOld->drawable.width;
+        int old_h = pOld->drawable.height;
+
+        if (compResizePixmapStorage(pOld, pix_w, pix_h)) {
+            /*
+             * The old bits are still in place, like when just moving, only
+             * the area the pixmap grew by needs reasonable contents.
+             */
+            if (pix_w > old_w)
+                compCopyFromParent(pWin, pOld, pix_x + old_w, pix_y,
+                                   pix_w - old_w, pix_h, old_w, 0);
+            if (pix_h > old_h)
+                compCopyFromParent(pWin, pOld, pix_x, pix_y + old_h,
+                                   min(old_w, pix_w), pix_h - old_h, 0, old_h);
+            GetCompScreen(pScreen)->pixmapsResized++;
+            pNew = pOld;
+            cw->pOldPixmap = 0;
+        }
+        else {
+            pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h);
+            if (!pNew)
+                return FALSE;
+            cw->pOldPixmap = pOld;
+            compSetPixmap(pWin, pNew, bw);
+        }
     }
     else {
         pNew = pOld;
@@ -247,6 +247,7 @@ SingleCompositeNameWindowPixmap(ClientPtr client, xCompositeNameWindowPixmapReq
         return rc;
 
     ++pPixmap->refcnt;
+    GetCompPixmap(pPixmap)->named = TRUE;
 
     if (!AddResource(stuff->pixmap, X11_RESTYPE_PIXMAP, (void *) pPixmap))
         return BadAlloc;
@@ -643,6 +644,7 @@ ProcCompositeNameWindowPixmap(ClientPtr client)
         }
 
         ++pPixmap->refcnt;
+        GetCompPixmap(pPixmap)->named = TRUE;
     });
 
     if (!AddResource(stuff->pixmap, XRT_PIXMAP, (void *) newPix))
@@ -61,11 +61,19 @@ Bool noCompositeExtension = FALSE;
 DevPrivateKeyRec CompScreenPrivateKeyRec;
 DevPrivateKeyRec CompWindowPrivateKeyRec;
 DevPrivateKeyRec CompSubwindowsPrivateKeyRec;
+DevPrivateKeyRec CompPixmapPrivateKeyRec;
 
 static void compCloseScreen(CallbackListPtr *pcbl, ScreenPtr pScreen, void *unused)
 {
     CompScreenPtr cs = GetCompScreen(pScreen);
 
+    LogMessageVerb(X_INFO, 3, "Composite: screen %d: %lu backing pixmaps "
+                   "allocated, %lu reused, %lu resized in place\n",
+                   pScreen->myNum, cs->pixmapsAllocated, cs->pixmapsReused,
+                   cs->pixmapsResized);
+    compFlushPixmapPool(pScreen);
+    TimerFree(cs->pixmapPoolTimer);
+
     free(cs->alternateVisuals);
     free(cs->implicitRedirectExceptions);
 
@@ -314,6 +322,10 @@ bool compScreenInit(ScreenPtr pScreen)
         return FALSE;
     if (!dixRegisterPrivateKey(&CompSubwindowsPrivateKeyRec, PRIVATE_WINDOW, 0))
         return FALSE;
+    dixSetPrivateKeyHot(&CompWindowPrivateKeyRec);
+    if (!dixRegisterPrivateKey(&CompPixmapPrivateKeyRec, PRIVATE_PIXMAP,
+                               sizeof(CompPixmapRec)))
+        return FALSE;
 
     if (GetCompScreen(pScreen))
         return TRUE;
@@ -89,6 +89,23 @@ typedef struct _CompWindow {
 
 #define COMP_ORIGIN_INVALID	    0x80000000
 
+/*
+ * Backing pixmaps of CPU-accessible screens are allocated with some
+ * headroom, so they can change size within their storage.
+ */
+typedef struct _CompPixmap {
+    int width;                  /* size of the storage, 0 if it */
+    int height;                 /* can't hold more than the pixmap */
+    Bool named;                 /* exposed by NameWindowPixmap */
+} CompPixmapRec, *CompPixmapPtr;
+
+/*
+ * Retired backing pixmaps are kept for a moment to be reused, in size
+ * classes of 4x the area of the previous one.
+ */
+#define COMP_POOL_CLASSES       5
+#define COMP_POOL_CLASS_SIZE    2
+
 typedef struct _CompSubwindows {
     int update;
     CompClientWindowPtr clients;
@@ -154,6 +171,13 @@ typedef struct _CompScreen {
     CompOverlayClientPtr pOverlayClients;
 
     SourceValidateProcPtr SourceValidate;
+
+    PixmapPtr pixmapPool[COMP_POOL_CLASSES][COMP_POOL_CLASS_SIZE];
+    OsTimerPtr pixmapPoolTimer;
+    unsigned int cpuBackingDepths;      /* 1 << (depth - 1) */
+    unsigned long pixmapsAllocated;
+    unsigned long pixmapsReused;
+    unsigned long pixmapsResized;
 } CompScreenRec, *CompScreenPtr;
 
 extern DevPrivateKeyRec CompScreenPrivateKeyRec;
@@ -168,12 +192,18 @@ extern DevPrivateKeyRec CompSubwindowsPrivateKeyRec;
 
 #define CompSubwindowsPrivateKey (&CompSubwindowsPrivateKeyRec)
 
+extern DevPrivateKeyRec CompPixmapPrivateKeyRec;
+
+#define CompPixmapPrivateKey (&CompPixmapPrivateKeyRec)
+
 #define GetCompScreen(s) ((CompScreenPtr) \
     dixLookupPrivate(&(s)->devPrivates, CompScreenPrivateKey))
 #define GetCompWindow(w) ((CompWindowPtr) \
     dixLookupPrivate(&(w)->devPrivates, CompWindowPrivateKey))
 #define GetCompSubwindows(w) ((CompSubwindowsPtr) \
     dixLookupPrivate(&(w)->devPrivates, CompSubwindowsPrivateKey))
+#define GetCompPixmap(p) ((CompPixmapPtr) \
+    dixGetPrivateAddr(&(p)->devPrivates, CompPixmapPrivateKey))
 
 extern RESTYPE CompositeClientSubwindowsType;
 extern RESTYPE CompositeClientOverlayType;
@@ -212,6 +242,12 @@ void
 void
  compRestoreWindow(WindowPtr pWin, PixmapPtr pPixmap);
 
+void
+ compReleasePixmap(PixmapPtr pPixmap);
+
+void
+ compFlushPixmapPool(ScreenPtr pScreen);
+
 void compMarkAncestors(WindowPtr pWin);
 
 /*
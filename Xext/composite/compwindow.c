@@ -141,7 +141,7 @@ bool compCheckRedirect(WindowPtr pWin)
 
             compSetParentPixmap(pWin);
             compRestoreWindow(pWin, pPixmap);
-            dixDestroyPixmap(pPixmap, 0);
+            compReleasePixmap(pPixmap);
         }
     }
     else if (should) {
@@ -321,7 +321,7 @@ compFreeOldPixmap(WindowPtr pWin)
         CompWindowPtr cw = GetCompWindow(pWin);
 
         if (cw->pOldPixmap) {
-            dixDestroyPixmap(cw->pOldPixmap, 0);
+            compReleasePixmap(cw->pOldPixmap);
             cw->pOldPixmap = NullPixmap;
         }
     }
@@ -540,7 +540,7 @@ void compWindowDestroy(CallbackListPtr *pcbl, ScreenPtr pScreen, WindowPtr pWin)
         PixmapPtr pPixmap = (*pScreen->GetWindowPixmap) (pWin);
 
         compSetParentPixmap(pWin);
-        dixDestroyPixmap(pPixmap, 0);
+        compReleasePixmap(pPixmap);
     }
 
     /* Did we just destroy the overlay window? */
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * X-DAMAGE-AGE extension - protocol definitions
+ *
+ * A server-private companion to DAMAGE for compositors that keep several
+ * buffers: Fetch ends the current frame of a damage object, stores all
+ * damage since a given earlier frame in an XFixes region and replies with
+ * the number of the frame just ended. A buffer last painted at frame n only
+ * needs that region repainted, which is the whole drawable if n is 0 or
+ * older than the frames the server keeps.
+ *
+ * damageproto defines no such request, so rather than taking a DAMAGE
+ * request number and version this lives in its own extension, with the
+ * wire definitions kept here.
+ */
+#ifndef _XSERVER_DAMAGEAGEPROTO_H
+#define _XSERVER_DAMAGEAGEPROTO_H
+
+#include <X11/Xmd.h>
+
+#define DAMAGE_AGE_NAME                 "X-DAMAGE-AGE"
+#define DAMAGE_AGE_MAJOR_VERSION        1
+#define DAMAGE_AGE_MINOR_VERSION        0
+
+/* request opcodes (minor) */
+#define X_DamageAgeQueryVersion         0
+#define X_DamageAgeFetch                1
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 damageAgeReqType;             /* X_DamageAgeQueryVersion */
+    CARD16 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+} xDamageAgeQueryVersionReq;
+
+#define sz_xDamageAgeQueryVersionReq    12
+
+typedef struct {
+    BYTE type;
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+} xDamageAgeQueryVersionReply;
+
+/* damage is a DAMAGE object, region an XFixes region or None */
+typedef struct {
+    CARD8 reqType;
+    CARD8 damageAgeReqType;             /* X_DamageAgeFetch */
+    CARD16 length;
+    CARD32 damage;
+    CARD32 region;
+    CARD32 frame;
+} xDamageAgeFetchReq;
+
+#define sz_xDamageAgeFetchReq           16
+
+typedef struct {
+    BYTE type;
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 frame;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+    CARD32 pad6;
+} xDamageAgeFetchReply;
+
+#endif /* _XSERVER_DAMAGEAGEPROTO_H */
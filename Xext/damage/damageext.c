@@ -34,6 +34,7 @@
 #include "include/windowstr.h"
 #include "miext/extinit_priv.h"
 #include "os/client_priv.h"
+#include "Xext/damage/damageageproto.h"
 #include "Xext/damage/damageext_priv.h"
 #include "Xext/panoramiX/panoramiX.h"
 #include "Xext/panoramiX/panoramiXsrv.h"
@@ -47,6 +48,7 @@
 typedef struct _DamageClient {
     CARD32 major_version;
     CARD32 minor_version;
+    CARD32 age_major_version;   /* of X-DAMAGE-AGE, 0 until queried */
     int critical;
 } DamageClientRec, *DamageClientPtr;
 
@@ -59,6 +61,9 @@ typedef struct _DamageExt {
     XID drawable;
 } DamageExtRec, *DamageExtPtr;
 
+/* how many frames X-DAMAGE-AGE can look back */
+#define DAMAGE_AGE_FRAMES 8
+
 #define VERIFY_DAMAGEEXT(pDamageExt, rid, client, mode) { \
     int rc = dixLookupResourceByType((void **)&(pDamageExt), (rid), \
                                      DamageExtType, (client), (mode)); \
@@ -493,6 +498,79 @@ ProcDamageAdd(ClientPtr client)
     return Success;
 }
 
+static int
+ProcDamageAgeQueryVersion(ClientPtr client)
+{
+    X_REQUEST_HEAD_STRUCT(xDamageAgeQueryVersionReq);
+    X_REQUEST_FIELD_CARD32(majorVersion);
+    X_REQUEST_FIELD_CARD32(minorVersion);
+
+    DamageClientPtr pDamageClient = GetDamageClient(client);
+
+    if (stuff->majorVersion < DAMAGE_AGE_MAJOR_VERSION) {
+        client->errorValue = stuff->majorVersion;
+        return BadValue;
+    }
+
+    xDamageAgeQueryVersionReply reply = {
+        .majorVersion = DAMAGE_AGE_MAJOR_VERSION,
+        .minorVersion = DAMAGE_AGE_MINOR_VERSION,
+    };
+
+    pDamageClient->age_major_version = reply.majorVersion;
+
+    X_REPLY_FIELD_CARD32(majorVersion);
+    X_REPLY_FIELD_CARD32(minorVersion);
+
+    return X_SEND_REPLY_SIMPLE(client, reply);
+}
+
+static int
+ProcDamageAgeFetch(ClientPtr client)
+{
+    X_REQUEST_HEAD_STRUCT(xDamageAgeFetchReq);
+    X_REQUEST_FIELD_CARD32(damage);
+    X_REQUEST_FIELD_CARD32(region);
+    X_REQUEST_FIELD_CARD32(frame);
+
+    DamageClientPtr pDamageClient = GetDamageClient(client);
+    DamageExtPtr pDamageExt;
+    DamagePtr pDamage;
+    RegionPtr pRegion;
+
+    if (!pDamageClient->age_major_version)
+        return BadRequest;
+
+    VERIFY_DAMAGEEXT(pDamageExt, stuff->damage, client, DixWriteAccess);
+    VERIFY_REGION_OR_NONE(pRegion, stuff->region, client, DixWriteAccess);
+
+    pDamage = pDamageExt->pDamage;
+    if (!pDamage->age && !DamageSetAgeTracking(pDamage, DAMAGE_AGE_FRAMES))
+        return BadAlloc;
+
+    if (pRegion && !DamageAgeRegion(pDamage, stuff->frame, pRegion)) {
+        DrawablePtr pDrawable = pDamageExt->pDrawable;
+
+        if (pDrawable->type == DRAWABLE_WINDOW) {
+            RegionCopy(pRegion, &((WindowPtr) pDrawable)->borderClip);
+            RegionTranslate(pRegion, -pDrawable->x, -pDrawable->y);
+        }
+        else {
+            BoxRec box = { 0, 0, pDrawable->width, pDrawable->height };
+
+            RegionReset(pRegion, &box);
+        }
+    }
+
+    xDamageAgeFetchReply reply = {
+        .frame = DamageAgeEndFrame(pDamage),
+    };
+
+    X_REPLY_FIELD_CARD32(frame);
+
+    return X_SEND_REPLY_SIMPLE(client, reply);
+}
+
 static int
 ProcDamageDispatch(ClientPtr client)
 {
@@ -515,6 +593,20 @@ ProcDamageDispatch(ClientPtr client)
     }
 }
 
+static int
+ProcDamageAgeDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    switch (stuff->data) {
+        case X_DamageAgeQueryVersion:
+            return ProcDamageAgeQueryVersion(client);
+        case X_DamageAgeFetch:
+            return ProcDamageAgeFetch(client);
+        default:
+            return BadRequest;
+    }
+}
+
 static int
 FreeDamageExt(void *value, XID did)
 {
@@ -693,5 +785,9 @@ DamageExtensionInit(void)
             SetResourceTypeErrorValue(XRT_DAMAGE,
                                       extEntry->errorBase + BadDamage);
 #endif /* XINERAMA */
+
+        AddExtension(DAMAGE_AGE_NAME, 0, 0,
+                     ProcDamageAgeDispatch, ProcDamageAgeDispatch,
+                     NULL, StandardMinorOpcode);
     }
 }
@@ -1379,11 +1379,122 @@ PanoramiXCopyPlane(ClientPtr client)
     return Success;
 }
 
+/*
+ * Bounding box of a drawing request, in the coordinates of the request.
+ * x2 and y2 are exclusive. Plain ints, as coordinate plus extent does not
+ * fit into a BoxRec.
+ */
+typedef struct {
+    int x1, y1, x2, y2;
+} PanoramiXBox;
+
+static void
+PanoramiXBoxInit(PanoramiXBox *box)
+{
+    box->x1 = box->y1 = INT_MAX;
+    box->x2 = box->y2 = INT_MIN;
+}
+
+static void
+PanoramiXBoxAdd(PanoramiXBox *box, int x, int y, int w, int h)
+{
+    box->x1 = min(box->x1, x);
+    box->y1 = min(box->y1, y);
+    box->x2 = max(box->x2, x + w);
+    box->y2 = max(box->y2, y + h);
+}
+
+static void
+PanoramiXBoxAddPoints(PanoramiXBox *box, const xPoint *pts, int npoint,
+                      int mode)
+{
+    int x = 0, y = 0;
+
+    for (int i = 0; i < npoint; i++) {
+        if (mode == CoordModePrevious && i) {
+            x += pts[i].x;
+            y += pts[i].y;
+        }
+        else {
+            x = pts[i].x;
+            y = pts[i].y;
+        }
+        PanoramiXBoxAdd(box, x, y, 1, 1);
+    }
+}
+
+/*
+ * How far a line drawn with the GC may reach beyond its end points. Miter
+ * joins are the worst case; with the 11 degree miter limit of the protocol
+ * they stay within about 5.2 line widths.
+ */
+static int
+PanoramiXLinePad(ClientPtr client, PanoramiXRes *gc)
+{
+    GCPtr pGC;
+
+    if (dixLookupGC(&pGC, gc->info[0].id, client, DixReadAccess) != Success)
+        return -1;
+
+    return pGC->lineWidth * 6 + 1;
+}
+
+/*
+ * Returns the mask of screens on which drawing within box, grown by pad
+ * pixels on each side, may touch the drawable at all. On the others the
+ * window is clipped away entirely, so the request can skip them. The
+ * border clip, rather than the screen area, keeps this right for windows
+ * whose contents are retained off screen by Composite or backing store.
+ *
+ * Pixmaps exist in full on every screen and are always drawn everywhere.
+ * At least one screen is returned, so errors are still reported.
+ */
+static unsigned int
+PanoramiXDrawableScreens(ClientPtr client, PanoramiXRes *draw,
+                         const PanoramiXBox *box, int pad)
+{
+    unsigned int screens = 0;
+
+    if (draw->type != XRT_WINDOW || pad < 0 || box->x1 > box->x2)
+        return ~0;
+
+    XINERAMA_FOR_EACH_SCREEN_FORWARD({
+        WindowPtr pWin;
+        BoxPtr extents;
+        int dx, dy;
+
+        if (dixLookupWindow(&pWin, draw->info[walkScreenIdx].id, client,
+                            DixWriteAccess) != Success)
+            return ~0;
+
+        if (!RegionNotEmpty(&pWin->borderClip))
+            continue;
+
+        dx = pWin->drawable.x;
+        dy = pWin->drawable.y;
+        if (draw->u.win.root) {
+            dx -= walkScreen->x;
+            dy -= walkScreen->y;
+        }
+
+        extents = RegionExtents(&pWin->borderClip);
+        if (box->x1 + dx - pad < extents->x2 &&
+            box->x2 + dx + pad > extents->x1 &&
+            box->y1 + dy - pad < extents->y2 &&
+            box->y2 + dy + pad > extents->y1)
+            screens |= 1 << walkScreenIdx;
+    });
+
+    return screens ? screens : 1;
+}
+
 int
 PanoramiXPolyPoint(ClientPtr client)
 {
     PanoramiXRes *gc, *draw;
     int result, npoint;
+    unsigned int screens;
+    PanoramiXBox box;
     Bool isRoot;
 
     REQUEST(xPolyPointReq);
@@ -1412,7 +1523,13 @@ PanoramiXPolyPoint(ClientPtr client)
 
         memcpy((char *) origPts, (char *) &stuff[1], npoint * sizeof(xPoint));
 
+        PanoramiXBoxInit(&box);
+        PanoramiXBoxAddPoints(&box, origPts, npoint, stuff->coordMode);
+        screens = PanoramiXDrawableScreens(client, draw, &box, 0);
+
         XINERAMA_FOR_EACH_SCREEN_FORWARD({
+            if (!(screens & (1 << walkScreenIdx)))
+                continue;
             if (walkScreenIdx)
                 memcpy(&stuff[1], origPts, npoint * sizeof(xPoint));
 
@@ -1452,6 +1569,8 @@ PanoramiXPolyLine(ClientPtr client)
 {
     PanoramiXRes *gc, *draw;
     int result, npoint;
+    unsigned int screens;
+    PanoramiXBox box;
     Bool isRoot;
 
     REQUEST(xPolyLineReq);
@@ -1479,7 +1598,14 @@ PanoramiXPolyLine(ClientPtr client)
             return BadAlloc;
         memcpy((char *) origPts, (char *) &stuff[1], npoint * sizeof(xPoint));
 
+        PanoramiXBoxInit(&box);
+        PanoramiXBoxAddPoints(&box, origPts, npoint, stuff->coordMode);
+        screens = PanoramiXDrawableScreens(client, draw, &box,
+                                           PanoramiXLinePad(client, gc));
+
         XINERAMA_FOR_EACH_SCREEN_FORWARD({
+            if (!(screens & (1 << walkScreenIdx)))
+                continue;
             if (walkScreenIdx)
                 memcpy(&stuff[1], origPts, npoint * sizeof(xPoint));
 
@@ -1518,6 +1644,8 @@ int
 PanoramiXPolySegment(ClientPtr client)
 {
     int result, nsegs, i;
+    unsigned int screens;
+    PanoramiXBox box;
     PanoramiXRes *gc, *draw;
     Bool isRoot;
 
@@ -1550,7 +1678,17 @@ PanoramiXPolySegment(ClientPtr client)
             return BadAlloc;
         memcpy((char *) origSegs, (char *) &stuff[1], nsegs * sizeof(xSegment));
 
+        PanoramiXBoxInit(&box);
+        for (i = 0; i < nsegs; i++) {
+            PanoramiXBoxAdd(&box, origSegs[i].x1, origSegs[i].y1, 1, 1);
+            PanoramiXBoxAdd(&box, origSegs[i].x2, origSegs[i].y2, 1, 1);
+        }
+        screens = PanoramiXDrawableScreens(client, draw, &box,
+                                           PanoramiXLinePad(client, gc));
+
         XINERAMA_FOR_EACH_SCREEN_FORWARD({
+            if (!(screens & (1 << walkScreenIdx)))
+                continue;
             if (walkScreenIdx) /* skip on screen #0 */
                 memcpy(&stuff[1], origSegs, nsegs * sizeof(xSegment));
 
@@ -1588,6 +1726,8 @@ int
 PanoramiXPolyRectangle(ClientPtr client)
 {
     int result, nrects, i;
+    unsigned int screens;
+    PanoramiXBox box;
     PanoramiXRes *gc, *draw;
     Bool isRoot;
 
@@ -1621,7 +1761,16 @@ PanoramiXPolyRectangle(ClientPtr client)
         memcpy((char *) origRecs, (char *) &stuff[1],
                nrects * sizeof(xRectangle));
 
+        PanoramiXBoxInit(&box);
+        for (i = 0; i < nrects; i++)
+            PanoramiXBoxAdd(&box, origRecs[i].x, origRecs[i].y,
+                            origRecs[i].width + 1, origRecs[i].height + 1);
+        screens = PanoramiXDrawableScreens(client, draw, &box,
+                                           PanoramiXLinePad(client, gc));
+
         XINERAMA_FOR_EACH_SCREEN_FORWARD({
+            if (!(screens & (1 << walkScreenIdx)))
+                continue;
             if (walkScreenIdx) /* skip on screen #0 */
                 memcpy(&stuff[1], origRecs, nrects * sizeof(xRectangle));
 
@@ -1657,6 +1806,8 @@ int
 PanoramiXPolyArc(ClientPtr client)
 {
     int result, narcs, i;
+    unsigned int screens;
+    PanoramiXBox box;
     PanoramiXRes *gc, *draw;
     Bool isRoot;
 
@@ -1689,7 +1840,16 @@ PanoramiXPolyArc(ClientPtr client)
             return BadAlloc;
         memcpy((char *) origArcs, (char *) &stuff[1], narcs * sizeof(xArc));
 
+        PanoramiXBoxInit(&box);
+        for (i = 0; i < narcs; i++)
+            PanoramiXBoxAdd(&box, origArcs[i].x, origArcs[i].y,
+                            origArcs[i].width + 1, origArcs[i].height + 1);
+        screens = PanoramiXDrawableScreens(client, draw, &box,
+                                           PanoramiXLinePad(client, gc));
+
         XINERAMA_FOR_EACH_SCREEN_FORWARD({
+            if (!(screens & (1 << walkScreenIdx)))
+                continue;
             if (walkScreenIdx) /* skip screen #0 */
                 memcpy(&stuff[1], origArcs, narcs * sizeof(xArc));
 
@@ -1724,6 +1884,8 @@ int
 PanoramiXFillPoly(ClientPtr client)
 {
     int result, count;
+    unsigned int screens;
+    PanoramiXBox box;
     PanoramiXRes *gc, *draw;
     Bool isRoot;
 
@@ -1754,7 +1916,13 @@ PanoramiXFillPoly(ClientPtr client)
         memcpy((char *) locPts, (char *) &stuff[1],
                count * sizeof(xPoint));
 
+        PanoramiXBoxInit(&box);
+        PanoramiXBoxAddPoints(&box, (xPoint *) locPts, count, stuff->coordMode);
+        screens = PanoramiXDrawableScreens(client, draw, &box, 1);
+
         XINERAMA_FOR_EACH_SCREEN_FORWARD({
+            if (!(screens & (1 << walkScreenIdx)))
+                continue;
             if (walkScreenIdx) /* skip screen #0 */
                 memcpy(&stuff[1], locPts, count * sizeof(xPoint));
 
@@ -1792,6 +1960,8 @@ int
 PanoramiXPolyFillRectangle(ClientPtr client)
 {
     int result, things, i;
+    unsigned int screens;
+    PanoramiXBox box;
     PanoramiXRes *gc, *draw;
     Bool isRoot;
     REQUEST(xPolyFillRectangleReq);
@@ -1824,7 +1994,15 @@ PanoramiXPolyFillRectangle(ClientPtr client)
         memcpy((char *) origRects, (char *) &stuff[1],
                things * sizeof(xRectangle));
 
+        PanoramiXBoxInit(&box);
+        for (i = 0; i < things; i++)
+            PanoramiXBoxAdd(&box, origRects[i].x, origRects[i].y,
+                            origRects[i].width, origRects[i].height);
+        screens = PanoramiXDrawableScreens(client, draw, &box, 0);
+
         XINERAMA_FOR_EACH_SCREEN_FORWARD({
+            if (!(screens & (1 << walkScreenIdx)))
+                continue;
             if (walkScreenIdx) /* skip screen #0 */
                 memcpy(&stuff[1], origRects, things * sizeof(xRectangle));
 
@@ -1862,6 +2040,8 @@ PanoramiXPolyFillArc(ClientPtr client)
     PanoramiXRes *gc, *draw;
     Bool isRoot;
     int result, narcs, i;
+    unsigned int screens;
+    PanoramiXBox box;
 
     REQUEST(xPolyFillArcReq);
 
@@ -1892,7 +2072,15 @@ PanoramiXPolyFillArc(ClientPtr client)
             return BadAlloc;
         memcpy((char *) origArcs, (char *) &stuff[1], narcs * sizeof(xArc));
 
+        PanoramiXBoxInit(&box);
+        for (i = 0; i < narcs; i++)
+            PanoramiXBoxAdd(&box, origArcs[i].x, origArcs[i].y,
+                            origArcs[i].width, origArcs[i].height);
+        screens = PanoramiXDrawableScreens(client, draw, &box, 1);
+
         XINERAMA_FOR_EACH_SCREEN_FORWARD({
+            if (!(screens & (1 << walkScreenIdx)))
+                continue;
             if (walkScreenIdx) /* skip screen #0 */
                 memcpy(&stuff[1], origArcs, narcs * sizeof(xArc));
 
@@ -1930,6 +2118,8 @@ PanoramiXPutImage(ClientPtr client)
     PanoramiXRes *gc, *draw;
     Bool isRoot;
     int result, orig_x, orig_y;
+    unsigned int screens;
+    PanoramiXBox box;
 
     REQUEST(xPutImageReq);
 
@@ -1953,7 +2143,13 @@ PanoramiXPutImage(ClientPtr client)
     orig_x = stuff->dstX;
     orig_y = stuff->dstY;
 
+    PanoramiXBoxInit(&box);
+    PanoramiXBoxAdd(&box, orig_x, orig_y, stuff->width, stuff->height);
+    screens = PanoramiXDrawableScreens(client, draw, &box, 0);
+
     XINERAMA_FOR_EACH_SCREEN_BACKWARD({
+        if (!(screens & (1 << walkScreenIdx)))
+            continue;
         if (isRoot) {
             stuff->dstX = orig_x - walkScreen->x;
             stuff->dstY = orig_y - walkScreen->y;
@@ -115,6 +115,7 @@ present_execute_copy(present_vblank_ptr vblank, uint64_t crtc_msc)
                                              vblank->event_id,
                                              vblank->exec_msc)) {
         vblank->queued = TRUE;
+        vblank->latch_ust = 0;
         return;
     }
 
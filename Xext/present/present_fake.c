@@ -24,32 +24,58 @@
 #include "include/list.h"
 #include "Xext/present/present_priv.h"
 
+/*
+ * Pending fake vblanks, ordered by the UST of the vblank they wait for.
+ * A single timer is armed for the first one, so events for the same
+ * vblank are delivered together and in the order they were queued.
+ */
 static struct xorg_list fake_vblank_queue;
+static OsTimerPtr fake_vblank_timer;
 
 typedef struct present_fake_vblank {
     struct xorg_list            list;
     uint64_t                    event_id;
-    OsTimerPtr                  timer;
-    ScreenPtr                   screen;
+    uint64_t                    ust;
+    uint64_t                    msc;
 } present_fake_vblank_rec, *present_fake_vblank_ptr;
 
+/*
+ * Fake vblanks happen at multiples of the fake interval; report the last
+ * one, like a driver would for a real CRTC.
+ */
 int
 present_fake_get_ust_msc(ScreenPtr screen, uint64_t *ust, uint64_t *msc)
 {
     present_screen_priv_ptr screen_priv = present_screen_priv(screen);
 
-    *ust = GetTimeInMicros();
-    *msc = (*ust + screen_priv->fake_interval / 2) / screen_priv->fake_interval;
+    *msc = GetTimeInMicros() / screen_priv->fake_interval;
+    *ust = *msc * screen_priv->fake_interval;
     return Success;
 }
 
+static CARD32
+present_fake_do_timer(OsTimerPtr timer, CARD32 time, void *arg);
+
 static void
-present_fake_notify(ScreenPtr screen, uint64_t event_id)
+present_fake_arm_timer(void)
 {
-    uint64_t                    ust, msc;
+    present_fake_vblank_ptr     first;
+    uint64_t                    now = GetTimeInMicros();
+    CARD32                      delay = 0;
 
-    present_fake_get_ust_msc(screen, &ust, &msc);
-    present_event_notify(event_id, ust, msc);
+    if (xorg_list_is_empty(&fake_vblank_queue)) {
+        TimerFree(fake_vblank_timer);
+        fake_vblank_timer = NULL;
+        return;
+    }
+
+    first = xorg_list_first_entry(&fake_vblank_queue,
+                                  present_fake_vblank_rec, list);
+    if (first->ust > now)
+        delay = (first->ust - now + 999) / 1000;
+
+    fake_vblank_timer = TimerSet(fake_vblank_timer, 0, max(delay, 1),
+                                 present_fake_do_timer, NULL);
 }
 
 static CARD32
@@ -57,12 +83,26 @@ present_fake_do_timer(OsTimerPtr timer,
                       CARD32 time,
                       void *arg)
 {
-    present_fake_vblank_ptr     fake_vblank = arg;
+    present_fake_vblank_ptr     fake_vblank;
+    uint64_t                    now = GetTimeInMicros();
+
+    /* Notifying may queue or abort other fake vblanks, so always restart
+     * from the head of the queue */
+    while (!xorg_list_is_empty(&fake_vblank_queue)) {
+        fake_vblank = xorg_list_first_entry(&fake_vblank_queue,
+                                            present_fake_vblank_rec, list);
+
+        /* the millisecond timer may fire a little early */
+        if (fake_vblank->ust > now)
+            break;
+
+        xorg_list_del(&fake_vblank->list);
+        present_event_notify(fake_vblank->event_id, fake_vblank->ust,
+                             fake_vblank->msc);
+        free(fake_vblank);
+    }
 
-    present_fake_notify(fake_vblank->screen, fake_vblank->event_id);
-    xorg_list_del(&fake_vblank->list);
-    TimerFree(fake_vblank->timer);
-    free(fake_vblank);
+    present_fake_arm_timer();
     return 0;
 }
 
@@ -73,9 +113,12 @@ present_fake_abort_vblank(ScreenPtr screen, uint64_t event_id, uint64_t msc)
 
     xorg_list_for_each_entry_safe(fake_vblank, tmp, &fake_vblank_queue, list) {
         if (fake_vblank->event_id == event_id) {
-            TimerFree(fake_vblank->timer); /* TimerFree will call TimerCancel() */
+            Bool first = fake_vblank->list.prev == &fake_vblank_queue;
+
             xorg_list_del(&fake_vblank->list);
             free (fake_vblank);
+            if (first)
+                present_fake_arm_timer();
             break;
         }
     }
@@ -88,12 +131,12 @@ present_fake_queue_vblank(ScreenPtr     screen,
 {
     present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
     uint64_t                    ust = msc * screen_priv->fake_interval;
-    uint64_t                    now = GetTimeInMicros();
-    INT32                       delay = ((int64_t) (ust - now)) / 1000;
-    present_fake_vblank_ptr     fake_vblank;
+    present_fake_vblank_ptr     fake_vblank, prev;
+    struct xorg_list            *pos;
 
-    if (delay <= 0) {
-        present_fake_notify(screen, event_id);
+    if (ust <= GetTimeInMicros()) {
+        present_fake_get_ust_msc(screen, &ust, &msc);
+        present_event_notify(event_id, ust, msc);
         return Success;
     }
 
@@ -101,15 +144,26 @@ present_fake_queue_vblank(ScreenPtr     screen,
     if (!fake_vblank)
         return BadAlloc;
 
-    fake_vblank->screen = screen;
     fake_vblank->event_id = event_id;
-    fake_vblank->timer = TimerSet(NULL, 0, delay, present_fake_do_timer, fake_vblank);
-    if (!fake_vblank->timer) {
-        free(fake_vblank);
-        return BadAlloc;
+    fake_vblank->ust = ust;
+    fake_vblank->msc = msc;
+
+    /* Insert after everything due no later; mostly that is the tail */
+    for (pos = fake_vblank_queue.prev; pos != &fake_vblank_queue; pos = pos->prev) {
+        prev = xorg_list_entry(pos, present_fake_vblank_rec, list);
+        if (prev->ust <= ust)
+            break;
     }
+    xorg_list_add(&fake_vblank->list, pos);
 
-    xorg_list_add(&fake_vblank->list, &fake_vblank_queue);
+    if (fake_vblank->list.prev == &fake_vblank_queue) {
+        present_fake_arm_timer();
+        if (!fake_vblank_timer) {
+            xorg_list_del(&fake_vblank->list);
+            free(fake_vblank);
+            return BadAlloc;
+        }
+    }
 
     return Success;
 }
@@ -82,6 +82,8 @@ struct present_vblank {
     uint64_t            target_msc;     /* target MSC when present should complete */
     uint64_t            exec_msc;       /* MSC at which present can be executed */
     uint64_t            msc_offset;
+    uint64_t            target_ust;     /* with PresentOptionUST, 0 otherwise */
+    uint64_t            latch_ust;      /* when the present was executed */
     present_fence_ptr   idle_fence;
     present_fence_ptr   wait_fence;
     present_notify_ptr  notifies;
@@ -222,6 +224,14 @@ typedef struct present_event {
     int mask;
 } present_event_rec;
 
+typedef struct present_frame_stats {
+    uint32_t               presented;
+    uint32_t               missed;
+    uint32_t               max_queued;
+    uint64_t               latency_sum;
+    uint64_t               latency_max;
+} present_frame_stats_rec, *present_frame_stats_ptr;
+
 struct present_window_priv {
     WindowPtr              window;
     present_event_ptr      events;
@@ -230,12 +240,22 @@ struct present_window_priv {
     uint64_t               msc;         /* Last reported MSC from the current crtc */
     struct xorg_list       vblank;
     struct xorg_list       notifies;
+    present_frame_stats_rec stats;
 };
 
 #define PresentCrtcNeverSet     ((RRCrtcPtr) 1)
 
 extern DevPrivateKeyRec present_window_private_key;
 
+extern DevPrivateKeyRec present_client_private_key;
+
+/* X-PRESENT-STATS major version the client asked for, 0 until queried */
+static inline CARD32 *
+present_stats_client_version(ClientPtr client)
+{
+    return dixLookupPrivate(&client->devPrivates, &present_client_private_key);
+}
+
 static inline present_window_priv_ptr
 present_window_priv(WindowPtr window)
 {
@@ -430,6 +450,12 @@ proc_present_dispatch(ClientPtr client);
 int
 sproc_present_dispatch(ClientPtr client);
 
+int
+proc_present_stats_dispatch(ClientPtr client);
+
+int
+sproc_present_stats_dispatch(ClientPtr client);
+
 /*
  * present_scmd.c
  */
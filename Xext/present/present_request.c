@@ -24,6 +24,7 @@
 #include "dix/dix_priv.h"
 #include "dix/request_priv.h"
 #include "Xext/present/present_priv.h"
+#include "Xext/present/presentstatsproto.h"
 #include "Xext/dri3/dri3_priv.h"
 #include "Xext/randr/randrstr_priv.h"
 
@@ -464,3 +465,123 @@ sproc_present_dispatch(ClientPtr client)
 
     return BadRequest;
 }
+
+static int
+proc_present_stats_query_version(ClientPtr client)
+{
+    REQUEST(xPresentStatsQueryVersionReq);
+    xPresentStatsQueryVersionReply reply = {
+        .majorVersion = PRESENT_STATS_MAJOR_VERSION,
+        .minorVersion = PRESENT_STATS_MINOR_VERSION
+    };
+
+    REQUEST_SIZE_MATCH(xPresentStatsQueryVersionReq);
+
+    if (stuff->majorVersion < PRESENT_STATS_MAJOR_VERSION) {
+        client->errorValue = stuff->majorVersion;
+        return BadValue;
+    }
+
+    *present_stats_client_version(client) = reply.majorVersion;
+
+    if (client->swapped) {
+        swapl(&reply.majorVersion);
+        swapl(&reply.minorVersion);
+    }
+
+    return X_SEND_REPLY_SIMPLE(client, reply);
+}
+
+static int
+proc_present_stats_query_frame_stats(ClientPtr client)
+{
+    REQUEST(xPresentStatsQueryFrameStatsReq);
+    WindowPtr                   window;
+    present_window_priv_ptr     window_priv;
+    present_vblank_ptr          vblank;
+    int                         rc;
+
+    REQUEST_SIZE_MATCH(xPresentStatsQueryFrameStatsReq);
+    if (!*present_stats_client_version(client))
+        return BadRequest;
+
+    rc = dixLookupWindow(&window, stuff->window, client, DixGetAttrAccess);
+    if (rc != Success)
+        return rc;
+
+    xPresentStatsQueryFrameStatsReply reply = { 0 };
+
+    window_priv = present_window_priv(window);
+    if (window_priv) {
+        present_frame_stats_ptr stats = &window_priv->stats;
+
+        xorg_list_for_each_entry(vblank, &window_priv->vblank, window_list)
+            reply.queued++;
+
+        reply.presented = stats->presented;
+        reply.missed = stats->missed;
+        reply.maxQueued = stats->max_queued;
+        if (stats->presented)
+            reply.latency = stats->latency_sum / stats->presented;
+        reply.maxLatency = min(stats->latency_max, UINT32_MAX);
+    }
+
+    if (client->swapped) {
+        swapl(&reply.presented);
+        swapl(&reply.missed);
+        swapl(&reply.queued);
+        swapl(&reply.maxQueued);
+        swapl(&reply.latency);
+        swapl(&reply.maxLatency);
+    }
+    return X_SEND_REPLY_SIMPLE(client, reply);
+}
+
+int
+proc_present_stats_dispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+
+    switch (stuff->data) {
+        case X_PresentStatsQueryVersion:
+            return proc_present_stats_query_version(client);
+        case X_PresentStatsQueryFrameStats:
+            return proc_present_stats_query_frame_stats(client);
+    }
+
+    return BadRequest;
+}
+
+static int _X_COLD
+sproc_present_stats_query_version(ClientPtr client)
+{
+    REQUEST(xPresentStatsQueryVersionReq);
+    REQUEST_SIZE_MATCH(xPresentStatsQueryVersionReq);
+    swapl(&stuff->majorVersion);
+    swapl(&stuff->minorVersion);
+    return proc_present_stats_query_version(client);
+}
+
+static int _X_COLD
+sproc_present_stats_query_frame_stats(ClientPtr client)
+{
+    REQUEST(xPresentStatsQueryFrameStatsReq);
+    REQUEST_SIZE_MATCH(xPresentStatsQueryFrameStatsReq);
+    swapl(&stuff->window);
+    return proc_present_stats_query_frame_stats(client);
+}
+
+int _X_COLD
+sproc_present_stats_dispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+
+    switch (stuff->data) {
+        case X_PresentStatsQueryVersion:
+            return sproc_present_stats_query_version(client);
+        case X_PresentStatsQueryFrameStats:
+            return sproc_present_stats_query_frame_stats(client);
+    }
+
+    return BadRequest;
+}
@@ -44,6 +44,32 @@ static struct xorg_list present_flip_queue;
 static void
 present_execute(present_vblank_ptr vblank, uint64_t ust, uint64_t crtc_msc);
 
+static inline uint64_t
+present_vblank_target_ust(present_vblank_ptr vblank)
+{
+    return vblank->target_ust ? vblank->target_ust : UINT64_MAX;
+}
+
+/*
+ * The exec and flip queues are kept ordered by execution MSC and, for the
+ * same MSC, by target UST, so the most urgent presentation comes first.
+ */
+static void
+present_queue_insert(struct xorg_list *queue, present_vblank_ptr vblank)
+{
+    present_vblank_ptr  pos;
+
+    xorg_list_for_each_entry(pos, queue, event_queue) {
+        if (msc_is_after(pos->exec_msc, vblank->exec_msc))
+            break;
+        if (pos->exec_msc == vblank->exec_msc &&
+            present_vblank_target_ust(pos) > present_vblank_target_ust(vblank))
+            break;
+    }
+    /* before pos, or at the tail if we ran off the end */
+    xorg_list_append(&vblank->event_queue, &pos->event_queue);
+}
+
 static inline PixmapPtr
 present_flip_pending_pixmap(ScreenPtr screen)
 {
@@ -201,6 +227,65 @@ present_get_ust_msc(ScreenPtr screen, RRCrtcPtr crtc, uint64_t *ust, uint64_t *m
         return (*crtc_screen_priv->info->get_ust_msc)(crtc, ust, msc);
 }
 
+/*
+ * Nominal time between two vblanks in microseconds
+ */
+static uint64_t
+present_frame_interval(ScreenPtr screen, RRCrtcPtr crtc)
+{
+    if (crtc && crtc->mode) {
+        xRRModeInfo *mode = &crtc->mode->mode;
+        uint64_t    pixels = (uint64_t) mode->hTotal * mode->vTotal;
+
+        if (mode->modeFlags & RR_DoubleScan)
+            pixels *= 2;
+        if (mode->modeFlags & RR_Interlace)
+            pixels /= 2;
+        if (mode->dotClock && pixels)
+            return max(pixels * 1000000 / mode->dotClock, 1);
+    }
+    return present_screen_priv(screen)->fake_interval;
+}
+
+/*
+ * With PresentOptionUST, target, divisor and remainder are UST values in
+ * microseconds and pick the target UST the way their MSC counterparts pick
+ * the target MSC. Aim for the first vblank at or after it, extrapolating
+ * from the last one at the nominal refresh rate.
+ */
+static uint64_t
+present_ust_to_msc(ScreenPtr screen,
+                   RRCrtcPtr crtc,
+                   uint64_t *target_ust,
+                   uint64_t divisor,
+                   uint64_t remainder,
+                   uint64_t ust,
+                   uint64_t crtc_msc,
+                   uint32_t options)
+{
+    uint64_t    interval = present_frame_interval(screen, crtc);
+    uint64_t    frames = 0;
+
+    if (*target_ust <= ust) {
+        if (divisor == 0)
+            *target_ust = ust;
+        else {
+            *target_ust = ust - ust % divisor + remainder % divisor;
+            if (*target_ust <= ust)
+                *target_ust += divisor;
+        }
+    }
+
+    if (*target_ust > ust)
+        frames = (*target_ust - ust + interval - 1) / interval;
+
+    /* As with MSC targets, the current frame has already begun */
+    if (frames == 0 && !(options & PresentAllAsyncOptions))
+        frames = 1;
+
+    return crtc_msc + frames;
+}
+
 static void
 present_flush(WindowPtr window)
 {
@@ -564,7 +649,7 @@ present_execute(present_vblank_ptr vblank, uint64_t ust, uint64_t crtc_msc)
                           vblank->event_id, vblank,
                           screen_priv->flip_pending, screen_priv->unflip_event_id));
             xorg_list_del(&vblank->event_queue);
-            xorg_list_append(&vblank->event_queue, &present_flip_queue);
+            present_queue_insert(&present_flip_queue, vblank);
             vblank->flip_ready = TRUE;
             return;
         }
@@ -574,6 +659,10 @@ present_execute(present_vblank_ptr vblank, uint64_t ust, uint64_t crtc_msc)
     xorg_list_del(&vblank->window_list);
     vblank->queued = FALSE;
 
+    /* Executed again on completion when waiting for TearFree */
+    if (!vblank->latch_ust)
+        vblank->latch_ust = GetTimeInMicros();
+
     if (vblank->pixmap && vblank->window &&
         (vblank->reason < PRESENT_FLIP_REASON_DRIVER_TEARFREE ||
          vblank->exec_msc != vblank->target_msc)) {
@@ -750,6 +839,7 @@ present_scmd_pixmap(WindowPtr window,
 {
     uint64_t                    ust = 0;
     uint64_t                    target_msc;
+    uint64_t                    target_ust = 0;
     uint64_t                    crtc_msc = 0;
     int                         ret;
     present_vblank_ptr          vblank, tmp;
@@ -787,11 +877,18 @@ present_scmd_pixmap(WindowPtr window,
         window_priv->msc = crtc_msc;
     }
 
-    target_msc = present_get_target_msc(target_window_msc + window_priv->msc_offset,
-                                        crtc_msc,
-                                        divisor,
-                                        remainder,
-                                        options);
+    if (options & PresentOptionUST) {
+        target_ust = target_window_msc;
+        target_msc = present_ust_to_msc(screen, target_crtc, &target_ust,
+                                        divisor, remainder,
+                                        ust, crtc_msc, options);
+    }
+    else
+        target_msc = present_get_target_msc(target_window_msc + window_priv->msc_offset,
+                                            crtc_msc,
+                                            divisor,
+                                            remainder,
+                                            options);
 
     /*
      * Look for a matching presentation already on the list and
@@ -850,6 +947,9 @@ present_scmd_pixmap(WindowPtr window,
 
     vblank->event_id = ++present_scmd_event_id;
 
+    if (options & PresentOptionUST)
+        vblank->target_ust = target_ust;
+
     /* The soonest presentation is crtc_msc+2 if TearFree is already flipping */
     if (vblank->reason == PRESENT_FLIP_REASON_DRIVER_TEARFREE_FLIPPING &&
         !msc_is_after(vblank->exec_msc, crtc_msc + 1))
@@ -858,7 +958,7 @@ present_scmd_pixmap(WindowPtr window,
              (vblank->flip && vblank->sync_flip))
         vblank->exec_msc--;
 
-    xorg_list_append(&vblank->event_queue, &present_exec_queue);
+    present_queue_insert(&present_exec_queue, vblank);
     vblank->queued = TRUE;
     if (msc_is_after(vblank->exec_msc, crtc_msc)) {
         ret = present_queue_vblank(screen, window, target_crtc, vblank->event_id, vblank->exec_msc);
@@ -25,6 +25,7 @@
 #include "dix/screenint_priv.h"
 #include "miext/extinit_priv.h"
 #include "Xext/present/present_priv.h"
+#include "Xext/present/presentstatsproto.h"
 
 #define PRESENT_WRAP_HOOK(priv,real,mem,func) {\
     (priv)->mem = (real)->mem; \
@@ -38,6 +39,7 @@
 int present_request;
 DevPrivateKeyRec present_screen_private_key;
 DevPrivateKeyRec present_window_private_key;
+DevPrivateKeyRec present_client_private_key;
 
 /*
  * Get a pointer to a present window private, creating if necessary
@@ -176,6 +178,10 @@ present_screen_register_priv_keys(void)
     if (!dixRegisterPrivateKey(&present_window_private_key, PRIVATE_WINDOW, 0))
         return FALSE;
 
+    if (!dixRegisterPrivateKey(&present_client_private_key, PRIVATE_CLIENT,
+                               sizeof(CARD32)))
+        return FALSE;
+
     return TRUE;
 }
 
@@ -260,6 +266,11 @@ present_extension_init(void)
 
     present_request = extension->base;
 
+    if (!AddExtension(PRESENT_STATS_NAME, 0, 0,
+                      proc_present_stats_dispatch, sproc_present_stats_dispatch,
+                      NULL, StandardMinorOpcode))
+        goto bail;
+
     if (!present_init())
         goto bail;
 
@@ -25,11 +25,37 @@
 
 #include "Xext/present/present_priv.h"
 
+static void
+present_vblank_account(present_vblank_ptr vblank, uint64_t ust, uint64_t crtc_msc)
+{
+    present_window_priv_ptr     window_priv = present_window_priv(vblank->window);
+    present_frame_stats_ptr     stats;
+    uint64_t                    latency = 0;
+
+    if (!window_priv)
+        return;
+
+    stats = &window_priv->stats;
+    stats->presented++;
+
+    if (msc_is_after(crtc_msc, vblank->target_msc))
+        stats->missed++;
+
+    if (vblank->latch_ust && ust > vblank->latch_ust)
+        latency = ust - vblank->latch_ust;
+    stats->latency_sum += latency;
+    stats->latency_max = max(stats->latency_max, latency);
+}
+
 void
 present_vblank_notify(present_vblank_ptr vblank, CARD8 kind, CARD8 mode, uint64_t ust, uint64_t crtc_msc)
 {
     int n;
 
+    if (vblank->window && kind == PresentCompleteKindPixmap &&
+        mode != PresentCompleteModeSkip)
+        present_vblank_account(vblank, ust, crtc_msc);
+
     if (vblank->window)
         present_send_complete_notify(vblank->window, kind, mode, vblank->serial, ust, crtc_msc - vblank->msc_offset);
     for (n = 0; n < vblank->num_notifies; n++) {
@@ -97,6 +123,15 @@ present_vblank_init(present_vblank_ptr vblank,
     xorg_list_append(&vblank->window_list, &window_priv->vblank);
     xorg_list_init(&vblank->event_queue);
 
+    if (pixmap) {
+        present_vblank_ptr      queued;
+        uint32_t                depth = 0;
+
+        xorg_list_for_each_entry(queued, &window_priv->vblank, window_list)
+            depth++;
+        window_priv->stats.max_queued = max(window_priv->stats.max_queued, depth);
+    }
+
     vblank->screen = screen;
     vblank->window = window;
     vblank->pixmap = pixmap;
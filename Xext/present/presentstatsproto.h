@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * X-PRESENT-STATS extension - protocol definitions
+ *
+ * A server-private companion to Present reporting the frame timing of a
+ * window: pixmaps presented, how many of those completed after their
+ * target, the current and largest number of queued presentations, and
+ * the average and largest latency from execution to completion, in
+ * microseconds.
+ *
+ * presentproto defines no such request, so rather than taking a Present
+ * request number this lives in its own extension, with the wire
+ * definitions kept here.
+ */
+#ifndef _XSERVER_PRESENTSTATSPROTO_H
+#define _XSERVER_PRESENTSTATSPROTO_H
+
+#include <X11/Xmd.h>
+
+#define PRESENT_STATS_NAME              "X-PRESENT-STATS"
+#define PRESENT_STATS_MAJOR_VERSION     1
+#define PRESENT_STATS_MINOR_VERSION     0
+
+/* request opcodes (minor) */
+#define X_PresentStatsQueryVersion      0
+#define X_PresentStatsQueryFrameStats   1
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 presentStatsReqType;          /* X_PresentStatsQueryVersion */
+    CARD16 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+} xPresentStatsQueryVersionReq;
+
+#define sz_xPresentStatsQueryVersionReq 12
+
+typedef struct {
+    BYTE type;
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+} xPresentStatsQueryVersionReply;
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 presentStatsReqType;          /* X_PresentStatsQueryFrameStats */
+    CARD16 length;
+    CARD32 window;
+} xPresentStatsQueryFrameStatsReq;
+
+#define sz_xPresentStatsQueryFrameStatsReq 8
+
+typedef struct {
+    BYTE type;
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 presented;                   /* pixmaps shown */
+    CARD32 missed;                      /* of those, shown after their target */
+    CARD32 queued;                      /* presentations not executed yet */
+    CARD32 maxQueued;
+    CARD32 latency;                     /* average from execution to completion */
+    CARD32 maxLatency;
+} xPresentStatsQueryFrameStatsReply;
+
+#endif /* _XSERVER_PRESENTSTATSPROTO_H */
@@ -35,6 +35,7 @@ and Jim Haggerty of Metheus.
 
 #include <stdio.h>
 #include <assert.h>
+#include <unistd.h>
 #include <X11/Xmd.h>
 #include <X11/extensions/recordproto.h>
 
@@ -64,6 +65,14 @@ and Jim Haggerty of Metheus.
 
 #include "protocol-versions.h"
 
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_SYS_EVENTFD_H)
+#define RECORD_RING 1
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+#include "Xext/record/recordringproto.h"
+#endif
+
 static RESTYPE RTContext;       /* internal resource type for Record contexts */
 
 /* How many bytes of protocol data to buffer in a context. Don't set to less
@@ -71,6 +80,28 @@ static RESTYPE RTContext;       /* internal resource type for Record contexts */
  */
 #define REPLY_BUF_SIZE 1024
 
+#ifdef RECORD_RING
+#define RECORD_RING_DATA_OFFSET 4096
+#define RECORD_RING_MIN_SIZE (64 * 1024)
+#define RECORD_RING_DEFAULT_SIZE (1024 * 1024)
+#define RECORD_RING_MAX_SIZE (64 * 1024 * 1024)
+
+/* Server side of a shared ring, see xRecordRingHeader */
+typedef struct {
+    xRecordRingHeader *header;
+    char *data;
+    CARD32 size;
+    size_t mapSize;
+    int efd;
+    CARD32 head;                /* where the next byte goes */
+    CARD32 committed;           /* end of the last complete record */
+    CARD64 pending;             /* bytes left of the current record */
+    Bool dropping;              /* current record does not fit, skip it */
+    int numHeaderBytes;         /* of a header that came in pieces */
+    char headerBuf[sz_xRecordEnableContextReply];
+} RecordRingRec, *RecordRingPtr;
+#endif
+
 /* Record Context structure */
 
 typedef struct {
@@ -84,6 +115,9 @@ typedef struct {
     int numBufBytes;            /* number of bytes in replyBuffer */
     char replyBuffer[REPLY_BUF_SIZE];   /* buffered recorded protocol */
     int inFlush;                /*  are we inside RecordFlushReplyBuffer */
+#ifdef RECORD_RING
+    RecordRingPtr pRing;        /* shared ring instead of replies, or NULL */
+#endif
 } RecordContextRec, *RecordContextPtr;
 
 /*  RecordMinorOpRec - to hold minor opcode selections for extension requests
@@ -99,6 +133,21 @@ typedef union {
     } major;
 } RecordMinorOpRec, *RecordMinorOpPtr;
 
+/*  RecordOpcodeMaskRec - the request or reply selections of an RCAP
+ *  flattened into bitmaps, so that recording a protocol element tests a bit
+ *  instead of walking interval sets.
+ */
+
+typedef struct {
+    CARD32 major[8];            /* major opcodes, core and extension */
+    CARD32 minor[128][8];       /* minor opcodes, per extension major */
+} RecordOpcodeMaskRec, *RecordOpcodeMaskPtr;
+
+#define RecordMaskIsSet(_mask, _bit) \
+    (((_mask)[(_bit) >> 5] >> ((_bit) & 31)) & 1)
+#define RecordMaskSet(_mask, _bit) \
+    ((_mask)[(_bit) >> 5] |= 1U << ((_bit) & 31))
+
 /*  RecordClientsAndProtocolRec, nicknamed RCAP - holds all the client and
  *  protocol selections passed in a single CreateContext or RegisterClients.
  *  Generally, a context will have one of these from the create and an
@@ -116,6 +165,11 @@ typedef struct _RecordClientsAndProtocolRec {
     RecordSetPtr pDeviceEventSet;       /* device events to record */
     RecordSetPtr pDeliveredEventSet;    /* delivered events to record */
     RecordSetPtr pErrorSet;     /* errors to record */
+    RecordOpcodeMaskPtr pRequestMask;   /* pRequest* as bitmaps */
+    RecordOpcodeMaskPtr pReplyMask;     /* pReply* as bitmaps */
+    CARD32 deviceEventMask[4];  /* pDeviceEventSet as bitmap */
+    CARD32 deliveredEventMask[4];       /* pDeliveredEventSet as bitmap */
+    CARD32 errorMask[8];        /* pErrorSet as bitmap */
     XID *pClientIDs;            /* array of clients to record */
     short numClients;           /* number of clients in pClientIDs */
     short sizeClients;          /* size of pClientIDs array */
@@ -145,6 +199,8 @@ static int numEnabledRCAPs;
 static int RecordDeleteContext(void     *value,
                                XID      id);
 
+static void RecordDisableContext(RecordContextPtr pContext);
+
 /***************************************************************************/
 
 /* client private stuff */
@@ -177,6 +233,14 @@ static DevPrivateKeyRec RecordClientPrivateKeyRec;
  */
 #define RecordClientPrivate(_pClient) (RecordClientPrivatePtr) \
     dixLookupPrivate(&(_pClient)->devPrivates, RecordClientPrivateKey)
+
+#ifdef RECORD_RING
+/* X-RECORD-RING major version a client asked for, 0 until queried */
+static DevPrivateKeyRec RecordRingClientPrivateKeyRec;
+
+#define RecordRingClientVersion(_pClient) (CARD32 *) \
+    dixLookupPrivate(&(_pClient)->devPrivates, &RecordRingClientPrivateKeyRec)
+#endif
 
 /***************************************************************************/
 
@@ -219,6 +283,216 @@ RecordFindContextOnAllContexts(RecordContextPtr pContext)
 
 /***************************************************************************/
 
+#ifdef RECORD_RING
+
+/* RecordRingCopy
+ *
+ * Arguments:
+ *	pContext is a context recording into a ring.
+ *	data is a pointer to recorded protocol, and len is its length in bytes.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	The data is appended to the ring.  Every record starts with a complete
+ *	reply header, which RecordAProtocolElement keeps at the start of the
+ *	reply buffer; it tells how long the record is.  A record that does not
+ *	fit into the free space of the ring is dropped as a whole and counted
+ *	in the ring header.  A header that arrives in pieces is collected
+ *	first.  Data is not visible to the client until RecordRingPublish is
+ *	called.
+ */
+static void
+RecordRingCopy(RecordContextPtr pContext, const char *data, int len)
+{
+    RecordRingPtr pRing = pContext->pRing;
+
+    while (len > 0) {
+        CARD32 n, offset, chunk;
+
+        if (!pRing->pending) {  /* start of a record */
+            const xRecordEnableContextReply *pRep =
+                (const xRecordEnableContextReply *) data;
+            CARD32 length;
+            CARD32 used;
+
+            if (pRing->numHeaderBytes ||
+                len < SIZEOF(xRecordEnableContextReply)) {
+                n = min(len, SIZEOF(xRecordEnableContextReply) -
+                        pRing->numHeaderBytes);
+                memcpy(pRing->headerBuf + pRing->numHeaderBytes, data, n);
+                pRing->numHeaderBytes += n;
+                data += n;
+                len -= n;
+                if (pRing->numHeaderBytes < SIZEOF(xRecordEnableContextReply))
+                    return;
+
+                /* go on with the whole header, then the rest of data */
+                pRing->numHeaderBytes = 0;
+                RecordRingCopy(pContext, pRing->headerBuf,
+                               SIZEOF(xRecordEnableContextReply));
+                continue;
+            }
+
+            length = pRep->length;
+            if (pContext->pRecordingClient->swapped)
+                swapl(&length);
+            pRing->pending = SIZEOF(xRecordEnableContextReply) +
+                ((CARD64) length << 2);
+
+            used = pRing->head -
+                __atomic_load_n(&pRing->header->tail, __ATOMIC_ACQUIRE);
+            pRing->dropping = used > pRing->size ||
+                pRing->pending > pRing->size - used;
+            if (pRing->dropping)
+                __atomic_fetch_add(&pRing->header->dropped, 1,
+                                   __ATOMIC_RELAXED);
+        }
+
+        n = min((CARD64) len, pRing->pending);
+        if (!pRing->dropping) {
+            offset = pRing->head & (pRing->size - 1);
+            chunk = min(n, pRing->size - offset);
+            memcpy(pRing->data + offset, data, chunk);
+            memcpy(pRing->data, data + chunk, n - chunk);
+            pRing->head += n;
+        }
+        pRing->pending -= n;
+        data += n;
+        len -= n;
+
+        if (!pRing->pending && !pRing->dropping)
+            pRing->committed = pRing->head;
+    }
+}                               /* RecordRingCopy */
+
+/* RecordRingWrite
+ *
+ *	Like RecordRingCopy, but pads the data to a multiple of four bytes,
+ *	as WriteToClient does for the connection.
+ */
+static void
+RecordRingWrite(RecordContextPtr pContext, const char *data, int len)
+{
+    static const char padBuffer[3];
+    int padlen = padding_for_int32(len);
+
+    RecordRingCopy(pContext, data, len);
+    if (padlen && pContext->pRing->pending)
+        RecordRingCopy(pContext, padBuffer,
+                       min((CARD64) padlen, pContext->pRing->pending));
+}                               /* RecordRingWrite */
+
+/* RecordRingPublish
+ *
+ * Arguments:
+ *	pRing is a ring.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	All complete records written to the ring are made visible to the
+ *	client, which is woken up if it is waiting for them.
+ */
+static void
+RecordRingPublish(RecordRingPtr pRing)
+{
+    if (pRing->committed == pRing->header->head)
+        return;
+
+    __atomic_store_n(&pRing->header->head, pRing->committed, __ATOMIC_RELEASE);
+    if (__atomic_exchange_n(&pRing->header->waiting, 0, __ATOMIC_SEQ_CST))
+        eventfd_write(pRing->efd, 1);
+}                               /* RecordRingPublish */
+
+/* RecordRingCreate
+ *
+ * Arguments:
+ *	size is the requested size of the ring data in bytes, or 0.
+ *	pMemFd returns an fd of the ring memory for the client.
+ *
+ * Returns: the new ring, or NULL if it could not be created.
+ *
+ * Side Effects: none.
+ */
+static RecordRingPtr
+RecordRingCreate(CARD32 size, int *pMemFd)
+{
+    RecordRingPtr pRing;
+    CARD32 ringSize = RECORD_RING_MIN_SIZE;
+    int fd;
+
+    if (!size)
+        size = RECORD_RING_DEFAULT_SIZE;
+    while (ringSize < size && ringSize < RECORD_RING_MAX_SIZE)
+        ringSize <<= 1;
+
+    pRing = calloc(1, sizeof(RecordRingRec));
+    if (!pRing)
+        return NULL;
+    pRing->size = ringSize;
+    pRing->mapSize = RECORD_RING_DATA_OFFSET + ringSize;
+
+    fd = memfd_create("xorg-record", MFD_CLOEXEC);
+    if (fd < 0)
+        goto bail;
+    if (ftruncate(fd, pRing->mapSize) < 0)
+        goto bail_fd;
+    pRing->header = mmap(NULL, pRing->mapSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+    if (pRing->header == MAP_FAILED)
+        goto bail_fd;
+    pRing->data = (char *) pRing->header + RECORD_RING_DATA_OFFSET;
+
+    pRing->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (pRing->efd < 0)
+        goto bail_map;
+
+    *pMemFd = fd;
+    return pRing;
+
+ bail_map:
+    munmap(pRing->header, pRing->mapSize);
+ bail_fd:
+    close(fd);
+ bail:
+    free(pRing);
+    return NULL;
+}                               /* RecordRingCreate */
+
+static void
+RecordRingDestroy(RecordRingPtr pRing)
+{
+    if (!pRing)
+        return;
+    munmap(pRing->header, pRing->mapSize);
+    close(pRing->efd);
+    free(pRing);
+}                               /* RecordRingDestroy */
+
+/* RecordRingSendFd
+ *
+ * Queues a copy of fd for the client.  The connection owns and closes
+ * the copy once it is sent, so the caller keeps fd whatever happens.
+ *
+ * Returns: 0 on success, -1 if the fd could not be queued.
+ */
+static int
+RecordRingSendFd(ClientPtr client, int fd)
+{
+    int copy = dup(fd);
+
+    if (copy < 0)
+        return -1;
+    if (WriteFdToClient(client, copy, TRUE) < 0) {
+        close(copy);
+        return -1;
+    }
+    return 0;
+}                               /* RecordRingSendFd */
+
+#endif /* RECORD_RING */
+
 /* RecordFlushReplyBuffer
  *
  * Arguments:
@@ -233,7 +507,8 @@ RecordFindContextOnAllContexts(RecordContextPtr pContext)
  *	to the recording client, and the number of buffered bytes is set to
  *	zero.  If len1 is not zero, data1/len1 are then written to the
  *	recording client, and similarly for data2/len2 (written after
- *	data1/len1).
+ *	data1/len1).  A context enabled through X-RECORD-RING writes into
+ *	its ring instead.
  */
 static void
 RecordFlushReplyBuffer(RecordContextPtr pContext,
@@ -242,6 +517,17 @@ RecordFlushReplyBuffer(RecordContextPtr pContext,
     if (!pContext->pRecordingClient || pContext->pRecordingClient->clientGone ||
         pContext->inFlush)
         return;
+#ifdef RECORD_RING
+    if (pContext->pRing) {
+        RecordRingWrite(pContext, pContext->replyBuffer,
+                        pContext->numBufBytes);
+        pContext->numBufBytes = 0;
+        RecordRingWrite(pContext, data1, len1);
+        RecordRingWrite(pContext, data2, len2);
+        RecordRingPublish(pContext->pRing);
+        return;
+    }
+#endif
     ++pContext->inFlush;
     if (pContext->numBufBytes)
         dixWriteToClient(pContext->pRecordingClient, pContext->numBufBytes,
@@ -401,6 +687,27 @@ RecordAProtocolElement(RecordContextPtr pContext, ClientPtr pClient,
     }
 }                               /* RecordAProtocolElement */
 
+/* RecordWantsOpcode
+ *
+ * Arguments:
+ *	pMask is the request or reply mask of an RCAP, or NULL.
+ *	majorop and minorop identify a request or reply.
+ *
+ * Returns: TRUE if the RCAP records the request or reply, else FALSE.
+ *
+ * Side Effects: none.
+ */
+static inline Bool
+RecordWantsOpcode(RecordOpcodeMaskPtr pMask, int majorop, int minorop)
+{
+    if (!pMask || !RecordMaskIsSet(pMask->major, majorop))
+        return FALSE;
+    if (majorop <= 127)         /* core request */
+        return TRUE;
+    return minorop >= 0 && minorop <= 255 &&
+        RecordMaskIsSet(pMask->minor[majorop - 128], minorop);
+}                               /* RecordWantsOpcode */
+
 /* RecordFindClientOnContext
  *
  * Arguments:
@@ -517,44 +824,15 @@ RecordARequest(ClientPtr client)
     for (i = 0; i < numEnabledContexts; i++) {
         pContext = ppAllContexts[i];
         pRCAP = RecordFindClientOnContext(pContext, client->clientAsMask, NULL);
-        if (pRCAP && pRCAP->pRequestMajorOpSet &&
-            RecordIsMemberOfSet(pRCAP->pRequestMajorOpSet, majorop)) {
-            if (majorop <= 127) {       /* core request */
-
-                if (client->req_len == 0)
-                    RecordABigRequest(pContext, client, stuff);
-                else
-                    RecordAProtocolElement(pContext, client, XRecordFromClient,
-                                           (void *) stuff,
-                                           client->req_len << 2, 0, 0);
-            }
-            else {              /* extension, check minor opcode */
-
-                int minorop = client->minorOp;
-                int numMinOpInfo;
-                RecordMinorOpPtr pMinorOpInfo = pRCAP->pRequestMinOpInfo;
-
-                assert(pMinorOpInfo);
-                numMinOpInfo = pMinorOpInfo->count;
-                pMinorOpInfo++;
-                assert(numMinOpInfo);
-                for (; numMinOpInfo; numMinOpInfo--, pMinorOpInfo++) {
-                    if (majorop >= pMinorOpInfo->major.first &&
-                        majorop <= pMinorOpInfo->major.last &&
-                        RecordIsMemberOfSet(pMinorOpInfo->major.pMinOpSet,
-                                            minorop)) {
-                        if (client->req_len == 0)
-                            RecordABigRequest(pContext, client, stuff);
-                        else
-                            RecordAProtocolElement(pContext, client,
-                                                   XRecordFromClient,
-                                                   (void *) stuff,
-                                                   client->req_len << 2, 0, 0);
-                        break;
-                    }
-                }               /* end for each minor op info */
-            }                   /* end extension request */
-        }                       /* end this RCAP wants this major opcode */
+        if (pRCAP && RecordWantsOpcode(pRCAP->pRequestMask, majorop,
+                                       client->minorOp)) {
+            if (client->req_len == 0)
+                RecordABigRequest(pContext, client, stuff);
+            else
+                RecordAProtocolElement(pContext, client, XRecordFromClient,
+                                       (void *) stuff,
+                                       client->req_len << 2, 0, 0);
+        }                       /* end this RCAP wants this request */
     }                           /* end for each context */
     pClientPriv = RecordClientPrivate(client);
     assert(pClientPriv);
@@ -603,42 +881,15 @@ RecordAReply(CallbackListPtr *pcbl, void *nulldata, void *calldata)
                 if (!pri->bytesRemaining)
                     pContext->continuedReply = 0;
             }
-            else if (pri->startOfReply && pRCAP->pReplyMajorOpSet &&
-                     RecordIsMemberOfSet(pRCAP->pReplyMajorOpSet, majorop)) {
-                if (majorop <= 127) {   /* core reply */
-                    RecordAProtocolElement(pContext, client, XRecordFromServer,
-                                           (void *) pri->replyData,
-                                           pri->dataLenBytes, 0,
-                                           pri->bytesRemaining);
-                    if (pri->bytesRemaining)
-                        pContext->continuedReply = 1;
-                }
-                else {          /* extension, check minor opcode */
-
-                    int minorop = client->minorOp;
-                    int numMinOpInfo;
-                    RecordMinorOpPtr pMinorOpInfo = pRCAP->pReplyMinOpInfo;
-
-                    assert(pMinorOpInfo);
-                    numMinOpInfo = pMinorOpInfo->count;
-                    pMinorOpInfo++;
-                    assert(numMinOpInfo);
-                    for (; numMinOpInfo; numMinOpInfo--, pMinorOpInfo++) {
-                        if (majorop >= pMinorOpInfo->major.first &&
-                            majorop <= pMinorOpInfo->major.last &&
-                            RecordIsMemberOfSet(pMinorOpInfo->major.pMinOpSet,
-                                                minorop)) {
-                            RecordAProtocolElement(pContext, client,
-                                                   XRecordFromServer,
-                                                   (void *) pri->replyData,
-                                                   pri->dataLenBytes, 0,
-                                                   pri->bytesRemaining);
-                            if (pri->bytesRemaining)
-                                pContext->continuedReply = 1;
-                            break;
-                        }
-                    }           /* end for each minor op info */
-                }               /* end extension reply */
+            else if (pri->startOfReply &&
+                     RecordWantsOpcode(pRCAP->pReplyMask, majorop,
+                                       client->minorOp)) {
+                RecordAProtocolElement(pContext, client, XRecordFromServer,
+                                       (void *) pri->replyData,
+                                       pri->dataLenBytes, 0,
+                                       pri->bytesRemaining);
+                if (pri->bytesRemaining)
+                    pContext->continuedReply = 1;
             }                   /* end continued reply vs. start of reply */
         }                       /* end client is registered on this context */
     }                           /* end for each context */
@@ -681,13 +932,12 @@ RecordADeliveredEventOrError(CallbackListPtr *pcbl, void *nulldata,
                 int recordit = 0;
 
                 if (pRCAP->pErrorSet) {
-                    recordit = RecordIsMemberOfSet(pRCAP->pErrorSet,
-                                                   ((xError *) (pev))->
-                                                   errorCode);
+                    recordit = RecordMaskIsSet(pRCAP->errorMask,
+                                               ((xError *) (pev))->errorCode);
                 }
                 else if (pRCAP->pDeliveredEventSet) {
-                    recordit = RecordIsMemberOfSet(pRCAP->pDeliveredEventSet,
-                                                   pev->u.u.type & 0177);
+                    recordit = RecordMaskIsSet(pRCAP->deliveredEventMask,
+                                               pev->u.u.type & 0177);
                 }
                 if (recordit) {
                     xEvent swappedEvent;
@@ -715,7 +965,7 @@ RecordSendProtocolEvents(RecordClientsAndProtocolPtr pRCAP,
     int ev;                     /* event index */
 
     for (ev = 0; ev < count; ev++, pev++) {
-        if (RecordIsMemberOfSet(pRCAP->pDeviceEventSet, pev->u.u.type & 0177)) {
+        if (RecordMaskIsSet(pRCAP->deviceEventMask, pev->u.u.type & 0177)) {
             xEvent swappedEvent;
             xEvent *pEvToRecord = pev;
 
@@ -1056,6 +1306,8 @@ RecordDeleteClientFromRCAP(RecordClientsAndProtocolPtr pRCAP, int position)
         /* free the RCAP */
         if (pRCAP->clientIDsSeparatelyAllocated)
             free(pRCAP->pClientIDs);
+        free(pRCAP->pRequestMask);
+        free(pRCAP->pReplyMask);
         free(pRCAP);
     }
 }                               /* RecordDeleteClientFromRCAP */
@@ -1281,6 +1533,63 @@ RecordPadAlign(int size, int align)
     return (align - (size & (align - 1))) & (align - 1);
 }                               /* RecordPadAlign */
 
+/* RecordMaskAddSet
+ *
+ * Arguments:
+ *	mask is a bitmap of nbits bits.
+ *	pSet is a set.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	The bits of all members of pSet below nbits are set in mask.
+ */
+static void
+RecordMaskAddSet(CARD32 *mask, int nbits, RecordSetPtr pSet)
+{
+    RecordSetIteratePtr pIter = NULL;
+    RecordSetInterval interval;
+
+    while ((pIter = RecordIterateSet(pSet, pIter, &interval))) {
+        int i;
+
+        for (i = interval.first; i <= interval.last && i < nbits; i++)
+            RecordMaskSet(mask, i);
+    }
+}                               /* RecordMaskAddSet */
+
+/* RecordBuildOpcodeMask
+ *
+ * Arguments:
+ *	pMask is the mask to fill in.
+ *	pMajorOpSet is the set of major opcodes of an RCAP.
+ *	pMinOpInfo is the minor opcode info for its extension major opcodes,
+ *	  or NULL.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	pMask is set up to hold the same selection as the sets, so that
+ *	RecordWantsOpcode agrees with looking them up.
+ */
+static void
+RecordBuildOpcodeMask(RecordOpcodeMaskPtr pMask, RecordSetPtr pMajorOpSet,
+                      RecordMinorOpPtr pMinOpInfo)
+{
+    int i, majorop;
+
+    RecordMaskAddSet(pMask->major, 256, pMajorOpSet);
+    if (!pMinOpInfo)
+        return;
+
+    for (i = 1; i <= pMinOpInfo[0].count; i++) {
+        for (majorop = max(pMinOpInfo[i].major.first, 128);
+             majorop <= pMinOpInfo[i].major.last && majorop <= 255; majorop++)
+            RecordMaskAddSet(pMask->minor[majorop - 128], 256,
+                             pMinOpInfo[i].major.pMinOpSet);
+    }
+}                               /* RecordBuildOpcodeMask */
+
 /* RecordSanityCheckRegisterClients
  *
  * Arguments:
@@ -1700,6 +2009,19 @@ RecordRegisterClients(RecordContextPtr pContext, ClientPtr client,
         goto bailout;
     }
 
+    if (si[REQ].intervals)
+        pRCAP->pRequestMask = calloc(1, sizeof(RecordOpcodeMaskRec));
+    if (si[RI_REP].intervals)
+        pRCAP->pReplyMask = calloc(1, sizeof(RecordOpcodeMaskRec));
+    if ((si[REQ].intervals && !pRCAP->pRequestMask) ||
+        (si[RI_REP].intervals && !pRCAP->pReplyMask)) {
+        free(pRCAP->pRequestMask);
+        free(pRCAP->pReplyMask);
+        free(pRCAP);
+        err = BadAlloc;
+        goto bailout;
+    }
+
     /* fill in the RCAP */
 
     pRCAP->pContext = pContext;
@@ -1795,6 +2117,22 @@ RecordRegisterClients(RecordContextPtr pContext, ClientPtr client,
     else
         pRCAP->pReplyMinOpInfo = NULL;
 
+    /* flatten the sets for the recording hot paths */
+
+    if (pRCAP->pRequestMajorOpSet)
+        RecordBuildOpcodeMask(pRCAP->pRequestMask, pRCAP->pRequestMajorOpSet,
+                              pRCAP->pRequestMinOpInfo);
+    if (pRCAP->pReplyMajorOpSet)
+        RecordBuildOpcodeMask(pRCAP->pReplyMask, pRCAP->pReplyMajorOpSet,
+                              pRCAP->pReplyMinOpInfo);
+    if (pRCAP->pDeviceEventSet)
+        RecordMaskAddSet(pRCAP->deviceEventMask, 128, pRCAP->pDeviceEventSet);
+    if (pRCAP->pDeliveredEventSet)
+        RecordMaskAddSet(pRCAP->deliveredEventMask, 128,
+                         pRCAP->pDeliveredEventSet);
+    if (pRCAP->pErrorSet)
+        RecordMaskAddSet(pRCAP->errorMask, 256, pRCAP->pErrorSet);
+
     pRCAP->clientStarted = clientStarted;
     pRCAP->clientDied = clientDied;
 
@@ -2308,23 +2646,24 @@ ProcRecordGetContext(ClientPtr client)
     return err;
 }                               /* ProcRecordGetContext */
 
+/* RecordEnableContext
+ *
+ * Arguments:
+ *	pContext is the context to enable.
+ *	client is the client that receives the recorded protocol.
+ *
+ * Returns: BadAlloc if a memory allocation error occurred, else Success.
+ *
+ * Side Effects:
+ *	Recording hooks for this context are installed, and the context is
+ *	moved to the front part of the ppAllContexts array.
+ */
 static int
-ProcRecordEnableContext(ClientPtr client)
+RecordEnableContext(RecordContextPtr pContext, ClientPtr client)
 {
-    REQUEST(xRecordEnableContextReq);
-    REQUEST_SIZE_MATCH(xRecordEnableContextReq);
-
-    if (client->swapped)
-        swapl(&stuff->context);
-
-    RecordContextPtr pContext;
     int i;
     RecordClientsAndProtocolPtr pRCAP;
 
-    VERIFY_CONTEXT(pContext, stuff->context, client);
-    if (pContext->pRecordingClient)
-        return BadMatch;        /* already enabled */
-
     /* install record hooks for each RCAP */
 
     for (pRCAP = pContext->pListOfRCAP; pRCAP; pRCAP = pRCAP->pNextRCAP) {
@@ -2342,10 +2681,6 @@ ProcRecordEnableContext(ClientPtr client)
         }
     }
 
-    /* Disallow further request processing on this connection until
-     * the context is disabled.
-     */
-    IgnoreClient(client);
     pContext->pRecordingClient = client;
 
     /* Don't allow the data connection to record itself; unregister it. */
@@ -2364,6 +2699,33 @@ ProcRecordEnableContext(ClientPtr client)
 
     ++numEnabledContexts;
     assert(numEnabledContexts > 0);
+    return Success;
+}                               /* RecordEnableContext */
+
+static int
+ProcRecordEnableContext(ClientPtr client)
+{
+    REQUEST(xRecordEnableContextReq);
+    REQUEST_SIZE_MATCH(xRecordEnableContextReq);
+
+    if (client->swapped)
+        swapl(&stuff->context);
+
+    RecordContextPtr pContext;
+    int err;
+
+    VERIFY_CONTEXT(pContext, stuff->context, client);
+    if (pContext->pRecordingClient)
+        return BadMatch;        /* already enabled */
+
+    err = RecordEnableContext(pContext, client);
+    if (err != Success)
+        return err;
+
+    /* Disallow further request processing on this connection until
+     * the context is disabled.
+     */
+    IgnoreClient(client);
 
     /* send StartOfData */
     RecordAProtocolElement(pContext, NULL, XRecordStartOfData, NULL, 0, 0, 0);
@@ -2399,6 +2761,13 @@ RecordDisableContext(RecordContextPtr pContext)
         RecordAProtocolElement(pContext, NULL, XRecordEndOfData, NULL, 0, 0, 0);
         RecordFlushReplyBuffer(pContext, NULL, 0, NULL, 0);
     }
+#ifdef RECORD_RING
+    if (pContext->pRing) {
+        RecordRingDestroy(pContext->pRing);
+        pContext->pRing = NULL;
+    }
+    else
+#endif
     /* Re-enable request processing on this connection. */
     AttendClient(pContext->pRecordingClient);
 
@@ -2527,6 +2896,121 @@ ProcRecordDispatch(ClientPtr client)
     }
 }                               /* ProcRecordDispatch */
 
+#ifdef RECORD_RING
+static int
+ProcRecordRingQueryVersion(ClientPtr client)
+{
+    REQUEST(xRecordRingQueryVersionReq);
+    REQUEST_SIZE_MATCH(xRecordRingQueryVersionReq);
+
+    if (client->swapped) {
+        swapl(&stuff->majorVersion);
+        swapl(&stuff->minorVersion);
+    }
+
+    if (stuff->majorVersion < RECORD_RING_MAJOR_VERSION) {
+        client->errorValue = stuff->majorVersion;
+        return BadValue;
+    }
+
+    xRecordRingQueryVersionReply reply = {
+        .majorVersion = RECORD_RING_MAJOR_VERSION,
+        .minorVersion = RECORD_RING_MINOR_VERSION
+    };
+
+    *RecordRingClientVersion(client) = reply.majorVersion;
+
+    if (client->swapped) {
+        swapl(&reply.majorVersion);
+        swapl(&reply.minorVersion);
+    }
+
+    return X_SEND_REPLY_SIMPLE(client, reply);
+}
+
+static int
+ProcRecordRingEnableContext(ClientPtr client)
+{
+    REQUEST(xRecordRingEnableContextReq);
+    REQUEST_SIZE_MATCH(xRecordRingEnableContextReq);
+
+    if (client->swapped) {
+        swapl(&stuff->context);
+        swapl(&stuff->size);
+    }
+
+    RecordContextPtr pContext;
+    RecordRingPtr pRing;
+    int memfd, err;
+
+    if (!*RecordRingClientVersion(client))
+        return BadRequest;
+
+    /* the fds can only be passed over a local connection */
+    if (!client->local)
+        return BadMatch;
+
+    VERIFY_CONTEXT(pContext, stuff->context, client);
+    if (pContext->pRecordingClient)
+        return BadMatch;        /* already enabled */
+
+    pRing = RecordRingCreate(stuff->size, &memfd);
+    if (!pRing)
+        return BadAlloc;
+
+    pContext->pRing = pRing;
+    err = RecordEnableContext(pContext, client);
+    if (err != Success) {
+        pContext->pRing = NULL;
+        RecordRingDestroy(pRing);
+        close(memfd);
+        return err;
+    }
+
+    if (RecordRingSendFd(client, memfd) < 0 ||
+        RecordRingSendFd(client, pRing->efd) < 0) {
+        RecordDisableContext(pContext);
+        close(memfd);
+        return BadAlloc;
+    }
+    /* the ring stays mapped without it */
+    close(memfd);
+
+    xRecordRingEnableContextReply reply = {
+        .nfd = 2,
+        .size = pRing->size,
+        .offset = RECORD_RING_DATA_OFFSET,
+    };
+
+    if (client->swapped) {
+        swapl(&reply.size);
+        swapl(&reply.offset);
+    }
+
+    err = X_SEND_REPLY_SIMPLE(client, reply);
+
+    /* StartOfData goes into the ring, once the client can see it */
+    RecordAProtocolElement(pContext, NULL, XRecordStartOfData, NULL, 0, 0, 0);
+    RecordFlushReplyBuffer(pContext, NULL, 0, NULL, 0);
+    return err;
+}                               /* ProcRecordRingEnableContext */
+
+static int
+ProcRecordRingDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+
+    switch (stuff->data) {
+    case X_RecordRingQueryVersion:
+        return ProcRecordRingQueryVersion(client);
+    case X_RecordRingEnableContext:
+        return ProcRecordRingEnableContext(client);
+    default:
+        return BadRequest;
+    }
+}                               /* ProcRecordRingDispatch */
+#endif /* RECORD_RING */
+
 static int _X_COLD
 SwapCreateRegister(ClientPtr client, xRecordRegisterClientsReq * stuff)
 {
@@ -2717,6 +3201,11 @@ RecordExtensionInit(void)
 
     if (!dixRegisterPrivateKey(RecordClientPrivateKey, PRIVATE_CLIENT, 0))
         return;
+#ifdef RECORD_RING
+    if (!dixRegisterPrivateKey(&RecordRingClientPrivateKeyRec, PRIVATE_CLIENT,
+                               sizeof(CARD32)))
+        return;
+#endif
 
     ppAllContexts = NULL;
     numContexts = numEnabledContexts = numEnabledRCAPs = 0;
@@ -2734,4 +3223,10 @@ RecordExtensionInit(void)
     SetResourceTypeErrorValue(RTContext,
                               extentry->errorBase + XRecordBadContext);
 
+#ifdef RECORD_RING
+    AddExtension(RECORD_RING_NAME, 0, 0,
+                 ProcRecordRingDispatch, ProcRecordRingDispatch,
+                 NULL, StandardMinorOpcode);
+#endif
+
 }                               /* RecordExtensionInit */
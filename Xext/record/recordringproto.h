@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * X-RECORD-RING extension - protocol definitions
+ *
+ * A server-private companion to RECORD: EnableContext enables a RECORD
+ * context like RECORD's EnableContext, but instead of replies on the
+ * connection the recorded protocol goes into a ring buffer in memory
+ * shared with the client. The reply carries two fds, the ring memory and
+ * an eventfd, and the connection remains usable while the context is
+ * enabled.
+ *
+ * recordproto defines no such request, so rather than taking a RECORD
+ * request number and version this lives in its own extension, with the
+ * wire definitions kept here.
+ */
+#ifndef _XSERVER_RECORDRINGPROTO_H
+#define _XSERVER_RECORDRINGPROTO_H
+
+#include <X11/Xmd.h>
+
+#define RECORD_RING_NAME                "X-RECORD-RING"
+#define RECORD_RING_MAJOR_VERSION       1
+#define RECORD_RING_MINOR_VERSION       0
+
+/* request opcodes (minor) */
+#define X_RecordRingQueryVersion        0
+#define X_RecordRingEnableContext       1
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 recordRingReqType;            /* X_RecordRingQueryVersion */
+    CARD16 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+} xRecordRingQueryVersionReq;
+
+#define sz_xRecordRingQueryVersionReq   12
+
+typedef struct {
+    BYTE type;
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+} xRecordRingQueryVersionReply;
+
+/* context is a RECORD context */
+typedef struct {
+    CARD8 reqType;
+    CARD8 recordRingReqType;            /* X_RecordRingEnableContext */
+    CARD16 length;
+    CARD32 context;
+    CARD32 size;                        /* requested ring size in bytes, 0: default */
+} xRecordRingEnableContextReq;
+
+#define sz_xRecordRingEnableContextReq  12
+
+typedef struct {
+    BYTE type;
+    CARD8 nfd;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 size;                        /* size of the data area */
+    CARD32 offset;                      /* offset of the data area in the memory */
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+} xRecordRingEnableContextReply;
+
+/*
+ * Start of the ring memory, in host byte order. head and tail count the
+ * bytes written and consumed since the ring was created, modulo 2^32; the
+ * data area size is a power of two. The server only advances head past
+ * complete records, each of which has the same layout as a RECORD
+ * EnableContext reply. A client that wants to sleep sets waiting, checks
+ * head once more and polls the eventfd; the server clears waiting and
+ * signals the eventfd when it publishes new records.
+ */
+typedef struct {
+    CARD32 head;
+    CARD32 tail;
+    CARD32 waiting;
+    CARD32 dropped;                     /* records dropped because the ring was full */
+} xRecordRingHeader;
+
+#endif /* _XSERVER_RECORDRINGPROTO_H */
@@ -622,6 +622,7 @@ PictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
 
     if (!dixRegisterPrivateKey(&PictureWindowPrivateKeyRec, PRIVATE_WINDOW, 0))
         return FALSE;
+    dixSetPrivateKeyHot(&PictureWindowPrivateKeyRec);
 
     if (!formats) {
         formats = PictureCreateDefaultFormats(pScreen, &nformats);
@@ -861,7 +862,7 @@ CreateSolidPicture(Picture pid, xRenderColor * color, int *error)
     pPicture->pSourcePict = calloc(1, sizeof(SourcePict));
     if (!pPicture->pSourcePict) {
         *error = BadAlloc;
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     pPicture->pSourcePict->type = SourcePictTypeSolidFill;
@@ -892,7 +893,7 @@ CreateLinearGradientPicture(Picture pid, xPointFixed * p1, xPointFixed * p2,
     pPicture->pSourcePict = calloc(1, sizeof(SourcePict));
     if (!pPicture->pSourcePict) {
         *error = BadAlloc;
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
 
@@ -903,7 +904,7 @@ CreateLinearGradientPicture(Picture pid, xPointFixed * p1, xPointFixed * p2,
     initGradient(pPicture->pSourcePict, nStops, stops, colors, error);
     if (*error) {
         free(pPicture->pSourcePict);
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     return pPicture;
@@ -933,7 +934,7 @@ CreateRadialGradientPicture(Picture pid, xPointFixed * inner,
     pPicture->pSourcePict = calloc(1, sizeof(SourcePict));
     if (!pPicture->pSourcePict) {
         *error = BadAlloc;
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     radial = &pPicture->pSourcePict->radial;
@@ -949,7 +950,7 @@ CreateRadialGradientPicture(Picture pid, xPointFixed * inner,
     initGradient(pPicture->pSourcePict, nStops, stops, colors, error);
     if (*error) {
         free(pPicture->pSourcePict);
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     return pPicture;
@@ -977,7 +978,7 @@ CreateConicalGradientPicture(Picture pid, xPointFixed * center, xFixed angle,
     pPicture->pSourcePict = calloc(1, sizeof(SourcePict));
     if (!pPicture->pSourcePict) {
         *error = BadAlloc;
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
 
@@ -988,7 +989,7 @@ CreateConicalGradientPicture(Picture pid, xPointFixed * center, xFixed angle,
     initGradient(pPicture->pSourcePict, nStops, stops, colors, error);
     if (*error) {
         free(pPicture->pSourcePict);
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     return pPicture;
@@ -46,6 +46,7 @@ in this Software without prior written authorization from The Open Group.
 #include "dix/request_priv.h"
 #include "dix/screenint_priv.h"
 #include "dix/screen_hooks_priv.h"
+#include "dix/settings_priv.h"
 #include "dix/screenint_priv.h"
 #include "dix/window_priv.h"
 #include "include/misc.h"
@@ -111,11 +112,50 @@ Bool noMITShmExtension = FALSE;
 static PixmapPtr fbShmCreatePixmap(XSHM_CREATE_PIXMAP_ARGS);
 static int ShmDetachSegment(void *value, XID shmseg);
 static void ShmResetProc(ExtensionEntry *extEntry);
+#ifdef SHM_FD_PASSING
+static void ShmFlushFdCache(void);
+static void ShmFreeFaultedSegments(void);
+#endif
 static void SShmCompletionEvent(xShmCompletionEvent *from,
                                 xShmCompletionEvent *to);
 
 static int ShmCreatePixmap(ClientPtr client, xShmCreatePixmapReq *stuff);
 
+/*
+ * With -shmstrips, ZPixmap images larger than SHM_ASYNC_SIZE are put in
+ * strips of about SHM_ASYNC_STRIP_SIZE bytes. The client is ignored until
+ * the last strip is done, other clients get served in between. That makes
+ * the request non-atomic, hence it must be asked for.
+ */
+#define SHM_ASYNC_SIZE          (4 << 20)
+#define SHM_ASYNC_STRIP_SIZE    (1 << 20)
+
+typedef struct _ShmPutImageJob {
+    xShmPutImageReq req;
+    ShmDescPtr shmdesc;
+    long length;                /* bytes per image row */
+    int y;                      /* next row to put, relative to srcY */
+    int rows;                   /* rows per strip */
+} ShmPutImageJobRec, *ShmPutImageJobPtr;
+
+static int shmPutImageJobs;
+
+#ifdef SHM_FD_PASSING
+/*
+ * Fd segments are looked up by the file they map, so clients carving many
+ * pixmaps out of one memfd pool map it only once, however often they
+ * attach it. Up to SHM_FD_CACHE_SIZE segments of SHM_FD_CACHE_BYTES in
+ * total stay mapped after their last detach, for clients that attach their
+ * pool per frame.
+ */
+#define SHM_FD_CACHE_SIZE       4
+#define SHM_FD_CACHE_BYTES      (16 << 20)
+
+static int shmFdCached;
+static unsigned long shmFdCachedBytes;
+static Bool shmFaulted;         /* some segment has been truncated */
+#endif
+
 static unsigned char ShmReqCode;
 int ShmCompletionCode;
 int BadShmSegCode;
@@ -219,6 +259,9 @@ ShmResetProc(ExtensionEntry * extEntry)
     DIX_FOR_EACH_SCREEN({
         ShmRegisterFuncs(walkScreen, NULL);
     });
+#ifdef SHM_FD_PASSING
+    ShmFlushFdCache();
+#endif
 }
 
 void
@@ -388,18 +431,18 @@ ProcShmAttach(ClientPtr client)
     return Success;
 }
 
- /*ARGSUSED*/ static int
-ShmDetachSegment(void *value, /* must conform to DeleteType */
-                 XID unused)
+static void
+ShmUnlinkSegment(ShmDescPtr shmdesc)
 {
-    ShmDescPtr shmdesc = (ShmDescPtr) value;
     ShmDescPtr *prev;
 
-    if (!shmdesc)
-        return Success;
+    for (prev = &Shmsegs; *prev != shmdesc; prev = &(*prev)->next);
+    *prev = shmdesc->next;
+}
 
-    if (--shmdesc->refcnt)
-        return TRUE;
+static void
+ShmUnmapSegment(ShmDescPtr shmdesc)
+{
 #if SHM_FD_PASSING
     if (shmdesc->is_fd) {
         if (shmdesc->busfault)
@@ -408,9 +451,82 @@ ShmDetachSegment(void *value, /* must conform to DeleteType */
     } else
 #endif
         shmdt(shmdesc->addr);
-    for (prev = &Shmsegs; *prev != shmdesc; prev = &(*prev)->next);
-    *prev = shmdesc->next;
+    ShmUnlinkSegment(shmdesc);
     free(shmdesc);
+}
+
+#ifdef SHM_FD_PASSING
+static void
+ShmUncacheSegment(ShmDescPtr shmdesc)
+{
+    shmFdCached--;
+    shmFdCachedBytes -= shmdesc->size;
+}
+
+/*
+ * Keep an fd segment mapped after its last detach, evicting the one that
+ * has been unused the longest if the cache is full. Returns FALSE if the
+ * segment must be unmapped instead.
+ */
+static Bool
+ShmCacheSegment(ShmDescPtr shmdesc)
+{
+    ShmDescPtr oldest = NULL;
+
+    if (!shmdesc->is_fd || !shmdesc->busfault ||
+        shmdesc->size > SHM_FD_CACHE_BYTES)
+        return FALSE;
+
+    /* the list is kept in most recently used order */
+    ShmUnlinkSegment(shmdesc);
+    shmdesc->next = Shmsegs;
+    Shmsegs = shmdesc;
+    shmFdCached++;
+    shmFdCachedBytes += shmdesc->size;
+
+    while (shmFdCached > SHM_FD_CACHE_SIZE ||
+           shmFdCachedBytes > SHM_FD_CACHE_BYTES) {
+        for (ShmDescPtr desc = shmdesc->next; desc; desc = desc->next)
+            if (!desc->refcnt)
+                oldest = desc;
+        ShmUncacheSegment(oldest);
+        ShmUnmapSegment(oldest);
+        oldest = NULL;
+    }
+    return TRUE;
+}
+
+static void
+ShmFlushFdCache(void)
+{
+    ShmDescPtr shmdesc, next;
+
+    for (shmdesc = Shmsegs; shmdesc; shmdesc = next) {
+        next = shmdesc->next;
+        if (!shmdesc->refcnt)
+            ShmUnmapSegment(shmdesc);
+    }
+    shmFdCached = 0;
+    shmFdCachedBytes = 0;
+}
+#endif
+
+ /*ARGSUSED*/ static int
+ShmDetachSegment(void *value, /* must conform to DeleteType */
+                 XID unused)
+{
+    ShmDescPtr shmdesc = (ShmDescPtr) value;
+
+    if (!shmdesc)
+        return Success;
+
+    if (--shmdesc->refcnt)
+        return TRUE;
+#ifdef SHM_FD_PASSING
+    if (ShmCacheSegment(shmdesc))
+        return Success;
+#endif
+    ShmUnmapSegment(shmdesc);
     return Success;
 }
 
@@ -480,6 +596,139 @@ doShmPutImage(DrawablePtr dst, GCPtr pGC,
     }
 }
 
+static void
+ShmSendCompletion(ClientPtr client, xShmPutImageReq *stuff)
+{
+    xShmCompletionEvent ev = {
+        .type = ShmCompletionCode,
+        .drawable = stuff->drawable,
+        .minorEvent = X_ShmPutImage,
+        .majorEvent = ShmReqCode,
+        .shmseg = stuff->shmseg,
+        .offset = stuff->offset
+    };
+    WriteEventsToClient(client, 1, (xEvent *) &ev);
+}
+
+/*
+ * Put rows [y, y + h) of the source rectangle of a ZPixmap ShmPutImage.
+ */
+static void
+ShmPutImageRows(DrawablePtr pDraw, GCPtr pGC, xShmPutImageReq *stuff,
+                ShmDescPtr shmdesc, long length, int y, int h)
+{
+    if (stuff->srcX == 0 && stuff->srcWidth == stuff->totalWidth)
+        (*pGC->ops->PutImage) (pDraw, pGC, stuff->depth,
+                               stuff->dstX, stuff->dstY + y,
+                               stuff->totalWidth, h, 0, ZPixmap,
+                               shmdesc->addr + stuff->offset +
+                               ((stuff->srcY + y) * length));
+    else
+        doShmPutImage(pDraw, pGC, stuff->depth, ZPixmap,
+                      stuff->totalWidth, stuff->totalHeight,
+                      stuff->srcX, stuff->srcY + y,
+                      stuff->srcWidth, h,
+                      stuff->dstX, stuff->dstY + y,
+                      shmdesc->addr + stuff->offset);
+}
+
+static Bool
+ShmPutImageContinue(ClientPtr client, void *closure)
+{
+    ShmPutImageJobPtr job = closure;
+    xShmPutImageReq *stuff = &job->req;
+    DrawablePtr pDraw;
+    GCPtr pGC;
+
+    if (client->clientGone)
+        goto done;
+
+    /* the drawable may have been destroyed by another client meanwhile */
+    if (dixLookupDrawable(&pDraw, stuff->drawable, client, M_ANY,
+                          DixWriteAccess) == Success &&
+        dixLookupGC(&pGC, stuff->gc, client, DixUseAccess) == Success &&
+        pGC->depth == pDraw->depth && pGC->pScreen == pDraw->pScreen) {
+        int h = min(job->rows, stuff->srcHeight - job->y);
+
+        if (pGC->serialNumber != pDraw->serialNumber)
+            ValidateGC(pDraw, pGC);
+
+        ShmPutImageRows(pDraw, pGC, stuff, job->shmdesc, job->length,
+                        job->y, h);
+        job->y += h;
+        if (job->y < stuff->srcHeight)
+            return FALSE;
+    }
+
+    if (stuff->sendEvent)
+        ShmSendCompletion(client, stuff);
+    AttendClient(client);
+
+ done:
+    ShmDetachSegment(job->shmdesc, 0);
+    shmPutImageJobs--;
+    free(job);
+    return TRUE;
+}
+
+/*
+ * Put the first strip of a large image and queue the rest. Returns FALSE
+ * if the image should be put synchronously instead.
+ */
+static Bool
+ShmPutImageAsync(ClientPtr client, DrawablePtr pDraw, GCPtr pGC,
+                 xShmPutImageReq *stuff, ShmDescPtr shmdesc, long length)
+{
+    ShmPutImageJobPtr job;
+    int rows = max(SHM_ASYNC_STRIP_SIZE / length, 1);
+
+    if (!dixSettingShmPutImageStrips || stuff->format != ZPixmap ||
+        length * stuff->srcHeight <= SHM_ASYNC_SIZE ||
+        rows >= stuff->srcHeight)
+        return FALSE;
+
+#ifdef XINERAMA
+    /* the request is replayed for each screen */
+    if (!PanoramiXIsDisabled())
+        return FALSE;
+#endif
+
+    job = calloc(1, sizeof(*job));
+    if (!job)
+        return FALSE;
+
+    job->req = *stuff;
+    job->shmdesc = shmdesc;
+    job->length = length;
+    job->rows = rows;
+
+    if (!QueueWorkProc(ShmPutImageContinue, client, job)) {
+        free(job);
+        return FALSE;
+    }
+
+    shmdesc->refcnt++;
+    shmPutImageJobs++;
+    IgnoreClient(client);
+
+    ShmPutImageRows(pDraw, pGC, stuff, shmdesc, length, 0, job->rows);
+    job->y = job->rows;
+
+    return TRUE;
+}
+
+static void
+ShmBlockHandler(void *data, void *timeout)
+{
+    /* don't sleep while there are images left to put */
+    if (shmPutImageJobs)
+        AdjustWaitForDelay(timeout, 0);
+#ifdef SHM_FD_PASSING
+    if (shmFaulted)
+        ShmFreeFaultedSegments();
+#endif
+}
+
 static int
 ShmPutImage(ClientPtr client, xShmPutImageReq *stuff)
 {
@@ -541,6 +790,9 @@ ShmPutImage(ClientPtr client, xShmPutImageReq *stuff)
         return BadValue;
     }
 
+    if (ShmPutImageAsync(client, pDraw, pGC, stuff, shmdesc, length))
+        return Success;
+
     if ((((stuff->format == ZPixmap) && (stuff->srcX == 0)) ||
          ((stuff->format != ZPixmap) &&
           (stuff->srcX < screenInfo.bitmapScanlinePad) &&
@@ -561,17 +813,8 @@ ShmPutImage(ClientPtr client, xShmPutImageReq *stuff)
                       stuff->srcWidth, stuff->srcHeight,
                       stuff->dstX, stuff->dstY, shmdesc->addr + stuff->offset);
 
-    if (stuff->sendEvent) {
-        xShmCompletionEvent ev = {
-            .type = ShmCompletionCode,
-            .drawable = stuff->drawable,
-            .minorEvent = X_ShmPutImage,
-            .majorEvent = ShmReqCode,
-            .shmseg = stuff->shmseg,
-            .offset = stuff->offset
-        };
-        WriteEventsToClient(client, 1, (xEvent *) &ev);
-    }
+    if (stuff->sendEvent)
+        ShmSendCompletion(client, stuff);
 
     return Success;
 }
@@ -1117,6 +1360,18 @@ ShmCreatePixmap(ClientPtr client, xShmCreatePixmapReq *stuff)
 
 #ifdef SHM_FD_PASSING
 
+static void
+ShmFreeSegmentResource(void *value, XID id, void *cdata)
+{
+    if (value == cdata)
+        FreeResource(id, X11_RESTYPE_NONE);
+}
+
+/*
+ * Called by busfault_check() while it walks the list of busfaults, which
+ * freeing segments would change under it. So only mark the segment here;
+ * ShmBlockHandler() frees it later.
+ */
 static void
 ShmBusfaultNotify(void *context)
 {
@@ -1126,7 +1381,54 @@ ShmBusfaultNotify(void *context)
            (unsigned int) shmdesc->resource);
     busfault_unregister(shmdesc->busfault);
     shmdesc->busfault = NULL;
-    FreeResource (shmdesc->resource, X11_RESTYPE_NONE);
+    shmdesc->faulted = TRUE;
+    shmFaulted = TRUE;
+}
+
+static void
+ShmFreeFaultedSegments(void)
+{
+    ShmDescPtr shmdesc;
+
+    shmFaulted = FALSE;
+
+    /* freeing resources changes the list, start over after each segment */
+    do {
+        for (shmdesc = Shmsegs; shmdesc; shmdesc = shmdesc->next)
+            if (shmdesc->faulted)
+                break;
+        if (!shmdesc)
+            break;
+        shmdesc->faulted = FALSE;
+
+        /* the mapping may be shared by several segments, possibly of
+         * several clients, or be cached with no segment at all */
+        if (!shmdesc->refcnt++)
+            ShmUncacheSegment(shmdesc);
+        for (int i = 0; i < currentMaxClients; i++)
+            if (clients[i])
+                FindClientResourcesByType(clients[i], ShmSegType,
+                                          ShmFreeSegmentResource, shmdesc);
+        ShmDetachSegment(shmdesc, 0);
+    } while (TRUE);
+}
+
+/*
+ * Find a mapping of the file fd refers to, as attached before by this or
+ * another client.
+ */
+static ShmDescPtr
+ShmFindFdSegment(struct stat *statb, Bool readOnly)
+{
+    ShmDescPtr shmdesc;
+
+    for (shmdesc = Shmsegs; shmdesc; shmdesc = shmdesc->next) {
+        if (SHMDESC_IS_FD(shmdesc) && shmdesc->busfault &&
+            shmdesc->dev == statb->st_dev && shmdesc->ino == statb->st_ino &&
+            shmdesc->size == statb->st_size && shmdesc->writable == !readOnly)
+            return shmdesc;
+    }
+    return NULL;
 }
 
 static int
@@ -1157,6 +1459,26 @@ ProcShmAttachFd(ClientPtr client)
         return BadMatch;
     }
 
+    /* a shared mapping must not grant more than the fd does, mmap would
+     * refuse a fresh one too */
+    int accmode = fcntl(fd, F_GETFL);
+    if (accmode < 0 ||
+        ((accmode & O_ACCMODE) != O_RDWR &&
+         ((accmode & O_ACCMODE) != O_RDONLY || !stuff->readOnly))) {
+        close(fd);
+        return BadAccess;
+    }
+
+    shmdesc = ShmFindFdSegment(&statb, stuff->readOnly);
+    if (shmdesc) {
+        close(fd);
+        if (!shmdesc->refcnt++) {
+            ShmUncacheSegment(shmdesc);
+            shmdesc->resource = stuff->shmseg;
+        }
+        goto attach;
+    }
+
     shmdesc = calloc(1, sizeof(ShmDescRec));
     if (!shmdesc) {
         close(fd);
@@ -1178,6 +1500,8 @@ ProcShmAttachFd(ClientPtr client)
     shmdesc->writable = !stuff->readOnly;
     shmdesc->size = statb.st_size;
     shmdesc->resource = stuff->shmseg;
+    shmdesc->dev = statb.st_dev;
+    shmdesc->ino = statb.st_ino;
 
     shmdesc->busfault = busfault_register_mmap(shmdesc->addr, shmdesc->size, ShmBusfaultNotify, shmdesc);
     if (!shmdesc->busfault) {
@@ -1189,6 +1513,7 @@ ProcShmAttachFd(ClientPtr client)
     shmdesc->next = Shmsegs;
     Shmsegs = shmdesc;
 
+ attach:
     if (!AddResource(stuff->shmseg, ShmSegType, (void *) shmdesc))
         return BadAlloc;
     return Success;
@@ -1260,6 +1585,7 @@ ProcShmCreateSegment(ClientPtr client)
 
     int fd;
     ShmDescPtr shmdesc;
+    struct stat statb;
 
     LEGAL_NEW_RESOURCE(stuff->shmseg, client);
     if ((stuff->readOnly != xTrue) && (stuff->readOnly != xFalse)) {
@@ -1269,7 +1595,7 @@ ProcShmCreateSegment(ClientPtr client)
     fd = shm_tmpfile();
     if (fd < 0)
         return BadAlloc;
-    if (ftruncate(fd, stuff->size) < 0) {
+    if (ftruncate(fd, stuff->size) < 0 || fstat(fd, &statb) < 0) {
         close(fd);
         return BadAlloc;
     }
@@ -1293,6 +1619,9 @@ ProcShmCreateSegment(ClientPtr client)
     shmdesc->refcnt = 1;
     shmdesc->writable = !stuff->readOnly;
     shmdesc->size = stuff->size;
+    shmdesc->resource = stuff->shmseg;
+    shmdesc->dev = statb.st_dev;
+    shmdesc->ino = statb.st_ino;
 
     shmdesc->busfault = busfault_register_mmap(shmdesc->addr, shmdesc->size, ShmBusfaultNotify, shmdesc);
     if (!shmdesc->busfault) {
@@ -1413,5 +1742,12 @@ ShmExtensionInit(void)
         BadShmSegCode = extEntry->errorBase;
         SetResourceTypeErrorValue(ShmSegType, BadShmSegCode);
         EventSwapVector[ShmCompletionCode] = (EventSwapPtr) SShmCompletionEvent;
+        shmPutImageJobs = 0;
+#ifdef SHM_FD_PASSING
+        ShmFlushFdCache();
+#endif
+        RegisterBlockAndWakeupHandlers(ShmBlockHandler,
+                                       (ServerWakeupHandlerProcPtr) NoopDDA,
+                                       NULL);
     }
 }
@@ -6,6 +6,8 @@
 #ifndef _XSERVER_XEXT_SHM_PRIV_H
 #define _XSERVER_XEXT_SHM_PRIV_H
 
+#include <sys/types.h>
+
 #include "include/resource.h"
 #include "include/shmint.h"
 
@@ -19,7 +21,10 @@ typedef struct _ShmDesc {
 #ifdef SHM_FD_PASSING
     Bool is_fd;
     struct busfault *busfault;
+    Bool faulted;               /* truncated, to be freed */
     XID resource;
+    dev_t dev;                  /* identify the file mapped, so attaching */
+    ino_t ino;                  /* it again can share the mapping */
 #endif
 } ShmDescRec, *ShmDescPtr;
 
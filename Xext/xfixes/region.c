@@ -22,6 +22,7 @@
 
 #include <dix-config.h>
 
+#include "dix/client_priv.h"
 #include "dix/dix_priv.h"
 #include "dix/request_priv.h"
 #include "dix/rpcbuf_priv.h"
@@ -39,6 +40,34 @@
 
 RESTYPE RegionResType;
 
+/*
+ * Scratch registers of EvaluateRegions, allocated for each client on its
+ * first program. They live across requests so that their rectangle
+ * storage gets reused, unless it grew unusually large.
+ */
+static DevPrivateKeyRec XFixesRegistersPrivateKeyRec;
+
+#define GetXFixesRegisters(pClient) ((RegionPtr) \
+    dixLookupPrivate(&(pClient)->devPrivates, &XFixesRegistersPrivateKeyRec))
+
+#define XFIXES_REGISTER_KEEP_RECTS 256
+
+static void
+XFixesRegistersClientDestroy(CallbackListPtr *pcbl, void *unused,
+                             void *calldata)
+{
+    ClientPtr client = calldata;
+    RegionPtr registers = GetXFixesRegisters(client);
+
+    if (!registers)
+        return;
+
+    for (int i = 0; i < XFixesNumRegionRegisters; i++)
+        RegionUninit(&registers[i]);
+    free(registers);
+    dixSetPrivate(&client->devPrivates, &XFixesRegistersPrivateKeyRec, NULL);
+}
+
 static int
 RegionResFree(void *data, XID id)
 {
@@ -68,6 +97,13 @@ XFixesRegionInit(void)
 {
     RegionResType = CreateNewResourceType(RegionResFree, "XFixesRegion");
 
+    if (!dixRegisterPrivateKey(&XFixesRegistersPrivateKeyRec,
+                               PRIVATE_CLIENT, 0))
+        return FALSE;
+    if (!AddCallback(&ClientDestroyCallback, XFixesRegistersClientDestroy,
+                     NULL))
+        return FALSE;
+
     return RegionResType != 0;
 }
 
@@ -653,6 +689,229 @@ ProcXFixesExpandRegion(ClientPtr client)
     return Success;
 }
 
+/* box of x, y, width, height, limited to 16 bits like InvertRegion */
+static void
+XFixesOpBox(const xXFixesRegionOp *op, BoxPtr box)
+{
+    box->x1 = op->x;
+    box->y1 = op->y;
+    box->x2 = min((int) op->x + (int) op->width, MAXSHORT);
+    box->y2 = min((int) op->y + (int) op->height, MAXSHORT);
+}
+
+/*
+ * Check a program before running it, so that it either fails before
+ * touching any region or runs to completion (barring allocation
+ * failures). Registers must be written before they are read, so a program
+ * never sees what an earlier one left in them.
+ */
+static int
+XFixesCheckRegionOps(ClientPtr client, xXFixesRegionOp *ops, int numOps,
+                     CARD8 result)
+{
+    CARD32 defined = 0;
+
+    for (int i = 0; i < numOps; i++) {
+        xXFixesRegionOp *op = &ops[i];
+        RegionPtr pRegion;
+        CARD32 uses = 0;
+        Bool writes = TRUE;
+
+        switch (op->op) {
+        case XFixesRegionOpLoad:
+            VERIFY_REGION(pRegion, op->region, client, DixReadAccess);
+            break;
+        case XFixesRegionOpRectangle:
+            break;
+        case XFixesRegionOpUnion:
+        case XFixesRegionOpIntersect:
+        case XFixesRegionOpSubtract:
+            if (op->src2 >= XFixesNumRegionRegisters) {
+                client->errorValue = op->src2;
+                return BadValue;
+            }
+            uses = 1 << op->src2;
+            /* fall through */
+        case XFixesRegionOpInvert:
+        case XFixesRegionOpTranslate:
+        case XFixesRegionOpExtents:
+            if (op->src1 >= XFixesNumRegionRegisters) {
+                client->errorValue = op->src1;
+                return BadValue;
+            }
+            uses |= 1 << op->src1;
+            break;
+        case XFixesRegionOpStore:
+            VERIFY_REGION(pRegion, op->region, client, DixWriteAccess);
+            if (op->src1 >= XFixesNumRegionRegisters) {
+                client->errorValue = op->src1;
+                return BadValue;
+            }
+            uses = 1 << op->src1;
+            writes = FALSE;
+            break;
+        default:
+            client->errorValue = op->op;
+            return BadValue;
+        }
+
+        if ((uses & defined) != uses)
+            return BadMatch;
+
+        if (writes) {
+            if (op->dst >= XFixesNumRegionRegisters) {
+                client->errorValue = op->dst;
+                return BadValue;
+            }
+            defined |= 1 << op->dst;
+        }
+    }
+
+    if (result >= XFixesNumRegionRegisters) {
+        client->errorValue = result;
+        return BadValue;
+    }
+    if (!(defined & (1 << result)))
+        return BadMatch;
+
+    return Success;
+}
+
+static Bool
+XFixesRunRegionOp(ClientPtr client, RegionPtr registers,
+                  const xXFixesRegionOp *op)
+{
+    RegionPtr dst = &registers[op->dst];
+    RegionPtr src1 = &registers[op->src1];
+    RegionPtr src2 = &registers[op->src2];
+    RegionPtr pRegion;
+    BoxRec box;
+
+    switch (op->op) {
+    case XFixesRegionOpLoad:
+        dixLookupResourceByType((void **) &pRegion, op->region, RegionResType,
+                                client, DixReadAccess);
+        return RegionCopy(dst, pRegion);
+    case XFixesRegionOpRectangle:
+        XFixesOpBox(op, &box);
+        if (box.x1 >= box.x2 || box.y1 >= box.y2)
+            RegionEmpty(dst);
+        else
+            RegionReset(dst, &box);
+        return TRUE;
+    case XFixesRegionOpUnion:
+        return RegionUnion(dst, src1, src2);
+    case XFixesRegionOpIntersect:
+        return RegionIntersect(dst, src1, src2);
+    case XFixesRegionOpSubtract:
+        return RegionSubtract(dst, src1, src2);
+    case XFixesRegionOpInvert:
+        XFixesOpBox(op, &box);
+        return RegionInverse(dst, src1, &box);
+    case XFixesRegionOpTranslate:
+        if (dst != src1 && !RegionCopy(dst, src1))
+            return FALSE;
+        RegionTranslate(dst, op->x, op->y);
+        return TRUE;
+    case XFixesRegionOpExtents:
+        box = *RegionExtents(src1);
+        RegionReset(dst, &box);
+        return TRUE;
+    case XFixesRegionOpStore:
+        dixLookupResourceByType((void **) &pRegion, op->region, RegionResType,
+                                client, DixWriteAccess);
+        return RegionCopy(pRegion, src1);
+    }
+    return FALSE;
+}
+
+int
+ProcXFixesEvaluateRegions(ClientPtr client)
+{
+    X_REQUEST_HEAD_AT_LEAST(xXFixesEvaluateRegionsReq);
+
+    int numOps = (client->req_len << 2) - sizeof(xXFixesEvaluateRegionsReq);
+    if (numOps % sz_xXFixesRegionOp)
+        return BadLength;
+    numOps /= sz_xXFixesRegionOp;
+
+    xXFixesRegionOp *ops = (xXFixesRegionOp *) (stuff + 1);
+    if (client->swapped) {
+        for (int i = 0; i < numOps; i++) {
+            swapl(&ops[i].region);
+            swaps(&ops[i].x);
+            swaps(&ops[i].y);
+            swaps(&ops[i].width);
+            swaps(&ops[i].height);
+        }
+    }
+
+    int rc = XFixesCheckRegionOps(client, ops, numOps, stuff->result);
+    if (rc != Success)
+        return rc;
+
+    RegionPtr registers = GetXFixesRegisters(client);
+    if (!registers) {
+        registers = calloc(XFixesNumRegionRegisters, sizeof(RegionRec));
+        if (!registers)
+            return BadAlloc;
+        for (int i = 0; i < XFixesNumRegionRegisters; i++)
+            RegionNull(&registers[i]);
+        dixSetPrivate(&client->devPrivates, &XFixesRegistersPrivateKeyRec,
+                      registers);
+    }
+
+    for (int i = 0; i < numOps; i++) {
+        if (!XFixesRunRegionOp(client, registers, &ops[i])) {
+            rc = BadAlloc;
+            break;
+        }
+    }
+
+    if (rc == Success) {
+        RegionPtr pRegion = &registers[stuff->result];
+        BoxPtr pExtent = RegionExtents(pRegion);
+        BoxPtr pBox = RegionRects(pRegion);
+        int nBox = RegionNumRects(pRegion);
+
+        x_rpcbuf_t rpcbuf = { .swapped = client->swapped, .err_clear = TRUE };
+
+        for (int i = 0; i < nBox; i++) {
+            x_rpcbuf_write_rect(&rpcbuf,
+                                pBox[i].x1,
+                                pBox[i].y1,
+                                pBox[i].x2 - pBox[i].x1,
+                                pBox[i].y2 - pBox[i].y1);
+        }
+
+        xXFixesFetchRegionReply reply = {
+            .x = pExtent->x1,
+            .y = pExtent->y1,
+            .width = pExtent->x2 - pExtent->x1,
+            .height = pExtent->y2 - pExtent->y1,
+        };
+
+        X_REPLY_FIELD_CARD16(x);
+        X_REPLY_FIELD_CARD16(y);
+        X_REPLY_FIELD_CARD16(width);
+        X_REPLY_FIELD_CARD16(height);
+
+        rc = X_SEND_REPLY_WITH_RPCBUF(client, reply, rpcbuf);
+    }
+
+    /* give back storage a large program left behind */
+    for (int i = 0; i < XFixesNumRegionRegisters; i++) {
+        RegionPtr pReg = &registers[i];
+
+        if (pReg->data && pReg->data->size > XFIXES_REGISTER_KEEP_RECTS) {
+            RegionUninit(pReg);
+            RegionNull(pReg);
+        }
+    }
+
+    return rc;
+}
+
 #ifdef XINERAMA
 
 static int
@@ -203,6 +203,51 @@ ProcXFixesDispatch(ClientPtr client)
     }
 }
 
+static int
+ProcXFixesRegionsQueryVersion(ClientPtr client)
+{
+    X_REQUEST_HEAD_STRUCT(xXFixesRegionsQueryVersionReq);
+    X_REQUEST_FIELD_CARD32(majorVersion);
+    X_REQUEST_FIELD_CARD32(minorVersion);
+
+    XFixesClientPtr pXFixesClient = GetXFixesClient(client);
+
+    if (stuff->majorVersion < XFIXES_REGIONS_MAJOR_VERSION) {
+        client->errorValue = stuff->majorVersion;
+        return BadValue;
+    }
+
+    xXFixesRegionsQueryVersionReply reply = {
+        .majorVersion = XFIXES_REGIONS_MAJOR_VERSION,
+        .minorVersion = XFIXES_REGIONS_MINOR_VERSION,
+    };
+
+    pXFixesClient->regions_major_version = reply.majorVersion;
+
+    X_REPLY_FIELD_CARD32(majorVersion);
+    X_REPLY_FIELD_CARD32(minorVersion);
+
+    return X_SEND_REPLY_SIMPLE(client, reply);
+}
+
+static int
+ProcXFixesRegionsDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    XFixesClientPtr pXFixesClient = GetXFixesClient(client);
+
+    switch (stuff->data) {
+        case X_XFixesRegionsQueryVersion:
+            return ProcXFixesRegionsQueryVersion(client);
+        case X_XFixesEvaluateRegions:
+            if (!pXFixesClient->regions_major_version)
+                return BadRequest;
+            return ProcXFixesEvaluateRegions(client);
+        default:
+            return BadRequest;
+    }
+}
+
 void
 XFixesExtensionInit(void)
 {
@@ -230,6 +275,10 @@ XFixesExtensionInit(void)
         SetResourceTypeErrorValue(RegionResType, XFixesErrorBase + BadRegion);
         SetResourceTypeErrorValue(PointerBarrierType,
                                   XFixesErrorBase + BadBarrier);
+
+        AddExtension(XFIXES_REGIONS_NAME, 0, 0,
+                     ProcXFixesRegionsDispatch, ProcXFixesRegionsDispatch,
+                     NULL, StandardMinorOpcode);
     }
 }
 
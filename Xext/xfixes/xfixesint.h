@@ -52,6 +52,7 @@
 #include "dix/selection_priv.h"
 #include "include/misc.h"
 #include "Xext/xfixes/xfixes.h"
+#include "Xext/xfixes/xfixesregionsproto.h"
 
 #include "os.h"
 #include "dixstruct.h"
@@ -63,6 +64,7 @@ extern int XFixesUseXinerama;
 
 typedef struct _XFixesClient {
     CARD32 major_version;
+    CARD32 regions_major_version;       /* X-FIXES-REGIONS, 0 until queried */
 } XFixesClientRec, *XFixesClientPtr;
 
 #define GetXFixesClient(pClient) ((XFixesClientPtr)dixLookupPrivate(&(pClient)->devPrivates, XFixesClientPrivateKey))
@@ -201,6 +203,10 @@ int
 Bool
  XFixesShouldDisconnectClient(ClientPtr client);
 
+/* X-FIXES-REGIONS */
+int
+ ProcXFixesEvaluateRegions(ClientPtr client);
+
 /* Xinerama */
 #ifdef XINERAMA
 void PanoramiXFixesInit(void);
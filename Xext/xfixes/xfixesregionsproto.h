@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * X-FIXES-REGIONS extension - protocol definitions
+ *
+ * A server-private companion to XFIXES: EvaluateRegions runs a program of
+ * region operations on the requesting client's scratch registers in one
+ * request, so that compositors can combine damage without creating,
+ * combining and destroying a region resource per step. XFIXES region
+ * resources are only touched by explicit Load and Store operations; the
+ * reply carries the contents of the result register in the format of the
+ * XFIXES FetchRegion reply.
+ *
+ * fixesproto defines no such request, so rather than taking an XFIXES
+ * request number and version this lives in its own extension, with the
+ * wire definitions kept here.
+ */
+#ifndef _XSERVER_XFIXESREGIONSPROTO_H
+#define _XSERVER_XFIXESREGIONSPROTO_H
+
+#include <X11/Xmd.h>
+
+#define XFIXES_REGIONS_NAME             "X-FIXES-REGIONS"
+#define XFIXES_REGIONS_MAJOR_VERSION    1
+#define XFIXES_REGIONS_MINOR_VERSION    0
+
+/* request opcodes (minor) */
+#define X_XFixesRegionsQueryVersion     0
+#define X_XFixesEvaluateRegions         1
+
+#define XFixesRegionOpLoad       0  /* dst = region */
+#define XFixesRegionOpRectangle  1  /* dst = x, y, width, height */
+#define XFixesRegionOpUnion      2  /* dst = src1 + src2 */
+#define XFixesRegionOpIntersect  3  /* dst = src1 * src2 */
+#define XFixesRegionOpSubtract   4  /* dst = src1 - src2 */
+#define XFixesRegionOpInvert     5  /* dst = (x, y, width, height) - src1 */
+#define XFixesRegionOpTranslate  6  /* dst = src1 moved by x, y */
+#define XFixesRegionOpExtents    7  /* dst = extents of src1 */
+#define XFixesRegionOpStore      8  /* region = src1 */
+
+#define XFixesNumRegionRegisters 16
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 xfixesRegionsReqType;         /* X_XFixesRegionsQueryVersion */
+    CARD16 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+} xXFixesRegionsQueryVersionReq;
+
+#define sz_xXFixesRegionsQueryVersionReq 12
+
+typedef struct {
+    BYTE type;
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+} xXFixesRegionsQueryVersionReply;
+
+typedef struct {
+    CARD8 op;
+    CARD8 dst;
+    CARD8 src1;
+    CARD8 src2;
+    CARD32 region;
+    INT16 x;
+    INT16 y;
+    CARD16 width;
+    CARD16 height;
+} xXFixesRegionOp;
+
+#define sz_xXFixesRegionOp 16
+
+/* followed by a list of xXFixesRegionOp */
+typedef struct {
+    CARD8 reqType;
+    CARD8 xfixesRegionsReqType;         /* X_XFixesEvaluateRegions */
+    CARD16 length;
+    CARD8 result;
+    CARD8 pad1;
+    CARD16 pad2;
+} xXFixesEvaluateRegionsReq;
+
+#define sz_xXFixesEvaluateRegionsReq 8
+
+#endif /* _XSERVER_XFIXESREGIONSPROTO_H */
@@ -31,6 +31,9 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
 #include <X11/X.h>
 #include <X11/Xos.h>
 #include <X11/Xproto.h>
@@ -41,6 +44,7 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "dix/dix_priv.h"
 #include "os/log_priv.h"
 #include "os/osdep.h"
+#include "os/xsha1.h"
 #include "xkbfile_priv.h"
 #include "xkbfmisc_priv.h"
 #include "xkbrules_priv.h"
@@ -61,10 +65,20 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #define PATHSEPARATOR "/"
 #endif
 
+/* compiled keymaps kept in the output directory, least recently used go */
+#define XKB_CACHE_MAX_ENTRIES   32
+#define XKB_CACHE_PREFIX        "xkm-cache-"
+
 static unsigned
-LoadXKM(unsigned want, unsigned need, const char *keymap, XkbDescPtr *xkbRtrn);
+LoadXKM(unsigned want, unsigned need, const char *keymap, Bool keep,
+        XkbDescPtr *xkbRtrn);
 
-static void
+/**
+ * Fill outdir with the directory compiled keymaps are written to. Returns
+ * TRUE if that directory is private to the server (or its user), i.e. it is
+ * safe to keep compiled keymaps there and load them again later.
+ */
+static Bool
 OutputDirectory(char *outdir, size_t size)
 {
     const char *directory = NULL;
@@ -96,7 +110,37 @@ OutputDirectory(char *outdir, size_t size)
     if (r < 0 || r >= size) {
         assert(strlen("/tmp/") < size);
         strcpy(outdir, "/tmp/");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Build the path of the compiled keymap mapName in the output directory.
+ * Returns FALSE if the path doesn't fit into buf.
+ */
+static Bool
+XkmPath(const char *mapName, char *buf, size_t size)
+{
+    char xkm_output_dir[PATH_MAX] = { 0 };
+    int r;
+
+    OutputDirectory(xkm_output_dir, sizeof(xkm_output_dir));
+    if ((XkbBaseDirectory != NULL) && (xkm_output_dir[0] != '/')
+#ifdef WIN32
+        && (!isalpha(xkm_output_dir[0]) || xkm_output_dir[1] != ':')
+#endif
+        )
+        r = snprintf(buf, size, "%s/%s%s.xkm", XkbBaseDirectory,
+                     xkm_output_dir, mapName);
+    else
+        r = snprintf(buf, size, "%s%s.xkm", xkm_output_dir, mapName);
+
+    if (r < 0 || r >= size) {
+        buf[0] = '\0';
+        return FALSE;
     }
+    return TRUE;
 }
 
 /**
@@ -104,17 +148,251 @@ OutputDirectory(char *outdir, size_t size)
  */
 typedef void (*xkbcomp_buffer_callback)(FILE *out, void *userdata);
 
+/**
+ * Let the callback write the xkbcomp input into a temporary file and return
+ * its contents, so it can be both hashed and fed to xkbcomp.
+ */
+static char *
+XkbCompInput(xkbcomp_buffer_callback callback, void *userdata, size_t *len)
+{
+    FILE *tmp;
+    char *input = NULL;
+    long size;
+
+    tmp = tmpfile();
+    if (!tmp)
+        return NULL;
+
+    (*callback)(tmp, userdata);
+
+    if (fflush(tmp) == 0 && (size = ftell(tmp)) >= 0 &&
+        fseek(tmp, 0, SEEK_SET) == 0 && (input = malloc(size + 1))) {
+        if (fread(input, 1, size, tmp) == size) {
+            input[size] = '\0';
+            *len = size;
+        }
+        else {
+            free(input);
+            input = NULL;
+        }
+    }
+
+    fclose(tmp);
+    return input;
+}
+
+/*
+ * Add up a stamp of every file below path: its name, size, mtime and
+ * inode. Summing makes the result independent of the order readdir returns
+ * the entries in. xkbcomp follows includes into any of the files, so all of
+ * them count, and editing one in place changes the stamp even though the
+ * directory's own mtime stays the same.
+ */
+static void
+XkbStampDir(const char *path, int depth, CARD64 *sum, CARD64 *count)
+{
+    DIR *dir;
+    struct dirent *entry;
+
+    if (depth > 3 || !(dir = opendir(path)))
+        return;
+
+    while ((entry = readdir(dir))) {
+        char file[PATH_MAX];
+        struct stat st;
+        CARD64 stamp = 14695981039346656037ULL;
+        const char *c;
+
+        if (entry->d_name[0] == '.' ||
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name) >=
+            sizeof(file) || stat(file, &st) != 0)
+            continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            XkbStampDir(file, depth + 1, sum, count);
+            continue;
+        }
+
+        for (c = file; *c; c++)
+            stamp = (stamp ^ (unsigned char) *c) * 1099511628211ULL;
+        stamp = (stamp ^ (CARD64) st.st_size) * 1099511628211ULL;
+        stamp = (stamp ^ (CARD64) st.st_mtime) * 1099511628211ULL;
+        stamp = (stamp ^ (CARD64) st.st_ino) * 1099511628211ULL;
+        *sum += stamp;
+        (*count)++;
+    }
+    closedir(dir);
+}
+
+static const char *xkbDataDirs[] = {
+    "rules", "keycodes", "types", "compat", "symbols", "geometry",
+};
+
+/* stamps of xkbDataDirs, taken by XkbStampData() */
+static CARD64 xkbDataStamp[ARRAY_SIZE(xkbDataDirs)][2];
+static unsigned long xkbDataStampGeneration;
+
+/*
+ * Walking the data directories costs more than a cache hit saves, so the
+ * stamp is only taken once per server generation and again whenever a
+ * compile misses the cache. Files changed while the server runs are thus
+ * picked up by the next keymap that is not cached yet, or the next reset.
+ */
+static void
+XkbStampData(void)
+{
+    char path[PATH_MAX];
+    int i;
+
+    memset(xkbDataStamp, 0, sizeof(xkbDataStamp));
+    for (i = 0; i < ARRAY_SIZE(xkbDataDirs); i++) {
+        if (XkbBaseDirectory &&
+            snprintf(path, sizeof(path), "%s/%s", XkbBaseDirectory,
+                     xkbDataDirs[i]) < sizeof(path))
+            XkbStampDir(path, 0, &xkbDataStamp[i][0], &xkbDataStamp[i][1]);
+    }
+    xkbDataStampGeneration = serverGeneration;
+}
+
+/**
+ * Compute the name a compiled keymap is cached under: a hash of the
+ * xkbcomp input (i.e. the KcCGST component names, or the keymap source)
+ * plus everything else that affects its output, namely the compiler used
+ * and the state of the files in the XKB data directories. Changing any of
+ * those files, by a package update or by hand, thereby retires the stale
+ * cache entries.
+ */
+static Bool
+XkbCacheName(const char *input, size_t len, const char *compiler,
+             char *name, size_t size)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    unsigned char sha1[20];
+    char sha1Asc[sizeof(sha1) * 2 + 1];
+    void *ctx;
+    int i;
+
+    ctx = x_sha1_init();
+    if (!ctx)
+        return FALSE;
+
+    x_sha1_update(ctx, (void *) input, len);
+    x_sha1_update(ctx, (void *) compiler, strlen(compiler));
+    if (xkbDataStampGeneration != serverGeneration)
+        XkbStampData();
+    x_sha1_update(ctx, xkbDataStamp, sizeof(xkbDataStamp));
+
+    if (!x_sha1_final(ctx, sha1))
+        return FALSE;
+
+    for (i = 0; i < sizeof(sha1); i++) {
+        sha1Asc[i * 2] = hex_digits[sha1[i] >> 4];
+        sha1Asc[i * 2 + 1] = hex_digits[sha1[i] & 0x0f];
+    }
+    sha1Asc[sizeof(sha1Asc) - 1] = '\0';
+
+    return snprintf(name, size, XKB_CACHE_PREFIX "%s", sha1Asc) < size;
+}
+
+typedef struct {
+    char name[64];
+    time_t mtime;
+} XkbCacheEntry;
+
+static int
+XkbCacheEntryCompare(const void *a, const void *b)
+{
+    time_t ta = ((const XkbCacheEntry *) a)->mtime;
+    time_t tb = ((const XkbCacheEntry *) b)->mtime;
+
+    return (ta > tb) - (ta < tb);
+}
+
+/**
+ * Remove the least recently used cache entries from the directory of
+ * cachepath, down to XKB_CACHE_MAX_ENTRIES. Hits touch their entry, so the
+ * mtime tells when an entry was last used. Another server may lose an entry
+ * it is about to load; it compiles the keymap again then.
+ */
+static void
+XkbPruneCache(const char *cachepath)
+{
+    char dirpath[PATH_MAX], file[PATH_MAX];
+    XkbCacheEntry *entries = NULL;
+    size_t num = 0, size = 0, i;
+    struct dirent *entry;
+    char *sep;
+    DIR *dir;
+
+    strlcpy(dirpath, cachepath, sizeof(dirpath));
+    sep = strrchr(dirpath, PATHSEPARATOR[0]);
+    if (!sep)
+        return;
+    *sep = '\0';
+
+    if (!(dir = opendir(dirpath)))
+        return;
+
+    while ((entry = readdir(dir))) {
+        struct stat st;
+
+        if (strncmp(entry->d_name, XKB_CACHE_PREFIX,
+                    strlen(XKB_CACHE_PREFIX)) != 0 ||
+            strlen(entry->d_name) >= sizeof(entries->name) ||
+            snprintf(file, sizeof(file), "%s%s%s", dirpath, PATHSEPARATOR,
+                     entry->d_name) >= sizeof(file) ||
+            stat(file, &st) != 0)
+            continue;
+
+        if (num == size) {
+            XkbCacheEntry *grown = reallocarray(entries, size ? size * 2 : 64,
+                                                sizeof(XkbCacheEntry));
+
+            if (!grown)
+                break;
+            entries = grown;
+            size = size ? size * 2 : 64;
+        }
+        strcpy(entries[num].name, entry->d_name);
+        entries[num].mtime = st.st_mtime;
+        num++;
+    }
+    closedir(dir);
+
+    if (num > XKB_CACHE_MAX_ENTRIES) {
+        qsort(entries, num, sizeof(XkbCacheEntry), XkbCacheEntryCompare);
+        for (i = 0; i < num - XKB_CACHE_MAX_ENTRIES; i++) {
+            if (snprintf(file, sizeof(file), "%s%s%s", dirpath, PATHSEPARATOR,
+                         entries[i].name) < sizeof(file))
+                (void) unlink(file);
+        }
+    }
+    free(entries);
+}
+
 /**
  * Start xkbcomp, let the callback write into xkbcomp's stdin. When done,
  * return a strdup'd copy of the file name we've written to.
+ *
+ * If the keymap cache is enabled and the output directory is private, the
+ * compiled keymap is kept under a content-addressed name and subsequent
+ * requests for the same keymap, from this or any other server sharing the
+ * output directory, skip xkbcomp altogether. *keepRtrn is set if the
+ * returned file is such a cache entry and must not be removed.
  */
 static char *
-RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
+RunXkbComp(xkbcomp_buffer_callback callback, void *userdata, Bool *keepRtrn)
 {
     FILE *out;
     char *buf = NULL;
+    char *input = NULL;
+    size_t input_len = 0;
     char keymap[PATH_MAX] = { 0 };
+    char cached[PATH_MAX] = { 0 };
     char xkm_output_dir[PATH_MAX] = { 0 };
+    char xkmpath[PATH_MAX] = { 0 };
+    char cachepath[PATH_MAX] = { 0 };
+    Bool use_cache, stamped;
 
     const char *emptystring = "";
     char *xkbbasedirflag = NULL;
@@ -130,9 +408,12 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
     const char *xkmfile = "-";
 #endif
 
+    *keepRtrn = FALSE;
+
     snprintf(keymap, sizeof(keymap), "server-%s", display);
 
-    OutputDirectory(xkm_output_dir, sizeof(xkm_output_dir));
+    use_cache = OutputDirectory(xkm_output_dir, sizeof(xkm_output_dir)) &&
+        XkbKeymapCache;
 
 #ifdef WIN32
     strcpy(tmpname, Win32TempDir());
@@ -175,6 +456,43 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
         return NULL;
     }
 
+    input = XkbCompInput(callback, userdata, &input_len);
+    if (!input) {
+        LogMessage(X_ERROR,
+                   "XKB: Could not invoke xkbcomp: failed to buffer input\n");
+        free(buf);
+        return NULL;
+    }
+
+    /* The command line contains the display-specific output file name,
+     * which must not be part of the cache key. */
+    stamped = xkbDataStampGeneration != serverGeneration;
+    if (use_cache)
+        use_cache = XkbCacheName(input, input_len,
+                                 XkbBinDirectory ? XkbBinDirectory : "",
+                                 cached, sizeof(cached)) &&
+            XkmPath(cached, cachepath, sizeof(cachepath));
+
+    /* on a miss, look again with a fresh stamp before compiling, so the
+     * entry is published under the name the current files give */
+    if (use_cache && !stamped && access(cachepath, R_OK) != 0) {
+        XkbStampData();
+        use_cache = XkbCacheName(input, input_len,
+                                 XkbBinDirectory ? XkbBinDirectory : "",
+                                 cached, sizeof(cached)) &&
+            XkmPath(cached, cachepath, sizeof(cachepath));
+    }
+
+    if (use_cache && access(cachepath, R_OK) == 0) {
+        LogMessageVerb(X_INFO, 4, "XKB: Using cached keymap %s\n", cachepath);
+        /* mark it recently used for XkbPruneCache() */
+        (void) utime(cachepath, NULL);
+        free(input);
+        free(buf);
+        *keepRtrn = TRUE;
+        return strdup(cached);
+    }
+
 #ifndef WIN32
     out = Popen(buf, "w");
 #else
@@ -183,7 +501,7 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
 
     if (out != NULL) {
         /* Now write to xkbcomp */
-        (*callback)(out, userdata);
+        fwrite(input, input_len, 1, out);
 
 #ifndef WIN32
         if (Pclose(out) == 0)
@@ -193,10 +511,19 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
         {
             if (xkbDebugFlags)
                 DebugF("[xkb] xkb executes: %s\n", buf);
+            free(input);
             free(buf);
 #ifdef WIN32
             unlink(tmpname);
 #endif
+            /* publish atomically, so concurrent servers never see a
+             * partially written cache entry */
+            if (use_cache && XkmPath(keymap, xkmpath, sizeof(xkmpath)) &&
+                rename(xkmpath, cachepath) == 0) {
+                XkbPruneCache(cachepath);
+                *keepRtrn = TRUE;
+                return strdup(cached);
+            }
             return strdup(keymap);
         }
         else {
@@ -215,6 +542,7 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
         LogMessage(X_ERROR, "Could not open file %s\n", tmpname);
 #endif
     }
+    free(input);
     free(buf);
     return NULL;
 }
@@ -243,7 +571,8 @@ static Bool
 XkbDDXCompileKeymapByNames(XkbDescPtr xkb,
                            XkbComponentNamesPtr names,
                            unsigned want,
-                           unsigned need, char *nameRtrn, int nameRtrnLen)
+                           unsigned need, char *nameRtrn, int nameRtrnLen,
+                           Bool *keepRtrn)
 {
     char *keymap;
     Bool rc = FALSE;
@@ -254,7 +583,7 @@ XkbDDXCompileKeymapByNames(XkbDescPtr xkb,
         .need = need
     };
 
-    keymap = RunXkbComp(xkb_write_keymap_for_names_cb, &ctx);
+    keymap = RunXkbComp(xkb_write_keymap_for_names_cb, &ctx, keepRtrn);
 
     if (keymap) {
         if(nameRtrn)
@@ -289,6 +618,7 @@ XkbDDXLoadKeymapFromString(DeviceIntPtr keybd,
 {
     unsigned int have;
     char *map_name;
+    Bool keep;
     XkbKeymapString map = {
         .keymap = keymap,
         .len = keymap_length
@@ -296,15 +626,24 @@ XkbDDXLoadKeymapFromString(DeviceIntPtr keybd,
 
     *xkbRtrn = NULL;
 
-    map_name = RunXkbComp(xkb_write_keymap_string_cb, &map);
+    map_name = RunXkbComp(xkb_write_keymap_string_cb, &map, &keep);
     if (!map_name) {
         LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
         return 0;
     }
 
-    have = LoadXKM(want, need, map_name, xkbRtrn);
+    have = LoadXKM(want, need, map_name, keep, xkbRtrn);
     free(map_name);
 
+    /* a cache entry that doesn't load is gone now, compile it again */
+    if (!*xkbRtrn && keep) {
+        map_name = RunXkbComp(xkb_write_keymap_string_cb, &map, &keep);
+        if (!map_name)
+            return 0;
+        have = LoadXKM(want, need, map_name, keep, xkbRtrn);
+        free(map_name);
+    }
+
     return have;
 }
 
@@ -312,33 +651,10 @@ static FILE *
 XkbDDXOpenConfigFile(const char *mapName, char *fileNameRtrn, int fileNameRtrnLen)
 {
     char buf[PATH_MAX] = { 0 };
-    char xkm_output_dir[PATH_MAX] = { 0 };
-    FILE *file;
+    FILE *file = NULL;
 
-    buf[0] = '\0';
-    if (mapName != NULL) {
-        OutputDirectory(xkm_output_dir, sizeof(xkm_output_dir));
-        if ((XkbBaseDirectory != NULL) && (xkm_output_dir[0] != '/')
-#ifdef WIN32
-            && (!isalpha(xkm_output_dir[0]) || xkm_output_dir[1] != ':')
-#endif
-            ) {
-            if (snprintf(buf, PATH_MAX, "%s/%s%s.xkm", XkbBaseDirectory,
-                         xkm_output_dir, mapName) >= PATH_MAX)
-                buf[0] = '\0';
-        }
-        else {
-            if (snprintf(buf, PATH_MAX, "%s%s.xkm", xkm_output_dir, mapName)
-                >= PATH_MAX)
-                buf[0] = '\0';
-        }
-        if (buf[0] != '\0')
-            file = fopen(buf, "rb");
-        else
-            file = NULL;
-    }
-    else
-        file = NULL;
+    if (mapName != NULL && XkmPath(mapName, buf, sizeof(buf)))
+        file = fopen(buf, "rb");
     if ((fileNameRtrn != NULL) && (fileNameRtrnLen > 0)) {
         strlcpy(fileNameRtrn, buf, fileNameRtrnLen);
     }
@@ -346,7 +662,8 @@ XkbDDXOpenConfigFile(const char *mapName, char *fileNameRtrn, int fileNameRtrnLe
 }
 
 static unsigned
-LoadXKM(unsigned want, unsigned need, const char *keymap, XkbDescPtr *xkbRtrn)
+LoadXKM(unsigned want, unsigned need, const char *keymap, Bool keep,
+        XkbDescPtr *xkbRtrn)
 {
     FILE *file;
     char fileName[PATH_MAX] = { 0 };
@@ -362,6 +679,7 @@ LoadXKM(unsigned want, unsigned need, const char *keymap, XkbDescPtr *xkbRtrn)
     if (*xkbRtrn == NULL) {
         LogMessage(X_ERROR, "Error loading keymap %s\n", fileName);
         fclose(file);
+        /* never keep a cache entry we can't load */
         (void) unlink(fileName);
         return 0;
     }
@@ -370,7 +688,8 @@ LoadXKM(unsigned want, unsigned need, const char *keymap, XkbDescPtr *xkbRtrn)
                (*xkbRtrn)->defined);
     }
     fclose(file);
-    (void) unlink(fileName);
+    if (!keep)
+        (void) unlink(fileName);
     return (need | want) & (~missing);
 }
 
@@ -382,6 +701,8 @@ XkbDDXLoadKeymapByNames(DeviceIntPtr keybd,
                         XkbDescPtr *xkbRtrn, char *nameRtrn, int nameRtrnLen)
 {
     XkbDescPtr xkb;
+    Bool keep = FALSE;
+    unsigned have;
 
     *xkbRtrn = NULL;
     if ((keybd == NULL) || (keybd->key == NULL) ||
@@ -397,12 +718,22 @@ XkbDDXLoadKeymapByNames(DeviceIntPtr keybd,
         return 0;
     }
     else if (!XkbDDXCompileKeymapByNames(xkb, names, want, need,
-                                         nameRtrn, nameRtrnLen)) {
+                                         nameRtrn, nameRtrnLen, &keep)) {
         LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
         return 0;
     }
 
-    return LoadXKM(want, need, nameRtrn, xkbRtrn);
+    have = LoadXKM(want, need, nameRtrn, keep, xkbRtrn);
+
+    /* a cache entry that doesn't load is gone now, compile it again */
+    if (!*xkbRtrn && keep) {
+        if (!XkbDDXCompileKeymapByNames(xkb, names, want, need,
+                                        nameRtrn, nameRtrnLen, &keep))
+            return 0;
+        have = LoadXKM(want, need, nameRtrn, keep, xkbRtrn);
+    }
+
+    return have;
 }
 
 Bool
@@ -210,8 +210,8 @@ ProcXkbUseExtension(ClientPtr client)
     return X_SEND_REPLY_SIMPLE(client, reply);
 }
 
-int
-ProcXkbSelectEvents(ClientPtr client)
+static int
+XkbSelectEvents(ClientPtr client, DeviceIntPtr *devRtrn)
 {
     X_REQUEST_HEAD_AT_LEAST(xkbSelectEventsReq);
     X_REQUEST_FIELD_CARD16(deviceSpec);
@@ -295,6 +295,7 @@ ProcXkbSelectEvents(ClientPtr client)
         return BadAccess;
 
     CHK_ANY_DEVICE(dev, stuff->deviceSpec, client, DixUseAccess);
+    *devRtrn = dev;
 
     if (((stuff->affectWhich & XkbMapNotifyMask) != 0) && (stuff->affectMap)) {
         client->mapNotifyMask &= ~stuff->affectMap;
@@ -439,6 +440,21 @@ ProcXkbSelectEvents(ClientPtr client)
     return BadAlloc;
 }
 
+int
+ProcXkbSelectEvents(ClientPtr client)
+{
+    DeviceIntPtr dev = NULL;
+    int rc;
+
+    rc = XkbSelectEvents(client, &dev);
+
+    /* masks may have been changed partially before an error was found */
+    if (dev)
+        XkbUpdateInterestMasks(dev);
+
+    return rc;
+}
+
 /**
  * Ring a bell on the given device for the given client.
  */
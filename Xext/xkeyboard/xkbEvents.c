@@ -205,19 +205,23 @@ XkbSendStateNotify(DeviceIntPtr kbd, xkbStateNotify * pSN)
     XkbSrvInfoPtr xkbi;
     XkbStatePtr state = { 0 };
     XkbInterestPtr interest;
-    Time time;
-    register CARD16 changed, bState;
+    xkbStateNotify swapped;
+    Bool have_swapped = FALSE;
+    CARD16 changed;
 
     interest = kbd->xkb_interest;
     if (!interest || !kbd->key || !kbd->key->xkbInfo)
         return;
+    changed = pSN->changed;
+    if (!(XKBDEVICEINFO(kbd)->stateNotifyMask & changed))
+        return;
     xkbi = kbd->key->xkbInfo;
     state = &xkbi->state;
 
     pSN->type = XkbEventCode + XkbEventBase;
     pSN->xkbType = XkbStateNotify;
     pSN->deviceID = kbd->id;
-    pSN->time = time = GetTimeInMillis();
+    pSN->time = GetTimeInMillis();
     pSN->mods = state->mods;
     pSN->baseMods = state->base_mods;
     pSN->latchedMods = state->latched_mods;
@@ -232,22 +236,27 @@ XkbSendStateNotify(DeviceIntPtr kbd, xkbStateNotify * pSN)
     pSN->lookupMods = state->lookup_mods;
     pSN->compatLookupMods = state->compat_lookup_mods;
     pSN->ptrBtnState = state->ptr_buttons;
-    changed = pSN->changed;
-    bState = pSN->ptrBtnState;
 
+    /* The event is identical for all clients but for the sequence number,
+     * so it is built once per byte order. */
     while (interest) {
-        if ((!interest->client->clientGone) &&
-            (interest->client->xkbClientFlags & _XkbClientInitialized) &&
+        ClientPtr client = interest->client;
+
+        if ((!client->clientGone) &&
+            (client->xkbClientFlags & _XkbClientInitialized) &&
             (interest->stateNotifyMask & changed)) {
-            pSN->time = time;
-            pSN->changed = changed;
-            pSN->ptrBtnState = bState;
-            if (interest->client->swapped) {
-                swapl(&pSN->time);
-                swaps(&pSN->changed);
-                swaps(&pSN->ptrBtnState);
+            if (client->swapped) {
+                if (!have_swapped) {
+                    swapped = *pSN;
+                    swapl(&swapped.time);
+                    swaps(&swapped.changed);
+                    swaps(&swapped.ptrBtnState);
+                    have_swapped = TRUE;
+                }
+                xmitClientEvent(client, *(xEvent*)&swapped);
             }
-            xmitClientEvent(interest->client, *(xEvent*)pSN);
+            else
+                xmitClientEvent(client, *(xEvent*)pSN);
         }
         interest = interest->next;
     }
@@ -378,44 +387,47 @@ XkbComputeControlsNotify(DeviceIntPtr kbd,
 void
 XkbSendControlsNotify(DeviceIntPtr kbd, xkbControlsNotify * pCN)
 {
-    int initialized;
-    CARD32 changedControls, enabledControls, enabledChanges = 0;
     XkbSrvInfoPtr xkbi;
     XkbInterestPtr interest;
-    Time time = 0;
+    xkbControlsNotify swapped;
+    Bool have_swapped = FALSE;
+    CARD32 changedControls;
 
     interest = kbd->xkb_interest;
     if (!interest || !kbd->key || !kbd->key->xkbInfo)
         return;
     xkbi = kbd->key->xkbInfo;
 
-    initialized = 0;
-    enabledControls = xkbi->desc->ctrls->enabled_ctrls;
     changedControls = pCN->changedControls;
     pCN->numGroups = xkbi->desc->ctrls->num_groups;
+    if (!(XKBDEVICEINFO(kbd)->ctrlsNotifyMask & changedControls))
+        return;
+
+    pCN->type = XkbEventCode + XkbEventBase;
+    pCN->xkbType = XkbControlsNotify;
+    pCN->deviceID = kbd->id;
+    pCN->time = GetTimeInMillis();
+    pCN->enabledControls = xkbi->desc->ctrls->enabled_ctrls;
+
     while (interest) {
-        if ((!interest->client->clientGone) &&
-            (interest->client->xkbClientFlags & _XkbClientInitialized) &&
+        ClientPtr client = interest->client;
+
+        if ((!client->clientGone) &&
+            (client->xkbClientFlags & _XkbClientInitialized) &&
             (interest->ctrlsNotifyMask & changedControls)) {
-            if (!initialized) {
-                pCN->type = XkbEventCode + XkbEventBase;
-                pCN->xkbType = XkbControlsNotify;
-                pCN->deviceID = kbd->id;
-                pCN->time = time = GetTimeInMillis();
-                enabledChanges = pCN->enabledControlChanges;
-                initialized = 1;
-            }
-            pCN->changedControls = changedControls;
-            pCN->enabledControls = enabledControls;
-            pCN->enabledControlChanges = enabledChanges;
-            pCN->time = time;
-            if (interest->client->swapped) {
-                swapl(&pCN->changedControls);
-                swapl(&pCN->enabledControls);
-                swapl(&pCN->enabledControlChanges);
-                swapl(&pCN->time);
+            if (client->swapped) {
+                if (!have_swapped) {
+                    swapped = *pCN;
+                    swapl(&swapped.changedControls);
+                    swapl(&swapped.enabledControls);
+                    swapl(&swapped.enabledControlChanges);
+                    swapl(&swapped.time);
+                    have_swapped = TRUE;
+                }
+                xmitClientEvent(client, *(xEvent*)&swapped);
             }
-            xmitClientEvent(interest->client, *(xEvent*)pCN);
+            else
+                xmitClientEvent(client, *(xEvent*)pCN);
         }
         interest = interest->next;
     }
@@ -425,41 +437,50 @@ XkbSendControlsNotify(DeviceIntPtr kbd, xkbControlsNotify * pCN)
 static void
 XkbSendIndicatorNotify(DeviceIntPtr kbd, int xkbType, xkbIndicatorNotify * pEv)
 {
-    int initialized;
+    xkbDeviceInfoPtr xkbPrivPtr = XKBDEVICEINFO(kbd);
     XkbInterestPtr interest;
-    Time time = 0;
-    CARD32 state, changed;
+    xkbIndicatorNotify swapped;
+    Bool have_swapped = FALSE;
+    CARD32 changed, interested;
 
     interest = kbd->xkb_interest;
     if (!interest)
         return;
 
-    initialized = 0;
-    state = pEv->state;
     changed = pEv->changed;
+    if (xkbType == XkbIndicatorStateNotify)
+        interested = xkbPrivPtr->iStateNotifyMask;
+    else
+        interested = xkbPrivPtr->iMapNotifyMask;
+    if (!(interested & changed))
+        return;
+
+    pEv->type = XkbEventCode + XkbEventBase;
+    pEv->xkbType = xkbType;
+    pEv->deviceID = kbd->id;
+    pEv->time = GetTimeInMillis();
+
     while (interest) {
-        if ((!interest->client->clientGone) &&
-            (interest->client->xkbClientFlags & _XkbClientInitialized) &&
+        ClientPtr client = interest->client;
+
+        if ((!client->clientGone) &&
+            (client->xkbClientFlags & _XkbClientInitialized) &&
             (((xkbType == XkbIndicatorStateNotify) &&
               (interest->iStateNotifyMask & changed)) ||
              ((xkbType == XkbIndicatorMapNotify) &&
               (interest->iMapNotifyMask & changed)))) {
-            if (!initialized) {
-                pEv->type = XkbEventCode + XkbEventBase;
-                pEv->xkbType = xkbType;
-                pEv->deviceID = kbd->id;
-                pEv->time = time = GetTimeInMillis();
-                initialized = 1;
-            }
-            pEv->time = time;
-            pEv->changed = changed;
-            pEv->state = state;
-            if (interest->client->swapped) {
-                swapl(&pEv->time);
-                swapl(&pEv->changed);
-                swapl(&pEv->state);
+            if (client->swapped) {
+                if (!have_swapped) {
+                    swapped = *pEv;
+                    swapl(&swapped.time);
+                    swapl(&swapped.changed);
+                    swapl(&swapped.state);
+                    have_swapped = TRUE;
+                }
+                xmitClientEvent(client, *(xEvent*)&swapped);
             }
-            xmitClientEvent(interest->client, *(xEvent*)pEv);
+            else
+                xmitClientEvent(client, *(xEvent*)pEv);
         }
         interest = interest->next;
     }
@@ -1007,6 +1028,32 @@ XkbAddClientResource(DevicePtr inDev, ClientPtr client, XID id)
     return NULL;
 }
 
+/**
+ * Recompute the union of the notify masks of all clients interested in
+ * dev. The notification paths consult it to skip building events nobody
+ * has selected for, which is the common case for modifier and LED changes
+ * on a busy server. It must be called whenever an interest's masks change
+ * or an interest goes away.
+ */
+void
+XkbUpdateInterestMasks(DeviceIntPtr dev)
+{
+    xkbDeviceInfoPtr xkbPrivPtr = XKBDEVICEINFO(dev);
+    XkbInterestPtr interest;
+
+    xkbPrivPtr->stateNotifyMask = 0;
+    xkbPrivPtr->ctrlsNotifyMask = 0;
+    xkbPrivPtr->iStateNotifyMask = 0;
+    xkbPrivPtr->iMapNotifyMask = 0;
+
+    for (interest = dev->xkb_interest; interest; interest = interest->next) {
+        xkbPrivPtr->stateNotifyMask |= interest->stateNotifyMask;
+        xkbPrivPtr->ctrlsNotifyMask |= interest->ctrlsNotifyMask;
+        xkbPrivPtr->iStateNotifyMask |= interest->iStateNotifyMask;
+        xkbPrivPtr->iMapNotifyMask |= interest->iMapNotifyMask;
+    }
+}
+
 int
 XkbRemoveResourceClient(DevicePtr inDev, XID id)
 {
@@ -1049,6 +1096,8 @@ XkbRemoveResourceClient(DevicePtr inDev, XID id)
             interest = interest->next;
         }
     }
+    if (found)
+        XkbUpdateInterestMasks(dev);
     if (found && autoCtrls && dev->key && dev->key->xkbInfo) {
         XkbEventCauseRec cause = { 0 };
 
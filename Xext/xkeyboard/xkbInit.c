@@ -47,6 +47,7 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "xkbsrv_priv.h"
 
 #include "inputstr.h"
+#include "list.h"
 #include "opaque.h"
 #include "property.h"
 #include "scrnintstr.h"
@@ -83,6 +84,7 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 const char *XkbBaseDirectory = XKB_BASE_DIRECTORY;
 const char *XkbBinDirectory = XKB_BIN_DIRECTORY;
+Bool XkbKeymapCache = TRUE;
 static int XkbWantAccessX = 0;
 
 static char *XkbRulesDflt = NULL;
@@ -97,7 +99,23 @@ static char *XkbLayoutUsed = NULL;
 static char *XkbVariantUsed = NULL;
 static char *XkbOptionsUsed = NULL;
 
-static XkbDescPtr xkb_cached_map = NULL;
+/*
+ * Compiled keymaps, keyed by the RMLVO they were compiled from. Hotplugged
+ * keyboards that share a configuration get a private copy of the cached map
+ * instead of going through the rules and the keymap compiler again.
+ */
+#define XKB_MAX_CACHED_MAPS 8
+
+typedef struct _XkbCachedMap {
+    struct xorg_list entry;
+    XkbRMLVOSet rmlvo;
+    XkbDescPtr map;
+} XkbCachedMapRec, *XkbCachedMapPtr;
+
+static struct xorg_list xkb_cached_maps = { &xkb_cached_maps, &xkb_cached_maps };
+static int xkb_num_cached_maps = 0;
+
+static void XkbFreeCachedMaps(void);
 
 static Bool XkbWantRulesProp = XKB_DFLT_RULES_PROP;
 
@@ -287,26 +305,87 @@ XkbDeleteRulesDflts(void)
     free(XkbOptionsDflt);
     XkbOptionsDflt = NULL;
 
-    XkbFreeKeyboard(xkb_cached_map, XkbAllComponentsMask, TRUE);
-    xkb_cached_map = NULL;
+    XkbFreeCachedMaps();
 }
 
 #define DIFFERS(a, b) (strcmp((a) ? (a) : "", (b) ? (b) : "") != 0)
 
 static Bool
-XkbCompareUsedRMLVO(XkbRMLVOSet * rmlvo)
+XkbCompareRMLVO(XkbRMLVOSet * a, XkbRMLVOSet * b)
 {
-    if (DIFFERS(rmlvo->rules, XkbRulesUsed) ||
-        DIFFERS(rmlvo->model, XkbModelUsed) ||
-        DIFFERS(rmlvo->layout, XkbLayoutUsed) ||
-        DIFFERS(rmlvo->variant, XkbVariantUsed) ||
-        DIFFERS(rmlvo->options, XkbOptionsUsed))
+    if (DIFFERS(a->rules, b->rules) ||
+        DIFFERS(a->model, b->model) ||
+        DIFFERS(a->layout, b->layout) ||
+        DIFFERS(a->variant, b->variant) ||
+        DIFFERS(a->options, b->options))
         return FALSE;
     return TRUE;
 }
 
 #undef DIFFERS
 
+static void
+XkbFreeCachedMap(XkbCachedMapPtr cached)
+{
+    xorg_list_del(&cached->entry);
+    XkbFreeKeyboard(cached->map, XkbAllComponentsMask, TRUE);
+    XkbFreeRMLVOSet(&cached->rmlvo, FALSE);
+    free(cached);
+    xkb_num_cached_maps--;
+}
+
+static void
+XkbFreeCachedMaps(void)
+{
+    XkbCachedMapPtr cached, tmp;
+
+    xorg_list_for_each_entry_safe(cached, tmp, &xkb_cached_maps, entry)
+        XkbFreeCachedMap(cached);
+}
+
+/**
+ * Return the cached keymap compiled for rmlvo, or compile it and add it to
+ * the cache. The returned map is owned by the cache and must be copied
+ * before use.
+ */
+static XkbDescPtr
+XkbLookupCachedMap(DeviceIntPtr dev, XkbRMLVOSet * rmlvo)
+{
+    XkbCachedMapPtr cached;
+
+    xorg_list_for_each_entry(cached, &xkb_cached_maps, entry) {
+        if (XkbCompareRMLVO(&cached->rmlvo, rmlvo)) {
+            LogMessageVerb(X_INFO, 4, "XKB: Reusing cached keymap\n");
+            /* keep the list in most recently used order */
+            xorg_list_del(&cached->entry);
+            xorg_list_add(&cached->entry, &xkb_cached_maps);
+            return cached->map;
+        }
+    }
+
+    cached = calloc(1, sizeof(*cached));
+    if (!cached)
+        return NULL;
+
+    cached->map = XkbCompileKeymap(dev, rmlvo);
+    if (!cached->map) {
+        free(cached);
+        return NULL;
+    }
+
+    XkbInitRules(&cached->rmlvo, rmlvo->rules, rmlvo->model, rmlvo->layout,
+                 rmlvo->variant, rmlvo->options);
+
+    if (xkb_num_cached_maps >= XKB_MAX_CACHED_MAPS)
+        XkbFreeCachedMap(xorg_list_last_entry(&xkb_cached_maps,
+                                              XkbCachedMapRec, entry));
+
+    xorg_list_add(&cached->entry, &xkb_cached_maps);
+    xkb_num_cached_maps++;
+
+    return cached->map;
+}
+
 /***====================================================================***/
 
 #include "xkbDflts.h"
@@ -512,6 +591,8 @@ InitKeyboardDeviceStructInternal(DeviceIntPtr dev, XkbRMLVOSet * rmlvo,
     unsigned int check;
     XkbSrvInfoPtr xkbi;
     XkbDescPtr xkb;
+    XkbDescPtr compiled = NULL;
+    XkbDescPtr string_map = NULL;
     XkbSrvLedInfoPtr sli;
     XkbChangesRec changes = { 0 };
     XkbEventCauseRec cause = { 0 };
@@ -550,23 +631,16 @@ InitKeyboardDeviceStructInternal(DeviceIntPtr dev, XkbRMLVOSet * rmlvo,
     }
     dev->key->xkbInfo = xkbi;
 
-    if (xkb_cached_map && (keymap || (rmlvo && !XkbCompareUsedRMLVO(rmlvo)))) {
-        XkbFreeKeyboard(xkb_cached_map, XkbAllComponentsMask, TRUE);
-        xkb_cached_map = NULL;
-    }
-
-    if (xkb_cached_map)
-        LogMessageVerb(X_INFO, 4, "XKB: Reusing cached keymap\n");
-    else {
-        if (rmlvo)
-            xkb_cached_map = XkbCompileKeymap(dev, rmlvo);
-        else
-            xkb_cached_map = XkbCompileKeymapFromString(dev, keymap, keymap_length);
+    /* keymaps from strings are one-off, only RMLVO maps are kept around */
+    if (rmlvo)
+        compiled = XkbLookupCachedMap(dev, rmlvo);
+    else
+        compiled = string_map =
+            XkbCompileKeymapFromString(dev, keymap, keymap_length);
 
-        if (!xkb_cached_map) {
-            ErrorF("XKB: Failed to compile keymap\n");
-            goto unwind_info;
-        }
+    if (!compiled) {
+        ErrorF("XKB: Failed to compile keymap\n");
+        goto unwind_info;
     }
 
     xkb = XkbAllocKeyboard();
@@ -575,15 +649,20 @@ InitKeyboardDeviceStructInternal(DeviceIntPtr dev, XkbRMLVOSet * rmlvo,
         goto unwind_info;
     }
 
-    if (!XkbCopyKeymap(xkb, xkb_cached_map)) {
+    if (!XkbCopyKeymap(xkb, compiled)) {
         ErrorF("XKB: Failed to copy keymap\n");
         goto unwind_desc;
     }
-    xkb->defined = xkb_cached_map->defined;
-    xkb->flags = xkb_cached_map->flags;
-    xkb->device_spec = xkb_cached_map->device_spec;
+    xkb->defined = compiled->defined;
+    xkb->flags = compiled->flags;
+    xkb->device_spec = compiled->device_spec;
     xkbi->desc = xkb;
 
+    if (string_map) {
+        XkbFreeKeyboard(string_map, XkbAllComponentsMask, TRUE);
+        string_map = NULL;
+    }
+
     if (xkb->min_key_code == 0)
         xkb->min_key_code = 8;
     if (xkb->max_key_code == 0)
@@ -644,6 +723,8 @@ InitKeyboardDeviceStructInternal(DeviceIntPtr dev, XkbRMLVOSet * rmlvo,
  unwind_desc:
     XkbFreeKeyboard(xkb, 0, TRUE);
  unwind_info:
+    if (string_map)
+        XkbFreeKeyboard(string_map, XkbAllComponentsMask, TRUE);
     free(xkbi);
     dev->key->xkbInfo = NULL;
  unwind_kbdfeed:
@@ -761,6 +842,10 @@ XkbProcessArguments(int argc, char *argv[], int i)
             return -1;
         }
     }
+    else if (strcmp(argv[i], "-noxkbcache") == 0) {
+        XkbKeymapCache = FALSE;
+        return 1;
+    }
     else if ((strncmp(argv[i], "-accessx", 8) == 0) ||
              (strncmp(argv[i], "+accessx", 8) == 0)) {
         int j = 1;
@@ -825,4 +910,5 @@ XkbUseMsg(void)
     ErrorF("                       enable/disable accessx key sequences\n");
     ErrorF("-ardelay               set XKB autorepeat delay\n");
     ErrorF("-arinterval            set XKB autorepeat interval\n");
+    ErrorF("-noxkbcache            don't reuse compiled keymaps across servers\n");
 }
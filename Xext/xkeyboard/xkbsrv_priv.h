@@ -190,6 +190,7 @@ extern int XkbEventBase;
 extern int XkbKeyboardErrorCode;
 extern const char *XkbBaseDirectory;
 extern const char *XkbBinDirectory;
+extern Bool XkbKeymapCache;
 extern CARD32 xkbDebugFlags;
 
 /* AccessX functions */
@@ -210,6 +211,7 @@ int XkbDDXPrivate(DeviceIntPtr dev, KeyCode key, XkbAction *act);
 XkbInterestPtr XkbFindClientResource(DevicePtr inDev, ClientPtr client);
 XkbInterestPtr XkbAddClientResource(DevicePtr inDev, ClientPtr client, XID id);
 int XkbRemoveResourceClient(DevicePtr inDev, XID id);
+void XkbUpdateInterestMasks(DeviceIntPtr dev);
 
 /* key latching */
 int XkbLatchModifiers(DeviceIntPtr pXDev, CARD8 mask, CARD8 latches);
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * X-CLIENT-SCHED extension - protocol definitions
+ *
+ * A server-private extension letting a client give up part of its share
+ * of the server under the fair scheduling policy (-schedPolicy fair).
+ * SetWeight sets the weight of the requesting client, from
+ * SCHED_WEIGHT_MIN up to the default of SCHED_WEIGHT_DEFAULT; a client
+ * doing bulk work in the background can thus stay out of the way of
+ * interactive ones. No client can change the weight of another.
+ *
+ * resproto defines no such request, so rather than taking an X-Resource
+ * request number and version this lives in its own extension, with the
+ * wire definitions kept here.
+ */
+#ifndef _XSERVER_CLIENTSCHEDPROTO_H
+#define _XSERVER_CLIENTSCHEDPROTO_H
+
+#include <X11/Xmd.h>
+
+#define CLIENT_SCHED_NAME               "X-CLIENT-SCHED"
+#define CLIENT_SCHED_MAJOR_VERSION      1
+#define CLIENT_SCHED_MINOR_VERSION      0
+
+/* request opcodes (minor) */
+#define X_ClientSchedQueryVersion       0
+#define X_ClientSchedSetWeight          1
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 clientSchedReqType;           /* X_ClientSchedQueryVersion */
+    CARD16 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+} xClientSchedQueryVersionReq;
+
+#define sz_xClientSchedQueryVersionReq  12
+
+typedef struct {
+    BYTE type;
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+} xClientSchedQueryVersionReply;
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 clientSchedReqType;           /* X_ClientSchedSetWeight */
+    CARD16 length;
+    CARD32 weight;
+} xClientSchedSetWeightReq;
+
+#define sz_xClientSchedSetWeightReq     8
+
+#endif /* _XSERVER_CLIENTSCHEDPROTO_H */
@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * X-CLIENT-STATS extension - protocol definitions
+ *
+ * A server-private companion to X-Resource for per-client accounting:
+ * dispatch CPU time, requests, connection I/O, how long output waited for
+ * the client to read it, and pixmap memory. QueryClientStats lists the
+ * clients (by any XID they own) to report on, or none to report on every
+ * client the requestor may see, and replies with one record per client.
+ *
+ * resproto defines no such request, so rather than taking an X-Resource
+ * request number and version this lives in its own extension, with the
+ * wire definitions kept here.
+ */
+#ifndef _XSERVER_CLIENTSTATSPROTO_H
+#define _XSERVER_CLIENTSTATSPROTO_H
+
+#include <X11/Xmd.h>
+
+#define CLIENT_STATS_NAME               "X-CLIENT-STATS"
+#define CLIENT_STATS_MAJOR_VERSION      1
+#define CLIENT_STATS_MINOR_VERSION      0
+
+/* request opcodes (minor) */
+#define X_ClientStatsQueryVersion       0
+#define X_ClientStatsQueryClientStats   1
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 clientStatsReqType;           /* X_ClientStatsQueryVersion */
+    CARD16 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+} xClientStatsQueryVersionReq;
+
+#define sz_xClientStatsQueryVersionReq  12
+
+typedef struct {
+    BYTE type;
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 majorVersion;
+    CARD32 minorVersion;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+} xClientStatsQueryVersionReply;
+
+/* followed by numClients CARD32 XIDs */
+typedef struct {
+    CARD8 reqType;
+    CARD8 clientStatsReqType;           /* X_ClientStatsQueryClientStats */
+    CARD16 length;
+    CARD32 numClients;
+} xClientStatsQueryClientStatsReq;
+
+#define sz_xClientStatsQueryClientStatsReq 8
+
+typedef struct {
+    BYTE type;
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 numClients;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+    CARD32 pad6;
+} xClientStatsQueryClientStatsReply;
+
+/* following the reply, per client (all CARD64 fields 8-byte aligned):
+ *
+ *  CARD32 resource_base
+ *  CARD32 output_high_water     largest output backlog, in bytes
+ *  CARD64 dispatch_ns           CPU time spent on its requests
+ *  CARD64 requests
+ *  CARD64 bytes_read
+ *  CARD64 bytes_written
+ *  CARD64 blocked_us            time output waited for the client to read
+ *  CARD64 pixmap_bytes          as XResQueryClientPixmapBytes
+ */
+#define sz_xClientStats                 56
+
+#endif /* _XSERVER_CLIENTSTATSPROTO_H */
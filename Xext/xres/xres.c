@@ -13,6 +13,7 @@
 
 #include "dix/client_priv.h"
 #include "dix/dix_priv.h"
+#include "dix/dixstruct_priv.h"
 #include "dix/registry_priv.h"
 #include "dix/request_priv.h"
 #include "dix/resource_priv.h"
@@ -22,6 +23,8 @@
 #include "miext/extinit_priv.h"
 #include "Xext/composite/compint.h"
 #include "Xext/xace.h"
+#include "Xext/xres/clientschedproto.h"
+#include "Xext/xres/clientstatsproto.h"
 
 #include "os.h"
 #include "dixstruct.h"
@@ -38,6 +41,18 @@
 
 Bool noResExtension = FALSE;
 
+/* X-CLIENT-STATS major version a client asked for, 0 until queried */
+static DevPrivateKeyRec ClientStatsClientPrivateKeyRec;
+
+#define ClientStatsClientVersion(_pClient) (CARD32 *) \
+    dixLookupPrivate(&(_pClient)->devPrivates, &ClientStatsClientPrivateKeyRec)
+
+/* X-CLIENT-SCHED major version a client asked for, 0 until queried */
+static DevPrivateKeyRec ClientSchedClientPrivateKeyRec;
+
+#define ClientSchedClientVersion(_pClient) (CARD32 *) \
+    dixLookupPrivate(&(_pClient)->devPrivates, &ClientSchedClientPrivateKeyRec)
+
 /** @brief Holds fragments of responses for ConstructClientIds.
  *
  *  note: there is no consideration for data alignment */
@@ -319,6 +334,145 @@ ProcXResQueryClientPixmapBytes(ClientPtr client)
     return X_SEND_REPLY_SIMPLE(client, reply);
 }
 
+static void
+ResWriteClientStats(x_rpcbuf_t *rpcbuf, ClientPtr owner)
+{
+    ClientStatsRec *stats = &owner->stats;
+    unsigned long pixmapBytes = 0;
+    CARD64 blocked = stats->blockedTime;
+
+    if (stats->blockedSince)
+        blocked += GetTimeInMicros() - stats->blockedSince;
+
+    FindAllClientResources(owner, ResFindResourcePixmaps, &pixmapBytes);
+
+    x_rpcbuf_write_CARD32(rpcbuf, owner->clientAsMask);
+    x_rpcbuf_write_CARD32(rpcbuf, stats->outputHighWater);
+    x_rpcbuf_write_CARD64(rpcbuf, stats->dispatchTime);
+    x_rpcbuf_write_CARD64(rpcbuf, stats->requests);
+    x_rpcbuf_write_CARD64(rpcbuf, stats->bytesRead);
+    x_rpcbuf_write_CARD64(rpcbuf, stats->bytesWritten);
+    x_rpcbuf_write_CARD64(rpcbuf, blocked);
+    x_rpcbuf_write_CARD64(rpcbuf, pixmapBytes);
+}
+
+static int
+ProcClientStatsQueryVersion(ClientPtr client)
+{
+    X_REQUEST_HEAD_STRUCT(xClientStatsQueryVersionReq);
+    X_REQUEST_FIELD_CARD32(majorVersion);
+    X_REQUEST_FIELD_CARD32(minorVersion);
+
+    if (stuff->majorVersion < CLIENT_STATS_MAJOR_VERSION) {
+        client->errorValue = stuff->majorVersion;
+        return BadValue;
+    }
+
+    xClientStatsQueryVersionReply reply = {
+        .majorVersion = CLIENT_STATS_MAJOR_VERSION,
+        .minorVersion = CLIENT_STATS_MINOR_VERSION,
+    };
+
+    *ClientStatsClientVersion(client) = reply.majorVersion;
+
+    X_REPLY_FIELD_CARD32(majorVersion);
+    X_REPLY_FIELD_CARD32(minorVersion);
+
+    return X_SEND_REPLY_SIMPLE(client, reply);
+}
+
+static int
+ProcClientStatsQueryClientStats(ClientPtr client)
+{
+    X_REQUEST_HEAD_AT_LEAST(xClientStatsQueryClientStatsReq);
+    X_REQUEST_FIELD_CARD32(numClients);
+    X_REQUEST_REST_COUNT_CARD32(stuff->numClients);
+
+    if (!*ClientStatsClientVersion(client))
+        return BadRequest;
+
+    x_rpcbuf_t rpcbuf = { .swapped = client->swapped, .err_clear = TRUE };
+
+    int num_clients = 0;
+    if (stuff->numClients == 0) {
+        for (int i = 0; i < currentMaxClients; i++) {
+            ClientPtr walkClient = clients[i];
+            if (walkClient &&
+                (dixCallClientAccessCallback(client, walkClient, DixReadAccess) == Success)) {
+                ResWriteClientStats(&rpcbuf, walkClient);
+                num_clients++;
+            }
+        }
+    }
+    else {
+        for (CARD32 i = 0; i < stuff->numClients; i++) {
+            ClientPtr owner = dixClientForXID(request_rest[i]);
+            if ((!owner) ||
+                (dixCallClientAccessCallback(client, owner, DixReadAccess)
+                                      != Success)) {
+                x_rpcbuf_clear(&rpcbuf);
+                client->errorValue = request_rest[i];
+                return BadValue;
+            }
+            ResWriteClientStats(&rpcbuf, owner);
+            num_clients++;
+        }
+    }
+
+    xClientStatsQueryClientStatsReply reply = {
+        .numClients = num_clients
+    };
+
+    X_REPLY_FIELD_CARD32(numClients);
+
+    return X_SEND_REPLY_WITH_RPCBUF(client, reply, rpcbuf);
+}
+
+static int
+ProcClientSchedQueryVersion(ClientPtr client)
+{
+    X_REQUEST_HEAD_STRUCT(xClientSchedQueryVersionReq);
+    X_REQUEST_FIELD_CARD32(majorVersion);
+    X_REQUEST_FIELD_CARD32(minorVersion);
+
+    if (stuff->majorVersion < CLIENT_SCHED_MAJOR_VERSION) {
+        client->errorValue = stuff->majorVersion;
+        return BadValue;
+    }
+
+    xClientSchedQueryVersionReply reply = {
+        .majorVersion = CLIENT_SCHED_MAJOR_VERSION,
+        .minorVersion = CLIENT_SCHED_MINOR_VERSION,
+    };
+
+    *ClientSchedClientVersion(client) = reply.majorVersion;
+
+    X_REPLY_FIELD_CARD32(majorVersion);
+    X_REPLY_FIELD_CARD32(minorVersion);
+
+    return X_SEND_REPLY_SIMPLE(client, reply);
+}
+
+static int
+ProcClientSchedSetWeight(ClientPtr client)
+{
+    X_REQUEST_HEAD_STRUCT(xClientSchedSetWeightReq);
+    X_REQUEST_FIELD_CARD32(weight);
+
+    if (!*ClientSchedClientVersion(client))
+        return BadRequest;
+
+    /* a client can only give up its own share, never take more */
+    if (stuff->weight < SCHED_WEIGHT_MIN ||
+        stuff->weight > SCHED_WEIGHT_DEFAULT) {
+        client->errorValue = stuff->weight;
+        return BadValue;
+    }
+
+    client->sched_weight = stuff->weight;
+    return Success;
+}
+
 /** @brief Finds out if a client's information need to be put into the
     response; marks client having been handled, if that is the case.
 
@@ -898,10 +1052,54 @@ ProcResDispatch(ClientPtr client)
     return BadRequest;
 }
 
+static int
+ProcClientSchedDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    switch (stuff->data) {
+    case X_ClientSchedQueryVersion:
+        return ProcClientSchedQueryVersion(client);
+    case X_ClientSchedSetWeight:
+        return ProcClientSchedSetWeight(client);
+    default: break;
+    }
+
+    return BadRequest;
+}
+
+static int
+ProcClientStatsDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    switch (stuff->data) {
+    case X_ClientStatsQueryVersion:
+        return ProcClientStatsQueryVersion(client);
+    case X_ClientStatsQueryClientStats:
+        return ProcClientStatsQueryClientStats(client);
+    default: break;
+    }
+
+    return BadRequest;
+}
+
 void
 ResExtensionInit(void)
 {
     (void) AddExtension(XRES_NAME, 0, 0,
                         ProcResDispatch, ProcResDispatch,
                         NULL, StandardMinorOpcode);
+
+    if (!dixRegisterPrivateKey(&ClientStatsClientPrivateKeyRec,
+                               PRIVATE_CLIENT, sizeof(CARD32)))
+        return;
+    (void) AddExtension(CLIENT_STATS_NAME, 0, 0,
+                        ProcClientStatsDispatch, ProcClientStatsDispatch,
+                        NULL, StandardMinorOpcode);
+
+    if (!dixRegisterPrivateKey(&ClientSchedClientPrivateKeyRec,
+                               PRIVATE_CLIENT, sizeof(CARD32)))
+        return;
+    (void) AddExtension(CLIENT_SCHED_NAME, 0, 0,
+                        ProcClientSchedDispatch, ProcClientSchedDispatch,
+                        NULL, StandardMinorOpcode);
 }
@@ -49,7 +49,9 @@ SOFTWARE.
 #include <X11/X.h>
 #include <X11/Xproto.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
@@ -83,7 +85,8 @@ SOFTWARE.
 typedef int (*ColorCompareProcPtr) (EntryPtr /*pent */ ,
                                     xrgb * /*prgb */ );
 
-static Pixel FindBestPixel(EntryPtr /*pentFirst */ ,
+static Pixel FindBestPixel(ColormapPtr /*pmap */ ,
+                           EntryPtr /*pentFirst */ ,
                            int /*size */ ,
                            xrgb * /*prgb */ ,
                            int  /*channel */
@@ -122,6 +125,10 @@ static void FreeCell(ColormapPtr /*pmap */ ,
 
 static void doUpdateColors(ColormapPtr pmap);
 
+static void ColorIndexAdd(ColormapPtr pmap, Pixel pixel, int channel);
+static void ColorIndexRemove(ColormapPtr pmap, Pixel pixel, int channel);
+static void ColorIndexFree(ColormapPtr pmap);
+
 static int AllocDirect(int /*client */ ,
                        ColormapPtr /*pmap */ ,
                        int /*c */ ,
@@ -288,6 +295,8 @@ dixCreateColormap(Colormap mid, ScreenPtr pScreen, VisualPtr pVisual,
                                   (LimitClients * sizeof(Pixel *)));
     pmap->mid = mid;
     pmap->flags = 0;            /* start out with all flags clear */
+    memset(pmap->colorHash, 0, sizeof(pmap->colorHash));
+    memset(pmap->colorTree, 0, sizeof(pmap->colorTree));
     if (mid == pScreen->defColormap)
         pmap->flags |= CM_IsDefault;
     pmap->pScreen = pScreen;
@@ -448,6 +457,8 @@ FreeColormap(void *value, XID mid)
         }
     }
 
+    ColorIndexFree(pmap);
+
     if (pmap->flags & CM_IsDefault) {
         dixFreePrivates(pmap->devPrivates, PRIVATE_COLORMAP);
         free(pmap);
@@ -620,8 +631,10 @@ CopyFree(int channel, int client, ColormapPtr pmapSrc, ColormapPtr pmapDst)
             else {
                 *pentDst = *pentSrc;
                 nalloc++;
-                if (pentSrc->refcnt > 0)
+                if (pentSrc->refcnt > 0) {
                     pentDst->refcnt = 1;
+                    ColorIndexAdd(pmapDst, *ppix, channel);
+                }
                 else
                     pentSrc->fShared = FALSE;
             }
@@ -696,6 +709,8 @@ FreeCell(ColormapPtr pmap, Pixel i, int channel)
                 free(pent->co.shco.blue);
             pent->fShared = FALSE;
         }
+        if (pent->refcnt > 0)
+            ColorIndexRemove(pmap, i, channel);
         pent->refcnt = 0;
         *pCount += 1;
     }
@@ -754,6 +769,314 @@ doUpdateColors(ColormapPtr pmap)
     free(defs);
 }
 
+/*
+ * Color lookup for AllocColor. The read-only cells of a dynamic map are
+ * kept in a hash by color, so that finding a shared cell doesn't scan the
+ * whole map. The cells of a static map never change once it is created;
+ * they go into a k-d tree for the closest color. Both are set up on the
+ * first lookup. FindColor and CopyFree add the cells they make read-only,
+ * FreeCell takes them out again.
+ */
+#define COLOR_INDEX_MAX     (1 << 16)
+
+#define CHAIN_END           (-1)
+#define CHAIN_NONE          (-2)
+
+typedef struct _ColorHash {
+    int size;
+    int channel;                /* the one the colors are hashed for */
+    unsigned mask;
+    int *next;                  /* by pixel, CHAIN_NONE if not in the hash */
+    int buckets[];
+} ColorHashRec;
+
+typedef struct {
+    unsigned short rgb[3];
+    unsigned char axis;
+    Pixel pixel;
+} ColorTreeNodeRec, *ColorTreeNodePtr;
+
+typedef struct _ColorTree {
+    int size;
+    ColorTreeNodeRec nodes[];
+} ColorTreeRec;
+
+static int
+ColorIndexSlot(int channel)
+{
+    return channel == PSEUDOMAP ? REDMAP : channel;
+}
+
+static EntryPtr
+ColorIndexEntries(ColormapPtr pmap, int channel)
+{
+    switch (channel) {
+    case GREENMAP:
+        return pmap->green;
+    case BLUEMAP:
+        return pmap->blue;
+    default:
+        return pmap->red;
+    }
+}
+
+/* The part of the color the cells of the channel hold, as a point */
+static void
+ColorPoint(unsigned short red, unsigned short green, unsigned short blue,
+           int channel, unsigned short point[3])
+{
+    point[0] = (channel == PSEUDOMAP || channel == REDMAP) ? red : 0;
+    point[1] = (channel == PSEUDOMAP || channel == GREENMAP) ? green : 0;
+    point[2] = (channel == PSEUDOMAP || channel == BLUEMAP) ? blue : 0;
+}
+
+static unsigned
+ColorHashBucket(ColorHashPtr hash, unsigned short red, unsigned short green,
+                unsigned short blue)
+{
+    unsigned short point[3];
+    CARD32 h;
+
+    ColorPoint(red, green, blue, hash->channel, point);
+    h = point[0] ^ ((CARD32) point[1] << 8) ^ ((CARD32) point[2] << 16);
+    return ((h * 2654435761u) >> 12) & hash->mask;
+}
+
+static void
+ColorHashLink(ColorHashPtr hash, EntryPtr pentFirst, Pixel pixel)
+{
+    EntryPtr pent = pentFirst + pixel;
+    unsigned b;
+
+    if (hash->next[pixel] != CHAIN_NONE)
+        return;
+    b = ColorHashBucket(hash, pent->co.local.red, pent->co.local.green,
+                        pent->co.local.blue);
+    hash->next[pixel] = hash->buckets[b];
+    hash->buckets[b] = pixel;
+}
+
+static void
+ColorHashUnlink(ColorHashPtr hash, EntryPtr pentFirst, Pixel pixel)
+{
+    EntryPtr pent = pentFirst + pixel;
+    int *link;
+
+    if (hash->next[pixel] == CHAIN_NONE)
+        return;
+    link = &hash->buckets[ColorHashBucket(hash, pent->co.local.red,
+                                          pent->co.local.green,
+                                          pent->co.local.blue)];
+    while (*link != CHAIN_END && *link != (int) pixel)
+        link = &hash->next[*link];
+    BUG_RETURN(*link == CHAIN_END);
+    *link = hash->next[pixel];
+    hash->next[pixel] = CHAIN_NONE;
+}
+
+/* The hash of the read-only cells of a dynamic map, set up on first use */
+static ColorHashPtr
+ColorHashGet(ColormapPtr pmap, EntryPtr pentFirst, int size, int channel)
+{
+    ColorHashPtr *phash = &pmap->colorHash[ColorIndexSlot(channel)];
+    ColorHashPtr hash = *phash;
+    unsigned buckets = 16;
+
+    if (hash)
+        return hash->size == size ? hash : NULL;
+    if (!(pmap->class & DynamicClass) || (pmap->flags & CM_BeingCreated) ||
+        size > COLOR_INDEX_MAX)
+        return NULL;
+
+    while (buckets < size)
+        buckets <<= 1;
+    hash = malloc(sizeof(ColorHashRec) + buckets * sizeof(int));
+    if (!hash)
+        return NULL;
+    hash->next = malloc(size * sizeof(int));
+    if (!hash->next) {
+        free(hash);
+        return NULL;
+    }
+    hash->size = size;
+    hash->channel = channel;
+    hash->mask = buckets - 1;
+    for (unsigned i = 0; i < buckets; i++)
+        hash->buckets[i] = CHAIN_END;
+    for (int i = 0; i < size; i++)
+        hash->next[i] = CHAIN_NONE;
+    /* link the last cells first, the chains are walked whole anyway */
+    for (int i = size; --i >= 0;)
+        if (pentFirst[i].refcnt > 0)
+            ColorHashLink(hash, pentFirst, i);
+
+    *phash = hash;
+    return hash;
+}
+
+/* A cell of the map became read-only */
+static void
+ColorIndexAdd(ColormapPtr pmap, Pixel pixel, int channel)
+{
+    ColorHashPtr hash = pmap->colorHash[ColorIndexSlot(channel)];
+
+    if (hash && pixel < hash->size)
+        ColorHashLink(hash, ColorIndexEntries(pmap, channel), pixel);
+}
+
+/* A read-only cell of the map was freed */
+static void
+ColorIndexRemove(ColormapPtr pmap, Pixel pixel, int channel)
+{
+    ColorHashPtr hash = pmap->colorHash[ColorIndexSlot(channel)];
+
+    if (hash && pixel < hash->size)
+        ColorHashUnlink(hash, ColorIndexEntries(pmap, channel), pixel);
+}
+
+/*
+ * The read-only cell matching prgb that comes first (or last) when going
+ * through the map from pixel start on, wrapping around, or -1.
+ */
+static int
+ColorHashFind(ColorHashPtr hash, EntryPtr pentFirst, xrgb *prgb,
+              ColorCompareProcPtr comp, Pixel start, Bool last)
+{
+    int found = -1;
+    int best = 0;
+
+    for (int i = hash->buckets[ColorHashBucket(hash, prgb->red, prgb->green,
+                                               prgb->blue)];
+         i != CHAIN_END; i = hash->next[i]) {
+        int dist = (i - (int) start + hash->size) % hash->size;
+
+        if (pentFirst[i].refcnt <= 0 || !(*comp) (&pentFirst[i], prgb))
+            continue;
+        if (found < 0 || (last ? dist > best : dist < best)) {
+            found = i;
+            best = dist;
+        }
+    }
+    return found;
+}
+
+static int colorTreeAxis;
+
+static int
+ColorTreeCompare(const void *a, const void *b)
+{
+    const ColorTreeNodeRec *na = a, *nb = b;
+
+    if (na->rgb[colorTreeAxis] != nb->rgb[colorTreeAxis])
+        return na->rgb[colorTreeAxis] < nb->rgb[colorTreeAxis] ? -1 : 1;
+    return 0;
+}
+
+/* Split [lo, hi) at its median along the axis the colors spread most */
+static void
+ColorTreeBuild(ColorTreeNodePtr nodes, int lo, int hi)
+{
+    unsigned short low[3] = { 0xffff, 0xffff, 0xffff };
+    unsigned short high[3] = { 0, 0, 0 };
+    int axis = 0, mid;
+
+    if (hi - lo < 1)
+        return;
+
+    for (int i = lo; i < hi; i++) {
+        for (int a = 0; a < 3; a++) {
+            low[a] = min(low[a], nodes[i].rgb[a]);
+            high[a] = max(high[a], nodes[i].rgb[a]);
+        }
+    }
+    for (int a = 1; a < 3; a++)
+        if (high[a] - low[a] > high[axis] - low[axis])
+            axis = a;
+
+    colorTreeAxis = axis;
+    qsort(nodes + lo, hi - lo, sizeof(ColorTreeNodeRec), ColorTreeCompare);
+    mid = (lo + hi) / 2;
+    nodes[mid].axis = axis;
+    ColorTreeBuild(nodes, lo, mid);
+    ColorTreeBuild(nodes, mid + 1, hi);
+}
+
+/* The k-d tree of all cells of a static map, set up on first use */
+static ColorTreePtr
+ColorTreeGet(ColormapPtr pmap, EntryPtr pentFirst, int size, int channel)
+{
+    ColorTreePtr *ptree = &pmap->colorTree[ColorIndexSlot(channel)];
+    ColorTreePtr tree = *ptree;
+
+    if (tree)
+        return tree->size == size ? tree : NULL;
+    if ((pmap->class & DynamicClass) || (pmap->flags & CM_BeingCreated) ||
+        size > COLOR_INDEX_MAX)
+        return NULL;
+
+    tree = malloc(sizeof(ColorTreeRec) + size * sizeof(ColorTreeNodeRec));
+    if (!tree)
+        return NULL;
+    tree->size = size;
+    for (int i = 0; i < size; i++) {
+        ColorPoint(pentFirst[i].co.local.red, pentFirst[i].co.local.green,
+                   pentFirst[i].co.local.blue, channel, tree->nodes[i].rgb);
+        tree->nodes[i].pixel = i;
+    }
+    ColorTreeBuild(tree->nodes, 0, size);
+
+    *ptree = tree;
+    return tree;
+}
+
+static void
+ColorTreeNearest(const ColorTreeNodeRec *nodes, int lo, int hi,
+                 const unsigned short point[3], Pixel *best, uint64_t *bestDist)
+{
+    const ColorTreeNodeRec *node;
+    uint64_t dist = 0;
+    int64_t diff;
+    int mid;
+
+    if (hi - lo < 1)
+        return;
+
+    mid = (lo + hi) / 2;
+    node = &nodes[mid];
+    for (int a = 0; a < 3; a++) {
+        diff = (int64_t) node->rgb[a] - point[a];
+        dist += diff * diff;
+    }
+    /* ties go to the lowest pixel, like the scan over the map did */
+    if (dist < *bestDist || (dist == *bestDist && node->pixel < *best)) {
+        *best = node->pixel;
+        *bestDist = dist;
+    }
+
+    diff = (int64_t) point[node->axis] - node->rgb[node->axis];
+    if (diff < 0) {
+        ColorTreeNearest(nodes, lo, mid, point, best, bestDist);
+        if ((uint64_t) (diff * diff) <= *bestDist)
+            ColorTreeNearest(nodes, mid + 1, hi, point, best, bestDist);
+    }
+    else {
+        ColorTreeNearest(nodes, mid + 1, hi, point, best, bestDist);
+        if ((uint64_t) (diff * diff) <= *bestDist)
+            ColorTreeNearest(nodes, lo, mid, point, best, bestDist);
+    }
+}
+
+static void
+ColorIndexFree(ColormapPtr pmap)
+{
+    for (int i = 0; i < 3; i++) {
+        if (pmap->colorHash[i])
+            free(pmap->colorHash[i]->next);
+        free(pmap->colorHash[i]);
+        free(pmap->colorTree[i]);
+    }
+}
+
 /* Tries to find a color in pmap that exactly matches the one requested in prgb
  * if it can't it allocates one.
  * Starts looking at pentFirst + *pPixel, so if you want a specific pixel,
@@ -768,30 +1091,41 @@ FindColor(ColormapPtr pmap, EntryPtr pentFirst, int size, xrgb * prgb,
         pixel = 0;
 
     Pixel Free = 0;
-    /* see if there is a match, and also look for a free entry */
     bool foundFree = FALSE;
     int count;
     EntryPtr pent;
+    ColorHashPtr hash = ColorHashGet(pmap, pentFirst, size, channel);
+
+    if (hash) {
+        int match = ColorHashFind(hash, pentFirst, prgb, comp, pixel, FALSE);
+
+        if (match >= 0) {
+            pixel = match;
+            pent = pentFirst + pixel;
+            goto found;
+        }
+        for (pent = pentFirst + pixel, count = size; --count >= 0;) {
+            if (pent->refcnt == 0) {
+                Free = pixel;
+                foundFree = TRUE;
+                break;
+            }
+            pixel++;
+            if (pixel >= size) {
+                pent = pentFirst;
+                pixel = 0;
+            }
+            else
+                pent++;
+        }
+        goto allocate;
+    }
+
+    /* see if there is a match, and also look for a free entry */
     for (pent = pentFirst + pixel, count = size; --count >= 0;) {
         if (pent->refcnt > 0) {
-            if ((*comp) (pent, prgb)) {
-                if (client >= 0)
-                    pent->refcnt++;
-                *pPixel = pixel;
-                switch (channel) {
-                case REDMAP:
-                    *pPixel <<= pmap->pVisual->offsetRed;
-                case PSEUDOMAP:
-                    break;
-                case GREENMAP:
-                    *pPixel <<= pmap->pVisual->offsetGreen;
-                    break;
-                case BLUEMAP:
-                    *pPixel <<= pmap->pVisual->offsetBlue;
-                    break;
-                }
-                goto gotit;
-            }
+            if ((*comp) (pent, prgb))
+                goto found;
         }
         else if (!foundFree && pent->refcnt == 0) {
             Free = pixel;
@@ -814,6 +1148,7 @@ FindColor(ColormapPtr pmap, EntryPtr pentFirst, int size, xrgb * prgb,
     /* If we got here, we didn't find a match.  If we also didn't find
      * a free entry, we're out of luck.  Otherwise, we'll usurp a free
      * entry and fill it in */
+ allocate:
     if (!foundFree)
         return BadAlloc;
     pent = pentFirst + Free;
@@ -871,6 +1206,26 @@ FindColor(ColormapPtr pmap, EntryPtr pentFirst, int size, xrgb * prgb,
     (*pmap->pScreen->StoreColors) (pmap, 1, &def);
     pixel = Free;
     *pPixel = def.pixel;
+    if (client >= 0)
+        ColorIndexAdd(pmap, pixel, channel);
+    goto gotit;
+
+ found:
+    if (client >= 0)
+        pent->refcnt++;
+    *pPixel = pixel;
+    switch (channel) {
+    case REDMAP:
+        *pPixel <<= pmap->pVisual->offsetRed;
+    case PSEUDOMAP:
+        break;
+    case GREENMAP:
+        *pPixel <<= pmap->pVisual->offsetGreen;
+        break;
+    case BLUEMAP:
+        *pPixel <<= pmap->pVisual->offsetBlue;
+        break;
+    }
 
  gotit:
     if (pmap->flags & CM_BeingCreated || client == -1)
@@ -900,7 +1255,8 @@ FindColor(ColormapPtr pmap, EntryPtr pentFirst, int size, xrgb * prgb,
     int npix = nump[client];
     Pixel *ppix = reallocarray(pixp[client], npix + 1, sizeof(Pixel));
     if (!ppix) {
-        pent->refcnt--;
+        if (--pent->refcnt == 0)
+            ColorIndexRemove(pmap, pixel, channel);
         if (!pent->fShared)
             switch (channel) {
             case PSEUDOMAP:
@@ -960,7 +1316,7 @@ AllocColor(ColormapPtr pmap,
     case StaticColor:
     case StaticGray:
         /* Look up all three components in the same pmap */
-        *pPix = pixR = FindBestPixel(pmap->red, entries, &rgb, PSEUDOMAP);
+        *pPix = pixR = FindBestPixel(pmap, pmap->red, entries, &rgb, PSEUDOMAP);
         *pred = pmap->red[pixR].co.local.red;
         *pgreen = pmap->red[pixR].co.local.green;
         *pblue = pmap->red[pixR].co.local.blue;
@@ -976,9 +1332,9 @@ AllocColor(ColormapPtr pmap,
 
     case TrueColor:
         /* Look up each component in its own map, then OR them together */
-        pixR = FindBestPixel(pmap->red, NUMRED(pVisual), &rgb, REDMAP);
-        pixG = FindBestPixel(pmap->green, NUMGREEN(pVisual), &rgb, GREENMAP);
-        pixB = FindBestPixel(pmap->blue, NUMBLUE(pVisual), &rgb, BLUEMAP);
+        pixR = FindBestPixel(pmap, pmap->red, NUMRED(pVisual), &rgb, REDMAP);
+        pixG = FindBestPixel(pmap, pmap->green, NUMGREEN(pVisual), &rgb, GREENMAP);
+        pixB = FindBestPixel(pmap, pmap->blue, NUMBLUE(pVisual), &rgb, BLUEMAP);
         *pPix = (pixR << pVisual->offsetRed) |
             (pixG << pVisual->offsetGreen) |
             (pixB << pVisual->offsetBlue) | ALPHAMASK(pVisual);
@@ -1133,7 +1489,7 @@ FakeAllocColor(ColormapPtr pmap, xColorItem * item)
     }
     case StaticColor:
     case StaticGray:
-        item->pixel = FindBestPixel(pmap->red, entries, &rgb, PSEUDOMAP);
+        item->pixel = FindBestPixel(pmap, pmap->red, entries, &rgb, PSEUDOMAP);
         break;
 
     case DirectColor:
@@ -1144,15 +1500,15 @@ FakeAllocColor(ColormapPtr pmap, xColorItem * item)
         Pixel pixB = (item->pixel & pVisual->blueMask) >> pVisual->offsetBlue;
         if (FindColor(pmap, pmap->red, NUMRED(pVisual), &rgb, &pixR, REDMAP,
                       -1, RedComp) != Success)
-            pixR = FindBestPixel(pmap->red, NUMRED(pVisual), &rgb, REDMAP)
+            pixR = FindBestPixel(pmap, pmap->red, NUMRED(pVisual), &rgb, REDMAP)
                 << pVisual->offsetRed;
         if (FindColor(pmap, pmap->green, NUMGREEN(pVisual), &rgb, &pixG,
                       GREENMAP, -1, GreenComp) != Success)
-            pixG = FindBestPixel(pmap->green, NUMGREEN(pVisual), &rgb,
+            pixG = FindBestPixel(pmap, pmap->green, NUMGREEN(pVisual), &rgb,
                                  GREENMAP) << pVisual->offsetGreen;
         if (FindColor(pmap, pmap->blue, NUMBLUE(pVisual), &rgb, &pixB, BLUEMAP,
                       -1, BlueComp) != Success)
-            pixB = FindBestPixel(pmap->blue, NUMBLUE(pVisual), &rgb, BLUEMAP)
+            pixB = FindBestPixel(pmap, pmap->blue, NUMBLUE(pVisual), &rgb, BLUEMAP)
                 << pVisual->offsetBlue;
         item->pixel = pixR | pixG | pixB;
         break;
@@ -1161,9 +1517,9 @@ FakeAllocColor(ColormapPtr pmap, xColorItem * item)
     case TrueColor:
     {
         /* Look up each component in its own map, then OR them together */
-        Pixel pixR = FindBestPixel(pmap->red, NUMRED(pVisual), &rgb, REDMAP);
-        Pixel pixG = FindBestPixel(pmap->green, NUMGREEN(pVisual), &rgb, GREENMAP);
-        Pixel pixB = FindBestPixel(pmap->blue, NUMBLUE(pVisual), &rgb, BLUEMAP);
+        Pixel pixR = FindBestPixel(pmap, pmap->red, NUMRED(pVisual), &rgb, REDMAP);
+        Pixel pixG = FindBestPixel(pmap, pmap->green, NUMGREEN(pVisual), &rgb, GREENMAP);
+        Pixel pixB = FindBestPixel(pmap, pmap->blue, NUMBLUE(pVisual), &rgb, BLUEMAP);
         item->pixel = (pixR << pVisual->offsetRed) |
             (pixG << pVisual->offsetGreen) | (pixB << pVisual->offsetBlue);
         break;
@@ -1236,11 +1592,22 @@ BigNumAdd(BigNumPtr x, BigNumPtr y, BigNumPtr r)
 }
 
 static Pixel
-FindBestPixel(EntryPtr pentFirst, int size, xrgb * prgb, int channel)
+FindBestPixel(ColormapPtr pmap, EntryPtr pentFirst, int size, xrgb * prgb,
+              int channel)
 {
     EntryPtr pent;
     Pixel pixel;
     Pixel final = 0;
+    ColorTreePtr tree = ColorTreeGet(pmap, pentFirst, size, channel);
+
+    if (tree) {
+        unsigned short point[3];
+        uint64_t dist = UINT64_MAX;
+
+        ColorPoint(prgb->red, prgb->green, prgb->blue, channel, point);
+        ColorTreeNearest(tree->nodes, 0, tree->size, point, &final, &dist);
+        return final;
+    }
 
     BigNumRec minval;
     MaxBigNum(&minval);
@@ -1290,9 +1657,35 @@ FindColorInRootCmap(ColormapPtr pmap, EntryPtr pentFirst, int size,
     EntryPtr pent;
     Pixel pixel;
     int count;
+    ColorHashPtr hash;
 
     if ((pixel = *pPixel) >= size)
         pixel = 0;
+
+    /* the last match in the order of the scan below wins */
+    if ((hash = ColorHashGet(pmap, pentFirst, size, channel))) {
+        int match = ColorHashFind(hash, pentFirst, prgb, comp, pixel, TRUE);
+
+        if (match < 0)
+            return;
+        pixel = match;
+        switch (channel) {
+        case REDMAP:
+            pixel <<= pmap->pVisual->offsetRed;
+            break;
+        case GREENMAP:
+            pixel <<= pmap->pVisual->offsetGreen;
+            break;
+        case BLUEMAP:
+            pixel <<= pmap->pVisual->offsetBlue;
+            break;
+        default:           /* PSEUDOMAP */
+            break;
+        }
+        *pPixel = pixel;
+        return;
+    }
+
     for (pent = pentFirst + pixel, count = size; --count >= 0;) {
         if (pent->refcnt > 0 && (*comp) (pent, prgb)) {
             switch (channel) {
@@ -45,6 +45,9 @@ typedef struct _CMEntry {
     Bool fShared;
 } Entry, *EntryPtr;
 
+typedef struct _ColorHash *ColorHashPtr;
+typedef struct _ColorTree *ColorTreePtr;
+
 /* COLORMAPs can be used for either Direct or Pseudo color.  PseudoColor
  * only needs one cell table, we arbitrarily pick red.  We keep track
  * of that table with freeRed, numPixelsRed, and clientPixelsRed */
@@ -69,6 +72,8 @@ typedef struct _ColormapRec {
     Entry *green;
     Entry *blue;
     PrivateRec *devPrivates;
+    ColorHashPtr colorHash[3];  /* read-only cells by color, per channel */
+    ColorTreePtr colorTree[3];  /* closest color in a static map */
 } ColormapRec;
 
 int dixCreateColormap(Colormap mid, ScreenPtr pScreen, VisualPtr pVisual,
@@ -73,6 +73,24 @@ typedef struct _GlyphShare {
 
 static GlyphSharePtr sharedGlyphs = (GlyphSharePtr) NULL;
 
+/*
+ * Cursor bits are shared by content: the clients on a desktop all load the
+ * same cursor theme, so the cursors created with the same image, from
+ * whichever client and request, get the same bits. The bits follow their
+ * BitsShare in memory and are counted by the cursors using them.
+ */
+#define BITS_HASH_SIZE 256
+
+typedef struct _BitsShare {
+    struct _BitsShare *next;
+    CARD32 hash;
+} BitsShare, *BitsSharePtr;
+
+static BitsSharePtr sharedBits[BITS_HASH_SIZE];
+
+#define BitsShareBits(share)    ((CursorBitsPtr) ((share) + 1))
+#define BitsShareOf(bits)       ((BitsSharePtr) (bits) - 1)
+
 static CARD32 cursorSerial;
 
 static void
@@ -80,22 +98,30 @@ FreeCursorBits(CursorBitsPtr bits)
 {
     if (--bits->refcnt > 0)
         return;
-    free(bits->source);
-    free(bits->mask);
-    free(bits->argb);
-    dixFiniPrivates(bits, PRIVATE_CURSOR_BITS);
-    if (bits->refcnt == 0) {
-        GlyphSharePtr *prev, this;
 
-        for (prev = &sharedGlyphs;
-             (this = *prev) && (this->bits != bits); prev = &this->next);
-        if (this) {
-            *prev = this->next;
+    BitsSharePtr share = BitsShareOf(bits), *prev;
+    for (prev = &sharedBits[share->hash % BITS_HASH_SIZE];
+         *prev && *prev != share; prev = &(*prev)->next);
+    if (*prev)
+        *prev = share->next;
+
+    /* fonts with the same glyphs may share the bits too */
+    GlyphSharePtr *gprev = &sharedGlyphs, this;
+    while ((this = *gprev)) {
+        if (this->bits == bits) {
+            *gprev = this->next;
             CloseFont(this->font, (Font) 0);
             free(this);
         }
-        free(bits);
+        else
+            gprev = &this->next;
     }
+
+    free(bits->source);
+    free(bits->mask);
+    free(bits->argb);
+    dixFiniPrivates(bits, PRIVATE_CURSOR_BITS);
+    free(share);
 }
 
 /**
@@ -176,6 +202,90 @@ CheckForEmptyMask(CursorBitsPtr bits)
     bits->emptyMask = TRUE;
 }
 
+static CARD32
+HashBytes(CARD32 hash, const void *data, size_t size)
+{
+    const unsigned char *p = data;
+
+    while (size--)
+        hash = (hash ^ *p++) * 16777619u;
+    return hash;
+}
+
+static CARD32
+CursorBitsHash(const unsigned char *psrcbits, const unsigned char *pmaskbits,
+               const CARD32 *argb, CursorMetricPtr cm)
+{
+    size_t n = BitmapBytePad(cm->width) * cm->height;
+    CARD32 hash = HashBytes(2166136261u, cm, sizeof(CursorMetricRec));
+
+    hash = HashBytes(hash, psrcbits, n);
+    hash = HashBytes(hash, pmaskbits, n);
+    if (argb)
+        hash = HashBytes(hash, argb, cm->width * cm->height * sizeof(CARD32));
+    return hash;
+}
+
+/**
+ * Bits for an image, either the bits of an existing cursor with the same
+ * image, with another reference, or new ones.
+ *
+ * Takes ownership of \p psrcbits, \p pmaskbits, and \p argb, like
+ * AllocARGBCursor. Returns NULL if out of memory.
+ */
+static CursorBitsPtr
+ShareCursorBits(unsigned char *psrcbits, unsigned char *pmaskbits,
+                CARD32 *argb, CursorMetricPtr cm)
+{
+    size_t n = BitmapBytePad(cm->width) * cm->height;
+    CARD32 hash = CursorBitsHash(psrcbits, pmaskbits, argb, cm);
+    BitsSharePtr share;
+    CursorBitsPtr bits;
+
+    for (share = sharedBits[hash % BITS_HASH_SIZE]; share; share = share->next) {
+        bits = BitsShareBits(share);
+        if (share->hash == hash &&
+            bits->width == cm->width && bits->height == cm->height &&
+            bits->xhot == cm->xhot && bits->yhot == cm->yhot &&
+            !bits->argb == !argb &&
+            memcmp(bits->source, psrcbits, n) == 0 &&
+            memcmp(bits->mask, pmaskbits, n) == 0 &&
+            (!argb || memcmp(bits->argb, argb,
+                             cm->width * cm->height * sizeof(CARD32)) == 0)) {
+            free(psrcbits);
+            free(pmaskbits);
+            free(argb);
+            bits->refcnt++;
+            return bits;
+        }
+    }
+
+    share = calloc(1, sizeof(BitsShare) + CURSOR_BITS_SIZE);
+    if (!share) {
+        free(psrcbits);
+        free(pmaskbits);
+        free(argb);
+        return NULL;
+    }
+
+    bits = BitsShareBits(share);
+    dixInitPrivates(bits, bits + 1, PRIVATE_CURSOR_BITS);
+    bits->source = psrcbits;
+    bits->mask = pmaskbits;
+    bits->argb = argb;
+    bits->width = cm->width;
+    bits->height = cm->height;
+    bits->xhot = cm->xhot;
+    bits->yhot = cm->yhot;
+    bits->refcnt = 1;
+    CheckForEmptyMask(bits);
+
+    share->hash = hash;
+    share->next = sharedBits[hash % BITS_HASH_SIZE];
+    sharedBits[hash % BITS_HASH_SIZE] = share;
+    return bits;
+}
+
 /**
  * realize the cursor for every screen. Do not change the refcnt, this will be
  * changed when ChangeToCursor actually changes the sprite.
@@ -243,27 +353,40 @@ AllocARGBCursor(unsigned char *psrcbits, unsigned char *pmaskbits,
 {
     *ppCurs = NULL;
 
-    CursorPtr pCurs = (CursorPtr) calloc(CURSOR_REC_SIZE + CURSOR_BITS_SIZE, 1);
+    if (argb) {
+        size_t size = cm->width * cm->height;
+
+        for (size_t i = 0; i < size; i++) {
+            if ((argb[i] & 0xff000000) == 0 && (argb[i] & 0xffffff) != 0) {
+                /* ARGB data doesn't seem pre-multiplied, fix it */
+                for (size_t j = 0; j < size; j++) {
+                    CARD32 a, ar, ag, ab;
+
+                    a = argb[j] >> 24;
+                    ar = a * ((argb[j] >> 16) & 0xff) / 0xff;
+                    ag = a * ((argb[j] >> 8) & 0xff) / 0xff;
+                    ab = a * (argb[j] & 0xff) / 0xff;
+
+                    argb[j] = a << 24 | ar << 16 | ag << 8 | ab;
+                }
+
+                break;
+            }
+        }
+    }
+
+    CursorBitsPtr bits = ShareCursorBits(psrcbits, pmaskbits, argb, cm);
+    if (!bits)
+        return BadAlloc;
+
+    CursorPtr pCurs = (CursorPtr) calloc(CURSOR_REC_SIZE, 1);
     if (!pCurs) {
-        free(psrcbits);
-        free(pmaskbits);
-        free(argb);
+        FreeCursorBits(bits);
         return BadAlloc;
     }
 
-    CursorBitsPtr bits = (CursorBitsPtr) ((char *) pCurs + CURSOR_REC_SIZE);
     dixInitPrivates(pCurs, pCurs + 1, PRIVATE_CURSOR);
-    dixInitPrivates(bits, bits + 1, PRIVATE_CURSOR_BITS)
-        bits->source = psrcbits;
-    bits->mask = pmaskbits;
-    bits->argb = argb;
-    bits->width = cm->width;
-    bits->height = cm->height;
-    bits->xhot = cm->xhot;
-    bits->yhot = cm->yhot;
     pCurs->refcnt = 1;
-    bits->refcnt = -1;
-    CheckForEmptyMask(bits);
     pCurs->bits = bits;
     pCurs->serialNumber = ++cursorSerial;
     pCurs->name = None;
@@ -289,29 +412,6 @@ AllocARGBCursor(unsigned char *psrcbits, unsigned char *pmaskbits,
         goto error;
 
     *ppCurs = pCurs;
-
-    if (argb) {
-        size_t size = bits->width * bits->height;
-
-        for (size_t i = 0; i < size; i++) {
-            if ((argb[i] & 0xff000000) == 0 && (argb[i] & 0xffffff) != 0) {
-                /* ARGB data doesn't seem pre-multiplied, fix it */
-                for (size_t j = 0; j < size; j++) {
-                    CARD32 a, ar, ag, ab;
-
-                    a = argb[j] >> 24;
-                    ar = a * ((argb[j] >> 16) & 0xff) / 0xff;
-                    ag = a * ((argb[j] >> 8) & 0xff) / 0xff;
-                    ab = a * (argb[j] & 0xff) / 0xff;
-
-                    argb[j] = a << 24 | ar << 16 | ag << 8 | ab;
-                }
-
-                break;
-            }
-        }
-    }
-
     return Success;
 
  error:
@@ -394,41 +494,20 @@ AllocGlyphCursor(Font source, unsigned short sourceChar, Font mask, unsigned sho
             free(mskbits);
             return rc;
         }
-        if (sourcefont != maskfont) {
-            pCurs = (CursorPtr) calloc(CURSOR_REC_SIZE + CURSOR_BITS_SIZE, 1);
-            if (pCurs)
-                bits = (CursorBitsPtr) ((char *) pCurs + CURSOR_REC_SIZE);
-            else
-                bits = (CursorBitsPtr) NULL;
-        }
-        else {
-            pCurs = (CursorPtr) calloc(CURSOR_REC_SIZE, 1);
-            if (pCurs)
-                bits = (CursorBitsPtr) calloc(CURSOR_BITS_SIZE, 1);
-            else
-                bits = (CursorBitsPtr) NULL;
-        }
-        if (!bits) {
-            free(pCurs);
-            free(mskbits);
-            free(srcbits);
+        bits = ShareCursorBits(srcbits, mskbits, NULL, &cm);
+        if (!bits)
+            return BadAlloc;
+        pCurs = (CursorPtr) calloc(CURSOR_REC_SIZE, 1);
+        if (!pCurs) {
+            FreeCursorBits(bits);
             return BadAlloc;
         }
         dixInitPrivates(pCurs, pCurs + 1, PRIVATE_CURSOR);
-        dixInitPrivates(bits, bits + 1, PRIVATE_CURSOR_BITS);
-        bits->source = srcbits;
-        bits->mask = mskbits;
-        bits->argb = 0;
-        bits->width = cm.width;
-        bits->height = cm.height;
-        bits->xhot = cm.xhot;
-        bits->yhot = cm.yhot;
-        if (sourcefont != maskfont)
-            bits->refcnt = -1;
-        else {
-            bits->refcnt = 1;
+        if (sourcefont == maskfont) {
             pShare = calloc(1, sizeof(GlyphShare));
             if (!pShare) {
+                dixFiniPrivates(pCurs, PRIVATE_CURSOR);
+                free(pCurs);
                 FreeCursorBits(bits);
                 return BadAlloc;
             }
@@ -442,7 +521,6 @@ AllocGlyphCursor(Font source, unsigned short sourceChar, Font mask, unsigned sho
         }
     }
 
-    CheckForEmptyMask(bits);
     pCurs->bits = bits;
     pCurs->refcnt = 1;
     pCurs->serialNumber = ++cursorSerial;
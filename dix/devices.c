@@ -61,6 +61,7 @@ SOFTWARE.
 #include "dix/dixgrabs_priv.h"
 #include "dix/exevents_priv.h"
 #include "dix/input_priv.h"
+#include "dix/inpututils_priv.h"
 #include "dix/ptrveloc_priv.h"
 #include "dix/request_priv.h"
 #include "dix/resource_priv.h"
@@ -144,6 +145,21 @@ DeviceSetTransform(DeviceIntPtr dev, float *transform_data)
     dev->relative_transform = transform;
     dev->relative_transform.m[0][2] = 0;
     dev->relative_transform.m[1][2] = 0;
+
+    /* The scaling back and forth leaves rounding errors in an otherwise
+     * identity matrix. Snap it, so events can skip the transformation. */
+    if (transform_is_identity(&transform))
+        pixman_f_transform_init_identity(&dev->scale_and_transform);
+
+    /* the inverse is needed for events that only set one of x/y */
+    if (!pixman_f_transform_invert(&dev->scale_and_transform_inverse,
+                                   &dev->scale_and_transform))
+        pixman_f_transform_init_identity(&dev->scale_and_transform_inverse);
+
+    dev->relative_transform_is_identity =
+        transform_is_identity(&dev->relative_transform);
+    dev->scale_and_transform_is_identity =
+        transform_is_identity(&dev->scale_and_transform);
 }
 
 /**
@@ -325,6 +341,9 @@ AddInputDevice(ClientPtr client, DeviceProc deviceProc, Bool autoStart)
     dev->relative_transform.m[1][1] = 1.0;
     dev->relative_transform.m[2][2] = 1.0;
     dev->scale_and_transform = dev->relative_transform;
+    dev->scale_and_transform_inverse = dev->relative_transform;
+    dev->relative_transform_is_identity = TRUE;
+    dev->scale_and_transform_is_identity = TRUE;
 
     XIChangeDeviceProperty(dev, XIGetKnownProperty(XI_PROP_TRANSFORM),
                            XIGetKnownProperty(XATOM_FLOAT), 32,
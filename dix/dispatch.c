@@ -103,6 +103,7 @@ Equipment Corporation.
 
 #include <assert.h>
 #include <stddef.h>
+#include <time.h>
 #include <X11/fonts/fontstruct.h>
 #include <X11/fonts/libxfont2.h>
 
@@ -121,6 +122,7 @@ Equipment Corporation.
 #include "dix/selection_priv.h"
 #include "dix/server_priv.h"
 #include "dix/settings_priv.h"
+#include "dix/trace_priv.h"
 #include "dix/window_priv.h"
 #include "include/resource.h"
 #include "miext/extinit_priv.h"
@@ -338,6 +340,71 @@ mark_client_ungrab(void)
     }
 }
 
+/*
+ * CPU time of the dispatch thread in nanoseconds, for charging the time
+ * spent on a client's requests to it. Read once per scheduling slice
+ * rather than per request, as it is a system call on most platforms.
+ */
+static CARD64
+DispatchThreadTime(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return (CARD64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+    return 0;
+}
+
+/*
+ * Wall time in nanoseconds, for charging batches of requests to clients
+ * in the fair scheduler.
+ */
+static CARD64
+DispatchMonotonicTime(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return (CARD64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+    return (CARD64) GetTimeInMicros() * 1000;
+}
+
+/*
+ * Common tail of the policies: note the client switch and adapt the slice.
+ */
+static void
+ScheduleSlice(ClientPtr best, int nready)
+{
+    long now = SmartScheduleTime;
+
+    /*
+     * Set current client pointer
+     */
+    if (SmartLastClient != best) {
+        best->smart_start_tick = now;
+        SmartLastClient = best;
+    }
+    /*
+     * Adjust slice
+     */
+    if (nready == 1 && SmartScheduleLatencyLimited == 0) {
+        /*
+         * If it's been a long time since another client
+         * has run, bump the slice up to get maximal
+         * performance from a single client
+         */
+        if ((now - best->smart_start_tick) > 1000 &&
+            SmartScheduleSlice < SmartScheduleMaxSlice) {
+            SmartScheduleSlice += SmartScheduleInterval;
+        }
+    }
+    else {
+        SmartScheduleSlice = SmartScheduleInterval;
+    }
+}
+
 static ClientPtr
 SmartScheduleClient(void)
 {
@@ -384,31 +451,83 @@ SmartScheduleClient(void)
     }
 #endif
     SmartLastIndex[best->smart_priority - SMART_MIN_PRIORITY] = best->index;
-    /*
-     * Set current client pointer
-     */
-    if (SmartLastClient != best) {
-        best->smart_start_tick = now;
-        SmartLastClient = best;
+    ScheduleSlice(best, nready);
+    return best;
+}
+
+static void
+SmartScheduleCharge(ClientPtr client, CARD64 ns, Bool exhausted)
+{
+    /* Penalize clients which consume ticks */
+    if (exhausted && client->smart_priority > SMART_MIN_PRIORITY)
+        client->smart_priority--;
+}
+
+/*
+ * Weighted fair queueing: every client accumulates virtual runtime, the
+ * wall time of its request batches scaled by the inverse of its weight,
+ * and the ready client furthest behind runs next. A client flooding the
+ * server with cheap requests thus can't hold off one that only
+ * occasionally needs a round trip, however short its requests are.
+ *
+ * FairMinVruntime follows the virtual runtime of the clients being
+ * served. Clients coming back from idle are pulled up to one slice
+ * behind it, so they get served promptly but can't bank their idle
+ * time to then monopolize the server.
+ */
+static CARD64 FairMinVruntime;
+
+static ClientPtr
+FairScheduleClient(void)
+{
+    ClientPtr pClient, best = NULL;
+    CARD64 lag = (CARD64) SmartScheduleInterval * 1000000;
+    int nready = 0;
+
+    xorg_list_for_each_entry(pClient, &ready_clients, ready) {
+        nready++;
+
+        if (pClient->sched_vruntime + lag < FairMinVruntime)
+            pClient->sched_vruntime = FairMinVruntime - lag;
+
+        /* SYNC client priorities still take precedence */
+        if (!best ||
+            pClient->priority > best->priority ||
+            (pClient->priority == best->priority &&
+             pClient->sched_vruntime < best->sched_vruntime))
+            best = pClient;
     }
-    /*
-     * Adjust slice
-     */
-    if (nready == 1 && SmartScheduleLatencyLimited == 0) {
-        /*
-         * If it's been a long time since another client
-         * has run, bump the slice up to get maximal
-         * performance from a single client
-         */
-        if ((now - best->smart_start_tick) > 1000 &&
-            SmartScheduleSlice < SmartScheduleMaxSlice) {
-            SmartScheduleSlice += SmartScheduleInterval;
+
+    if (best->sched_vruntime > FairMinVruntime)
+        FairMinVruntime = best->sched_vruntime;
+
+    ScheduleSlice(best, nready);
+    return best;
+}
+
+static void
+FairScheduleCharge(ClientPtr client, CARD64 ns, Bool exhausted)
+{
+    client->sched_vruntime += ns * SCHED_WEIGHT_DEFAULT / client->sched_weight;
+}
+
+static const DispatchSchedulerRec DispatchSchedulers[] = {
+    { "smart", SmartScheduleClient, SmartScheduleCharge },
+    { "fair", FairScheduleClient, FairScheduleCharge },
+};
+
+static const DispatchSchedulerRec *DispatchScheduler = &DispatchSchedulers[0];
+
+Bool
+DispatchSetScheduler(const char *name)
+{
+    for (int i = 0; i < ARRAY_SIZE(DispatchSchedulers); i++) {
+        if (strcmp(DispatchSchedulers[i].name, name) == 0) {
+            DispatchScheduler = &DispatchSchedulers[i];
+            return TRUE;
         }
     }
-    else {
-        SmartScheduleSlice = SmartScheduleInterval;
-    }
-    return best;
+    return FALSE;
 }
 
 static CARD32
@@ -496,17 +615,23 @@ Dispatch(void)
         if (!WaitForSomething(clients_are_ready()))
             continue;
 
+        if (traceToggle)
+            TraceToggle();
+
         /*****************
          *  Handle events in round robin fashion, doing input between
          *  each round
          *****************/
 
         if (!dispatchException && clients_are_ready()) {
-            ClientPtr client = SmartScheduleClient();
+            ClientPtr client = DispatchScheduler->pickClient();
 
             isItTimeToYield = FALSE;
 
             long start_tick = SmartScheduleTime;
+            CARD64 start_time = DispatchThreadTime();
+            CARD64 start_wall = DispatchMonotonicTime();
+            Bool closed = FALSE, exhausted = FALSE;
             while (!isItTimeToYield) {
                 if (InputCheckPending())
                     ProcessInputEvents();
@@ -514,9 +639,7 @@ Dispatch(void)
                 FlushIfCriticalOutputPending();
                 if ((SmartScheduleTime - start_tick) >= SmartScheduleSlice)
                 {
-                    /* Penalize clients which consume ticks */
-                    if (client->smart_priority > SMART_MIN_PRIORITY)
-                        client->smart_priority--;
+                    exhausted = TRUE;
                     break;
                 }
 
@@ -525,11 +648,15 @@ Dispatch(void)
                 if (read_result == 0)
                     break;
                 else if (read_result == -1) {
+                    client->stats.dispatchTime +=
+                        DispatchThreadTime() - start_time;
                     CloseDownClient(client);
+                    closed = TRUE;
                     break;
                 }
 
                 client->sequence++;
+                client->stats.requests++;
                 client->majorOp = ((xReq *) client->requestBuffer)->reqType;
                 client->minorOp = 0;
                 if (client->majorOp >= EXTENSION_BASE) {
@@ -538,6 +665,8 @@ Dispatch(void)
                     if (ext)
                         client->minorOp = ext->MinorOpcode(client);
                 }
+                if (traceActive)
+                    TraceRequestStart(client);
 #ifdef XSERVER_DTRACE
                 if (XSERVER_REQUEST_START_ENABLED())
                     XSERVER_REQUEST_START(LookupMajorName(client->majorOp),
@@ -576,9 +705,14 @@ Dispatch(void)
                                          client->majorOp, client->sequence,
                                          client->index, result);
 #endif
+                if (traceActive)
+                    TraceRequestDone(client, read_result, result);
 
                 if (client->noClientException != Success) {
+                    client->stats.dispatchTime +=
+                        DispatchThreadTime() - start_time;
                     CloseDownClient(client);
+                    closed = TRUE;
                     break;
                 }
                 else if (result != Success) {
@@ -588,6 +722,12 @@ Dispatch(void)
                     break;
                 }
             }
+            if (!closed) {
+                client->stats.dispatchTime += DispatchThreadTime() - start_time;
+                DispatchScheduler->chargeClient(client,
+                                                DispatchMonotonicTime() - start_wall,
+                                                exhausted);
+            }
             FlushAllOutput();
             if (client == SmartLastClient)
                 client->smart_stop_tick = SmartScheduleTime;
@@ -597,6 +737,7 @@ Dispatch(void)
     ddxBeforeReset();
     KillAllClients();
     SmartScheduleLatencyLimited = 0;
+    FairMinVruntime = 0;
     ResetOsBuffers();
 }
 
@@ -1417,7 +1558,7 @@ ProcQueryTextExtents(ClientPtr client)
             return BadLength;
         length--;
     }
-    if (!xfont2_query_text_extents(pFont, length, (unsigned char *) &stuff[1], &info))
+    if (!dixQueryTextExtents(pFont, length, (unsigned char *) &stuff[1], &info))
         return BadAlloc;
 
     xQueryTextExtentsReply reply = {
@@ -3750,6 +3891,7 @@ InitClient(ClientPtr client, int i, void *ospriv)
     QueryMinMaxKeyCodes(&client->minKC, &client->maxKC);
     client->smart_start_tick = SmartScheduleTime;
     client->smart_stop_tick = SmartScheduleTime;
+    client->sched_weight = SCHED_WEIGHT_DEFAULT;
     client->clientIds = NULL;
 }
 
@@ -100,6 +100,9 @@ void InitClient(ClientPtr client, int i, void *ospriv);
 
 int FillFontPath(x_rpcbuf_t *rpcbuf);
 
+/* close the fonts kept open after their last client closed them */
+void FlushKeptFonts(void);
+
 /* lookup builtin color by name */
 Bool dixLookupBuiltinColor(char *name,
                            unsigned len,
@@ -280,6 +283,10 @@ int CoreKeyboardProc(DeviceIntPtr dev, int what);
 typedef struct _xQueryFontReply *xQueryFontReplyPtr;
 void QueryFont(FontPtr pFont, xQueryFontReplyPtr pReply, int nProtoCCIStructs);
 
+struct _ExtentInfo;
+Bool dixQueryTextExtents(FontPtr pFont, unsigned long count,
+                         unsigned char *chars, struct _ExtentInfo *info);
+
 extern Bool whiteRoot;
 
 extern volatile char isItTimeToYield;
@@ -82,6 +82,13 @@ struct open_font_closure {
     FontPtr non_cachable_font;
 };
 
+/* what a ListFonts or ListFontsWithInfo result is cached under */
+struct font_list_key {
+    char pattern[XLFDMAXFONTNAMELEN];
+    int patlen;
+    int max_names;
+};
+
 struct list_fonts_with_info_closure {
     ClientPtr client;
     int num_fpes;
@@ -93,6 +100,9 @@ struct list_fonts_with_info_closure {
     int savedNumFonts;
     bool haveSaved;
     char *savedName;
+    struct font_list_key key;
+    x_rpcbuf_t record;          /* the replies sent, for the cache */
+    int numRecorded;
 };
 
 struct list_fonts_closure {
@@ -105,6 +115,7 @@ struct list_fonts_closure {
     bool haveSaved;
     char *savedName;
     int savedNameLen;
+    struct font_list_key key;
 };
 
 struct poly_text_closure {
@@ -145,6 +156,47 @@ static int size_slept_fpes = 0;
 static FontPathElementPtr *slept_fpes = (FontPathElementPtr *) 0;
 static xfont2_pattern_cache_ptr patternCache;
 
+/*
+ * ListFonts and ListFontsWithInfo results by pattern. Walking the font
+ * path for a wildcard pattern takes long, and for local FPEs the result
+ * only changes when the font path is set, which is also when the fontfile
+ * FPEs rescan their directories; that is when the cache is emptied.
+ * libXfont2 has no other notification of FPE changes, so lists that went
+ * through a font server, whose fonts change behind our back, are not
+ * cached at all.
+ */
+#define FONT_LIST_CACHE_SIZE            64
+#define FONT_LIST_CACHE_MAX_RESULT      (256 << 10)
+
+typedef struct {
+    struct xorg_list entry;     /* most recently used first */
+    CARD8 reqType;              /* X_ListFonts or X_ListFontsWithInfo */
+    struct font_list_key key;
+    int count;                  /* names, or replies */
+    size_t size;
+    char data[];                /* the reply payload, or the replies */
+} FontListCacheEntryRec, *FontListCacheEntryPtr;
+
+static struct xorg_list fontListCache;
+static int fontListCacheCount;
+
+/*
+ * The fonts clients closed last stay open for a while, so that the next
+ * OpenFont of the same name finds them in the pattern cache instead of
+ * going through the font path again.
+ */
+#define FONT_KEEP_SIZE  16
+
+static FontPtr keptFonts[FONT_KEEP_SIZE];     /* oldest first */
+static int numKeptFonts;
+
+static struct {
+    unsigned long listHits;
+    unsigned long listMisses;
+    unsigned long openHits;
+    unsigned long openMisses;
+} fontCacheStats;
+
 static int
 FontToXError(int err)
 {
@@ -175,13 +227,223 @@ LoadGlyphs(ClientPtr client, FontPtr pfont, unsigned nchars, int item_size,
         return Successful;
 }
 
+/*
+ * What get_glyphs and get_metrics return for each character of a font, by
+ * row and column, hung off the svrPrivate of the fonts the FPE loads all
+ * glyphs of itself. Text requests then mostly become array lookups. The
+ * table is set up when a font is opened; a row is filled in as its
+ * characters are first used, since scaled fonts only rasterize a glyph
+ * when it is first asked for.
+ */
+#define GLYPH_TABLE_MAX_ROWS    32
+
+typedef struct {
+    int numRows;                /* allocated rows, glyphs and metrics */
+    CharInfoPtr *glyphs[256];
+    xCharInfo **metrics[256];
+} FontGlyphTableRec, *FontGlyphTablePtr;
+
+/* not looked up yet */
+static CharInfoRec unknownGlyph;
+static xCharInfo unknownMetrics;
+
+static void
+FontGlyphTableCreate(FontPtr pfont)
+{
+    if (fpe_functions[pfont->fpe->type]->load_glyphs)
+        return;
+    pfont->svrPrivate = calloc(1, sizeof(FontGlyphTableRec));
+}
+
+static void
+FontGlyphTableDestroy(FontPtr pfont)
+{
+    FontGlyphTablePtr table = pfont->svrPrivate;
+
+    if (!table)
+        return;
+    for (int i = 0; i < 256; i++) {
+        free(table->glyphs[i]);
+        free(table->metrics[i]);
+    }
+    free(table);
+    pfont->svrPrivate = NULL;
+}
+
+static void *
+FontGlyphTableRow(FontGlyphTablePtr table, void **rows, unsigned char row,
+                  void *unknown)
+{
+    void **entries;
+
+    if (table->numRows == GLYPH_TABLE_MAX_ROWS)
+        return NULL;
+    entries = rows[row] = malloc(256 * sizeof(void *));
+    if (!entries)
+        return NULL;
+    for (int i = 0; i < 256; i++)
+        entries[i] = unknown;
+    table->numRows++;
+    return entries;
+}
+
+static CharInfoPtr
+FontTableGlyph(FontPtr font, FontGlyphTablePtr table,
+               unsigned char row, unsigned char col)
+{
+    CharInfoPtr *glyphs = table->glyphs[row];
+    unsigned char c[2] = { row, col };
+    unsigned long n;
+    CharInfoPtr glyph;
+
+    if (glyphs && glyphs[col] != &unknownGlyph)
+        return glyphs[col];
+
+    (*font->get_glyphs) (font, 1, c, TwoD16Bit, &n, &glyph);
+    if (!n)
+        glyph = NULL;
+    if (!glyphs)
+        glyphs = FontGlyphTableRow(table, (void **) table->glyphs, row,
+                                   &unknownGlyph);
+    if (glyphs)
+        glyphs[col] = glyph;
+    return glyph;
+}
+
+static xCharInfo *
+FontTableMetrics(FontPtr font, FontGlyphTablePtr table,
+                 unsigned char row, unsigned char col)
+{
+    xCharInfo **metrics = table->metrics[row];
+    unsigned char c[2] = { row, col };
+    unsigned long n;
+    xCharInfo *ci;
+
+    if (metrics && metrics[col] != &unknownMetrics)
+        return metrics[col];
+
+    (*font->get_metrics) (font, 1, c, TwoD16Bit, &n, &ci);
+    if (!n)
+        ci = NULL;
+    if (!metrics)
+        metrics = FontGlyphTableRow(table, (void **) table->metrics, row,
+                                    &unknownMetrics);
+    if (metrics)
+        metrics[col] = ci;
+    return ci;
+}
+
 void
 GetGlyphs(FontPtr font, unsigned long count, unsigned char *chars,
           FontEncoding fontEncoding,
           unsigned long *glyphcount,    /* RETURN */
           CharInfoPtr *glyphs)          /* RETURN */
 {
-    (*font->get_glyphs) (font, count, chars, fontEncoding, glyphcount, glyphs);
+    FontGlyphTablePtr table = font->svrPrivate;
+    Bool twoByte = (fontEncoding == Linear16Bit || fontEncoding == TwoD16Bit);
+    unsigned long n = 0;
+
+    /* the fonts put one byte characters in the first row, if it exists */
+    if (!table || (fontEncoding != TwoD16Bit && font->info.firstRow > 0)) {
+        (*font->get_glyphs) (font, count, chars, fontEncoding, glyphcount,
+                             glyphs);
+        return;
+    }
+
+    while (count--) {
+        unsigned char row = twoByte ? *chars++ : 0;
+        unsigned char col = *chars++;
+        CharInfoPtr glyph;
+
+        if (fontEncoding == Linear16Bit && row) {
+            /* beyond the first row, which is all a linear font has */
+            unsigned long one;
+
+            (*font->get_glyphs) (font, 1, chars - 2, fontEncoding, &one,
+                                 &glyph);
+            if (!one)
+                glyph = NULL;
+        }
+        else
+            glyph = FontTableGlyph(font, table, row, col);
+
+        if (glyph)
+            glyphs[n++] = glyph;
+    }
+    *glyphcount = n;
+}
+
+/* The metrics of the two byte character c, as QueryTextExtents asks */
+static xCharInfo *
+FontCharMetrics(FontPtr pFont, FontGlyphTablePtr table, unsigned char *c)
+{
+    xCharInfo *ci;
+    unsigned long n;
+
+    if (pFont->info.lastRow > 0 || c[0] == 0)
+        return FontTableMetrics(pFont, table, c[0], c[1]);
+
+    /* beyond the first row, which is all a linear font has */
+    (*pFont->get_metrics) (pFont, 1, c, Linear16Bit, &n, &ci);
+    return n ? ci : NULL;
+}
+
+#define IsNonExistentChar(ci) (!(ci) || \
+                               ((ci)->ascent == 0 && \
+                                (ci)->descent == 0 && \
+                                (ci)->leftSideBearing == 0 && \
+                                (ci)->rightSideBearing == 0 && \
+                                (ci)->characterWidth == 0))
+
+/*
+ * xfont2_query_text_extents() with the metrics from the glyph table.
+ * Characters the font has nothing for are left out, empty ones are
+ * replaced by the default character, or else left out up to the first
+ * real one.
+ */
+Bool
+dixQueryTextExtents(FontPtr pFont, unsigned long count, unsigned char *chars,
+                    ExtentInfoPtr info)
+{
+    FontGlyphTablePtr table = pFont->svrPrivate;
+    xCharInfo **charinfo, *defaultChar;
+    unsigned char defc[2];
+    unsigned long n = 0;
+    unsigned int cm;
+
+    if (!table)
+        return xfont2_query_text_extents(pFont, count, chars, info);
+
+    charinfo = calloc(count ? count : 1, sizeof(xCharInfo *));
+    if (!charinfo)
+        return FALSE;
+
+    defc[0] = pFont->info.defaultCh >> 8;
+    defc[1] = pFont->info.defaultCh;
+    defaultChar = FontCharMetrics(pFont, table, defc);
+    if (IsNonExistentChar(defaultChar))
+        defaultChar = NULL;
+
+    for (unsigned long i = 0; i < count; i++, chars += 2) {
+        xCharInfo *ci = FontCharMetrics(pFont, table, chars);
+
+        if (!ci)
+            continue;
+        if (IsNonExistentChar(ci)) {
+            if (defaultChar)
+                ci = defaultChar;
+            else if (n == 0)
+                continue;
+        }
+        charinfo[n++] = ci;
+    }
+
+    cm = pFont->info.constantMetrics;
+    pFont->info.constantMetrics = FALSE;
+    xfont2_query_glyph_extents(pFont, (CharInfoPtr *) charinfo, n, info);
+    pFont->info.constantMetrics = cm;
+    free(charinfo);
+    return TRUE;
 }
 
 /*
@@ -284,6 +546,136 @@ FreeFPE(FontPathElementPtr fpe)
     }
 }
 
+/* Font names and patterns are case insensitive, in ISO Latin-1 */
+static void
+FontListKey(struct font_list_key *key, const unsigned char *pattern,
+            int length, int max_names)
+{
+    for (int i = 0; i < length; i++) {
+        unsigned char ch = pattern[i];
+
+        if ((ch >= 'A' && ch <= 'Z') ||
+            (ch >= 0xc0 && ch <= 0xde && ch != 0xd7))
+            ch += 'a' - 'A';
+        key->pattern[i] = ch;
+    }
+    key->patlen = length;
+    key->max_names = max_names;
+}
+
+static FontListCacheEntryPtr
+FontListCacheFind(CARD8 reqType, const struct font_list_key *key)
+{
+    FontListCacheEntryPtr entry;
+
+    xorg_list_for_each_entry(entry, &fontListCache, entry) {
+        if (entry->reqType == reqType &&
+            entry->key.max_names == key->max_names &&
+            entry->key.patlen == key->patlen &&
+            memcmp(entry->key.pattern, key->pattern, key->patlen) == 0) {
+            xorg_list_del(&entry->entry);
+            xorg_list_add(&entry->entry, &fontListCache);
+            fontCacheStats.listHits++;
+            return entry;
+        }
+    }
+
+    fontCacheStats.listMisses++;
+    return NULL;
+}
+
+static void
+FontListCacheAdd(CARD8 reqType, const struct font_list_key *key, int count,
+                 const void *data, size_t size)
+{
+    FontListCacheEntryPtr entry;
+
+    if (size > FONT_LIST_CACHE_MAX_RESULT)
+        return;
+
+    if (fontListCacheCount == FONT_LIST_CACHE_SIZE) {
+        entry = xorg_list_last_entry(&fontListCache, FontListCacheEntryRec,
+                                     entry);
+        xorg_list_del(&entry->entry);
+        free(entry);
+        fontListCacheCount--;
+    }
+
+    entry = malloc(sizeof(FontListCacheEntryRec) + size);
+    if (!entry)
+        return;
+    entry->reqType = reqType;
+    entry->key = *key;
+    entry->count = count;
+    entry->size = size;
+    memcpy(entry->data, data, size);
+    xorg_list_add(&entry->entry, &fontListCache);
+    fontListCacheCount++;
+}
+
+static void
+FontListCacheEmpty(void)
+{
+    FontListCacheEntryPtr entry, tmp;
+
+    xorg_list_for_each_entry_safe(entry, tmp, &fontListCache, entry) {
+        xorg_list_del(&entry->entry);
+        free(entry);
+    }
+    fontListCacheCount = 0;
+}
+
+/* Font servers are the FPEs that sleep on wakeups and load glyphs lazily */
+static Bool
+FontListCacheable(FontPathElementPtr *fpe_list, int num)
+{
+    for (int i = 0; i < num; i++) {
+        if (fpe_functions[fpe_list[i]->type]->wakeup_fpe ||
+            fpe_functions[fpe_list[i]->type]->load_glyphs)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* Take over the last reference to a font a client closed */
+static Bool
+FontKeep(FontPtr pfont)
+{
+    if (!patternCache || !pfont->info.cachable)
+        return FALSE;
+
+    if (numKeptFonts == FONT_KEEP_SIZE) {
+        FontPtr oldest = keptFonts[0];
+
+        numKeptFonts--;
+        memmove(keptFonts, keptFonts + 1, numKeptFonts * sizeof(FontPtr));
+        CloseFont(oldest, (Font) 0);
+    }
+    keptFonts[numKeptFonts++] = pfont;
+    return TRUE;
+}
+
+/* Move a kept font to the end of the line, if it is kept */
+static void
+FontKeepUsed(FontPtr pfont)
+{
+    for (int i = 0; i < numKeptFonts; i++) {
+        if (keptFonts[i] == pfont) {
+            memmove(keptFonts + i, keptFonts + i + 1,
+                    (numKeptFonts - i - 1) * sizeof(FontPtr));
+            keptFonts[numKeptFonts - 1] = pfont;
+            return;
+        }
+    }
+}
+
+void
+FlushKeptFonts(void)
+{
+    while (numKeptFonts > 0)
+        CloseFont(keptFonts[--numKeptFonts], (Font) 0);
+}
+
 static Bool
 doOpenFont(ClientPtr client, struct open_font_closure *c)
 {
@@ -379,6 +771,7 @@ doOpenFont(ClientPtr client, struct open_font_closure *c)
     pfont->refcnt++;
     if (pfont->refcnt == 1) {
         UseFPE(pfont->fpe);
+        FontGlyphTableCreate(pfont);
         DIX_FOR_EACH_SCREEN({
             if (walkScreen->RealizeFont) {
                 if (!(*walkScreen->RealizeFont) (walkScreen, pfont)) {
@@ -407,6 +800,7 @@ doOpenFont(ClientPtr client, struct open_font_closure *c)
     }
     free(c->fpe_list);
     free((void *) c->fontname);
+    free((void *) c->origFontName);
     free(c);
     return TRUE;
 }
@@ -443,25 +837,33 @@ OpenFont(ClientPtr client, XID fid, Mask flags, unsigned lenfname,
             if (!AddResource(fid, X11_RESTYPE_FONT, (void *) cached))
                 return BadAlloc;
             cached->refcnt++;
+            FontKeepUsed(cached);
+            fontCacheStats.openHits++;
             return Success;
         }
+        fontCacheStats.openMisses++;
     }
     struct open_font_closure *c = calloc(1, sizeof(*c));
     if (!c)
         return BadAlloc;
     c->fontname = calloc(1, lenfname);
-    c->origFontName = pfontname;
+    /* the request is gone by the time a font server answers */
+    c->origFontName = calloc(1, lenfname);
     c->origFontNameLen = lenfname;
-    if (!c->fontname) {
+    if (!c->fontname || !c->origFontName) {
+        free((void *) c->origFontName);
+        free(c->fontname);
         free(c);
         return BadAlloc;
     }
+    memcpy((char *) c->origFontName, pfontname, lenfname);
     /*
      * copy the current FPE list, so that if it gets changed by another client
      * while we're blocking, the request still appears atomic
      */
     c->fpe_list = calloc(num_fpes, sizeof(FontPathElementPtr));
     if (!c->fpe_list) {
+        free((void *) c->origFontName);
         free((void *) c->fontname);
         free(c);
         return BadAlloc;
@@ -496,6 +898,8 @@ CloseFont(void *value, XID fid)
 
     if (pfont == NullFont)
         return Success;
+    if (fid != 0 && pfont->refcnt == 1 && FontKeep(pfont))
+        return Success;
     if (--pfont->refcnt == 0) {
         if (patternCache)
             xfont2_remove_cached_font_pattern(patternCache, pfont);
@@ -509,6 +913,7 @@ CloseFont(void *value, XID fid)
         });
         if (pfont == defaultFont)
             defaultFont = NULL;
+        FontGlyphTableDestroy(pfont);
         fpe = pfont->fpe;
         (*fpe_functions[fpe->type]->close_font) (fpe, pfont);
         FreeFPE(fpe);
@@ -789,6 +1194,10 @@ doListFontsAndAliases(ClientPtr client, struct list_fonts_closure *c)
         goto bail;
     }
 
+    if (FontListCacheable(c->fpe_list, c->num_fpes))
+        FontListCacheAdd(X_ListFonts, &c->key, reply.nFonts,
+                         rpcbuf.buffer, rpcbuf.wpos);
+
     if (client->swapped) {
         swaps(&reply.nFonts);
     }
@@ -827,6 +1236,25 @@ ListFonts(ClientPtr client, unsigned char *pattern, unsigned length,
     if (access != Success)
         return access;
 
+    struct font_list_key key;
+    FontListCacheEntryPtr cached;
+
+    FontListKey(&key, pattern, length, max_names);
+    if ((cached = FontListCacheFind(X_ListFonts, &key))) {
+        xListFontsReply reply = {
+            .nFonts = cached->count,
+        };
+        x_rpcbuf_t rpcbuf = { .swapped = client->swapped, .err_clear = TRUE };
+
+        x_rpcbuf_write_CARD8s(&rpcbuf, (CARD8 *) cached->data, cached->size);
+        if (rpcbuf.error)
+            return BadAlloc;
+        if (client->swapped)
+            swaps(&reply.nFonts);
+        X_SEND_REPLY_WITH_RPCBUF(client, reply, rpcbuf);
+        return Success;
+    }
+
     if (!(c = calloc(1, sizeof *c)))
         return BadAlloc;
     c->fpe_list = calloc(num_fpes, sizeof(FontPathElementPtr));
@@ -834,6 +1262,7 @@ ListFonts(ClientPtr client, unsigned char *pattern, unsigned length,
         free(c);
         return BadAlloc;
     }
+    c->key = key;
     c->names = xfont2_make_font_names_record(max_names < 100 ? max_names : 100);
     if (!c->names) {
         free(c->fpe_list);
@@ -858,6 +1287,80 @@ ListFonts(ClientPtr client, unsigned char *pattern, unsigned length,
     return Success;
 }
 
+/* Keep a copy of a ListFontsWithInfo reply before it is byte swapped */
+static void
+FontListRecordReply(struct list_fonts_with_info_closure *c,
+                    const xListFontsWithInfoReply *reply, int length,
+                    const char *name, int namelen)
+{
+    CARD32 *hdr;
+
+    if (c->numRecorded < 0)
+        return;
+
+    hdr = x_rpcbuf_reserve(&c->record, 2 * sizeof(CARD32) + length +
+                           pad_to_int32(namelen));
+    if (!hdr || c->record.wpos > FONT_LIST_CACHE_MAX_RESULT) {
+        x_rpcbuf_clear(&c->record);
+        c->numRecorded = -1;
+        return;
+    }
+    hdr[0] = length;
+    hdr[1] = namelen;
+    memcpy(hdr + 2, reply, length);
+    memcpy((char *) (hdr + 2) + length, name, namelen);
+    c->numRecorded++;
+}
+
+static void
+SendListFontsWithInfoReply(ClientPtr client, xListFontsWithInfoReply *reply,
+                           int length, const char *name, int namelen)
+{
+    reply->sequenceNumber = client->sequence;
+    if (client->swapped) {
+        swaps(&reply->sequenceNumber);
+        swapl(&reply->length);
+        unsigned nprops = reply->nFontProps;
+
+        /* from SwapInfo() */
+        swaps(&reply->minCharOrByte2);
+        swaps(&reply->maxCharOrByte2);
+        swaps(&reply->defaultChar);
+        swaps(&reply->nFontProps);
+        swaps(&reply->fontAscent);
+        swaps(&reply->fontDescent);
+        swapl(&reply->nReplies);
+
+        /* from SwapCharInfo */
+        swaps(&reply->minBounds.leftSideBearing);
+        swaps(&reply->minBounds.rightSideBearing);
+        swaps(&reply->minBounds.characterWidth);
+        swaps(&reply->minBounds.ascent);
+        swaps(&reply->minBounds.descent);
+        swaps(&reply->minBounds.attributes);
+
+        /* from SwapCharInfo */
+        swaps(&reply->maxBounds.leftSideBearing);
+        swaps(&reply->maxBounds.rightSideBearing);
+        swaps(&reply->maxBounds.characterWidth);
+        swaps(&reply->maxBounds.ascent);
+        swaps(&reply->maxBounds.descent);
+        swaps(&reply->maxBounds.attributes);
+
+        char *pby = (char *) &reply[1];
+        /* Font properties are an atom and either an int32 or a CARD32, so
+         * they are always 2 4 byte values */
+        for (unsigned i = 0; i < nprops; i++) {
+            swapl((int *) pby);
+            pby += 4;
+            swapl((int *) pby);
+            pby += 4;
+        }
+    }
+    dixWriteToClient(client, length, reply);
+    dixWriteToClient(client, namelen, name);
+}
+
 static int
 doListFontsWithInfo(ClientPtr client, struct list_fonts_with_info_closure *c)
 {
@@ -1006,7 +1509,6 @@ doListFontsWithInfo(ClientPtr client, struct list_fonts_with_info_closure *c)
             reply->length =
                 X_REPLY_HEADER_UNITS(xListFontsWithInfoReply)
                 + bytes_to_int32(pFontInfo->nprops*sizeof(xFontProp)+namelen);
-            reply->sequenceNumber = client->sequence;
             reply->nameLength = namelen;
             reply->minBounds = pFontInfo->ink_minbounds;
             reply->maxBounds = pFontInfo->ink_maxbounds;
@@ -1027,48 +1529,8 @@ doListFontsWithInfo(ClientPtr client, struct list_fonts_with_info_closure *c)
                 pFP->value = pFontInfo->props[i].value;
                 pFP++;
             }
-            if (client->swapped) {
-                swaps(&reply->sequenceNumber);
-                swapl(&reply->length);
-                unsigned nprops = reply->nFontProps;
-
-                /* from SwapInfo() */
-                swaps(&reply->minCharOrByte2);
-                swaps(&reply->maxCharOrByte2);
-                swaps(&reply->defaultChar);
-                swaps(&reply->nFontProps);
-                swaps(&reply->fontAscent);
-                swaps(&reply->fontDescent);
-                swapl(&reply->nReplies);
-
-                /* from SwapCharInfo */
-                swaps(&reply->minBounds.leftSideBearing);
-                swaps(&reply->minBounds.rightSideBearing);
-                swaps(&reply->minBounds.characterWidth);
-                swaps(&reply->minBounds.ascent);
-                swaps(&reply->minBounds.descent);
-                swaps(&reply->minBounds.attributes);
-
-                /* from SwapCharInfo */
-                swaps(&reply->maxBounds.leftSideBearing);
-                swaps(&reply->maxBounds.rightSideBearing);
-                swaps(&reply->maxBounds.characterWidth);
-                swaps(&reply->maxBounds.ascent);
-                swaps(&reply->maxBounds.descent);
-                swaps(&reply->maxBounds.attributes);
-
-                char *pby = (char *) &reply[1];
-                /* Font properties are an atom and either an int32 or a CARD32, so
-                 * they are always 2 4 byte values */
-                for (unsigned i = 0; i < nprops; i++) {
-                    swapl((int *) pby);
-                    pby += 4;
-                    swapl((int *) pby);
-                    pby += 4;
-                }
-            }
-            dixWriteToClient(client, length, reply);
-            dixWriteToClient(client, namelen, name);
+            FontListRecordReply(c, reply, length, name, namelen);
+            SendListFontsWithInfoReply(client, reply, length, name, namelen);
             if (pFontInfo == &fontInfo) {
                 free(fontInfo.props);
                 free(fontInfo.isStringProp);
@@ -1077,6 +1539,9 @@ doListFontsWithInfo(ClientPtr client, struct list_fonts_with_info_closure *c)
         }
     }
  finish: ;
+    if (err == Successful && c->numRecorded >= 0)
+        FontListCacheAdd(X_ListFontsWithInfo, &c->key, c->numRecorded,
+                         c->record.buffer, c->record.wpos);
     /* finish it the replies series sending an empty reply */
     xListFontsWithInfoReply reply = { 0 };
     X_SEND_REPLY_SIMPLE(client, reply);
@@ -1084,6 +1549,7 @@ doListFontsWithInfo(ClientPtr client, struct list_fonts_with_info_closure *c)
     ClientWakeup(client);
     for (int i = 0; i < c->num_fpes; i++)
         FreeFPE(c->fpe_list[i]);
+    x_rpcbuf_clear(&c->record);
     free(c->reply);
     free(c->fpe_list);
     free(c->savedName);
@@ -1111,6 +1577,32 @@ StartListFontsWithInfo(ClientPtr client, int length, unsigned char *pattern,
     if (access != Success)
         return access;
 
+    struct font_list_key key;
+    FontListCacheEntryPtr cached;
+
+    FontListKey(&key, pattern, length, max_names);
+    if ((cached = FontListCacheFind(X_ListFontsWithInfo, &key))) {
+        const char *data = cached->data;
+
+        for (int i = 0; i < cached->count; i++) {
+            CARD32 hdr[2];
+            xListFontsWithInfoReply *reply;
+
+            memcpy(hdr, data, sizeof(hdr));
+            if (!(reply = malloc(hdr[0])))
+                return BadAlloc;
+            memcpy(reply, data + sizeof(hdr), hdr[0]);
+            SendListFontsWithInfoReply(client, reply, hdr[0],
+                                       data + sizeof(hdr) + hdr[0], hdr[1]);
+            free(reply);
+            data += sizeof(hdr) + hdr[0] + pad_to_int32(hdr[1]);
+        }
+
+        xListFontsWithInfoReply reply = { 0 };
+        X_SEND_REPLY_SIMPLE(client, reply);
+        return Success;
+    }
+
     if (!(c = calloc(1, sizeof *c)))
         goto badAlloc;
     c->fpe_list = calloc(num_fpes, sizeof(FontPathElementPtr));
@@ -1135,6 +1627,9 @@ StartListFontsWithInfo(ClientPtr client, int length, unsigned char *pattern,
     c->savedNumFonts = 0;
     c->haveSaved = FALSE;
     c->savedName = 0;
+    c->key = key;
+    if (!FontListCacheable(c->fpe_list, c->num_fpes))
+        c->numRecorded = -1;
     doListFontsWithInfo(client, c);
     return Success;
  badAlloc:
@@ -1712,8 +2207,11 @@ SetFontPathElements(int npaths, unsigned char *paths, int *bad, Bool persist)
 
     FreeFontPath(font_path_elements, num_fpes, FALSE);
     font_path_elements = fplist;
-    if (patternCache)
+    if (patternCache) {
+        FlushKeptFonts();
         xfont2_empty_font_pattern_cache(patternCache);
+    }
+    FontListCacheEmpty();
     num_fpes = valid_paths;
 
     return Success;
@@ -1894,6 +2392,13 @@ get_client_resolutions(int *num)
 void
 FreeFonts(void)
 {
+    LogMessageVerb(X_INFO, 3, "Font cache: %lu/%lu list hits, %lu/%lu open hits\n",
+                   fontCacheStats.listHits,
+                   fontCacheStats.listHits + fontCacheStats.listMisses,
+                   fontCacheStats.openHits,
+                   fontCacheStats.openHits + fontCacheStats.openMisses);
+    memset(&fontCacheStats, 0, sizeof(fontCacheStats));
+    FontListCacheEmpty();
     if (patternCache) {
         xfont2_free_font_pattern_cache(patternCache);
         patternCache = 0;
@@ -2078,13 +2583,13 @@ static const xfont2_client_funcs_rec xfont2_client_funcs = {
     .adjust_fs_wait_for_delay = adjust_fs_wait_for_delay,
 };
 
-xfont2_pattern_cache_ptr fontPatternCache;
-
 void
 InitFonts(void)
 {
-    if (fontPatternCache)
-	xfont2_free_font_pattern_cache(fontPatternCache);
-    fontPatternCache = xfont2_make_font_pattern_cache();
+    if (patternCache)
+        xfont2_free_font_pattern_cache(patternCache);
+    patternCache = xfont2_make_font_pattern_cache();
+    xorg_list_init(&fontListCache);
+    fontListCacheCount = 0;
     xfont2_init(&xfont2_client_funcs);
 }
@@ -38,6 +38,28 @@ extern Bool SmartScheduleSignalEnable;
 void SmartScheduleStartTimer(void);
 void SmartScheduleStopTimer(void);
 
+/*
+ * Scheduling policy: picks the ready client to serve next and is told how
+ * much wall time each batch of that client's requests took. exhausted is
+ * set when the batch ran until the end of the time slice.
+ */
+typedef struct _DispatchScheduler {
+    const char *name;
+    ClientPtr (*pickClient)(void);
+    void (*chargeClient)(ClientPtr client, CARD64 ns, Bool exhausted);
+} DispatchSchedulerRec;
+
+/* select a policy by name ("fair", "smart"); FALSE if there's no such one */
+Bool DispatchSetScheduler(const char *name);
+
+/*
+ * Share of the server a client gets under the fair policy, relative to
+ * other clients of the same priority. Clients can only lower their own
+ * weight, so none ever gets more than the default.
+ */
+#define SCHED_WEIGHT_MIN     1
+#define SCHED_WEIGHT_DEFAULT 1024
+
 /* Client has requests queued or data on the network */
 void mark_client_ready(ClientPtr client);
 
@@ -351,6 +351,23 @@ updateSlaveDeviceCoords(DeviceIntPtr master, DeviceIntPtr pDev)
     /* other axes are left as-is */
 }
 
+/* The x/y coordinates pre-scaled for core requests, and the screen
+ * width/height they were scaled to, as INT16 each. */
+#define MOTION_CORE_SIZE (sizeof(INT16) * 4)
+
+/**
+ * The size of a single motion history entry, see updateMotionHistory() for
+ * the layout.
+ */
+static int
+motionEntrySize(DeviceIntPtr pDev)
+{
+    if (InputDevIsMaster(pDev))
+        return sizeof(Time) + MOTION_CORE_SIZE +
+            sizeof(INT32) * 3 * MAX_VALUATORS;
+    return sizeof(Time) + sizeof(INT32) * pDev->valuator->numAxes;
+}
+
 /**
  * Allocate the motion history buffer.
  */
@@ -360,35 +377,92 @@ AllocateMotionHistory(DeviceIntPtr pDev)
     int size;
 
     free(pDev->valuator->motion);
+    pDev->valuator->motion = NULL;
+    pDev->valuator->first_motion = 0;
+    pDev->valuator->last_motion = 0;
 
     if (pDev->valuator->numMotionEvents < 1)
         return;
 
-    /* An MD must have a motion history size large enough to keep all
-     * potential valuators, plus the respective range of the valuators.
-     * 3 * INT32 for (min_val, max_val, curr_val))
-     */
-    if (InputDevIsMaster(pDev))
-        size = sizeof(INT32) * 3 * MAX_VALUATORS;
-    else {
-        ValuatorClassPtr v = pDev->valuator;
-        int numAxes;
-
-        /* XI1 doesn't understand mixed mode devices */
-        for (numAxes = 0; numAxes < v->numAxes; numAxes++)
-            if (valuator_get_mode(pDev, numAxes) != valuator_get_mode(pDev, 0))
-                break;
-        size = sizeof(INT32) * numAxes;
-    }
-
-    size += sizeof(Time);
+    size = motionEntrySize(pDev);
 
     pDev->valuator->motion = calloc(pDev->valuator->numMotionEvents, size);
-    pDev->valuator->first_motion = 0;
-    pDev->valuator->last_motion = 0;
-    if (!pDev->valuator->motion)
+    if (!pDev->valuator->motion) {
         ErrorF("[dix] %s: Failed to alloc motion history (%d bytes).\n",
                pDev->name, size * pDev->valuator->numMotionEvents);
+        pDev->valuator->numMotionEvents = 0;
+    }
+}
+
+/**
+ * Change the number of motion history events stored for the device.
+ * The existing history is discarded.
+ *
+ * @return FALSE if the device has no valuators or the allocation failed.
+ */
+Bool
+SetMotionHistorySize(DeviceIntPtr pDev, int size)
+{
+    if (!pDev->valuator || size < 0)
+        return FALSE;
+
+    pDev->valuator->numMotionEvents = size;
+    AllocateMotionHistory(pDev);
+
+    return pDev->valuator->numMotionEvents == size;
+}
+
+/**
+ * Scale a stored [min_val, max_val, val] triple to core coordinates on a
+ * screen dimension of screen_size.
+ */
+static INT16
+motionCoreCoord(const char *ibuff, int screen_size)
+{
+    AxisInfo from = { 0 }, to = { 0 };
+    INT32 coord;
+
+    memcpy(&from.min_value, ibuff, sizeof(INT32));
+    memcpy(&from.max_value, ibuff + sizeof(INT32), sizeof(INT32));
+    memcpy(&coord, ibuff + 2 * sizeof(INT32), sizeof(INT32));
+    to.max_value = screen_size;
+
+    return (int) rescaleValuatorAxis(coord, &from, &to, 0, screen_size);
+}
+
+/**
+ * Return the idx'th oldest entry in the motion history.
+ */
+static inline char *
+motionEntry(ValuatorClassPtr v, int size, int idx)
+{
+    return (char *) v->motion + ((v->first_motion + idx) % v->numMotionEvents) * size;
+}
+
+/**
+ * Binary search the count entries of the motion history, which are stored
+ * in chronological order, for the first one with a timestamp at or after
+ * time. If after is set, entries with a timestamp equal to time are
+ * skipped too.
+ */
+static int
+motionHistorySearch(ValuatorClassPtr v, int size, int count,
+                    unsigned long time, Bool after)
+{
+    int lo = 0, hi = count;
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        Time current;
+
+        memcpy(&current, motionEntry(v, size, mid), sizeof(Time));
+        if (current < time || (after && current == time))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
 }
 
 /**
@@ -402,123 +476,105 @@ int
 GetMotionHistory(DeviceIntPtr pDev, xTimecoord ** buff, unsigned long start,
                  unsigned long stop, ScreenPtr pScreen, BOOL core)
 {
-    char *ibuff = NULL, *obuff;
-    int ret = 0;
+    ValuatorClassPtr v = pDev->valuator;
+    char *ibuff, *obuff;
     int coord;
-    Time current;
+    int count, first, last;
 
-    /* The size of a single motion event. */
-    int size;
-    AxisInfo from, *to;         /* for scaling */
-    INT32 *ocbuf, *icbuf;       /* pointer to coordinates for copying */
-    INT16 *corebuf;
-    AxisInfo core_axis = { 0 };
+    /* The size of a single motion event, stored and returned. */
+    int size, osize;
+    AxisInfo from;              /* for scaling */
+    INT32 *ocbuf;
+    const char *icbuf;          /* pointer to coordinates for copying */
 
-    if (!pDev->valuator || !pDev->valuator->numMotionEvents)
+    if (!v || !v->numMotionEvents || !v->motion)
         return 0;
 
     if (core && !pScreen)
         return 0;
 
-    if (InputDevIsMaster(pDev))
-        size = (sizeof(INT32) * 3 * MAX_VALUATORS) + sizeof(Time);
+    size = motionEntrySize(pDev);
+    if (core)
+        osize = sizeof(Time) + 2 * sizeof(INT16);
     else
-        size = (sizeof(INT32) * pDev->valuator->numAxes) + sizeof(Time);
+        osize = sizeof(Time) + sizeof(INT32) * v->numAxes;
 
-    *buff = calloc(size, pDev->valuator->numMotionEvents);
+    count = (v->last_motion - v->first_motion + v->numMotionEvents) %
+        v->numMotionEvents;
+    first = motionHistorySearch(v, size, count, start, FALSE);
+    last = motionHistorySearch(v, size, count, stop, TRUE);
+    if (first >= last)
+        return 0;
+
+    *buff = calloc(last - first, osize);
     if (!(*buff))
         return 0;
     obuff = (char *) *buff;
 
-    for (int i = pDev->valuator->first_motion;
-         i != pDev->valuator->last_motion;
-         i = (i + 1) % pDev->valuator->numMotionEvents) {
+    if (!core && !InputDevIsMaster(pDev)) {
+        /* SD entries are stored as returned, copy the (at most two)
+         * contiguous runs of the ring */
+        int idx = (v->first_motion + first) % v->numMotionEvents;
+        int n = min(last - first, v->numMotionEvents - idx);
+
+        memcpy(obuff, (char *) v->motion + idx * size, n * size);
+        if (n < last - first)
+            memcpy(obuff + n * size, v->motion, (last - first - n) * size);
+
+        return last - first;
+    }
+
+    for (int i = first; i < last; i++) {
         /* We index the input buffer by which element we're accessing, which
          * is not monotonic, and the output buffer by how many events we've
          * written so far. */
-        ibuff = (char *) pDev->valuator->motion + (i * size);
-        memcpy(&current, ibuff, sizeof(Time));
+        ibuff = motionEntry(v, size, i);
+        memcpy(obuff, ibuff, sizeof(Time));     /* copy timestamp */
+        icbuf = ibuff + sizeof(Time) + MOTION_CORE_SIZE;
+
+        if (core) {
+            INT16 corebuf[4];
+
+            /* use the coordinates scaled at insertion time if they were
+             * scaled for a screen of this size */
+            memcpy(corebuf, ibuff + sizeof(Time), sizeof(corebuf));
+            if (corebuf[2] != pScreen->width || corebuf[3] != pScreen->height) {
+                corebuf[0] = motionCoreCoord(icbuf, pScreen->width);
+                corebuf[1] = motionCoreCoord(icbuf + 3 * sizeof(INT32),
+                                             pScreen->height);
+            }
 
-        if (current > stop) {
-            return ret;
+            memcpy(obuff + sizeof(Time), corebuf, 2 * sizeof(INT16));
         }
-        else if (current >= start) {
-            if (core) {
-                memcpy(obuff, ibuff, sizeof(Time));     /* copy timestamp */
-
-                icbuf = (INT32 *) (ibuff + sizeof(Time));
-                corebuf = (INT16 *) (obuff + sizeof(Time));
-
-                /* fetch x coordinate + range */
-                memcpy(&from.min_value, icbuf++, sizeof(INT32));
-                memcpy(&from.max_value, icbuf++, sizeof(INT32));
-                memcpy(&coord, icbuf++, sizeof(INT32));
-
-                /* scale to screen coords */
-                to = &core_axis;
-                to->max_value = pScreen->width;
-                coord =
-                    rescaleValuatorAxis(coord, &from, to, 0, pScreen->width);
-
-                memcpy(corebuf, &coord, sizeof(INT16));
-                corebuf++;
-
-                /* fetch y coordinate + range */
-                memcpy(&from.min_value, icbuf++, sizeof(INT32));
-                memcpy(&from.max_value, icbuf++, sizeof(INT32));
-                memcpy(&coord, icbuf++, sizeof(INT32));
-
-                to->max_value = pScreen->height;
-                coord =
-                    rescaleValuatorAxis(coord, &from, to, 0, pScreen->height);
-                memcpy(corebuf, &coord, sizeof(INT16));
-
-            }
-            else if (InputDevIsMaster(pDev)) {
-                memcpy(obuff, ibuff, sizeof(Time));     /* copy timestamp */
-
-                ocbuf = (INT32 *) (obuff + sizeof(Time));
-                icbuf = (INT32 *) (ibuff + sizeof(Time));
-                for (int j = 0; j < MAX_VALUATORS; j++) {
-                    if (j >= pDev->valuator->numAxes)
-                        break;
-
-                    /* fetch min/max/coordinate */
-                    memcpy(&from.min_value, icbuf++, sizeof(INT32));
-                    memcpy(&from.max_value, icbuf++, sizeof(INT32));
-                    memcpy(&coord, icbuf++, sizeof(INT32));
-
-                    to = (j <
-                          pDev->valuator->numAxes) ? &pDev->valuator->
-                        axes[j] : NULL;
-
-                    /* x/y scaled to screen if no range is present */
-                    if (j == 0 && (from.max_value < from.min_value))
-                        from.max_value = pScreen->width;
-                    else if (j == 1 && (from.max_value < from.min_value))
-                        from.max_value = pScreen->height;
-
-                    /* scale from stored range into current range */
-                    coord = rescaleValuatorAxis(coord, &from, to, 0, 0);
-                    memcpy(ocbuf, &coord, sizeof(INT32));
-                    ocbuf++;
-                }
+        else {
+            ocbuf = (INT32 *) (obuff + sizeof(Time));
+            for (int j = 0; j < v->numAxes && j < MAX_VALUATORS; j++) {
+                /* fetch min/max/coordinate */
+                memcpy(&from.min_value, icbuf, sizeof(INT32));
+                memcpy(&from.max_value, icbuf + sizeof(INT32), sizeof(INT32));
+                memcpy(&coord, icbuf + 2 * sizeof(INT32), sizeof(INT32));
+                icbuf += 3 * sizeof(INT32);
+
+                /* x/y scaled to screen if no range is present */
+                if (pScreen && j == 0 && (from.max_value < from.min_value))
+                    from.max_value = pScreen->width;
+                else if (pScreen && j == 1 &&
+                         (from.max_value < from.min_value))
+                    from.max_value = pScreen->height;
+
+                /* scale from stored range into current range */
+                coord = rescaleValuatorAxis(coord, &from, &v->axes[j], 0, 0);
+                memcpy(ocbuf, &coord, sizeof(INT32));
+                ocbuf++;
             }
-            else
-                memcpy(obuff, ibuff, size);
-
-            /* don't advance by size here. size may be different to the
-             * actually written size if the MD has less valuators than MAX */
-            if (core)
-                obuff += sizeof(INT32) + sizeof(Time);
-            else
-                obuff +=
-                    (sizeof(INT32) * pDev->valuator->numAxes) + sizeof(Time);
-            ret++;
         }
+
+        /* don't advance by size here. size may be different to the
+         * actually written size if the MD has less valuators than MAX */
+        obuff += osize;
     }
 
-    return ret;
+    return last - first;
 }
 
 /**
@@ -527,7 +583,12 @@ GetMotionHistory(DeviceIntPtr pDev, xTimecoord ** buff, unsigned long start,
  *
  * Layout of the history buffer:
  *   for SDs: [time] [val0] [val1] ... [valn]
- *   for MDs: [time] [min_val0] [max_val0] [val0] [min_val1] ... [valn]
+ *   for MDs: [time] [core x] [core y] [core width] [core height]
+ *            [min_val0] [max_val0] [val0] [min_val1] ... [valn]
+ *
+ * The core fields hold x/y scaled to the master screen, whose width and
+ * height are stored alongside, so that core GetMotionEvents requests can
+ * skip the rescaling.
  *
  * For events that have some valuators unset:
  *      min_val == max_val == val == 0.
@@ -538,20 +599,26 @@ updateMotionHistory(DeviceIntPtr pDev, CARD32 ms, ValuatorMask *mask,
 {
     char *buff = (char *) pDev->valuator->motion;
     ValuatorClassPtr v;
+    int size;
 
-    if (!pDev->valuator->numMotionEvents)
+    if (!pDev->valuator->numMotionEvents || !buff)
         return;
 
     v = pDev->valuator;
-    if (InputDevIsMaster(pDev)) {
-        buff += ((sizeof(INT32) * 3 * MAX_VALUATORS) + sizeof(CARD32)) *
-            v->last_motion;
+    size = motionEntrySize(pDev);
+    buff += size * v->last_motion;
 
-        memcpy(buff, &ms, sizeof(Time));
-        buff += sizeof(Time);
+    memcpy(buff, &ms, sizeof(Time));
+    buff += sizeof(Time);
 
-        memset(buff, 0, sizeof(INT32) * 3 * MAX_VALUATORS);
+    if (InputDevIsMaster(pDev)) {
+        char *axes = buff + MOTION_CORE_SIZE;
+        ScreenPtr pScreen = dixGetMasterScreen();
+        INT16 corebuf[4] = { 0 };
+
+        memset(axes, 0, sizeof(INT32) * 3 * MAX_VALUATORS);
 
+        buff = axes;
         for (int i = 0; i < v->numAxes; i++) {
             int val;
 
@@ -570,18 +637,20 @@ updateMotionHistory(DeviceIntPtr pDev, CARD32 ms, ValuatorMask *mask,
             memcpy(buff, &val, sizeof(INT32));
             buff += sizeof(INT32);
         }
+
+        if (pScreen) {
+            corebuf[0] = motionCoreCoord(axes, pScreen->width);
+            corebuf[1] = motionCoreCoord(axes + 3 * sizeof(INT32),
+                                         pScreen->height);
+            corebuf[2] = pScreen->width;
+            corebuf[3] = pScreen->height;
+        }
+        memcpy(axes - MOTION_CORE_SIZE, corebuf, sizeof(corebuf));
     }
     else {
+        memset(buff, 0, sizeof(INT32) * v->numAxes);
 
-        buff += ((sizeof(INT32) * pDev->valuator->numAxes) + sizeof(CARD32)) *
-            pDev->valuator->last_motion;
-
-        memcpy(buff, &ms, sizeof(Time));
-        buff += sizeof(Time);
-
-        memset(buff, 0, sizeof(INT32) * pDev->valuator->numAxes);
-
-        for (int i = 0; i < MAX_VALUATORS; i++) {
+        for (int i = 0; i < v->numAxes; i++) {
             int val;
 
             if (valuator_mask_size(mask) <= i || !valuator_mask_isset(mask, i)) {
@@ -1147,20 +1216,6 @@ FreeEventList(InternalEvent *list, int num_events)
     free(list);
 }
 
-/**
- * Transform vector x/y according to matrix m and drop the rounded coords
- * back into x/y.
- */
-static void
-transform(struct pixman_f_transform *m, double *x, double *y)
-{
-    struct pixman_f_vector p = {.v = {*x, *y, 1} };
-    pixman_f_transform_point(m, &p);
-
-    *x = p.v[0];
-    *y = p.v[1];
-}
-
 static void
 transformRelative(DeviceIntPtr dev, ValuatorMask *mask)
 {
@@ -1169,7 +1224,8 @@ transformRelative(DeviceIntPtr dev, ValuatorMask *mask)
     valuator_mask_fetch_double(mask, 0, &x);
     valuator_mask_fetch_double(mask, 1, &y);
 
-    transform(&dev->relative_transform, &x, &y);
+    if (!dev->relative_transform_is_identity)
+        transform_point(&dev->relative_transform, &x, &y);
 
     if (x)
         valuator_mask_set_double(mask, 0, x);
@@ -1202,15 +1258,16 @@ transformAbsolute(DeviceIntPtr dev, ValuatorMask *mask)
     if (!has_x && !has_y)
         return;
 
-    if (!has_x || !has_y) {
-        struct pixman_f_transform invert;
+    /* x/y are passed through unchanged */
+    if (dev->scale_and_transform_is_identity)
+        return;
 
+    if (!has_x || !has_y) {
         /* undo transformation from last event */
         ox = dev->last.valuators[0];
         oy = dev->last.valuators[1];
 
-        pixman_f_transform_invert(&invert, &dev->scale_and_transform);
-        transform(&invert, &ox, &oy);
+        transform_point(&dev->scale_and_transform_inverse, &ox, &oy);
     }
 
     if (has_x)
@@ -1222,7 +1279,7 @@ transformAbsolute(DeviceIntPtr dev, ValuatorMask *mask)
     x = ox;
     y = oy;
 
-    transform(&dev->scale_and_transform, &x, &y);
+    transform_point(&dev->scale_and_transform, &x, &y);
 
     if (has_x || ox != x)
         valuator_mask_set_double(mask, 0, x);
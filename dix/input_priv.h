@@ -107,6 +107,8 @@ InternalEvent *UpdateFromMaster(InternalEvent *events,
                                 int type,
                                 int *num_events);
 
+Bool SetMotionHistorySize(DeviceIntPtr pDev, int size);
+
 void PostSyntheticMotion(DeviceIntPtr pDev,
                          int x,
                          int y,
@@ -996,6 +996,42 @@ input_option_set_value(InputOption *opt, const char *value)
     opt->opt_val = (value ? strdup(value) : NULL);
 }
 
+/**
+ * Transform the point x/y by the matrix m in place. Points the
+ * transformation is undefined for are left untouched.
+ *
+ * Affine matrices, i.e. all but user-supplied projective transformation
+ * matrices, skip the projection. The result is that of
+ * pixman_f_transform_point() up to rounding, the compiler may contract
+ * either into fused multiply-adds.
+ */
+void
+transform_point(const struct pixman_f_transform *m, double *x, double *y)
+{
+    struct pixman_f_vector p = {.v = {*x, *y, 1} };
+
+    if (m->m[2][0] == 0 && m->m[2][1] == 0 && m->m[2][2] == 1) {
+        *x = m->m[0][0] * p.v[0] + m->m[0][1] * p.v[1] + m->m[0][2];
+        *y = m->m[1][0] * p.v[0] + m->m[1][1] * p.v[1] + m->m[1][2];
+        return;
+    }
+
+    if (pixman_f_transform_point(m, &p)) {
+        *x = p.v[0];
+        *y = p.v[1];
+    }
+}
+
+Bool
+transform_is_identity(const struct pixman_f_transform *m)
+{
+    for (int y = 0; y < 3; y++)
+        for (int x = 0; x < 3; x++)
+            if (m->m[y][x] != (x == y ? 1.0 : 0.0))
+                return FALSE;
+    return TRUE;
+}
+
 /* FP1616/FP3232 conversion functions.
  * Fixed point types are encoded as signed integral and unsigned frac. So any
  * negative number -n.m is encoded as floor(n) + (1 - 0.m).
@@ -24,6 +24,8 @@
 #ifndef _XSERVER_DIX_INPUTUTILS_PRIV_H
 #define _XSERVER_DIX_INPUTUTILS_PRIV_H
 
+#include <pixman.h>
+
 #include "input.h"
 #include "eventstr.h"
 #include <X11/extensions/XI2proto.h>
@@ -54,6 +56,9 @@ FP1616 double_to_fp1616(double in);
 double fp1616_to_double(FP1616 in);
 double fp3232_to_double(FP3232 in);
 
+void transform_point(const struct pixman_f_transform *m, double *x, double *y);
+Bool transform_is_identity(const struct pixman_f_transform *m);
+
 XI2Mask *xi2mask_new(void);
 XI2Mask *xi2mask_new_with_size(size_t, size_t); /* don't use it */
 void xi2mask_free(XI2Mask **mask);
@@ -96,6 +96,9 @@ Equipment Corporation.
 #include "dix/screensaver_priv.h"
 #include "dix/selection_priv.h"
 #include "dix/server_priv.h"
+#include "dix/settings_priv.h"
+#include "dix/slab_priv.h"
+#include "dix/trace_priv.h"
 #include "include/extinit.h"
 #include "include/misc.h"
 #include "os/audit_priv.h"
@@ -190,6 +193,8 @@ dix_main(int argc, char *argv[], char *envp[])
     dixResetRegistry();
     InitFonts();
     InitCallbackManager();
+    TraceInit();
+    SlabInit();
     InitOutput(argc, argv);
 
     if (screenInfo.numScreens < 1)
@@ -199,6 +204,10 @@ dix_main(int argc, char *argv[], char *envp[])
     InitExtensions(argc, argv);
     LogMessageVerb(X_INFO, 1, "Extensions initialized\n");
 
+    /* Group the hot privates before the first pixmaps and windows exist */
+    if (dixSettingLayoutPrivates)
+        dixLayoutPrivates();
+
     DIX_FOR_EACH_GPU_SCREEN({
         if (!PixmapScreenInit(walkScreen))
             FatalError("failed to create screen pixmap properties");
@@ -286,6 +295,8 @@ dix_main(int argc, char *argv[], char *envp[])
     /* call the server's main loop */
     Dispatch();
 
+    TraceStop();
+
     UnrefCursor(rootCursor);
     UndisplayDevices();
     DisableAllDevices();
@@ -307,6 +318,7 @@ dix_main(int argc, char *argv[], char *envp[])
 #else
     FreeAllResources();
 #endif /* XINERAMA */
+    FlushKeptFonts();
 
     CloseInput();
 
@@ -335,6 +347,8 @@ dix_main(int argc, char *argv[], char *envp[])
     }
     memset(&screenInfo.screens, 0, sizeof(screenInfo.screens));
 
+    SlabReset();
+
     ReleaseClientIds(serverClient);
     dixFreePrivates(serverClient->devPrivates, PRIVATE_CLIENT);
     serverClient->devPrivates = NULL;
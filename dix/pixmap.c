@@ -32,6 +32,7 @@ from The Open Group.
 #include <X11/X.h>
 #include <X11/extensions/render.h>
 
+#include "dix/slab_priv.h"
 #include "include/misc.h"
 #include "include/randrstr.h"
 #include "mi/mi_priv.h"
@@ -100,14 +101,24 @@ PixmapScreenInit(ScreenPtr pScreen)
 PixmapPtr
 AllocatePixmap(ScreenPtr pScreen, int pixDataSize)
 {
-    PixmapPtr pPixmap;
+    PixmapPtr pPixmap = NULL;
 
     assert(pScreen->totalPixmapSize > 0);
 
     if (pScreen->totalPixmapSize > ((size_t) - 1) - pixDataSize)
         return NullPixmap;
 
-    pPixmap = calloc(1, pScreen->totalPixmapSize + pixDataSize);
+    /* Pixmaps without pixel data, i.e. ones the driver keeps elsewhere,
+     * are just headers and come from a slab cache */
+    if (pixDataSize == 0) {
+        SlabCachePtr cache = SlabCacheGet(PRIVATE_PIXMAP,
+                                          pScreen->totalPixmapSize, 0);
+
+        if (cache)
+            pPixmap = SlabAlloc(cache);
+    }
+    if (!pPixmap)
+        pPixmap = calloc(1, pScreen->totalPixmapSize + pixDataSize);
     if (!pPixmap)
         return NullPixmap;
 
@@ -120,7 +131,8 @@ void
 FreePixmap(PixmapPtr pPixmap)
 {
     dixFiniPrivates(pPixmap, PRIVATE_PIXMAP);
-    free(pPixmap);
+    if (!SlabFree(pPixmap))
+        free(pPixmap);
 }
 
 void PixmapUnshareSecondaryPixmap(PixmapPtr secondary_pixmap)
@@ -55,6 +55,7 @@ from The Open Group.
 
 #include "dix/colormap_priv.h"
 #include "dix/screenint_priv.h"
+#include "dix/slab_priv.h"
 
 #include "windowstr.h"
 #include "resource.h"
@@ -68,6 +69,17 @@ from The Open Group.
 
 static DevPrivateSetRec global_keys[PRIVATE_LAST];
 
+/* Keys marked with dixSetPrivateKeyHot(), grouped at the start of the
+ * private block by dixLayoutPrivates() */
+#define PRIVATE_HOT_MAX 64
+static DevPrivateKey hot_keys[PRIVATE_HOT_MAX];
+static int num_hot_keys;
+
+/* Types whose keys have been laid out. Their objects are cache line
+ * aligned, so the hot keys share as few lines as possible */
+#define PRIVATE_CACHE_LINE 64
+static Bool laid_out[PRIVATE_LAST];
+
 static const Bool xselinux_private[PRIVATE_LAST] = {
     [PRIVATE_SCREEN] = TRUE,
     [PRIVATE_CLIENT] = TRUE,
@@ -113,6 +125,13 @@ static const char *key_names[PRIVATE_LAST] = {
     [PRIVATE_SYNC_FENCE] = "SYNC_FENCE",
 };
 
+/* Objects allocated from slab caches, see also AllocatePixmap() */
+static const Bool slab_private[PRIVATE_LAST] = {
+    [PRIVATE_WINDOW] = TRUE,
+    [PRIVATE_GC] = TRUE,
+    [PRIVATE_PICTURE] = TRUE,
+};
+
 static const Bool screen_specific_private[PRIVATE_LAST] = {
     [PRIVATE_SCREEN] = FALSE,
     [PRIVATE_CLIENT] = FALSE,
@@ -206,6 +225,14 @@ fixupOneScreen(ScreenPtr pScreen, FixupFunc fixup, unsigned bytes)
                     *keyp = key;
                 }
             }
+
+        /* The hot key table points at the same keys */
+        for (int i = 0; i < num_hot_keys; i++) {
+            uintptr_t key = (uintptr_t) hot_keys[i];
+
+            if (old <= key && key < old + size)
+                hot_keys[i] = (DevPrivateKey) (new + (key - old));
+        }
     }
     return TRUE;
 }
@@ -287,26 +314,42 @@ static Bool (*const allocated_early[PRIVATE_LAST]) (FixupFunc, unsigned) = {
     [PRIVATE_DEVICE] = fixupDevices,
 };
 
+/*
+ * Move the keys at or above 'from' up by 'bytes'. Once the keys have been
+ * laid out, hot screen-specific keys live below the cold global keys and
+ * must stay where they are when another global key is appended.
+ */
 static void
-grow_private_set(DevPrivateSetPtr set, unsigned bytes)
+grow_private_set(DevPrivateSetPtr set, int from, unsigned bytes)
 {
     for (DevPrivateKey k = set->key; k; k = k->next)
-        k->offset += bytes;
+        if (k->offset >= from)
+            k->offset += bytes;
     set->offset += bytes;
 }
 
 static void
-grow_screen_specific_set(DevPrivateType type, unsigned bytes)
+grow_screen_specific_set(DevPrivateType type, int from, unsigned bytes)
 {
     /* Update offsets for all screen-specific keys */
     DIX_FOR_EACH_SCREEN({
-        grow_private_set(&walkScreen->screenSpecificPrivates[type], bytes);
+        grow_private_set(&walkScreen->screenSpecificPrivates[type], from, bytes);
     });
     DIX_FOR_EACH_GPU_SCREEN({
-        grow_private_set(&walkScreen->screenSpecificPrivates[type], bytes);
+        grow_private_set(&walkScreen->screenSpecificPrivates[type], from, bytes);
     });
 }
 
+static unsigned
+private_bytes(unsigned size)
+{
+    if (size == 0)
+        size = sizeof(void *);
+
+    /* align to pointer size */
+    return (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+}
+
 Bool
 dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
 {
@@ -319,12 +362,7 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
     }
 
     /* Compute required space */
-    bytes = size;
-    if (size == 0)
-        bytes = sizeof(void *);
-
-    /* align to pointer size */
-    bytes = (bytes + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    bytes = private_bytes(size);
 
     /* Update offsets for all affected keys */
     if (type == PRIVATE_XSELINUX) {
@@ -347,8 +385,8 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
          */
         for (DevPrivateType t = PRIVATE_XSELINUX; t < PRIVATE_LAST; t++) {
             if (xselinux_private[t]) {
-                grow_private_set(&global_keys[t], bytes);
-                grow_screen_specific_set(t, bytes);
+                grow_private_set(&global_keys[t], 0, bytes);
+                grow_screen_specific_set(t, 0, bytes);
                 if (allocated_early[t])
                     allocated_early[t] (dixMovePrivates, bytes);
             }
@@ -365,7 +403,7 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
             return FALSE;
         offset = global_keys[type].offset;
         global_keys[type].offset += bytes;
-        grow_screen_specific_set(type, bytes);
+        grow_screen_specific_set(type, offset, bytes);
     }
 
     /* Setup this key */
@@ -412,6 +450,71 @@ _dixGetScreenPrivateKey(const DevScreenPrivateKeyPtr key, ScreenPtr pScreen)
     return dixGetPrivate(&pScreen->devPrivates, &key->screenKey);
 }
 
+void
+dixSetPrivateKeyHot(DevPrivateKey key)
+{
+    assert(key->initialized);
+
+    for (int i = 0; i < num_hot_keys; i++)
+        if (hot_keys[i] == key)
+            return;
+
+    if (num_hot_keys < PRIVATE_HOT_MAX)
+        hot_keys[num_hot_keys++] = key;
+}
+
+static Bool
+private_key_hot(DevPrivateKey key)
+{
+    for (int i = 0; i < num_hot_keys; i++)
+        if (hot_keys[i] == key)
+            return TRUE;
+    return FALSE;
+}
+
+/*
+ * Allocate a zeroed object followed by its privates. Once the keys of
+ * the type have been laid out, the object is cache line aligned and its
+ * privates start on a cache line of their own.
+ *
+ * Windows, GCs and pictures come from slab caches, which are freed to
+ * by _dixFreeObjectWithPrivates().
+ */
+static void *
+alloc_object_with_privates(unsigned *baseSize, int privates_size,
+                           DevPrivateType type)
+{
+    void *object;
+    unsigned totalSize;
+    unsigned align = sizeof(void *);
+
+#ifdef HAVE_POSIX_MEMALIGN
+    if (laid_out[type] && privates_size)
+        align = PRIVATE_CACHE_LINE;
+#endif
+
+    *baseSize = (*baseSize + align - 1) & ~(align - 1);
+    totalSize = *baseSize + privates_size;
+
+    if (slab_private[type]) {
+        SlabCachePtr cache = SlabCacheGet(type, totalSize, align);
+
+        if (cache && (object = SlabAlloc(cache)))
+            return object;
+    }
+
+#ifdef HAVE_POSIX_MEMALIGN
+    if (align > sizeof(void *)) {
+        if (posix_memalign(&object, align, totalSize))
+            return NULL;
+        memset(object, '\0', totalSize);
+        return object;
+    }
+#endif
+
+    return calloc(1, totalSize);
+}
+
 /*
  * Initialize privates by zeroing them
  */
@@ -451,7 +554,6 @@ void *
 _dixAllocateObjectWithPrivates(unsigned baseSize, unsigned clear,
                                unsigned offset, DevPrivateType type)
 {
-    unsigned totalSize;
     PrivatePtr privates;
     PrivatePtr *devPrivates;
 
@@ -459,10 +561,8 @@ _dixAllocateObjectWithPrivates(unsigned baseSize, unsigned clear,
     assert(type < PRIVATE_LAST);
     assert(!screen_specific_private[type]);
 
-    /* round up so that void * is aligned */
-    baseSize = (baseSize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
-    totalSize = baseSize + global_keys[type].offset;
-    void *object = calloc(1, totalSize);
+    void *object = alloc_object_with_privates(&baseSize,
+                                              global_keys[type].offset, type);
     if (!object)
         return NULL;
 
@@ -515,7 +615,8 @@ _dixFreeObjectWithPrivates(void *object, PrivatePtr privates,
                            DevPrivateType type)
 {
     _dixFiniPrivates(privates, type);
-    free(object);
+    if (!SlabFree(object))
+        free(object);
 }
 
 /*
@@ -596,12 +697,7 @@ dixRegisterScreenSpecificPrivateKey(ScreenPtr pScreen, DevPrivateKey key,
     }
 
     /* Compute required space */
-    bytes = size;
-    if (size == 0)
-        bytes = sizeof(void *);
-
-    /* align to void * size */
-    bytes = (bytes + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    bytes = private_bytes(size);
 
     assert (!allocated_early[type]);
     assert (!pScreen->screenSpecificPrivates[type].created);
@@ -669,7 +765,6 @@ _dixAllocateScreenObjectWithPrivates(ScreenPtr pScreen,
                                      unsigned offset,
                                      DevPrivateType type)
 {
-    unsigned totalSize;
     PrivatePtr privates;
     PrivatePtr *devPrivates;
     int privates_size;
@@ -682,10 +777,7 @@ _dixAllocateScreenObjectWithPrivates(ScreenPtr pScreen,
         privates_size = pScreen->screenSpecificPrivates[type].offset;
     else
         privates_size = global_keys[type].offset;
-    /* round up so that pointer is aligned */
-    baseSize = (baseSize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
-    totalSize = baseSize + privates_size;
-    void *object = calloc(1, totalSize);
+    void *object = alloc_object_with_privates(&baseSize, privates_size, type);
     if (!object)
         return NULL;
 
@@ -730,6 +822,99 @@ dixPrivateUsage(void)
     ErrorF("TOTAL: %d objects, %d bytes, %d allocs\n", objects, bytes, alloc);
 }
 
+/*
+ * Assign consecutive offsets, starting at 'offset', to the keys of the set
+ * that are (or are not) hot. Returns the end of the assigned range.
+ */
+static int
+layout_keys(DevPrivateSetPtr set, Bool hot, int offset)
+{
+    for (DevPrivateKey key = set->key; key; key = key->next)
+        if (private_key_hot(key) == hot) {
+            key->offset = offset;
+            offset += private_bytes(key->size);
+        }
+    return offset;
+}
+
+static Bool
+layout_type(DevPrivateType type)
+{
+    DevPrivateSetPtr global = &global_keys[type];
+    Bool specific = screen_specific_private[type];
+    Bool hot = FALSE;
+    int offset, hot_end;
+
+    /* The XSELinux keys stay at the bottom, everything else is ours */
+    offset = global->offset;
+    for (DevPrivateKey key = global->key; key; key = key->next) {
+        offset = min(offset, key->offset);
+        hot = hot || private_key_hot(key);
+    }
+
+    if (specific) {
+        DIX_FOR_EACH_SCREEN({
+            for (DevPrivateKey key = walkScreen->screenSpecificPrivates[type].key;
+                 key; key = key->next)
+                hot = hot || private_key_hot(key);
+        });
+        DIX_FOR_EACH_GPU_SCREEN({
+            for (DevPrivateKey key = walkScreen->screenSpecificPrivates[type].key;
+                 key; key = key->next)
+                hot = hot || private_key_hot(key);
+        });
+    }
+
+    if (!hot)
+        return FALSE;
+
+    /* Hot global keys first, then each screen's hot keys, then the rest.
+     * Every screen's hot keys start at the same offset, the cold global
+     * keys go above the largest of them. */
+    offset = layout_keys(global, TRUE, offset);
+    hot_end = offset;
+    if (specific) {
+        DIX_FOR_EACH_SCREEN({
+            offset = max(offset,
+                         layout_keys(&walkScreen->screenSpecificPrivates[type],
+                                     TRUE, hot_end));
+        });
+        DIX_FOR_EACH_GPU_SCREEN({
+            offset = max(offset,
+                         layout_keys(&walkScreen->screenSpecificPrivates[type],
+                                     TRUE, hot_end));
+        });
+    }
+    global->offset = layout_keys(global, FALSE, offset);
+
+    if (specific) {
+        DIX_FOR_EACH_SCREEN({
+            DevPrivateSetPtr set = &walkScreen->screenSpecificPrivates[type];
+            set->offset = layout_keys(set, FALSE, global->offset);
+        });
+        DIX_FOR_EACH_GPU_SCREEN({
+            DevPrivateSetPtr set = &walkScreen->screenSpecificPrivates[type];
+            set->offset = layout_keys(set, FALSE, global->offset);
+        });
+    }
+
+    return TRUE;
+}
+
+void
+dixLayoutPrivates(void)
+{
+    for (DevPrivateType t = PRIVATE_XSELINUX + 1; t < PRIVATE_LAST; t++) {
+        /* Keys of objects that already exist cannot be moved */
+        if (allocated_early[t] || global_keys[t].created || laid_out[t])
+            continue;
+        laid_out[t] = layout_type(t);
+        if (laid_out[t])
+            LogMessageVerb(X_INFO, 4, "%s privates: %d bytes, hot keys first\n",
+                           key_names[t], global_keys[t].offset);
+    }
+}
+
 void
 dixResetPrivates(void)
 {
@@ -752,7 +937,9 @@ dixResetPrivates(void)
         global_keys[t].offset = 0;
         global_keys[t].created = 0;
         global_keys[t].allocated = 0;
+        laid_out[t] = FALSE;
     }
+    num_hot_keys = 0;
 }
 
 Bool
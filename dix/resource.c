@@ -127,6 +127,7 @@ Equipment Corporation.
 #include "dix/gc_priv.h"
 #include "dix/registry_priv.h"
 #include "dix/resource_priv.h"
+#include "dix/trace_priv.h"
 #include "include/extinit.h"
 #include "include/misc.h"
 #include "os/osdep.h"
@@ -1262,6 +1263,7 @@ dixLookupResourceByType(void **result, XID id, RESTYPE rtype,
             return cid;
     }
 
+    TraceResource(id);
     *result = res->value;
     return Success;
 }
@@ -1295,6 +1297,7 @@ dixLookupResourceByClass(void **result, XID id, RESTYPE rclass,
             return cid;
     }
 
+    TraceResource(id);
     *result = res->value;
     return Success;
 }
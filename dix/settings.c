@@ -16,4 +16,6 @@
 #include "dix/settings_priv.h"
 
 bool dixSettingAllowByteSwappedClients = false;
+bool dixSettingLayoutPrivates = true;
 char *dixSettingSeatId = NULL;
+bool dixSettingShmPutImageStrips = false;
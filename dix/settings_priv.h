@@ -15,6 +15,8 @@
  */
 
 extern bool dixSettingAllowByteSwappedClients;
+extern bool dixSettingLayoutPrivates;
 extern char *dixSettingSeatId;
+extern bool dixSettingShmPutImageStrips;
 
 #endif
@@ -0,0 +1,420 @@
+/* SPDX-License-Identifier: X11 OR MIT OR AGPL-3.0-or-later
+ */
+#include <dix-config.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dix/dix_priv.h"
+#include "dix/slab_priv.h"
+
+#include "dixstruct.h"
+#include "list.h"
+#include "privates.h"
+
+/*
+ * Slabs are SLAB_SIZE aligned, so the slab of an object is found by
+ * masking its address. Whether that address is a slab at all is looked up
+ * in a hash set of the slab addresses, as the objects of a type can also
+ * come from malloc (too big, too many caches, no posix_memalign).
+ *
+ * Objects are handed out from the front of a fresh slab, so a slab only
+ * touches as many pages as it ever had objects, and from the partially
+ * used slabs in the order they filled up, so the slabs left half empty
+ * after a burst drain and get released. Each cache keeps at most one empty
+ * slab around.
+ */
+#define SLAB_SIZE               (64 << 10)
+#define SLAB_MAX_OBJECT         (SLAB_SIZE / 8)
+#define SLAB_MAX_CACHES         16
+#define SLAB_MAGAZINE_SIZE      8
+
+typedef struct _Slab {
+    struct xorg_list entry;     /* in the partial or full list */
+    SlabCachePtr cache;
+    void *free;                 /* linked through the first word */
+    unsigned inUse;
+    unsigned untouched;         /* index of the first never used object */
+} SlabRec, *SlabPtr;
+
+typedef struct {
+    DevPrivateType type;
+    CARD32 objectSize;
+    CARD32 slabs;
+    CARD32 inUse;           /* including the ones in magazines */
+    CARD32 cached;          /* sitting in client magazines */
+    CARD64 allocs;
+    CARD64 magazineHits;
+} SlabCacheStatsRec;
+
+typedef struct _SlabCache {
+    SlabCacheStatsRec stats;
+    int id;                     /* index into caches and the magazines */
+    unsigned align;
+    unsigned first;             /* offset of the first object in a slab */
+    unsigned perSlab;
+    struct xorg_list partial;
+    struct xorg_list full;
+    SlabPtr spare;
+} SlabCacheRec;
+
+/* Objects the client freed last, handed back to its next allocations */
+typedef struct {
+    unsigned num;
+    void *objects[SLAB_MAGAZINE_SIZE];
+} SlabMagazineRec, *SlabMagazinePtr;
+
+static SlabCachePtr caches[SLAB_MAX_CACHES];
+static int numCaches;
+
+static uintptr_t *slabSet;
+static unsigned slabSetSize;    /* power of two */
+static unsigned slabSetCount;
+
+static DevPrivateKeyRec slabClientKeyRec;
+
+static unsigned
+SlabHash(uintptr_t slab)
+{
+    return ((slab / SLAB_SIZE) * 2654435761u) & (slabSetSize - 1);
+}
+
+static int
+SlabSetFind(uintptr_t slab)
+{
+    if (!slabSetSize)
+        return -1;
+
+    for (unsigned i = SlabHash(slab); slabSet[i]; i = (i + 1) & (slabSetSize - 1))
+        if (slabSet[i] == slab)
+            return i;
+    return -1;
+}
+
+static void
+SlabSetPut(uintptr_t slab)
+{
+    unsigned i;
+
+    for (i = SlabHash(slab); slabSet[i]; i = (i + 1) & (slabSetSize - 1))
+        ;
+    slabSet[i] = slab;
+}
+
+static Bool
+SlabSetAdd(uintptr_t slab)
+{
+    if ((slabSetCount + 1) * 2 > slabSetSize) {
+        uintptr_t *old = slabSet;
+        unsigned oldSize = slabSetSize;
+        unsigned size = oldSize ? oldSize * 2 : 64;
+        uintptr_t *set = calloc(size, sizeof(uintptr_t));
+
+        if (!set)
+            return FALSE;
+        slabSet = set;
+        slabSetSize = size;
+        for (unsigned i = 0; i < oldSize; i++)
+            if (old[i])
+                SlabSetPut(old[i]);
+        free(old);
+    }
+
+    SlabSetPut(slab);
+    slabSetCount++;
+    return TRUE;
+}
+
+static void
+SlabSetRemove(uintptr_t slab)
+{
+    int i = SlabSetFind(slab);
+    unsigned mask = slabSetSize - 1;
+
+    if (i < 0)
+        return;
+
+    /* move the following entries of the run back into the hole */
+    for (unsigned j = (i + 1) & mask; slabSet[j]; j = (j + 1) & mask) {
+        unsigned home = SlabHash(slabSet[j]);
+
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            slabSet[i] = slabSet[j];
+            i = j;
+        }
+    }
+    slabSet[i] = 0;
+    slabSetCount--;
+}
+
+static SlabPtr
+SlabCreate(SlabCachePtr cache)
+{
+#ifdef HAVE_POSIX_MEMALIGN
+    void *mem;
+    SlabPtr slab;
+
+    if (posix_memalign(&mem, SLAB_SIZE, SLAB_SIZE))
+        return NULL;
+    if (!SlabSetAdd((uintptr_t) mem)) {
+        free(mem);
+        return NULL;
+    }
+
+    slab = mem;
+    slab->cache = cache;
+    slab->free = NULL;
+    slab->inUse = 0;
+    slab->untouched = 0;
+    cache->stats.slabs++;
+    return slab;
+#else
+    return NULL;
+#endif
+}
+
+static void
+SlabDestroy(SlabPtr slab)
+{
+    slab->cache->stats.slabs--;
+    SlabSetRemove((uintptr_t) slab);
+    free(slab);
+}
+
+/* Return an object to its slab */
+static void
+SlabPut(SlabPtr slab, void *object)
+{
+    SlabCachePtr cache = slab->cache;
+
+    *(void **) object = slab->free;
+    slab->free = object;
+
+    if (slab->inUse == cache->perSlab) {
+        xorg_list_del(&slab->entry);
+        xorg_list_append(&slab->entry, &cache->partial);
+    }
+    cache->stats.inUse--;
+
+    if (--slab->inUse == 0) {
+        xorg_list_del(&slab->entry);
+        if (cache->spare)
+            SlabDestroy(slab);
+        else
+            cache->spare = slab;
+    }
+}
+
+/*
+ * The magazine of the cache for the client being dispatched. Objects are
+ * freed and allocated outside of requests too, those bypass magazines.
+ */
+static SlabMagazinePtr
+SlabClientMagazine(SlabCachePtr cache, Bool create)
+{
+    ClientPtr client = GetCurrentClient();
+    SlabMagazinePtr magazines;
+
+    if (!client || client == serverClient ||
+        client->clientState != ClientStateRunning ||
+        !dixPrivateKeyRegistered(&slabClientKeyRec))
+        return NULL;
+
+    magazines = dixLookupPrivate(&client->devPrivates, &slabClientKeyRec);
+    if (!magazines && create) {
+        magazines = calloc(SLAB_MAX_CACHES, sizeof(SlabMagazineRec));
+        dixSetPrivate(&client->devPrivates, &slabClientKeyRec, magazines);
+    }
+    return magazines ? &magazines[cache->id] : NULL;
+}
+
+static void
+SlabClientState(CallbackListPtr *list, void *closure, void *data)
+{
+    NewClientInfoRec *info = data;
+    ClientPtr client = info->client;
+    SlabMagazinePtr magazines;
+
+    if (client->clientState != ClientStateGone)
+        return;
+
+    magazines = dixLookupPrivate(&client->devPrivates, &slabClientKeyRec);
+    if (!magazines)
+        return;
+
+    for (int i = 0; i < numCaches; i++) {
+        while (magazines[i].num) {
+            void *object = magazines[i].objects[--magazines[i].num];
+
+            caches[i]->stats.cached--;
+            SlabPut((SlabPtr) ((uintptr_t) object & ~(uintptr_t) (SLAB_SIZE - 1)),
+                    object);
+        }
+    }
+    free(magazines);
+    dixSetPrivate(&client->devPrivates, &slabClientKeyRec, NULL);
+}
+
+SlabCachePtr
+SlabCacheGet(DevPrivateType type, unsigned size, unsigned align)
+{
+#ifdef HAVE_POSIX_MEMALIGN
+    SlabCachePtr cache;
+
+    if (align < sizeof(void *))
+        align = sizeof(void *);
+    size = (size + align - 1) & ~(align - 1);
+    if (size > SLAB_MAX_OBJECT)
+        return NULL;
+
+    for (int i = 0; i < numCaches; i++) {
+        cache = caches[i];
+        if (cache->stats.type == type && cache->stats.objectSize == size &&
+            cache->align == align)
+            return cache;
+    }
+
+    if (numCaches == SLAB_MAX_CACHES)
+        return NULL;
+
+    cache = calloc(1, sizeof(SlabCacheRec));
+    if (!cache)
+        return NULL;
+
+    cache->stats.type = type;
+    cache->stats.objectSize = size;
+    cache->id = numCaches;
+    cache->align = align;
+    cache->first = (sizeof(SlabRec) + align - 1) & ~(align - 1);
+    cache->perSlab = (SLAB_SIZE - cache->first) / size;
+    xorg_list_init(&cache->partial);
+    xorg_list_init(&cache->full);
+    caches[numCaches++] = cache;
+    return cache;
+#else
+    return NULL;
+#endif
+}
+
+void *
+SlabAlloc(SlabCachePtr cache)
+{
+    SlabMagazinePtr magazine = SlabClientMagazine(cache, FALSE);
+    SlabPtr slab;
+    void *object;
+
+    cache->stats.allocs++;
+
+    if (magazine && magazine->num) {
+        object = magazine->objects[--magazine->num];
+        cache->stats.cached--;
+        cache->stats.magazineHits++;
+        memset(object, '\0', cache->stats.objectSize);
+        return object;
+    }
+
+    if (!xorg_list_is_empty(&cache->partial))
+        slab = xorg_list_first_entry(&cache->partial, SlabRec, entry);
+    else {
+        slab = cache->spare;
+        if (slab)
+            cache->spare = NULL;
+        else if (!(slab = SlabCreate(cache)))
+            return NULL;
+        xorg_list_add(&slab->entry, &cache->partial);
+    }
+
+    if (slab->free) {
+        object = slab->free;
+        slab->free = *(void **) object;
+    }
+    else
+        object = (char *) slab + cache->first +
+            slab->untouched++ * cache->stats.objectSize;
+
+    if (++slab->inUse == cache->perSlab) {
+        xorg_list_del(&slab->entry);
+        xorg_list_add(&slab->entry, &cache->full);
+    }
+    cache->stats.inUse++;
+
+    memset(object, '\0', cache->stats.objectSize);
+    return object;
+}
+
+Bool
+SlabFree(void *object)
+{
+    SlabPtr slab = (SlabPtr) ((uintptr_t) object & ~(uintptr_t) (SLAB_SIZE - 1));
+    SlabMagazinePtr magazine;
+
+    if (!object || SlabSetFind((uintptr_t) slab) < 0)
+        return FALSE;
+
+    magazine = SlabClientMagazine(slab->cache, TRUE);
+    if (magazine && magazine->num < SLAB_MAGAZINE_SIZE) {
+        magazine->objects[magazine->num++] = object;
+        slab->cache->stats.cached++;
+        return TRUE;
+    }
+
+    SlabPut(slab, object);
+    return TRUE;
+}
+
+static void
+SlabLogStats(SlabCachePtr cache)
+{
+    static const char *type_names[PRIVATE_LAST] = {
+        [PRIVATE_WINDOW] = "window",
+        [PRIVATE_PIXMAP] = "pixmap",
+        [PRIVATE_GC] = "GC",
+        [PRIVATE_PICTURE] = "picture",
+    };
+    SlabCacheStatsRec *stats = &cache->stats;
+    const char *name = type_names[stats->type];
+
+    LogMessageVerb(X_INFO, 3, "Slab cache %s/%u: %u slabs, %u in use (%.0f%%), "
+                   "%llu allocs, %llu from magazines\n",
+                   name ? name : "?", (unsigned) stats->objectSize,
+                   (unsigned) stats->slabs, (unsigned) stats->inUse,
+                   stats->slabs ? 100.0 * stats->inUse * stats->objectSize /
+                   ((double) stats->slabs * SLAB_SIZE) : 0.0,
+                   (unsigned long long) stats->allocs,
+                   (unsigned long long) stats->magazineHits);
+}
+
+void
+SlabInit(void)
+{
+    if (!dixRegisterPrivateKey(&slabClientKeyRec, PRIVATE_CLIENT, 0))
+        return;
+    AddCallback(&ClientStateCallback, SlabClientState, NULL);
+}
+
+void
+SlabReset(void)
+{
+    int n = 0;
+
+    /* The object sizes change with the privates of the next generation;
+     * only caches with objects leaked from this one stay. No clients are
+     * left, so there are no magazines to renumber. */
+    for (int i = 0; i < numCaches; i++) {
+        SlabCachePtr cache = caches[i];
+
+        SlabLogStats(cache);
+        if (cache->spare) {
+            SlabDestroy(cache->spare);
+            cache->spare = NULL;
+        }
+        if (cache->stats.inUse) {
+            cache->id = n;
+            caches[n++] = cache;
+        }
+        else
+            free(cache);
+    }
+    numCaches = n;
+}
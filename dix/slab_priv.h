@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: X11 OR MIT OR AGPL-3.0-or-later
+ */
+#ifndef _XSERVER_DIX_SLAB_PRIV_H
+#define _XSERVER_DIX_SLAB_PRIV_H
+
+#include <X11/Xdefs.h>
+#include <X11/Xmd.h>
+
+#include "include/privates.h"
+
+/*
+ * Slab caches for the objects clients create and free by the million:
+ * windows, GCs, pictures and pixmap headers, each with its privates
+ * appended. Objects of one type and size are carved out of 64KB slabs;
+ * objects a client frees go into a small per-client magazine first and
+ * are handed back to the same client's next allocation.
+ *
+ * A cache is picked by type and final object size, so it is only asked
+ * for once the privates of the type are laid out.
+ */
+
+typedef struct _SlabCache *SlabCachePtr;
+
+/* Register the client private and callbacks, once per generation */
+void SlabInit(void);
+
+/*
+ * Release the empty slabs and caches, at the end of a generation. The use
+ * of each cache is logged at verbosity 3 first.
+ */
+void SlabReset(void);
+
+/*
+ * The cache for objects of the type of 'size' bytes, aligned to 'align'
+ * bytes, or NULL if the object is better left to malloc.
+ */
+SlabCachePtr SlabCacheGet(DevPrivateType type, unsigned size, unsigned align);
+
+/* A zeroed object, or NULL */
+void *SlabAlloc(SlabCachePtr cache);
+
+/* Free an object from SlabAlloc, or return FALSE if it isn't one */
+Bool SlabFree(void *object);
+
+#endif /* _XSERVER_DIX_SLAB_PRIV_H */
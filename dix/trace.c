@@ -0,0 +1,325 @@
+/* SPDX-License-Identifier: X11 OR MIT OR AGPL-3.0-or-later
+ */
+#include <dix-config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <X11/Xos.h>
+
+#include "dix/dix_priv.h"
+#include "dix/registry_priv.h"
+#include "dix/trace_priv.h"
+#include "os/client_priv.h"
+#include "os/log_priv.h"
+#include "os/osdep.h"
+
+#include "dixstruct.h"
+#include "extnsionst.h"
+#include "opaque.h"
+
+/*
+ * Requests are only ever dispatched on the main thread, so there is just
+ * one record buffer, written out whenever it fills up and when tracing
+ * stops. Write errors stop tracing.
+ */
+#define TRACE_BUFFER_SIZE       (256 << 10)
+#define TRACE_NAMES_SIZE        4096    /* power of two */
+
+Bool traceActive = FALSE;
+const char *traceFile = NULL;
+volatile sig_atomic_t traceToggle = 0;
+
+static int traceFd = -1;
+static Bool traceOpened;
+static char traceBuffer[TRACE_BUFFER_SIZE];
+static size_t tracePos;
+
+/* the request being dispatched */
+static Bool traceInRequest;
+static CARD64 traceRequestStart;
+static CARD64 traceBytesQueued;
+static CARD32 traceResources[TRACE_MAX_RESOURCES];
+static int traceNumResources;
+
+/* (major << 16 | minor) + 1 of the request names already written */
+static CARD32 traceNames[TRACE_NAMES_SIZE];
+
+static CARD64
+TraceTime(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (CARD64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* async-signal-safe, so that AbortServer() may call it via TraceStop() */
+static Bool
+TraceFlush(void)
+{
+    size_t done = 0;
+
+    while (done < tracePos) {
+        ssize_t ret = write(traceFd, traceBuffer + done, tracePos - done);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return FALSE;
+        done += ret;
+    }
+    tracePos = 0;
+    return TRUE;
+}
+
+/* Append a record, with len bytes of tail after it, padded to 4 bytes. */
+static void
+TraceWrite(TraceRecordHeader *hdr, size_t size, const void *tail, size_t len)
+{
+    size_t total = pad_to_int32(size + len);
+
+    hdr->length = total;
+    if (tracePos + total > sizeof(traceBuffer) && !TraceFlush()) {
+        LogMessage(X_ERROR, "trace: writing %s failed, %s\n", traceFile,
+                   strerror(errno));
+        TraceStop();
+        return;
+    }
+
+    memcpy(traceBuffer + tracePos, hdr, size);
+    memcpy(traceBuffer + tracePos + size, tail, len);
+    memset(traceBuffer + tracePos + size + len, 0, total - size - len);
+    tracePos += total;
+}
+
+static void
+TraceWriteName(int major, int minor, const char *name)
+{
+    TraceNameRecord rec = {
+        .hdr.type = TRACE_RECORD_NAME,
+        .hdr.data = major,
+        .minor = minor,
+    };
+
+    TraceWrite(&rec.hdr, sizeof(rec), name, strlen(name) + 1);
+}
+
+/*
+ * Name each request the first time it shows up: by the registry if it
+ * knows the name, otherwise by the extension it belongs to. Core request
+ * names are left to the converter if the registry is compiled out.
+ */
+static void
+TraceNameRequest(ClientPtr client)
+{
+    CARD32 key = (client->majorOp << 16 | client->minorOp) + 1;
+    unsigned int i = (key * 2654435761u) & (TRACE_NAMES_SIZE - 1);
+    const char *name;
+
+    for (; traceNames[i]; i = (i + 1) & (TRACE_NAMES_SIZE - 1))
+        if (traceNames[i] == key)
+            return;
+    traceNames[i] = key;
+
+    name = LookupRequestName(client->majorOp, client->minorOp);
+    if (strcmp(name, XREGISTRY_UNKNOWN) != 0)
+        TraceWriteName(client->majorOp, client->minorOp, name);
+    else if (client->majorOp >= EXTENSION_BASE) {
+        ExtensionEntry *ext = GetExtensionEntry(client->majorOp);
+
+        if (ext)
+            TraceWriteName(client->majorOp, TRACE_NAME_EXTENSION, ext->name);
+    }
+}
+
+static void
+TraceWriteClient(ClientPtr client, Bool connected)
+{
+    const char *name = GetClientCmdName(client);
+    TraceClientRecord rec = {
+        .hdr.type = TRACE_RECORD_CLIENT,
+        .hdr.data = connected,
+        .client = client->index,
+        .pid = GetClientPid(client),
+        .time = TraceTime(CLOCK_MONOTONIC),
+    };
+
+    if (!name)
+        name = "";
+    TraceWrite(&rec.hdr, sizeof(rec), name, strlen(name) + 1);
+}
+
+static void
+TraceClientState(CallbackListPtr *list, void *closure, void *data)
+{
+    NewClientInfoRec *info = data;
+
+    if (!traceActive)
+        return;
+
+    switch (info->client->clientState) {
+    case ClientStateRunning:
+        TraceWriteClient(info->client, TRUE);
+        break;
+    case ClientStateGone:
+        TraceWriteClient(info->client, FALSE);
+        break;
+    default:
+        break;
+    }
+}
+
+static Bool
+TraceStart(void)
+{
+    TraceFileHeader header = {
+        .magic = TRACE_MAGIC,
+        .version = TRACE_VERSION,
+        .startTime = TraceTime(CLOCK_MONOTONIC),
+        .startRealTime = TraceTime(CLOCK_REALTIME),
+        .pid = getpid(),
+    };
+    int i;
+
+    /* the file is opened with the server's privileges, see -trace */
+    if (PrivsElevated()) {
+        LogMessage(X_ERROR, "trace: not writing %s with elevated privileges\n",
+                   traceFile);
+        return FALSE;
+    }
+
+    /* A server run starts a new file. Traces started later, after a
+     * SIGUSR2 or a server reset, carry on in the same one: the clock and
+     * the pid are still those of the header. */
+    traceFd = open(traceFile, O_WRONLY | O_CREAT | O_CLOEXEC |
+                   (traceOpened ? O_APPEND : O_TRUNC), 0644);
+    if (traceFd == -1) {
+        LogMessage(X_ERROR, "trace: cannot open %s, %s\n", traceFile,
+                   strerror(errno));
+        return FALSE;
+    }
+
+    if (!traceOpened) {
+        memcpy(traceBuffer, &header, sizeof(header));
+        tracePos = sizeof(header);
+        traceOpened = TRUE;
+    }
+    else
+        tracePos = 0;
+    memset(traceNames, 0, sizeof(traceNames));
+    traceActive = TRUE;
+
+    for (i = 1; i < currentMaxClients; i++)
+        if (clients[i] && clients[i]->clientState == ClientStateRunning)
+            TraceWriteClient(clients[i], TRUE);
+
+    LogMessage(X_INFO, "trace: recording requests to %s\n", traceFile);
+    return TRUE;
+}
+
+void
+TraceStop(void)
+{
+    if (!traceActive)
+        return;
+
+    traceActive = FALSE;
+    traceInRequest = FALSE;
+    TraceFlush();
+    close(traceFd);
+    traceFd = -1;
+}
+
+void
+TraceToggle(void)
+{
+    traceToggle = 0;
+
+    if (traceActive) {
+        TraceStop();
+        LogMessage(X_INFO, "trace: stopped recording to %s\n", traceFile);
+    }
+    else
+        TraceStart();
+}
+
+static void
+TraceSignal(int sig)
+{
+    traceToggle = 1;
+}
+
+void
+TraceInit(void)
+{
+    if (!traceFile)
+        return;
+
+    if (!traceActive)
+        TraceStart();
+
+    AddCallback(&ClientStateCallback, TraceClientState, NULL);
+
+    /* Solaris uses SIGUSR2 for VT switching */
+#ifndef __sun
+    static Bool signalSet;
+
+    if (!signalSet) {
+        OsSignal(SIGUSR2, TraceSignal);
+        signalSet = TRUE;
+    }
+#endif
+}
+
+void
+TraceRequestStart(ClientPtr client)
+{
+    TraceNameRequest(client);
+
+    traceInRequest = TRUE;
+    traceNumResources = 0;
+    traceBytesQueued = client->stats.bytesQueued;
+    traceRequestStart = TraceTime(CLOCK_MONOTONIC);
+}
+
+void
+TraceRequestDone(ClientPtr client, int bytesIn, int result)
+{
+    TraceRequestRecord rec = {
+        .hdr.type = TRACE_RECORD_REQUEST,
+        .hdr.data = client->majorOp,
+        .minor = client->minorOp,
+        .result = result,
+        .numResources = traceNumResources,
+        .client = client->index,
+        .sequence = client->sequence,
+        .bytesIn = max(bytesIn, 0),
+        .bytesOut = client->stats.bytesQueued - traceBytesQueued,
+        .start = traceRequestStart,
+        .end = TraceTime(CLOCK_MONOTONIC),
+    };
+
+    if (!traceInRequest)
+        return;
+    traceInRequest = FALSE;
+
+    TraceWrite(&rec.hdr, sizeof(rec), traceResources,
+               traceNumResources * sizeof(CARD32));
+}
+
+void
+TraceAddResource(XID id)
+{
+    int i;
+
+    if (!traceInRequest || traceNumResources == TRACE_MAX_RESOURCES)
+        return;
+
+    for (i = 0; i < traceNumResources; i++)
+        if (traceResources[i] == id)
+            return;
+    traceResources[traceNumResources++] = id;
+}
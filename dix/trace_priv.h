@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: X11 OR MIT OR AGPL-3.0-or-later
+ */
+#ifndef _XSERVER_DIX_TRACE_PRIV_H
+#define _XSERVER_DIX_TRACE_PRIV_H
+
+#include <signal.h>
+#include <X11/Xdefs.h>
+
+#include "include/dix.h"
+
+/*
+ * Request trace recorder: with -trace, every dispatched request is
+ * appended to a binary trace file for offline performance analysis; SIGUSR2
+ * pauses and resumes it. test/scripts/xtrace-to-json.py turns the file into
+ * Chrome trace event JSON, which Perfetto and chrome://tracing can display.
+ *
+ * The file starts with a TraceFileHeader, followed by records which all
+ * start with a TraceRecordHeader and are padded to multiples of 4 bytes.
+ * Everything is in the server's byte order, which the magic tells.
+ */
+
+#define TRACE_MAGIC             0x43525458      /* "XTRC" on little endian */
+#define TRACE_VERSION           1
+
+#define TRACE_RECORD_REQUEST    1
+#define TRACE_RECORD_CLIENT     2
+#define TRACE_RECORD_NAME       3
+
+/* minor of a name record naming an extension rather than a request */
+#define TRACE_NAME_EXTENSION    0xffff
+
+#define TRACE_MAX_RESOURCES     8
+
+typedef struct {
+    CARD32 magic;
+    CARD32 version;
+    CARD64 startTime;           /* CLOCK_MONOTONIC, ns */
+    CARD64 startRealTime;       /* CLOCK_REALTIME at the same moment, ns */
+    CARD32 pid;
+    CARD32 pad;
+} TraceFileHeader;
+
+typedef struct {
+    CARD8 type;
+    CARD8 data;
+    CARD16 length;              /* of the whole record, bytes */
+} TraceRecordHeader;
+
+/* one per dispatched request, followed by the CARD32 XIDs it looked up */
+typedef struct {
+    TraceRecordHeader hdr;      /* data: major opcode */
+    CARD16 minor;
+    CARD8 result;               /* Success or the error code */
+    CARD8 numResources;
+    CARD32 client;              /* client index */
+    CARD32 sequence;
+    CARD32 bytesIn;             /* request length */
+    CARD32 bytesOut;            /* replies, events and errors to the client */
+    CARD64 start;               /* CLOCK_MONOTONIC, ns */
+    CARD64 end;
+} TraceRequestRecord;
+
+/* client connected (data 1), or gone (data 0), followed by its name */
+typedef struct {
+    TraceRecordHeader hdr;
+    CARD32 client;
+    CARD32 pid;
+    CARD32 pad;
+    CARD64 time;
+} TraceClientRecord;
+
+/* the name of a request, or of an extension, followed by the name */
+typedef struct {
+    TraceRecordHeader hdr;      /* data: major opcode */
+    CARD16 minor;
+    CARD16 pad;
+} TraceNameRecord;
+
+extern Bool traceActive;
+extern const char *traceFile;
+extern volatile sig_atomic_t traceToggle;
+
+void TraceInit(void);
+void TraceStop(void);
+void TraceToggle(void);
+
+void TraceRequestStart(ClientPtr client);
+void TraceRequestDone(ClientPtr client, int bytesIn, int result);
+void TraceAddResource(XID id);
+
+/* note that the current request touched a resource */
+static inline void
+TraceResource(XID id)
+{
+    if (traceActive)
+        TraceAddResource(id);
+}
+
+#endif /* _XSERVER_DIX_TRACE_PRIV_H */
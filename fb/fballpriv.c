@@ -54,6 +54,10 @@ fbAllocatePrivates(ScreenPtr pScreen)
     if (!dixRegisterScreenSpecificPrivateKey (pScreen, &pScrPriv->winPrivateKeyRec, PRIVATE_WINDOW, 0))
         return FALSE;
 
+    /* looked up by every rendering operation */
+    dixSetPrivateKeyHot(&pScrPriv->gcPrivateKeyRec);
+    dixSetPrivateKeyHot(&pScrPriv->winPrivateKeyRec);
+
     return TRUE;
 }
 
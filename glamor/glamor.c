@@ -701,6 +701,9 @@ glamor_init(ScreenPtr screen, unsigned int flags)
         goto fail;
     }
 
+    dixSetPrivateKeyHot(&glamor_pixmap_private_key);
+    dixSetPrivateKeyHot(&glamor_gc_private_key);
+
     /**
      * glamor_egl_screen_init2 adds any needed cleanup to CloseScreen
      */
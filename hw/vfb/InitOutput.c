@@ -56,13 +56,21 @@ from The Open Group.
 #include "input.h"
 #include "mipointer.h"
 #include "micmap.h"
+#include "damage.h"
 #include <sys/types.h>
 #ifdef HAVE_MMAP
 #include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #ifndef MAP_FILE
 #define MAP_FILE 0
 #endif
 #endif                          /* HAVE_MMAP */
+#if defined(HAVE_MMAP) && defined(HAVE_MEMFD_CREATE)
+#define VFB_MEMFD 1
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
 #include <sys/stat.h>
 #include <errno.h>
 #ifndef WIN32
@@ -108,6 +116,8 @@ typedef struct {
     int paddedBytesWidth;
     int paddedWidth;
     int height;
+    int x;
+    int y;
     int depth;
     int bitsPerPixel;
     int sizeInBytes;
@@ -125,6 +135,16 @@ typedef struct {
 #ifdef HAVE_MMAP
     int mmap_fd;
     char mmap_file[MAXPATHLEN];
+    /* what to msync and publish at the next block handler */
+    DamagePtr damage;
+    Bool headerDirty;
+    CreateScreenResourcesProcPtr createScreenResources;
+    struct _vfbDamageRing *ring;
+#endif
+
+#ifdef VFB_MEMFD
+    int memfd;
+    size_t memfdSize;           /* rounded up to the huge page size */
 #endif
 
 #ifdef CONFIG_MITSHM
@@ -151,8 +171,84 @@ static Bool vfbPixmapDepths[33];
 
 #ifdef HAVE_MMAP
 static char *pfbdir = NULL;
+
+/*
+ * With -fbdir, Xvfb_screen<n>.damage next to each framebuffer file holds a
+ * ring of the rectangles that changed, so that consumers can copy only
+ * those instead of diffing the whole file. The server appends the damage
+ * of each frame, i.e. of every pass through the block handler that drew
+ * something, after syncing it to the framebuffer file, then advances head
+ * and frame. Slots are overwritten as the ring wraps: a consumer that
+ * finds head more than size rectangles ahead of what it has read, before
+ * or after copying them, has lost track and has to copy the whole screen.
+ *
+ * To sleep until the next frame, a consumer sets waiting, checks head once
+ * more and then polls the FIFO Xvfb_screen<n>.wakeup, which the server
+ * writes a byte to when it publishes a frame and finds waiting set.
+ */
+#define VFB_DAMAGE_MAGIC        0x58766644      /* "XvfD" */
+#define VFB_DAMAGE_VERSION      1
+#define VFB_DAMAGE_RECTS        4096
+#define VFB_DAMAGE_RECTS_OFFSET 64
+
+typedef struct {
+    CARD32 magic;
+    CARD32 version;
+    CARD32 size;                /* rectangle slots */
+    CARD32 waiting;             /* set by a consumer about to sleep */
+    CARD64 frame;               /* frames published */
+    CARD64 head;                /* rectangles published */
+    CARD32 width;               /* of the screen at the last frame */
+    CARD32 height;
+} vfbDamageRingHeader;
+
+typedef struct {
+    CARD64 frame;               /* frame the rectangle belongs to */
+    INT16 x, y;
+    CARD16 width, height;
+} vfbDamageRect;
+
+typedef struct _vfbDamageRing {
+    vfbDamageRingHeader *header;
+    vfbDamageRect *rects;
+    size_t mapSize;
+    int wakeup_fd;
+    char file[MAXPATHLEN];
+    char fifo[MAXPATHLEN];
+} vfbDamageRing;
+#endif
+
+#ifdef VFB_MEMFD
+/*
+ * With -memfd, each framebuffer lives in a sealed memfd, and the server
+ * listens on a Unix socket at the given path. Every connection is sent one
+ * message per screen, a vfbMemfdInfo with the memfd attached, and then
+ * closed. The memfd holds the same xwd image as the -fbdir files, but is
+ * plain shared memory: there is nothing to msync, and it is gone when the
+ * last process using it is.
+ */
+static char *pmemfdsocket = NULL;
+static int vfbMemfdListenFd = -1;
+static Bool vfbHugePages = FALSE;
+
+#define VFB_MEMFD_MAGIC         0x5876664d      /* "XvfM" */
+#define VFB_HUGE_PAGE_SIZE      (2 << 20)
+
+typedef struct {
+    CARD32 magic;
+    CARD32 screen;
+    CARD32 numScreens;
+    CARD32 stride;              /* bytes per framebuffer row */
+    CARD64 size;                /* of the memfd */
+    CARD64 fbOffset;            /* of the framebuffer within it */
+    CARD32 width;
+    CARD32 height;
+    CARD32 bitsPerPixel;
+    CARD32 depth;
+} vfbMemfdInfo;
 #endif
-typedef enum { NORMAL_MEMORY_FB, SHARED_MEMORY_FB, MMAPPED_FILE_FB } fbMemType;
+typedef enum { NORMAL_MEMORY_FB, SHARED_MEMORY_FB, MMAPPED_FILE_FB,
+    MEMFD_FB } fbMemType;
 static fbMemType fbmemtype = NORMAL_MEMORY_FB;
 static char needswap = 0;
 static Bool Render = TRUE;
@@ -206,6 +302,38 @@ vfbInitializeScreenInfo(vfbScreenInfoPtr screen)
     return screen;
 }
 
+/*
+ * Parses the optional +X+Y (either sign) after WxHxD in -screen. Anything
+ * else after it is an error.
+ */
+static Bool
+vfbParseScreenOrigin(const char *arg, vfbScreenInfoPtr screen)
+{
+    long origin[2];
+
+    if (!*arg)
+        return TRUE;
+
+    for (int n = 0; n < 2; n++) {
+        char *end;
+
+        if (*arg != '+' && *arg != '-')
+            return FALSE;
+        errno = 0;
+        origin[n] = strtol(arg, &end, 10);
+        if (end == arg || errno || origin[n] < MINSHORT || origin[n] > MAXSHORT)
+            return FALSE;
+        arg = end;
+    }
+
+    if (*arg)
+        return FALSE;
+
+    screen->x = origin[0];
+    screen->y = origin[1];
+    return TRUE;
+}
+
 static void
 vfbInitializePixmapDepths(void)
 {
@@ -240,6 +368,10 @@ freeScreenInfo(vfbScreenInfoPtr pvfb)
             ErrorF("unlink %s failed, %s",
                    pvfb->mmap_file, strerror(errno));
         }
+        if (pvfb->ring) {
+            unlink(pvfb->ring->file);
+            unlink(pvfb->ring->fifo);
+        }
         break;
 #else                           /* HAVE_MMAP */
     case MMAPPED_FILE_FB:
@@ -258,6 +390,18 @@ freeScreenInfo(vfbScreenInfoPtr pvfb)
         break;
 #endif /* CONFIG_MITSHM */
 
+#ifdef VFB_MEMFD
+    case MEMFD_FB:
+        if (pvfb->pXWDHeader) {
+            munmap(pvfb->pXWDHeader, pvfb->memfdSize);
+            close(pvfb->memfd);
+        }
+        break;
+#else /* VFB_MEMFD */
+    case MEMFD_FB:
+        break;
+#endif /* VFB_MEMFD */
+
     case NORMAL_MEMORY_FB:
         free(pvfb->pXWDHeader);
         break;
@@ -275,6 +419,10 @@ ddxGiveUp(enum ExitCode error)
     for (i = 0; i < vfbNumScreens; i++) {
         freeScreenInfo(&vfbScreens[i]);
     }
+#ifdef VFB_MEMFD
+    if (vfbMemfdListenFd != -1)
+        unlink(pmemfdsocket);
+#endif
 }
 
 void ddxInit(void)
@@ -297,7 +445,8 @@ ddxInputThreadInit(void)
 void
 ddxUseMsg(void)
 {
-    ErrorF("-screen scrn WxHxD     set screen's width, height, depth\n");
+    ErrorF("-screen scrn WxHxD[+X+Y] set screen's width, height, depth\n");
+    ErrorF("                       and position within the Xinerama desktop\n");
     ErrorF("-pixdepths list-of-int support given pixmap depths\n");
     ErrorF("+/-render		   turn on/off RENDER extension support"
            "(default on)\n");
@@ -314,6 +463,11 @@ ddxUseMsg(void)
     ErrorF("-shmem                 put framebuffers in shared memory\n");
 #endif /* CONFIG_MITSHM */
 
+#ifdef VFB_MEMFD
+    ErrorF("-memfd socket          put framebuffers in memfds, handed out on socket\n");
+    ErrorF("-hugepages             back -memfd framebuffers with huge pages\n");
+#endif /* VFB_MEMFD */
+
 #ifdef GLAMOR
     ErrorF("-glamor                enable glamor render acceleration\n");
     ErrorF("-dri </dev/dri/renderDxxx>  render device to use\n");
@@ -340,8 +494,8 @@ ddxProcessArgument(int argc, char *argv[], int i)
     else
         currentScreen = &vfbScreens[lastScreen];
 
-    if (strcmp(argv[i], "-screen") == 0) {      /* -screen n WxHxD */
-        int screenNum;
+    if (strcmp(argv[i], "-screen") == 0) {      /* -screen n WxHxD[+X+Y] */
+        int screenNum, len = 0;
 
         CHECK_FOR_REQUIRED_ARGUMENTS(2);
         screenNum = atoi(argv[i + 1]);
@@ -363,10 +517,11 @@ ddxProcessArgument(int argc, char *argv[], int i)
                 vfbInitializeScreenInfo(&vfbScreens[vfbNumScreens]);
         }
 
-        if (3 != sscanf(argv[i + 2], "%dx%dx%d",
+        if (3 != sscanf(argv[i + 2], "%dx%dx%d%n",
                         &vfbScreens[screenNum].width,
                         &vfbScreens[screenNum].height,
-                        &vfbScreens[screenNum].depth)) {
+                        &vfbScreens[screenNum].depth, &len) ||
+            !vfbParseScreenOrigin(argv[i + 2] + len, &vfbScreens[screenNum])) {
             ErrorF("Invalid screen configuration %s\n", argv[i + 2]);
             UseMsg();
             FatalError("Invalid screen configuration %s for -screen %d\n",
@@ -439,6 +594,20 @@ ddxProcessArgument(int argc, char *argv[], int i)
     }
 #endif /* CONFIG_MITSHM */
 
+#ifdef VFB_MEMFD
+    if (strcmp(argv[i], "-memfd") == 0) {       /* -memfd socket */
+        CHECK_FOR_REQUIRED_ARGUMENTS(1);
+        pmemfdsocket = argv[++i];
+        fbmemtype = MEMFD_FB;
+        return 2;
+    }
+
+    if (strcmp(argv[i], "-hugepages") == 0) {
+        vfbHugePages = TRUE;
+        return 1;
+    }
+#endif /* VFB_MEMFD */
+
 #ifdef GLAMOR
     if (strcmp(argv[i], "-glamor") == 0) {
         use_glamor = TRUE;
@@ -495,6 +664,9 @@ vfbInstallColormap(ColormapPtr pmap)
         entries = pmap->pVisual->ColormapEntries;
         pXWDHeader = vfbScreens[pmap->pScreen->myNum].pXWDHeader;
         pVisual = pmap->pVisual;
+#ifdef HAVE_MMAP
+        vfbScreens[pmap->pScreen->myNum].headerDirty = TRUE;
+#endif
 
         swapcopy32(pXWDHeader->visual_class, pVisual->class);
         swapcopy32(pXWDHeader->red_mask, pVisual->redMask);
@@ -545,6 +717,9 @@ vfbStoreColors(ColormapPtr pmap, int ndef, xColorItem * pdefs)
     if ((pmap->pVisual->class | DynamicClass) == DirectColor) {
         return;
     }
+#ifdef HAVE_MMAP
+    vfbScreens[pmap->pScreen->myNum].headerDirty = TRUE;
+#endif
 
     for (i = 0; i < ndef; i++) {
         if (pdefs[i].flags & DoRed) {
@@ -561,26 +736,127 @@ vfbStoreColors(ColormapPtr pmap, int ndef, xColorItem * pdefs)
 
 #ifdef HAVE_MMAP
 
-/* this flushes any changes to the screens out to the mmapped file */
+/* msync the pages covering bytes [start, end) of the mmapped file */
 static void
-vfbBlockHandler(void *blockData, void *timeout)
+vfbSyncRange(vfbScreenInfoPtr pvfb, size_t start, size_t end)
 {
-    int i;
+    static size_t pagesize;
+
+    if (!pagesize)
+        pagesize = getpagesize();
+
+    start &= ~(pagesize - 1);
+    end = min(end, (size_t) pvfb->sizeInBytes);
+    if (start >= end)
+        return;
 
-    for (i = 0; i < vfbNumScreens; i++) {
 #ifdef MS_ASYNC
-        if (-1 == msync((caddr_t) vfbScreens[i].pXWDHeader,
-                        (size_t) vfbScreens[i].sizeInBytes, MS_ASYNC))
+    if (-1 == msync((caddr_t) pvfb->pXWDHeader + start, end - start, MS_ASYNC))
 #else
-        /* silly NetBSD and who else? */
-        if (-1 == msync((caddr_t) vfbScreens[i].pXWDHeader,
-                        (size_t) vfbScreens[i].sizeInBytes))
+    /* silly NetBSD and who else? */
+    if (-1 == msync((caddr_t) pvfb->pXWDHeader + start, end - start))
 #endif
-        {
-            perror("msync");
-            ErrorF("msync failed, %s", strerror(errno));
+    {
+        perror("msync");
+        ErrorF("msync failed, %s", strerror(errno));
+    }
+}
+
+/*
+ * Append the damaged boxes of a frame to the ring and wake up a waiting
+ * consumer. Frames with lots of small boxes are published as their
+ * extents, so that one frame can't wrap the ring all by itself.
+ */
+static void
+vfbPublishDamage(vfbScreenInfoPtr pvfb, ScreenPtr pScreen, RegionPtr region)
+{
+    vfbDamageRing *ring = pvfb->ring;
+    vfbDamageRingHeader *header = ring->header;
+    BoxPtr pBox = RegionRects(region);
+    int nBox = RegionNumRects(region);
+    CARD64 frame = header->frame + 1;
+    CARD64 head = header->head;
+
+    if (nBox > VFB_DAMAGE_RECTS / 4) {
+        pBox = RegionExtents(region);
+        nBox = 1;
+    }
+
+    for (int i = 0; i < nBox; i++, head++) {
+        vfbDamageRect *rect = &ring->rects[head % VFB_DAMAGE_RECTS];
+
+        rect->frame = frame;
+        rect->x = pBox[i].x1;
+        rect->y = pBox[i].y1;
+        rect->width = pBox[i].x2 - pBox[i].x1;
+        rect->height = pBox[i].y2 - pBox[i].y1;
+    }
+
+    header->width = pScreen->width;
+    header->height = pScreen->height;
+    __atomic_store_n(&header->frame, frame, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->head, head, __ATOMIC_RELEASE);
+
+    if (__atomic_exchange_n(&header->waiting, 0, __ATOMIC_SEQ_CST)) {
+        char byte = 0;
+
+        /* a full FIFO means the consumer has a wakeup pending anyway */
+        if (write(ring->wakeup_fd, &byte, 1) < 0 && errno != EAGAIN)
+            ErrorF("write %s failed, %s", ring->fifo, strerror(errno));
+    }
+}
+
+/*
+ * This flushes changes to a screen out to the mmapped file: the header and
+ * colormap if they changed, and the rows of framebuffer the damage
+ * touches, merging boxes that share pages.
+ */
+static void
+vfbBlockHandler(void *blockData, void *timeout)
+{
+    vfbScreenInfoPtr pvfb = blockData;
+    ScreenPtr pScreen = screenInfo.screens[pvfb - vfbScreens];
+    size_t fbOffset = pvfb->pfbMemory - (char *) pvfb->pXWDHeader;
+    size_t stride = pvfb->paddedBytesWidth;
+    size_t start = 0, end = 0;
+    RegionPtr region;
+
+    if (pvfb->headerDirty) {
+        vfbSyncRange(pvfb, 0, fbOffset);
+        pvfb->headerDirty = FALSE;
+    }
+
+    if (!pvfb->damage)
+        return;
+
+    region = DamageRegion(pvfb->damage);
+    if (!RegionNotEmpty(region))
+        return;
+
+    BoxPtr pBox = RegionRects(region);
+    int nBox = RegionNumRects(region);
+
+    for (int i = 0; i < nBox; i++) {
+        size_t boxStart = fbOffset + pBox[i].y1 * stride +
+            pBox[i].x1 * pvfb->bitsPerPixel / 8;
+        size_t boxEnd = fbOffset + (pBox[i].y2 - 1) * stride +
+            (pBox[i].x2 * pvfb->bitsPerPixel + 7) / 8;
+
+        if (end && boxStart <= end + getpagesize()) {
+            end = max(end, boxEnd);
+            continue;
         }
+        if (end)
+            vfbSyncRange(pvfb, start, end);
+        start = boxStart;
+        end = boxEnd;
     }
+    vfbSyncRange(pvfb, start, end);
+
+    if (pvfb->ring)
+        vfbPublishDamage(pvfb, pScreen, region);
+
+    DamageEmpty(pvfb->damage);
 }
 
 static void
@@ -588,6 +864,95 @@ vfbWakeupHandler(void *blockData, int result)
 {
 }
 
+static void
+vfbCreateDamageRing(vfbScreenInfoPtr pvfb)
+{
+    vfbDamageRing *ring = calloc(1, sizeof(vfbDamageRing));
+    int fd;
+
+    if (!ring)
+        return;
+
+    snprintf(ring->file, sizeof(ring->file), "%s.damage", pvfb->mmap_file);
+    snprintf(ring->fifo, sizeof(ring->fifo), "%s.wakeup", pvfb->mmap_file);
+    ring->mapSize = VFB_DAMAGE_RECTS_OFFSET +
+        VFB_DAMAGE_RECTS * sizeof(vfbDamageRect);
+
+    unlink(ring->fifo);
+    if (-1 == mkfifo(ring->fifo, 0666)) {
+        ErrorF("mkfifo %s failed, %s\n", ring->fifo, strerror(errno));
+        goto fail;
+    }
+    /* opened for writing as well, so writes never block or raise SIGPIPE
+     * while no consumer has it open */
+    ring->wakeup_fd = open(ring->fifo, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (ring->wakeup_fd == -1) {
+        ErrorF("open %s failed, %s\n", ring->fifo, strerror(errno));
+        goto fail_fifo;
+    }
+
+    fd = open(ring->file, O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0666);
+    if (fd == -1 || ftruncate(fd, ring->mapSize) == -1) {
+        ErrorF("creating %s failed, %s\n", ring->file, strerror(errno));
+        goto fail_file;
+    }
+    ring->header = mmap(NULL, ring->mapSize, PROT_READ | PROT_WRITE,
+                        MAP_FILE | MAP_SHARED, fd, 0);
+    close(fd);
+    fd = -1;
+    if (ring->header == MAP_FAILED) {
+        ErrorF("mmap %s failed, %s\n", ring->file, strerror(errno));
+        goto fail_file;
+    }
+
+    ring->rects = (vfbDamageRect *) ((char *) ring->header +
+                                     VFB_DAMAGE_RECTS_OFFSET);
+    ring->header->version = VFB_DAMAGE_VERSION;
+    ring->header->size = VFB_DAMAGE_RECTS;
+    ring->header->width = pvfb->width;
+    ring->header->height = pvfb->height;
+    __atomic_store_n(&ring->header->magic, VFB_DAMAGE_MAGIC, __ATOMIC_RELEASE);
+
+    pvfb->ring = ring;
+    return;
+
+fail_file:
+    if (fd != -1)
+        close(fd);
+    unlink(ring->file);
+    close(ring->wakeup_fd);
+fail_fifo:
+    unlink(ring->fifo);
+fail:
+    free(ring);
+}
+
+static Bool
+vfbCreateScreenResources(ScreenPtr pScreen)
+{
+    vfbScreenInfoPtr pvfb = &vfbScreens[pScreen->myNum];
+    BoxRec box = { 0, 0, pScreen->width, pScreen->height };
+    PixmapPtr pPixmap;
+    Bool ret;
+
+    pScreen->CreateScreenResources = pvfb->createScreenResources;
+    ret = pScreen->CreateScreenResources(pScreen);
+    pScreen->CreateScreenResources = vfbCreateScreenResources;
+    if (!ret)
+        return FALSE;
+
+    pPixmap = pScreen->GetScreenPixmap(pScreen);
+    pvfb->damage = DamageCreate(NULL, NULL, DamageReportNone, TRUE, pScreen,
+                                NULL);
+    if (!pvfb->damage)
+        return FALSE;
+    DamageRegister(&pPixmap->drawable, pvfb->damage);
+
+    /* the first frame is the whole screen */
+    RegionReset(DamageRegion(pvfb->damage), &box);
+    return TRUE;
+}
+
 static void
 vfbAllocateMmappedFramebuffer(vfbScreenInfoPtr pvfb)
 {
@@ -631,10 +996,7 @@ vfbAllocateMmappedFramebuffer(vfbScreenInfoPtr pvfb)
         return;
     }
 
-    if (!RegisterBlockAndWakeupHandlers(vfbBlockHandler, vfbWakeupHandler,
-                                        NULL)) {
-        pvfb->pXWDHeader = NULL;
-    }
+    vfbCreateDamageRing(pvfb);
 }
 #endif                          /* HAVE_MMAP */
 
@@ -666,6 +1028,157 @@ vfbAllocateSharedMemoryFramebuffer(vfbScreenInfoPtr pvfb)
 }
 #endif /* CONFIG_MITSHM */
 
+#ifdef VFB_MEMFD
+static void
+vfbSendMemfd(int fd, vfbScreenInfoPtr pvfb)
+{
+    vfbMemfdInfo info = {
+        .magic = VFB_MEMFD_MAGIC,
+        .screen = pvfb - vfbScreens,
+        .numScreens = vfbNumScreens,
+        .stride = pvfb->paddedBytesWidth,
+        .size = pvfb->memfdSize,
+        .fbOffset = pvfb->pfbMemory - (char *) pvfb->pXWDHeader,
+        .width = pvfb->width,
+        .height = pvfb->height,
+        .bitsPerPixel = pvfb->bitsPerPixel,
+        .depth = pvfb->depth,
+    };
+    union {
+        struct cmsghdr cmsg;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control = { 0 };
+    struct iovec iov = { .iov_base = &info, .iov_len = sizeof(info) };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &pvfb->memfd, sizeof(int));
+
+    /* a handful of small messages fit into a fresh socket's buffer */
+    if (sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) != sizeof(info))
+        ErrorF("sending screen %d memfd failed, %s\n", info.screen,
+               strerror(errno));
+}
+
+static void
+vfbMemfdNotify(int fd, int ready, void *data)
+{
+    int conn = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+    int i;
+
+    if (conn == -1)
+        return;
+
+    for (i = 0; i < vfbNumScreens; i++)
+        if (vfbScreens[i].pXWDHeader)
+            vfbSendMemfd(conn, &vfbScreens[i]);
+
+    close(conn);
+}
+
+static Bool
+vfbListenMemfdSocket(void)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if (strlen(pmemfdsocket) >= sizeof(addr.sun_path)) {
+        ErrorF("memfd socket path %s too long\n", pmemfdsocket);
+        return FALSE;
+    }
+    strcpy(addr.sun_path, pmemfdsocket);
+
+    vfbMemfdListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (vfbMemfdListenFd == -1) {
+        ErrorF("socket failed, %s\n", strerror(errno));
+        return FALSE;
+    }
+
+    unlink(pmemfdsocket);
+    if (bind(vfbMemfdListenFd, (struct sockaddr *) &addr, sizeof(addr)) == -1 ||
+        listen(vfbMemfdListenFd, 4) == -1 ||
+        !SetNotifyFd(vfbMemfdListenFd, vfbMemfdNotify, X_NOTIFY_READ, NULL)) {
+        ErrorF("listening on %s failed, %s\n", pmemfdsocket, strerror(errno));
+        close(vfbMemfdListenFd);
+        vfbMemfdListenFd = -1;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Create a memfd of the given size and map it, with huge pages if asked
+ * for: hugetlbfs pages if some are reserved, transparent huge pages for
+ * shmem otherwise.
+ */
+static void *
+vfbMapMemfd(vfbScreenInfoPtr pvfb, unsigned int flags, size_t size)
+{
+    void *map;
+
+    pvfb->memfd = memfd_create("Xvfb", MFD_CLOEXEC | MFD_ALLOW_SEALING | flags);
+    if (pvfb->memfd == -1)
+        return NULL;
+
+    if (ftruncate(pvfb->memfd, size) == -1)
+        goto fail;
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, pvfb->memfd, 0);
+    if (map == MAP_FAILED)
+        goto fail;
+
+#ifdef MADV_HUGEPAGE
+    if (vfbHugePages && !(flags & MFD_HUGETLB))
+        madvise(map, size, MADV_HUGEPAGE);
+#endif
+
+    /* consumers must not be able to resize it under the server's feet */
+    fcntl(pvfb->memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+    pvfb->memfdSize = size;
+    return map;
+
+fail:
+    close(pvfb->memfd);
+    pvfb->memfd = -1;
+    return NULL;
+}
+
+static void
+vfbAllocateMemfdFramebuffer(vfbScreenInfoPtr pvfb)
+{
+    size_t size = pvfb->sizeInBytes;
+
+    if (vfbMemfdListenFd == -1 && !vfbListenMemfdSocket())
+        return;
+
+#ifdef MFD_HUGETLB
+    if (vfbHugePages) {
+        pvfb->pXWDHeader =
+            vfbMapMemfd(pvfb, MFD_HUGETLB, (size + VFB_HUGE_PAGE_SIZE - 1) &
+                        ~(size_t) (VFB_HUGE_PAGE_SIZE - 1));
+        if (pvfb->pXWDHeader)
+            return;
+        LogMessage(X_WARNING, "screen %d: no hugetlbfs pages, "
+                   "falling back to transparent huge pages\n",
+                   (int) (pvfb - vfbScreens));
+    }
+#endif
+
+    pvfb->pXWDHeader = vfbMapMemfd(pvfb, 0, size);
+    if (!pvfb->pXWDHeader)
+        ErrorF("memfd of %d bytes failed, %s\n", pvfb->sizeInBytes,
+               strerror(errno));
+}
+#endif /* VFB_MEMFD */
+
 static char *
 vfbAllocateFramebufferMemory(vfbScreenInfoPtr pvfb)
 {
@@ -716,6 +1229,15 @@ vfbAllocateFramebufferMemory(vfbScreenInfoPtr pvfb)
         break;
 #endif /* CONFIG_MITSHM */
 
+#ifdef VFB_MEMFD
+    case MEMFD_FB:
+        vfbAllocateMemfdFramebuffer(pvfb);
+        break;
+#else /* VFB_MEMFD */
+    case MEMFD_FB:
+        break;
+#endif /* VFB_MEMFD */
+
     case NORMAL_MEMORY_FB:
         pvfb->pXWDHeader = (XWDFileHeader *) calloc(1, pvfb->sizeInBytes);
         break;
@@ -821,6 +1343,13 @@ vfbCloseScreen(ScreenPtr pScreen)
     /*
      * fb overwrites miCloseScreen, so do this here
      */
+#ifdef HAVE_MMAP
+    /* goes away with the screen pixmap */
+    pvfb->damage = NULL;
+    if (fbmemtype == MMAPPED_FILE_FB)
+        RemoveBlockAndWakeupHandlers(vfbBlockHandler, vfbWakeupHandler, pvfb);
+#endif
+
     dixDestroyPixmap(pScreen->devPrivate, 0);
     pScreen->devPrivate = NULL;
 
@@ -1104,6 +1633,9 @@ vfbScreenInit(ScreenPtr pScreen, int argc, char **argv)
     if (!ret)
         return FALSE;
 
+    pScreen->x = pvfb->x;
+    pScreen->y = pvfb->y;
+
     if (Render) {
         fbPictureInit(pScreen, 0, 0);
 #ifdef GLAMOR
@@ -1131,6 +1663,20 @@ vfbScreenInit(ScreenPtr pScreen, int argc, char **argv)
     pvfb->closeScreen = pScreen->CloseScreen;
     pScreen->CloseScreen = vfbCloseScreen;
 
+#ifdef HAVE_MMAP
+    /* block handlers don't survive a server reset, so this goes here
+     * rather than with the framebuffer file */
+    if (ret && fbmemtype == MMAPPED_FILE_FB) {
+        if (!DamageSetup(pScreen) ||
+            !RegisterBlockAndWakeupHandlers(vfbBlockHandler, vfbWakeupHandler,
+                                            pvfb))
+            return FALSE;
+        pvfb->headerDirty = TRUE;
+        pvfb->createScreenResources = pScreen->CreateScreenResources;
+        pScreen->CreateScreenResources = vfbCreateScreenResources;
+    }
+#endif
+
     return ret;
 
 }                               /* end vfbScreenInit */
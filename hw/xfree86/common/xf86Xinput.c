@@ -329,6 +329,33 @@ ApplyTransformationMatrix(DeviceIntPtr dev)
                            PropModeReplace, 9, matrix, FALSE);
 }
 
+static void
+ApplyMotionHistorySize(DeviceIntPtr dev)
+{
+    InputInfoPtr pInfo = (InputInfoPtr) dev->public.devicePrivate;
+    int size;
+
+    if (!dev->valuator)
+        return;
+
+    size = xf86SetIntOption(pInfo->options, "MotionHistorySize",
+                            dev->valuator->numMotionEvents);
+    if (size == dev->valuator->numMotionEvents)
+        return;
+
+    if (size < 0) {
+        LogMessageVerb(X_ERROR, 1,
+                       "%s: invalid motion history size %d. Ignoring configuration.\n",
+                       pInfo->name, size);
+        return;
+    }
+
+    if (!SetMotionHistorySize(dev, size))
+        LogMessageVerb(X_ERROR, 1,
+                       "%s: failed to resize motion history to %d events\n",
+                       pInfo->name, size);
+}
+
 static void
 ApplyAutoRepeat(DeviceIntPtr dev)
 {
@@ -892,6 +919,7 @@ xf86InputDevicePostInit(DeviceIntPtr dev)
 {
     ApplyAccelerationSettings(dev);
     ApplyTransformationMatrix(dev);
+    ApplyMotionHistorySize(dev);
     ApplyAutoRepeat(dev);
     return Success;
 }
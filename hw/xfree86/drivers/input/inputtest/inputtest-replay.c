@@ -0,0 +1,445 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Records evdev event streams into inputtest events and replays them into
+ * an inputtest device, reporting the timings of the server's input path.
+ *
+ *   inputtest-replay record /dev/input/eventN recording
+ *   inputtest-replay replay [--speed factor] socket-path recording
+ *
+ * A recording is the magic XF86IT_RECORDING_MAGIC followed by records of a
+ * uint64_t timestamp in microseconds, relative to the first record, and an
+ * inputtest event of header.length bytes, all in host byte order.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/input.h>
+
+#include "xf86-input-inputtest-protocol.h"
+
+#define XF86IT_RECORDING_MAGIC "XF86ITR1"
+
+/* keep in sync with the axis setup of the inputtest pointer devices */
+#define AXIS_X 0
+#define AXIS_Y 1
+#define AXIS_HSCROLL 2
+#define AXIS_VSCROLL 3
+#define ABS_AXIS_MAX 0xffff
+#define SCROLL_INCREMENT 120
+
+#define MAX_PENDING 32
+
+static volatile sig_atomic_t stop_recording;
+
+static uint64_t
+now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void
+set_valuator(xf86ITValuatorData *data, int axis, double value, bool add)
+{
+    if (add && (data->mask[axis / 8] & (1 << (axis % 8))))
+        data->valuators[axis] += value;
+    else
+        data->valuators[axis] = value;
+    data->mask[axis / 8] |= 1 << (axis % 8);
+}
+
+static bool
+has_valuators(const xf86ITValuatorData *data)
+{
+    for (int i = 0; i < sizeof(data->mask); i++)
+        if (data->mask[i])
+            return true;
+    return false;
+}
+
+static int
+evdev_button(int code)
+{
+    switch (code) {
+        case BTN_LEFT: return 1;
+        case BTN_MIDDLE: return 2;
+        case BTN_RIGHT: return 3;
+        case BTN_SIDE: return 8;
+        case BTN_EXTRA: return 9;
+        case BTN_FORWARD: return 10;
+        case BTN_BACK: return 11;
+        case BTN_TASK: return 12;
+    }
+    return 0;
+}
+
+/* One SYN_REPORT frame: motion first, then buttons and keys */
+struct frame {
+    xf86ITEventMotion motion;
+    xf86ITEventAny pending[MAX_PENDING];
+    int num_pending;
+};
+
+static bool
+write_record(FILE *out, uint64_t time, const void *event)
+{
+    xf86ITEventHeader header;
+
+    memcpy(&header, event, sizeof(header));
+    return fwrite(&time, sizeof(time), 1, out) == 1 &&
+        fwrite(event, header.length, 1, out) == 1;
+}
+
+static void
+stop_handler(int sig)
+{
+    stop_recording = 1;
+}
+
+static int
+record(const char *device, const char *path)
+{
+    struct input_absinfo absinfo[2];
+    struct input_event ev;
+    struct sigaction sa;
+    struct frame frame;
+    uint64_t first_time = 0;
+    bool have_first = false;
+    int num_records = 0;
+    int fd;
+    FILE *out;
+
+    fd = open(device, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", device, strerror(errno));
+        return 1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (ioctl(fd, EVIOCGABS(ABS_X + i), &absinfo[i]) < 0 ||
+            absinfo[i].maximum <= absinfo[i].minimum) {
+            absinfo[i].minimum = 0;
+            absinfo[i].maximum = ABS_AXIS_MAX;
+        }
+    }
+
+    out = fopen(path, "wb");
+    if (!out) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        close(fd);
+        return 1;
+    }
+    fwrite(XF86IT_RECORDING_MAGIC, strlen(XF86IT_RECORDING_MAGIC), 1, out);
+
+    /* no SA_RESTART, the signal must interrupt the blocking read() */
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sa.sa_handler = stop_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    memset(&frame, 0, sizeof(frame));
+    frame.motion.header.length = sizeof(frame.motion);
+    frame.motion.header.type = XF86IT_EVENT_MOTION;
+
+    fprintf(stderr, "Recording %s, press Ctrl+C to stop\n", device);
+
+    while (!stop_recording && read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
+        uint64_t time = (uint64_t) ev.input_event_sec * 1000000 +
+            ev.input_event_usec;
+        xf86ITEventAny *event;
+        int button;
+
+        switch (ev.type) {
+            case EV_REL:
+                if (ev.code == REL_X || ev.code == REL_Y)
+                    set_valuator(&frame.motion.valuators,
+                                 ev.code == REL_X ? AXIS_X : AXIS_Y,
+                                 ev.value, true);
+                else if (ev.code == REL_WHEEL)
+                    set_valuator(&frame.motion.valuators, AXIS_VSCROLL,
+                                 -ev.value * SCROLL_INCREMENT, true);
+                else if (ev.code == REL_HWHEEL)
+                    set_valuator(&frame.motion.valuators, AXIS_HSCROLL,
+                                 ev.value * SCROLL_INCREMENT, true);
+                break;
+            case EV_ABS:
+                if (ev.code == ABS_X || ev.code == ABS_Y) {
+                    struct input_absinfo *info = &absinfo[ev.code - ABS_X];
+
+                    frame.motion.is_absolute = 1;
+                    set_valuator(&frame.motion.valuators, ev.code - ABS_X,
+                                 (double) (ev.value - info->minimum) *
+                                 ABS_AXIS_MAX / (info->maximum - info->minimum),
+                                 false);
+                }
+                break;
+            case EV_KEY:
+                /* autorepeat is the server's business */
+                if (ev.value == 2 || frame.num_pending == MAX_PENDING)
+                    break;
+
+                event = &frame.pending[frame.num_pending];
+                memset(event, 0, sizeof(*event));
+                button = evdev_button(ev.code);
+                if (button) {
+                    event->button.header.length = sizeof(event->button);
+                    event->button.header.type = XF86IT_EVENT_BUTTON;
+                    event->button.button = button;
+                    event->button.is_press = ev.value;
+                    frame.num_pending++;
+                }
+                else if (ev.code < BTN_MISC) {
+                    event->key.header.length = sizeof(event->key);
+                    event->key.header.type = XF86IT_EVENT_KEY;
+                    event->key.key_code = ev.code + 8;
+                    event->key.is_press = ev.value;
+                    frame.num_pending++;
+                }
+                break;
+            case EV_SYN:
+                if (ev.code != SYN_REPORT)
+                    break;
+
+                if (!has_valuators(&frame.motion.valuators) && !frame.num_pending)
+                    break;
+
+                if (!have_first) {
+                    first_time = time;
+                    have_first = true;
+                }
+
+                if (has_valuators(&frame.motion.valuators)) {
+                    write_record(out, time - first_time, &frame.motion);
+                    num_records++;
+                }
+                for (int i = 0; i < frame.num_pending; i++) {
+                    write_record(out, time - first_time, &frame.pending[i]);
+                    num_records++;
+                }
+
+                memset(&frame.motion.valuators, 0, sizeof(frame.motion.valuators));
+                frame.motion.is_absolute = 0;
+                frame.num_pending = 0;
+                break;
+        }
+    }
+
+    fprintf(stderr, "Recorded %d events\n", num_records);
+
+    close(fd);
+    return fclose(out) == 0 ? 0 : 1;
+}
+
+static bool
+write_event(int fd, const void *event)
+{
+    xf86ITEventHeader header;
+
+    memcpy(&header, event, sizeof(header));
+    return write(fd, event, header.length) == header.length;
+}
+
+static bool
+read_response(int fd, enum xf86ITResponseType type, xf86ITResponseAny *response)
+{
+    xf86ITResponseHeader header;
+
+    if (read(fd, &header, sizeof(header)) != sizeof(header) ||
+        header.type != type || header.length > sizeof(*response))
+        return false;
+
+    memcpy(response, &header, sizeof(header));
+    return read(fd, (char *) response + sizeof(header),
+                header.length - sizeof(header)) == header.length - sizeof(header);
+}
+
+static int
+replay(const char *socket_path, const char *path, double speed)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    xf86ITEventClientVersion version;
+    xf86ITEventWaitForSync sync;
+    xf86ITEventGetStats get_stats;
+    xf86ITResponseAny response;
+    xf86ITResponseStats *stats = &response.stats;
+    xf86ITEventAny event;
+    xf86ITEventHeader header;
+    char magic[sizeof(XF86IT_RECORDING_MAGIC) - 1];
+    uint64_t start, elapsed, time;
+    int num_events = 0;
+    int fd;
+    FILE *in;
+
+    in = fopen(path, "rb");
+    if (!in) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    if (fread(magic, sizeof(magic), 1, in) != 1 ||
+        memcmp(magic, XF86IT_RECORDING_MAGIC, sizeof(magic)) != 0) {
+        fprintf(stderr, "%s is not an inputtest recording\n", path);
+        fclose(in);
+        return 1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Failed to connect to %s: %s\n", socket_path,
+                strerror(errno));
+        fclose(in);
+        return 1;
+    }
+
+    version.header.length = sizeof(version);
+    version.header.type = XF86IT_EVENT_CLIENT_VERSION;
+    version.major = XF86IT_PROTOCOL_VERSION_MAJOR;
+    version.minor = XF86IT_PROTOCOL_VERSION_MINOR;
+    if (!write_event(fd, &version) ||
+        !read_response(fd, XF86IT_RESPONSE_SERVER_VERSION, &response)) {
+        fprintf(stderr, "Protocol version handshake failed\n");
+        goto fail;
+    }
+
+    /* discard the stats of whatever ran before */
+    get_stats.header.length = sizeof(get_stats);
+    get_stats.header.type = XF86IT_EVENT_GET_STATS;
+    if (!write_event(fd, &get_stats) ||
+        !read_response(fd, XF86IT_RESPONSE_STATS, &response)) {
+        fprintf(stderr, "Server does not support input path statistics\n");
+        goto fail;
+    }
+
+    start = now_us();
+    while (fread(&time, sizeof(time), 1, in) == 1 &&
+           fread(&header, sizeof(header), 1, in) == 1) {
+        if (header.length < sizeof(header) || header.length > sizeof(event)) {
+            fprintf(stderr, "Corrupt recording\n");
+            goto fail;
+        }
+
+        memcpy(&event, &header, sizeof(header));
+        if (fread((char *) &event + sizeof(header),
+                  header.length - sizeof(header), 1, in) != 1)
+            break;
+
+        if (speed > 0) {
+            uint64_t due = start + time / speed;
+            uint64_t now = now_us();
+
+            if (due > now)
+                usleep(due - now);
+        }
+
+        if (!write_event(fd, &event)) {
+            fprintf(stderr, "Failed to send event: %s\n", strerror(errno));
+            goto fail;
+        }
+        num_events++;
+    }
+
+    sync.header.length = sizeof(sync);
+    sync.header.type = XF86IT_EVENT_WAIT_FOR_SYNC;
+    if (!write_event(fd, &sync) ||
+        !read_response(fd, XF86IT_RESPONSE_SYNC_FINISHED, &response)) {
+        fprintf(stderr, "Failed to synchronize with the server\n");
+        goto fail;
+    }
+    elapsed = now_us() - start;
+
+    if (!write_event(fd, &get_stats) ||
+        !read_response(fd, XF86IT_RESPONSE_STATS, &response)) {
+        fprintf(stderr, "Failed to fetch input path statistics\n");
+        goto fail;
+    }
+
+    printf("events sent:       %d in %.3f ms\n", num_events, elapsed / 1000.0);
+    printf("events posted:     %u, queue drained %u times\n",
+           stats->num_events, stats->num_drains);
+    if (stats->num_events) {
+        printf("post time:         %.2f us mean, %llu us max\n",
+               (double) stats->post_time_total / stats->num_events,
+               (unsigned long long) stats->post_time_max);
+        printf("delivery latency:  %.2f us mean, %llu us max\n",
+               (double) stats->latency_total / stats->num_events,
+               (unsigned long long) stats->latency_max);
+    }
+
+    close(fd);
+    fclose(in);
+    return 0;
+
+ fail:
+    close(fd);
+    fclose(in);
+    return 1;
+}
+
+static void
+usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s record <evdev device> <recording>\n"
+            "       %s replay [--speed <factor>] <socket path> <recording>\n"
+            "\n"
+            "A speed factor of 0 replays the events as fast as possible.\n",
+            name, name);
+}
+
+int
+main(int argc, char **argv)
+{
+    double speed = 1.0;
+
+    if (argc == 4 && strcmp(argv[1], "record") == 0)
+        return record(argv[2], argv[3]);
+
+    if (argc >= 4 && strcmp(argv[1], "replay") == 0) {
+        int arg = 2;
+
+        if (strcmp(argv[arg], "--speed") == 0 && argc == 6) {
+            speed = atof(argv[arg + 1]);
+            arg += 2;
+        }
+        if (argc - arg == 2)
+            return replay(argv[arg], argv[arg + 1], speed);
+    }
+
+    usage(argv[0]);
+    return 1;
+}
@@ -31,11 +31,12 @@ extern "C" {
 #include <stdint.h>
 
 #define XF86IT_PROTOCOL_VERSION_MAJOR 1
-#define XF86IT_PROTOCOL_VERSION_MINOR 1
+#define XF86IT_PROTOCOL_VERSION_MINOR 2
 
 enum xf86ITResponseType {
     XF86IT_RESPONSE_SERVER_VERSION,
     XF86IT_RESPONSE_SYNC_FINISHED,
+    XF86IT_RESPONSE_STATS, /* since 1.2 */
 };
 
 typedef struct {
@@ -53,9 +54,24 @@ typedef struct {
     xf86ITResponseHeader header;
 } xf86ITResponseSyncFinished;
 
+/* Input path timings, in microseconds, accumulated since the previous
+   xf86ITEventGetStats event */
+typedef struct {
+    xf86ITResponseHeader header;
+    uint32_t num_events;        /* number of input events posted */
+    uint32_t num_drains;        /* number of times the input queue was drained */
+    uint64_t post_time_total;   /* time spent posting events, i.e. in
+                                   GetPointerEvents() and friends and mieq */
+    uint64_t post_time_max;
+    uint64_t latency_total;     /* time from posting an event to the input
+                                   queue being processed */
+    uint64_t latency_max;
+} xf86ITResponseStats;
+
 typedef union {
     xf86ITResponseHeader header;
     xf86ITResponseServerVersion version;
+    xf86ITResponseStats stats;
 } xf86ITResponseAny;
 
 /* We care more about preserving the binary input driver protocol more than the
@@ -72,6 +88,7 @@ enum xf86ITEventType {
     XF86IT_EVENT_TOUCH,
     XF86IT_EVENT_GESTURE_PINCH,
     XF86IT_EVENT_GESTURE_SWIPE,
+    XF86IT_EVENT_GET_STATS, /* since 1.2 */
 };
 
 typedef struct {
@@ -96,6 +113,10 @@ typedef struct {
     xf86ITEventHeader header;
 } xf86ITEventWaitForSync;
 
+typedef struct {
+    xf86ITEventHeader header;
+} xf86ITEventGetStats;
+
 typedef struct {
     xf86ITEventHeader header;
     uint32_t is_absolute;
@@ -106,6 +106,22 @@ typedef struct {
     int last_processed_event_num;
     int last_event_num;
 
+    /*  Input path timings reported by xf86ITEventGetStats, in microseconds. Protected by
+        waiting_for_drain_mutex, too. The pending_* fields cover the events posted since the
+        input queue was last drained.
+    */
+    struct {
+        uint32_t num_events;
+        uint32_t num_drains;
+        uint64_t post_time_total;
+        uint64_t post_time_max;
+        uint64_t latency_total;
+        uint64_t latency_max;
+        uint32_t pending_events;
+        uint64_t pending_time_sum;
+        uint64_t pending_time_first;
+    } stats;
+
     ValuatorMask *valuators;
     ValuatorMask *valuators_unaccelerated;
 } xf86ITDevice, *xf86ITDevicePtr;
@@ -144,6 +160,17 @@ input_drain_callback(CallbackListPtr *callback, void *data, void *call_data)
 
     pthread_mutex_lock(&driver_data->waiting_for_drain_mutex);
     driver_data->last_processed_event_num = driver_data->last_event_num;
+    if (driver_data->stats.pending_events) {
+        uint64_t now = GetTimeInMicros();
+
+        driver_data->stats.num_drains++;
+        driver_data->stats.latency_total +=
+            driver_data->stats.pending_events * now - driver_data->stats.pending_time_sum;
+        driver_data->stats.latency_max = max(driver_data->stats.latency_max,
+                                             now - driver_data->stats.pending_time_first);
+        driver_data->stats.pending_events = 0;
+        driver_data->stats.pending_time_sum = 0;
+    }
     if (driver_data->waiting_for_drain) {
         driver_data->waiting_for_drain = false;
         notify_synchronization = true;
@@ -617,6 +644,38 @@ handle_wait_for_sync(InputInfoPtr pInfo)
     }
 }
 
+static void
+handle_get_stats(InputInfoPtr pInfo)
+{
+    xf86ITDevicePtr driver_data = pInfo->private;
+    xf86ITResponseStats response;
+
+    memset(&response, 0, sizeof(response));
+    response.header.length = sizeof(response);
+    response.header.type = XF86IT_RESPONSE_STATS;
+
+    pthread_mutex_lock(&driver_data->waiting_for_drain_mutex);
+    response.num_events = driver_data->stats.num_events;
+    response.num_drains = driver_data->stats.num_drains;
+    response.post_time_total = driver_data->stats.post_time_total;
+    response.post_time_max = driver_data->stats.post_time_max;
+    response.latency_total = driver_data->stats.latency_total;
+    response.latency_max = driver_data->stats.latency_max;
+
+    driver_data->stats.num_events = 0;
+    driver_data->stats.num_drains = 0;
+    driver_data->stats.post_time_total = 0;
+    driver_data->stats.post_time_max = 0;
+    driver_data->stats.latency_total = 0;
+    driver_data->stats.latency_max = 0;
+    pthread_mutex_unlock(&driver_data->waiting_for_drain_mutex);
+
+    if (write(driver_data->connection_fd, &response, response.header.length) != response.header.length) {
+        xf86IDrvMsg(pInfo, X_ERROR, "Error writing stats: %s\n", strerror(errno));
+        teardown_client_connection(pInfo);
+    }
+}
+
 static void
 handle_motion(InputInfoPtr pInfo, xf86ITEventMotion *event)
 {
@@ -737,13 +796,64 @@ client_new_handle_event(InputInfoPtr pInfo, xf86ITEventAny *event)
     }
 }
 
+static bool
+is_input_event(enum xf86ITEventType type)
+{
+    switch (type) {
+        case XF86IT_EVENT_MOTION:
+        case XF86IT_EVENT_PROXIMITY:
+        case XF86IT_EVENT_BUTTON:
+        case XF86IT_EVENT_KEY:
+        case XF86IT_EVENT_TOUCH:
+        case XF86IT_EVENT_GESTURE_PINCH:
+        case XF86IT_EVENT_GESTURE_SWIPE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void
+stats_event_begin(xf86ITDevicePtr driver_data, uint64_t start)
+{
+    pthread_mutex_lock(&driver_data->waiting_for_drain_mutex);
+    if (driver_data->stats.pending_events++ == 0)
+        driver_data->stats.pending_time_first = start;
+    driver_data->stats.pending_time_sum += start;
+    pthread_mutex_unlock(&driver_data->waiting_for_drain_mutex);
+}
+
+static void
+stats_event_end(xf86ITDevicePtr driver_data, uint64_t start)
+{
+    uint64_t elapsed = GetTimeInMicros() - start;
+
+    pthread_mutex_lock(&driver_data->waiting_for_drain_mutex);
+    driver_data->stats.num_events++;
+    driver_data->stats.post_time_total += elapsed;
+    driver_data->stats.post_time_max = max(driver_data->stats.post_time_max, elapsed);
+    pthread_mutex_unlock(&driver_data->waiting_for_drain_mutex);
+}
+
 static void
 client_ready_handle_event(InputInfoPtr pInfo, xf86ITEventAny *event)
 {
+    xf86ITDevicePtr driver_data = pInfo->private;
+    bool timed = is_input_event(event->header.type);
+    uint64_t start = 0;
+
+    if (timed) {
+        start = GetTimeInMicros();
+        stats_event_begin(driver_data, start);
+    }
+
     switch (event->header.type) {
         case XF86IT_EVENT_WAIT_FOR_SYNC:
             handle_wait_for_sync(pInfo);
             break;
+        case XF86IT_EVENT_GET_STATS:
+            handle_get_stats(pInfo);
+            break;
         case XF86IT_EVENT_MOTION:
             handle_motion(pInfo, &event->motion);
             break;
@@ -775,6 +885,9 @@ client_ready_handle_event(InputInfoPtr pInfo, xf86ITEventAny *event)
             teardown_client_connection(pInfo);
             break;
     }
+
+    if (timed)
+        stats_event_end(driver_data, start);
 }
 
 static void
@@ -811,6 +924,7 @@ is_supported_event(enum xf86ITEventType type)
         case XF86IT_EVENT_TOUCH:
         case XF86IT_EVENT_GESTURE_PINCH:
         case XF86IT_EVENT_GESTURE_SWIPE:
+        case XF86IT_EVENT_GET_STATS:
             return true;
     }
     return false;
@@ -829,6 +943,7 @@ get_event_size(enum xf86ITEventType type)
         case XF86IT_EVENT_TOUCH: return sizeof(xf86ITEventTouch);
         case XF86IT_EVENT_GESTURE_PINCH: return sizeof(xf86ITEventGesturePinch);
         case XF86IT_EVENT_GESTURE_SWIPE: return sizeof(xf86ITEventGestureSwipe);
+        case XF86IT_EVENT_GET_STATS: return sizeof(xf86ITEventGetStats);
     }
     FatalError("xf86-input-inputtest: get_event_size() got undefined event type %d\n", (int)type);
 }
@@ -5,6 +5,7 @@
 
 #include "xf86Cursor.h"
 #include "mipointrst.h"
+#include "list.h"
 
 typedef struct {
     Bool SWCursor;
@@ -32,6 +33,11 @@ typedef struct {
     Bool HWCursorForced;
 
     void *transparentData;
+
+    /* Realized images, shared by the cursors with the same bits */
+    struct xorg_list images;
+    /* Referenced, its image is the one in the hardware */
+    CursorPtr LoadedCursor;
 } xf86CursorScreenRec, *xf86CursorScreenPtr;
 
 Bool xf86SetCursor(ScreenPtr pScreen, CursorPtr pCurs, int x, int y);
@@ -40,6 +46,9 @@ void xf86MoveCursor(ScreenPtr pScreen, int x, int y);
 void xf86RecolorCursor(ScreenPtr pScreen, CursorPtr pCurs, Bool displayed);
 Bool xf86InitHardwareCursor(ScreenPtr pScreen, xf86CursorInfoPtr infoPtr);
 
+void xf86PutCursorImage(xf86CursorScreenPtr ScreenPriv, unsigned char *image);
+void xf86FreeCursorImages(xf86CursorScreenPtr ScreenPriv);
+
 Bool xf86CheckHWCursor(ScreenPtr pScreen, CursorPtr cursor, xf86CursorInfoPtr infoPtr);
 extern _X_EXPORT DevPrivateKeyRec xf86CursorScreenKeyRec;
 
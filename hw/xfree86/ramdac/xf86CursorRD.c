@@ -82,6 +82,7 @@ xf86InitCursor(ScreenPtr pScreen, xf86CursorInfoPtr infoPtr)
     ScreenPriv->CursorInfoPtr = infoPtr;
     ScreenPriv->PalettedCursor = FALSE;
     ScreenPriv->pInstalledMap = NULL;
+    xorg_list_init(&ScreenPriv->images);
 
     dixScreenHookClose(pScreen, xf86CursorCloseScreen);
     ScreenPriv->QueryBestSize = pScreen->QueryBestSize;
@@ -141,6 +142,7 @@ static void xf86CursorCloseScreen(CallbackListPtr *pcbl,
         xf86SetCursor(pScreen, NullCursor, ScreenPriv->x, ScreenPriv->y);
 
     FreeCursor(ScreenPriv->CurrentCursor, None);
+    xf86FreeCursorImages(ScreenPriv);
 
     pScreen->QueryBestSize = ScreenPriv->QueryBestSize;
     pScreen->RecolorCursor = ScreenPriv->RecolorCursor;
@@ -228,6 +230,10 @@ xf86CursorEnableDisableFBAccess(ScrnInfoPtr pScrn, Bool enable)
         ScreenPriv->SavedCursor = currentCursor;
     }
 
+    /* the hardware may lose the cursor image without FB access */
+    FreeCursor(ScreenPriv->LoadedCursor, None);
+    ScreenPriv->LoadedCursor = NULL;
+
     if (ScreenPriv->EnableDisableFBAccess)
         (*ScreenPriv->EnableDisableFBAccess) (pScrn, enable);
 
@@ -257,6 +263,9 @@ xf86CursorSwitchMode(ScrnInfoPtr pScrn, DisplayModePtr mode)
         ScreenPriv->isUp = FALSE;
     }
 
+    FreeCursor(ScreenPriv->LoadedCursor, None);
+    ScreenPriv->LoadedCursor = NULL;
+
     ret = (*ScreenPriv->SwitchMode) (pScrn, mode);
 
     /*
@@ -294,8 +303,9 @@ xf86CursorUnrealizeCursor(DeviceIntPtr pDev, ScreenPtr pScreen, CursorPtr pCurs)
                                                &xf86CursorScreenKeyRec);
 
     if (CursorRefCount(pCurs) <= 1) {
-        free(dixLookupScreenPrivate
-             (&pCurs->devPrivates, &xf86ScreenCursorBitsKeyRec, pScreen));
+        xf86PutCursorImage(ScreenPriv, dixLookupScreenPrivate
+                           (&pCurs->devPrivates, &xf86ScreenCursorBitsKeyRec,
+                            pScreen));
         dixSetScreenPrivate(&pCurs->devPrivates, &xf86ScreenCursorBitsKeyRec,
                             pScreen, NULL);
     }
@@ -4,6 +4,7 @@
 #include <X11/X.h>
 
 #include "dix/colormap_priv.h"
+#include "dix/cursor_priv.h"
 #include "include/misc.h"
 #include "Xext/randr/randrstr_priv.h"
 
@@ -22,6 +23,18 @@
 static void
 xf86RecolorCursor_locked(xf86CursorScreenPtr ScreenPriv, CursorPtr pCurs);
 
+/*
+ * Cursors with the same image share their bits (see dix/cursor.c), so the
+ * image realized for one is good for all of them. The images are counted by
+ * the cursors whose private points to them, and those keep the bits alive.
+ */
+typedef struct {
+    struct xorg_list entry;
+    CursorBitsPtr bits;
+    unsigned char *image;
+    int refcnt;
+} xf86CursorImageRec, *xf86CursorImagePtr;
+
 static CARD32
 xf86ReverseBitOrder(CARD32 v)
 {
@@ -133,6 +146,68 @@ xf86ScreenCheckHWCursor(ScreenPtr pScreen, CursorPtr cursor, xf86CursorInfoPtr i
          (!infoPtr->UseHWCursor || infoPtr->UseHWCursor(pScreen, cursor)));
 }
 
+static unsigned char *
+xf86GetCursorImage(xf86CursorScreenPtr ScreenPriv, CursorPtr pCurs)
+{
+    xf86CursorInfoPtr infoPtr = ScreenPriv->CursorInfoPtr;
+    xf86CursorImagePtr image;
+
+    xorg_list_for_each_entry(image, &ScreenPriv->images, entry) {
+        if (image->bits == pCurs->bits) {
+            image->refcnt++;
+            return image->image;
+        }
+    }
+
+    image = calloc(1, sizeof(xf86CursorImageRec));
+    if (!image)
+        return NULL;
+    image->image = (*infoPtr->RealizeCursor) (infoPtr, pCurs);
+    if (!image->image) {
+        free(image);
+        return NULL;
+    }
+    image->bits = pCurs->bits;
+    image->refcnt = 1;
+    xorg_list_add(&image->entry, &ScreenPriv->images);
+    return image->image;
+}
+
+void
+xf86PutCursorImage(xf86CursorScreenPtr ScreenPriv, unsigned char *image)
+{
+    xf86CursorImagePtr entry;
+
+    if (!image)
+        return;
+
+    xorg_list_for_each_entry(entry, &ScreenPriv->images, entry) {
+        if (entry->image == image) {
+            if (--entry->refcnt > 0)
+                return;
+            xorg_list_del(&entry->entry);
+            free(entry->image);
+            free(entry);
+            return;
+        }
+    }
+}
+
+void
+xf86FreeCursorImages(xf86CursorScreenPtr ScreenPriv)
+{
+    xf86CursorImagePtr image, tmp;
+
+    FreeCursor(ScreenPriv->LoadedCursor, None);
+    ScreenPriv->LoadedCursor = NULL;
+
+    xorg_list_for_each_entry_safe(image, tmp, &ScreenPriv->images, entry) {
+        xorg_list_del(&image->entry);
+        free(image->image);
+        free(image);
+    }
+}
+
 Bool
 xf86CheckHWCursor(ScreenPtr pScreen, CursorPtr cursor, xf86CursorInfoPtr infoPtr)
 {
@@ -209,21 +284,31 @@ xf86ScreenSetCursor(ScreenPtr pScreen, CursorPtr pCurs, int x, int y)
 
     if (!pCurs->bits->argb || !xf86DriverHasLoadCursorARGB(infoPtr))
         if (!bits) {
-            bits = (*infoPtr->RealizeCursor) (infoPtr, pCurs);
+            bits = xf86GetCursorImage(ScreenPriv, pCurs);
             dixSetScreenPrivate(&pCurs->devPrivates,
                                 &xf86ScreenCursorBitsKeyRec, pScreen, bits);
         }
 
-    if (!(infoPtr->Flags & HARDWARE_CURSOR_UPDATE_UNHIDDEN))
-        (*infoPtr->HideCursor) (infoPtr->pScrn);
-
-    if (pCurs->bits->argb && xf86DriverHasLoadCursorARGB(infoPtr)) {
-        if (!xf86DriverLoadCursorARGB (infoPtr, pCurs))
-            return FALSE;
-    } else
-    if (bits)
-        if (!xf86DriverLoadCursorImage (infoPtr, bits))
-            return FALSE;
+    /* switching between cursors with the same image needs no upload */
+    if (!ScreenPriv->LoadedCursor ||
+        ScreenPriv->LoadedCursor->bits != pCurs->bits) {
+        FreeCursor(ScreenPriv->LoadedCursor, None);
+        ScreenPriv->LoadedCursor = NULL;
+
+        if (!(infoPtr->Flags & HARDWARE_CURSOR_UPDATE_UNHIDDEN))
+            (*infoPtr->HideCursor) (infoPtr->pScrn);
+
+        if (pCurs->bits->argb && xf86DriverHasLoadCursorARGB(infoPtr)) {
+            if (!xf86DriverLoadCursorARGB (infoPtr, pCurs))
+                return FALSE;
+            ScreenPriv->LoadedCursor = RefCursor(pCurs);
+        } else
+        if (bits) {
+            if (!xf86DriverLoadCursorImage (infoPtr, bits))
+                return FALSE;
+            ScreenPriv->LoadedCursor = RefCursor(pCurs);
+        }
+    }
 
     xf86RecolorCursor_locked (ScreenPriv, pCurs);
 
@@ -284,6 +369,9 @@ xf86SetTransparentCursor(ScreenPtr pScreen)
         ScreenPriv->transparentData =
             (*infoPtr->RealizeCursor) (infoPtr, NullCursor);
 
+    FreeCursor(ScreenPriv->LoadedCursor, None);
+    ScreenPriv->LoadedCursor = NULL;
+
     if (!(infoPtr->Flags & HARDWARE_CURSOR_UPDATE_UNHIDDEN))
         (*infoPtr->HideCursor) (infoPtr->pScrn);
 
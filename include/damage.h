@@ -111,6 +111,27 @@ extern _X_EXPORT void
 extern _X_EXPORT void
  DamageRegionProcessPending(DrawablePtr pDrawable);
 
+/*
+ * Keep the damage of the last nframes frames, so that the damage since any
+ * of them can be asked for with DamageAgeRegion(). 0 stops tracking.
+ */
+extern _X_EXPORT Bool
+ DamageSetAgeTracking(DamagePtr pDamage, int nframes);
+
+/*
+ * End the current frame and return its sequence number, which is never 0.
+ * Returns 0 if age tracking is off.
+ */
+extern _X_EXPORT CARD32
+ DamageAgeEndFrame(DamagePtr pDamage);
+
+/*
+ * Store all damage since the end of the given frame in pRegion. Returns
+ * FALSE if that frame is unknown or too old to be tracked still.
+ */
+extern _X_EXPORT Bool
+ DamageAgeRegion(DamagePtr pDamage, CARD32 sequence, RegionPtr pRegion);
+
 /* Call this when you create a new Damage and you wish to send an initial damage message (to it). */
 extern _X_EXPORT void
  DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion);
@@ -44,6 +44,7 @@ typedef struct _damage {
     Bool reportAfter;
     RegionRec pendingDamage;    /* will be flushed post submission at the latest */
     ScreenPtr pScreen;
+    struct _damageAge *age;     /* per frame history, see DamageSetAgeTracking */
 } DamageRec;
 
 typedef struct _damageScrPriv {
@@ -53,6 +53,20 @@ typedef void (*ReplySwapPtr) (ClientPtr /* pClient */ ,
                               int /* size */ ,
                               void * /* pbuf */ );
 
+/*
+ * Per-client resource accounting, reported by X-CLIENT-STATS.
+ */
+typedef struct _ClientStats {
+    CARD64 dispatchTime;        /* thread CPU time spent in dispatch, ns */
+    CARD64 requests;            /* requests dispatched */
+    CARD64 bytesRead;           /* bytes read from the connection */
+    CARD64 bytesWritten;        /* bytes written to the connection */
+    CARD64 bytesQueued;         /* bytes handed to WriteToClient */
+    CARD64 blockedTime;         /* time output was stuck in the buffer, us */
+    CARD64 blockedSince;        /* start of current blocked period, or 0 */
+    CARD32 outputHighWater;     /* largest amount of output buffered, bytes */
+} ClientStatsRec;
+
 typedef enum { ClientStateInitial,
     ClientStateRunning,
     ClientStateRetained,
@@ -100,6 +114,11 @@ struct _Client {
 
     /* driver should never ever touch anything beyond here */
     struct xorg_list saveSets;
+    ClientStatsRec stats;
+
+    /* fair-share scheduling, see dix/dispatch.c */
+    CARD64 sched_vruntime;      /* weighted dispatch time, ns */
+    CARD32 sched_weight;
 };
 
 extern _X_EXPORT TimeStamp currentTime;
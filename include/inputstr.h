@@ -591,6 +591,11 @@ typedef struct _DeviceIntRec {
     /* scale matrix for absolute devices, this is the combined matrix of
        [1/scale] . [transform] . [scale]. See DeviceSetTransform */
     struct pixman_f_transform scale_and_transform;
+    /* inverse of scale_and_transform */
+    struct pixman_f_transform scale_and_transform_inverse;
+    /* whether the above matrices are the identity, see DeviceSetTransform */
+    Bool relative_transform_is_identity;
+    Bool scale_and_transform_is_identity;
 
     /* XTest related master device id */
     int xtest_master_id;
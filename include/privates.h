@@ -116,6 +116,20 @@ typedef struct _DevScreenPrivateKeyRec {
  */
 _X_EXPORT Bool  dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size);
 
+/*
+ * Mark a registered key as hot, i.e. looked up by most drawing operations.
+ *
+ * Hot keys of window, pixmap, GC and picture privates are grouped at the
+ * start of the private block when the server lays out the keys after
+ * extension initialization, instead of being spread out in registration
+ * order. Objects of those types are then allocated on a cache line
+ * boundary, so their hot privates share as few cache lines as possible.
+ *
+ * This is only a hint; keys registered after the layout are not moved.
+ */
+extern _X_EXPORT void
+dixSetPrivateKeyHot(DevPrivateKey key);
+
 /*
  * Check whether a private key has been registered
  */
@@ -358,6 +372,16 @@ extern void
 extern _X_EXPORT void
  dixResetPrivates(void);
 
+/*
+ * Moves the hot keys of each type without objects to the start of its
+ * private block. dixLayoutPrivates is called from the main loop once the
+ * screens and extensions have registered their keys, unless the server was
+ * started with -nolayoutprivates.  This function must only be called by
+ * main().
+ */
+extern void
+ dixLayoutPrivates(void);
+
 /*
  * Looks up the offset where the devPrivates field is located.
  *
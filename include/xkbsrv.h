@@ -187,6 +187,12 @@ typedef struct {
      */
     ProcessInputProc realInputProc;
     DeviceUnwrapProc unwrapProc;
+    /* union of the notify masks of all clients interested in the device,
+     * see XkbUpdateInterestMasks() */
+    CARD16 stateNotifyMask;
+    CARD32 ctrlsNotifyMask;
+    CARD32 iStateNotifyMask;
+    CARD32 iMapNotifyMask;
 } xkbDeviceInfoRec, *xkbDeviceInfoPtr;
 
 /***====================================================================***/
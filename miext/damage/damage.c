@@ -124,6 +124,20 @@ getDrawableDamageRef(DrawablePtr pDrawable)
     DamagePtr	*pPrev = (DamagePtr *) \
 	dixLookupPrivateAddr(&(pWindow)->devPrivates, damageWinPrivateKey)
 
+typedef struct _damageAge {
+    int nframes;
+    CARD32 sequence;            /* last frame ended */
+    RegionRec current;          /* damage since then */
+    RegionRec frames[];         /* damage of frame n in [n % nframes] */
+} DamageAgeRec, *DamageAgePtr;
+
+static inline void
+damageAgeAppend(DamagePtr pDamage, RegionPtr pRegion)
+{
+    if (pDamage->age)
+        RegionUnion(&pDamage->age->current, &pDamage->age->current, pRegion);
+}
+
 #if DAMAGE_DEBUG_ENABLE
 static void
 _damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
@@ -261,8 +275,10 @@ damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
         if (!pDamage->reportAfter) {
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, pDamageRegion);
-            else
+            else {
                 RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+                damageAgeAppend(pDamage, pDamageRegion);
+            }
         }
 
         /*
@@ -287,9 +303,11 @@ damageRegionProcessPending(DrawablePtr pDrawable)
             /* It's possible that there is only interest in postRendering reporting. */
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, &pDamage->pendingDamage);
-            else
+            else {
                 RegionUnion(&pDamage->damage, &pDamage->damage,
                             &pDamage->pendingDamage);
+                damageAgeAppend(pDamage, &pDamage->pendingDamage);
+            }
         }
 
         if (pDamage->reportAfter)
@@ -1661,6 +1679,10 @@ DamageSetup(ScreenPtr pScreen)
     if (!dixRegisterPrivateKey(&damageWinPrivateKeyRec, PRIVATE_WINDOW, 0))
         return FALSE;
 
+    dixSetPrivateKeyHot(&damageGCPrivateKeyRec);
+    dixSetPrivateKeyHot(&damagePixPrivateKeyRec);
+    dixSetPrivateKeyHot(&damageWinPrivateKeyRec);
+
     DamageScrPrivPtr pScrPriv = calloc(1, sizeof(DamageScrPrivRec));
     if (!pScrPriv)
         return FALSE;
@@ -1825,6 +1847,7 @@ DamageDestroy(DamagePtr pDamage)
     if (pScrPriv && pScrPriv->funcs.Destroy)
         pScrPriv->funcs.Destroy (pDamage);
 
+    DamageSetAgeTracking(pDamage, 0);
     RegionUninit(&pDamage->damage);
     RegionUninit(&pDamage->pendingDamage);
     free(pDamage);
@@ -1916,6 +1939,76 @@ DamageGetScreenFuncs(ScreenPtr pScreen)
     return &pScrPriv->funcs;
 }
 
+Bool
+DamageSetAgeTracking(DamagePtr pDamage, int nframes)
+{
+    DamageAgePtr age = pDamage->age;
+
+    if (age) {
+        RegionUninit(&age->current);
+        for (int i = 0; i < age->nframes; i++)
+            RegionUninit(&age->frames[i]);
+        free(age);
+        pDamage->age = NULL;
+    }
+
+    if (nframes <= 0)
+        return TRUE;
+
+    age = calloc(1, sizeof(DamageAgeRec) + nframes * sizeof(RegionRec));
+    if (!age)
+        return FALSE;
+
+    age->nframes = nframes;
+    RegionNull(&age->current);
+    for (int i = 0; i < nframes; i++)
+        RegionNull(&age->frames[i]);
+    pDamage->age = age;
+    return TRUE;
+}
+
+CARD32
+DamageAgeEndFrame(DamagePtr pDamage)
+{
+    DamageAgePtr age = pDamage->age;
+    RegionPtr frame;
+
+    if (!age)
+        return 0;
+
+    if (++age->sequence == 0)
+        age->sequence = 1;
+
+    /* the oldest frame makes room for the one just ended */
+    frame = &age->frames[age->sequence % age->nframes];
+    RegionUninit(frame);
+    *frame = age->current;
+    RegionNull(&age->current);
+
+    return age->sequence;
+}
+
+Bool
+DamageAgeRegion(DamagePtr pDamage, CARD32 sequence, RegionPtr pRegion)
+{
+    DamageAgePtr age = pDamage->age;
+    CARD32 frames;
+
+    if (!age || !sequence)
+        return FALSE;
+
+    /* frames sequence + 1 ... age->sequence, wrapping around */
+    frames = age->sequence - sequence;
+    if (frames > (CARD32) age->nframes)
+        return FALSE;
+
+    RegionCopy(pRegion, &age->current);
+    for (CARD32 n = 1; n <= frames; n++)
+        RegionUnion(pRegion, pRegion,
+                    &age->frames[(sequence + n) % age->nframes]);
+    return TRUE;
+}
+
 void
 DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
 {
@@ -1923,6 +2016,8 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
     RegionRec tmpRegion;
     Bool was_empty;
 
+    damageAgeAppend(pDamage, pDamageRegion);
+
     switch (pDamage->damageLevel) {
     case DamageReportRawRegion:
         RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
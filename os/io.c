@@ -384,6 +384,7 @@ ReadRequestFromClient(ClientPtr client)
         }
         oci->bufcnt += result;
         gotnow += result;
+        client->stats.bytesRead += result;
         /* free up some space after huge requests */
         if ((oci->size > BUFWATERMARK) &&
             (oci->bufcnt < BUFSIZE) && (needed < BUFSIZE)) {
@@ -801,6 +802,7 @@ dixWriteToClient(ClientPtr who, int count, const void *__buf)
     if (!count || !who || who == serverClient || who->clientGone)
         return 0;
     oc = who->osPrivate;
+    who->stats.bytesQueued += count;
 #ifdef DEBUG_COMMUNICATION
     {
         char info[128];
@@ -976,6 +978,9 @@ FlushClient(ClientPtr who, OsCommPtr oc)
     if (FlushCallback)
         CallCallbacks(&FlushCallback, who);
 
+    if (notWritten > who->stats.outputHighWater)
+        who->stats.outputHighWater = notWritten;
+
     size_t todo = notWritten; /* trying to write that much this time */
     while (notWritten) {
         errno = 0;
@@ -984,12 +989,15 @@ FlushClient(ClientPtr who, OsCommPtr oc)
             written += len;
             notWritten -= len;
             todo = notWritten;
+            who->stats.bytesWritten += len;
         }
         else if (ossock_wouldblock(errno)) {
             /* If we've arrived here, then the client is stuffed to the gills
                and not ready to accept more.  Make a note of it and buffer
                the rest. */
             output_pending_mark(who);
+            if (!who->stats.blockedSince)
+                who->stats.blockedSince = GetTimeInMicros();
 
             if (written > 0) {
                 oco->count -= written;
@@ -1018,6 +1026,10 @@ FlushClient(ClientPtr who, OsCommPtr oc)
     /* everything was flushed out */
     oco->count = 0;
     output_pending_clear(who);
+    if (who->stats.blockedSince) {
+        who->stats.blockedTime += GetTimeInMicros() - who->stats.blockedSince;
+        who->stats.blockedSince = 0;
+    }
 
     if (oco->size > BUFWATERMARK) {
         free(oco->buf);
@@ -86,6 +86,11 @@ OR PERFORMANCE OF THIS SOFTWARE.
 #include <string.h>             /* for strerror*() */
 #include <sys/stat.h>
 #include <time.h>
+#if INPUTTHREAD
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#endif
 #include <X11/Xfuncproto.h>
 #include <X11/Xos.h>
 
@@ -113,8 +118,11 @@ OR PERFORMANCE OF THIS SOFTWARE.
 #define DEFAULT_LOG_FILE_VERBOSITY	3
 #define DEFAULT_SYSLOG_VERBOSITY	0
 
+#define LOG_MSG_BUF_SIZE 1024
+
 static int logFileFd = -1;
 Bool xorgLogSync = FALSE;
+Bool xorgLogAsync = FALSE;
 int xorgLogVerbosity = DEFAULT_LOG_VERBOSITY;
 int xorgLogFileVerbosity = DEFAULT_LOG_FILE_VERBOSITY;
 #ifdef CONFIG_SYSLOG
@@ -127,6 +135,10 @@ static char *saveBuffer = NULL;
 static int bufferSize = 0, bufferUnused = 0, bufferPos = 0;
 static Bool needBuffer = TRUE;
 
+#if INPUTTHREAD
+static void LogAsyncStop(void);
+#endif
+
 #ifdef __APPLE__
 static char __crashreporter_info_buff__[4096] = { 0 };
 
@@ -390,6 +402,9 @@ LogClose(enum ExitCode error)
 {
     if (logFileFd != -1) {
         int msgtype = (error == EXIT_NO_ERROR) ? X_INFO : X_ERROR;
+#if INPUTTHREAD
+        LogAsyncStop();
+#endif
         LogMessageVerb(msgtype, -1,
                 "Server terminated %s (%d). Closing log file.\n",
                 (error == EXIT_NO_ERROR) ? "successfully" : "with error",
@@ -640,6 +655,342 @@ LogSyslogWrite(int verb, const char *buf, size_t len, Bool end_line) {
 #endif
 }
 
+#if INPUTTHREAD
+/*
+ * Asynchronous logging: with -logasync or Option "Log" "async", lines for
+ * the log file are queued in a bounded lock-free ring (Vyukov's MPMC queue)
+ * and written out in batches by a writer thread, so that dispatch doesn't
+ * wait for the disk. Queueing takes no locks and only makes async-signal-
+ * safe calls, so it works from the input thread too. The writer thread
+ * fsyncs once per LOG_ASYNC_SYNC_MS, or after every batch with -logsync.
+ *
+ * A line that doesn't fit a slot, or finds the ring full, is written by
+ * the calling thread once it has drained the ring, so the log stays in
+ * order. Anything logged in signal context, the backtrace in particular,
+ * and FatalError() first drain the ring in the calling thread and then
+ * switch back to synchronous logging, so nothing queued is lost when the
+ * server goes down. After a signal handler, the writer thread is started
+ * again for the next line logged outside signal context.
+ */
+#define LOG_ASYNC_SLOTS         512
+#define LOG_ASYNC_SLOT_SIZE     (LOG_MSG_BUF_SIZE + 32) /* and a timestamp */
+#define LOG_ASYNC_BATCH_SIZE    65536
+#define LOG_ASYNC_SYNC_MS       1000
+
+typedef struct {
+    unsigned long seq;
+    int len;
+    char buf[LOG_ASYNC_SLOT_SIZE];
+} LogAsyncSlot;
+
+static LogAsyncSlot *logAsyncSlots;
+static unsigned long logAsyncEnqueue, logAsyncDequeue;
+static int logAsyncStarted;     /* the ring was set up, or failed to */
+static int logAsyncRunning;     /* lines go through the ring */
+static int logAsyncSignalled;   /* a signal handler stopped the ring */
+static int logAsyncConsumer;    /* somebody is writing out the ring */
+static int logAsyncSleeping;    /* the writer waits for logAsyncPipe */
+static int logAsyncPipe[2] = { -1, -1 };
+static pthread_t logAsyncThread;
+static Bool logAsyncJoinable;
+
+static void
+LogAsyncWake(void)
+{
+    char byte = 0;
+
+    if (__atomic_exchange_n(&logAsyncSleeping, 0, __ATOMIC_SEQ_CST))
+        (void) !write(logAsyncPipe[1], &byte, 1);
+}
+
+static Bool
+LogAsyncTryQueue(const char *stamp, size_t stampLen,
+                 const char *buf, size_t len)
+{
+    unsigned long pos = __atomic_load_n(&logAsyncEnqueue, __ATOMIC_RELAXED);
+    LogAsyncSlot *slot;
+
+    for (;;) {
+        long diff;
+
+        slot = &logAsyncSlots[pos % LOG_ASYNC_SLOTS];
+        diff = (long) (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&logAsyncEnqueue, &pos, pos + 1,
+                                            TRUE, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+                break;
+        }
+        else if (diff < 0)
+            return FALSE;       /* full */
+        else
+            pos = __atomic_load_n(&logAsyncEnqueue, __ATOMIC_RELAXED);
+    }
+
+    memcpy(slot->buf, stamp, stampLen);
+    memcpy(slot->buf + stampLen, buf, len);
+    slot->len = stampLen + len;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    LogAsyncWake();
+    return TRUE;
+}
+
+/*
+ * Write out the lines queued so far through a batch buffer of the given
+ * size, and only then free their slots. Returns the number of lines
+ * written. The caller must be the consumer.
+ */
+static int
+LogAsyncDrain(char *batch, size_t size)
+{
+    unsigned long pos = logAsyncDequeue, end = pos;
+    size_t len = 0;
+    Bool ready;
+
+    do {
+        LogAsyncSlot *slot = &logAsyncSlots[end % LOG_ASYNC_SLOTS];
+
+        ready = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) == end + 1;
+        if (ready && len + slot->len <= size) {
+            memcpy(batch + len, slot->buf, slot->len);
+            len += slot->len;
+            end++;
+            continue;
+        }
+
+        if (len) {
+            LogWrite(logFileFd, batch, len);
+            len = 0;
+        }
+        for (; logAsyncDequeue != end; logAsyncDequeue++)
+            __atomic_store_n(&logAsyncSlots[logAsyncDequeue %
+                                            LOG_ASYNC_SLOTS].seq,
+                             logAsyncDequeue + LOG_ASYNC_SLOTS,
+                             __ATOMIC_RELEASE);
+    } while (ready);
+
+    return end - pos;
+}
+
+static Bool
+LogAsyncEmpty(void)
+{
+    return __atomic_load_n(&logAsyncSlots[logAsyncDequeue %
+                                          LOG_ASYNC_SLOTS].seq,
+                           __ATOMIC_ACQUIRE) != logAsyncDequeue + 1;
+}
+
+/*
+ * Write a line that can't be queued behind the ones already queued: become
+ * the consumer, waiting for the writer thread to finish its batch, write
+ * out the ring and then the line. Returns FALSE if async logging was
+ * stopped meanwhile, which drains the ring too.
+ */
+static Bool
+LogAsyncWriteThrough(const char *stamp, size_t stampLen,
+                     const char *buf, size_t len)
+{
+    static char batch[LOG_ASYNC_SLOT_SIZE];
+    struct timespec wait = { 0, 1000000 };
+
+    while (__atomic_exchange_n(&logAsyncConsumer, 1, __ATOMIC_ACQUIRE)) {
+        if (!__atomic_load_n(&logAsyncRunning, __ATOMIC_ACQUIRE))
+            return FALSE;
+        nanosleep(&wait, NULL);
+    }
+
+    LogAsyncDrain(batch, sizeof(batch));
+    if (stampLen)
+        LogWrite(logFileFd, stamp, stampLen);
+    LogWrite(logFileFd, buf, len);
+    if (xorgLogSync)
+        doLogSync();
+    __atomic_store_n(&logAsyncConsumer, 0, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+/*
+ * Queue a line, or write it out in order if it is too long for a slot or
+ * the ring is full. Returns FALSE if async logging isn't running.
+ */
+static Bool
+LogAsyncQueue(const char *stamp, size_t stampLen, const char *buf, size_t len)
+{
+    if (!__atomic_load_n(&logAsyncRunning, __ATOMIC_ACQUIRE))
+        return FALSE;
+    if (stampLen + len <= LOG_ASYNC_SLOT_SIZE &&
+        LogAsyncTryQueue(stamp, stampLen, buf, len))
+        return TRUE;
+    return LogAsyncWriteThrough(stamp, stampLen, buf, len);
+}
+
+static void *
+LogAsyncWriter(void *arg)
+{
+    static char batch[LOG_ASYNC_BATCH_SIZE];
+    struct pollfd pfd = { .fd = logAsyncPipe[0], .events = POLLIN };
+    CARD32 lastSync = GetTimeInMillis();
+    Bool dirty = FALSE;
+    sigset_t set;
+
+    /* Don't handle any signals on this thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+#if defined(HAVE_PTHREAD_SETNAME_NP_WITH_TID)
+    pthread_setname_np (pthread_self(), "LogWriter");
+#elif defined(HAVE_PTHREAD_SETNAME_NP_WITHOUT_TID)
+    pthread_setname_np ("LogWriter");
+#endif
+
+    while (__atomic_load_n(&logAsyncRunning, __ATOMIC_ACQUIRE)) {
+        int written = 0;
+        char drain[64];
+
+        /* the consumer is only ever taken away from us by LogAsyncStop() */
+        if (!__atomic_exchange_n(&logAsyncConsumer, 1, __ATOMIC_ACQUIRE)) {
+            written = LogAsyncDrain(batch, sizeof(batch));
+            __atomic_store_n(&logAsyncConsumer, 0, __ATOMIC_RELEASE);
+        }
+
+        dirty = dirty || written;
+        if (dirty && (xorgLogSync ||
+                      GetTimeInMillis() - lastSync >= LOG_ASYNC_SYNC_MS)) {
+            doLogSync();
+            lastSync = GetTimeInMillis();
+            dirty = FALSE;
+        }
+        if (written)
+            continue;
+
+        /* announce we're going to sleep, then check once more */
+        __atomic_store_n(&logAsyncSleeping, 1, __ATOMIC_SEQ_CST);
+        if (LogAsyncEmpty() &&
+            __atomic_load_n(&logAsyncRunning, __ATOMIC_ACQUIRE))
+            poll(&pfd, 1, dirty ? LOG_ASYNC_SYNC_MS : -1);
+        __atomic_store_n(&logAsyncSleeping, 0, __ATOMIC_SEQ_CST);
+        while (read(logAsyncPipe[0], drain, sizeof(drain)) > 0)
+            ;
+    }
+
+    return NULL;
+}
+
+/*
+ * Start the writer thread again after a signal handler stopped it. The
+ * stopped thread has let go of the ring, which the handler drained.
+ */
+static Bool
+LogAsyncRestart(void)
+{
+    if (logAsyncJoinable) {
+        pthread_join(logAsyncThread, NULL);
+        logAsyncJoinable = FALSE;
+    }
+
+    __atomic_store_n(&logAsyncConsumer, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&logAsyncRunning, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&logAsyncThread, NULL, LogAsyncWriter, NULL) != 0) {
+        __atomic_store_n(&logAsyncRunning, 0, __ATOMIC_RELEASE);
+        return FALSE;
+    }
+    logAsyncJoinable = TRUE;
+    return TRUE;
+}
+
+/*
+ * Set the ring and writer thread up the first time they are needed, or
+ * again after a signal handler stopped them.
+ */
+static Bool
+LogAsyncStart(void)
+{
+    int i;
+
+    if (__atomic_load_n(&logAsyncRunning, __ATOMIC_ACQUIRE))
+        return TRUE;
+    if (__atomic_exchange_n(&logAsyncSignalled, 0, __ATOMIC_ACQ_REL))
+        return LogAsyncRestart();
+    if (__atomic_exchange_n(&logAsyncStarted, 1, __ATOMIC_ACQ_REL))
+        return FALSE;
+
+    logAsyncSlots = calloc(LOG_ASYNC_SLOTS, sizeof(LogAsyncSlot));
+    if (!logAsyncSlots)
+        return FALSE;
+    for (i = 0; i < LOG_ASYNC_SLOTS; i++)
+        logAsyncSlots[i].seq = i;
+
+    if (pipe(logAsyncPipe) < 0)
+        goto fail;
+    for (i = 0; i < 2; i++) {
+        fcntl(logAsyncPipe[i], F_SETFL,
+              fcntl(logAsyncPipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(logAsyncPipe[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    __atomic_store_n(&logAsyncRunning, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&logAsyncThread, NULL, LogAsyncWriter, NULL) != 0) {
+        __atomic_store_n(&logAsyncRunning, 0, __ATOMIC_RELEASE);
+        close(logAsyncPipe[0]);
+        close(logAsyncPipe[1]);
+        goto fail;
+    }
+    logAsyncJoinable = TRUE;
+    return TRUE;
+
+fail:
+    free(logAsyncSlots);
+    logAsyncSlots = NULL;
+    return FALSE;
+}
+
+/*
+ * Switch back to synchronous logging, writing out whatever is queued
+ * first. In signal context the writer thread can't be waited for, so if it
+ * doesn't let go of the ring within a moment, the ring is drained anyway,
+ * at the risk of writing lines it was busy with twice. A stop in signal
+ * context only lasts until LogAsyncStart() is next called outside of it.
+ */
+static void
+LogAsyncStop(void)
+{
+    static char batch[LOG_ASYNC_SLOT_SIZE];
+    struct timespec wait = { 0, 1000000 };
+    Bool running = __atomic_exchange_n(&logAsyncRunning, 0, __ATOMIC_ACQ_REL);
+    int tries;
+
+    if (!inSignalContext)
+        __atomic_store_n(&logAsyncSignalled, 0, __ATOMIC_RELEASE);
+
+    /* after a stop in signal context, this is left for LogAsyncRestart() */
+    if (!inSignalContext && logAsyncJoinable) {
+        char byte = 0;
+
+        (void) !write(logAsyncPipe[1], &byte, 1);
+        pthread_join(logAsyncThread, NULL);
+        logAsyncJoinable = FALSE;
+    }
+
+    if (!running)
+        return;
+
+    for (tries = 0; tries < 100; tries++) {
+        if (!__atomic_exchange_n(&logAsyncConsumer, 1, __ATOMIC_ACQUIRE))
+            break;
+        nanosleep(&wait, NULL);
+    }
+    LogAsyncDrain(batch, sizeof(batch));
+    doLogSync();
+
+    if (inSignalContext) {
+        /* let the writer thread see it is stopped, for LogAsyncRestart() */
+        LogAsyncWake();
+        __atomic_store_n(&logAsyncSignalled, 1, __ATOMIC_RELEASE);
+    }
+}
+#endif /* INPUTTHREAD */
+
 /* This function does the actual log message writes. It must be signal safe.
  * When attempting to call non-signal-safe functions, guard them with a check
  * of the inSignalContext global variable. */
@@ -656,17 +1007,21 @@ LogSWrite(int verb, const char *buf, size_t len, Bool end_line)
 
     if (verb < 0 || xorgLogFileVerbosity >= verb) {
         if (inSignalContext && logFileFd >= 0) {
+#if INPUTTHREAD
+            LogAsyncStop();
+#endif
             LogWrite(logFileFd, buf, len);
             if (xorgLogSync){
                 doLogSync();
             }
         }
         else if (!inSignalContext && logFileFd != -1) {
+            char fmt_tm[32];
+            size_t fmt_len = 0;
+
             if (newline) {
                 time_t t = time(NULL);
                 struct tm tm;
-                char fmt_tm[32];
-                size_t fmt_len;
 
                 localtime_r(&t, &tm);
                 fmt_len = strftime(
@@ -674,9 +1029,15 @@ LogSWrite(int verb, const char *buf, size_t len, Bool end_line)
                                 sizeof(fmt_tm),
                                 "[%Y-%m-%d %H:%M:%S] ",
                                 &tm);
-                LogWrite(logFileFd, fmt_tm, fmt_len);
             }
             newline = end_line;
+#if INPUTTHREAD
+            if (xorgLogAsync && LogAsyncStart() &&
+                LogAsyncQueue(fmt_tm, fmt_len, buf, len))
+                return;
+#endif
+            if (fmt_len)
+                LogWrite(logFileFd, fmt_tm, fmt_len);
             LogWrite(logFileFd, buf, len);
             if (xorgLogSync) {
                 doLogSync();
@@ -739,8 +1100,6 @@ LogMessageTypeVerbString(MessageType type, int verb)
     }
 }
 
-#define LOG_MSG_BUF_SIZE 1024
-
 static ssize_t prepMsgHdr(MessageType type, int verb, char *buf)
 {
     const char *type_str = LogMessageTypeVerbString(type, verb);
@@ -947,6 +1306,11 @@ FatalError(const char *f, ...)
     va_list args2;
     static Bool beenhere = FALSE;
 
+#if INPUTTHREAD
+    /* whatever led up to this must make it into the log */
+    LogAsyncStop();
+#endif
+
     if (beenhere)
         ErrorF("\nFatalError re-entered, aborting\n");
     else
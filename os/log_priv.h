@@ -72,6 +72,14 @@ extern int xorgLogFileVerbosity;
  */
 extern Bool xorgLogSync;
 
+/**
+ * @brief write the log file from a separate thread
+ *
+ * If set to TRUE, log file writes are queued and done by a writer thread,
+ * so that logging doesn't wait for the disk.
+ */
+extern Bool xorgLogAsync;
+
 /**
  * @brief syslog verbosity
  *
@@ -106,6 +106,7 @@ __stdcall unsigned long GetTickCount(void);
 #include "dix/dix_priv.h"
 #include "dix/input_priv.h"
 #include "dix/settings_priv.h"
+#include "dix/trace_priv.h"
 #include "dix/screensaver_priv.h"
 #include "include/misc.h"
 #include "miext/extinit_priv.h"
@@ -297,6 +298,7 @@ UseMsg(void)
 #endif /* CONFIG_NAMESPACE */
     LockServerUseMsg();
     ErrorF("-maxclients n          set maximum number of clients (power of two)\n");
+    ErrorF("-nolayoutprivates      keep privates in registration order\n");
     ErrorF("-nolisten string       don't listen on protocol\n");
     ErrorF("-listen string         listen on protocol\n");
     ErrorF("-background [none]     create root window with no background\n");
@@ -309,13 +311,18 @@ UseMsg(void)
     ErrorF("-retro                 start with classic stipple and cursor\n");
     ErrorF("-s #                   screen-saver timeout (minutes)\n");
     ErrorF("-seat string           seat to run on\n");
+    ErrorF("-shmstrips             put large MIT-SHM images in strips\n");
     ErrorF("-t #                   default pointer threshold (pixels/t)\n");
     ErrorF("-terminate [delay]     terminate at server reset (optional delay in sec)\n");
     ErrorF("-tst                   disable testing extensions\n");
     ErrorF("ttyxx                  server started from init on /dev/ttyxx\n");
     ErrorF("v                      video blanking for screen-saver\n");
     ErrorF("-v                     screen-saver without video blanking\n");
+    ErrorF("-trace file            record a trace of all requests to file\n");
     ErrorF("-verbose [n]           verbose startup messages\n");
+#if INPUTTHREAD
+    ErrorF("-logasync              write the log file from a separate thread\n");
+#endif
     ErrorF("-wr                    create root window with white background\n");
     ErrorF("-maxbigreqsize         set maximal bigrequest size \n");
 #ifdef XINERAMA
@@ -324,6 +331,7 @@ UseMsg(void)
 #endif /* XINERAMA */
     ErrorF("-dumbSched             Disable smart scheduling and threaded input, enable old behavior\n");
     ErrorF("-schedInterval int     Set scheduler interval in msec\n");
+    ErrorF("-schedPolicy fair|smart Select the client scheduling policy\n");
     ErrorF("+extension name        Enable extension\n");
     ErrorF("-extension name        Disable extension\n");
     ListStaticExtensions();
@@ -586,6 +594,8 @@ ProcessCommandLine(int argc, char *argv[])
             } else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-nolayoutprivates") == 0)
+            dixSettingLayoutPrivates = FALSE;
         else if (strcmp(argv[i], "-nolisten") == 0) {
             if (++i < argc) {
                 if (_XSERVTransNoListen(argv[i]))
@@ -643,6 +653,8 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-shmstrips") == 0)
+            dixSettingShmPutImageStrips = TRUE;
         else if (strcmp(argv[i], "-t") == 0) {
             if (++i < argc)
                 defaultPointerControl.threshold = atoi(argv[i]);
@@ -663,6 +675,15 @@ ProcessCommandLine(int argc, char *argv[])
             defaultScreenSaverBlanking = PreferBlanking;
         else if (strcmp(argv[i], "-v") == 0)
             defaultScreenSaverBlanking = DontPreferBlanking;
+        else if (strcmp(argv[i], "-trace") == 0) {
+            if (++i >= argc)
+                UseMsg();
+            else if (PrivsElevated())
+                FatalError("\nInvalid argument -trace "
+                           "with elevated privileges\n");
+            else
+                traceFile = argv[i];
+        }
         else if (strcmp(argv[i], "-verbose") == 0) {
             int n = i + 1; /* next argument */
             verbosity++;
@@ -678,6 +699,10 @@ ProcessCommandLine(int argc, char *argv[])
             }
             xorgLogVerbosity = verbosity;
         }
+#if INPUTTHREAD
+        else if (strcmp(argv[i], "-logasync") == 0)
+            xorgLogAsync = TRUE;
+#endif
         else if (strcmp(argv[i], "-wr") == 0)
             whiteRoot = TRUE;
         else if (strcmp(argv[i], "-background") == 0) {
@@ -751,6 +776,10 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-schedPolicy") == 0) {
+            if (++i >= argc || !DispatchSetScheduler(argv[i]))
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-schedMax") == 0) {
             if (++i < argc) {
                 SmartScheduleMaxSlice = atoi(argv[i]);
@@ -1496,6 +1525,7 @@ os_move_fd(int fd)
 void
 AbortServer(void)
 {
+    TraceStop();
     CloseWellKnownConnections();
     UnlockServer();
     AbortDevices();
@@ -0,0 +1,170 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Interactively resizes a redirected window, the way a window manager
+ * would, and checks that its contents survive according to its bit
+ * gravity, that newly exposed areas get the background, and that a pixmap
+ * named through NameWindowPixmap keeps its size. Prints the achieved
+ * resize rate.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/composite.h>
+
+#include "xcb-test.h"
+
+#define RED 0xff0000
+#define BACKGROUND 0x0000ff
+
+static void
+resize(xcb_connection_t *c, xcb_window_t win, int w, int h)
+{
+    uint32_t size[] = { w, h };
+
+    xcb_configure_window(c, win,
+                         XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+                         size);
+}
+
+/* Checks that the given area of the window has the given color. */
+static bool
+check_area(xcb_connection_t *c, xcb_drawable_t drawable,
+           int x, int y, int w, int h, uint32_t color)
+{
+    xcb_get_image_reply_t *reply =
+        xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                             drawable, x, y, w, h, ~0),
+                            NULL);
+    const uint32_t *pixels;
+    bool ok = true;
+
+    assert(reply);
+    pixels = (const uint32_t *) xcb_get_image_data(reply);
+    for (int i = 0; i < w * h && ok; i++)
+        ok = (pixels[i] & 0xffffff) == color;
+    if (!ok)
+        printf("%dx%d+%d+%d is not 0x%06x\n", w, h, x, y, color);
+
+    free(reply);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext =
+        xcb_get_extension_data(c, &xcb_composite_id);
+    xcb_composite_query_version_reply_t *version;
+    xcb_get_geometry_reply_t *geometry;
+    xcb_screen_t *screen;
+    xcb_window_t win;
+    xcb_pixmap_t named;
+    xcb_gcontext_t gc;
+    xcb_rectangle_t rect = { 0, 0, 64, 64 };
+    double start, elapsed;
+    bool pass = true;
+    int resizes = 0;
+
+    if (!ext->present) {
+        printf("No Composite present\n");
+        exit(77);
+    }
+
+    version = xcb_composite_query_version_reply(c,
+        xcb_composite_query_version(c, 0, 2), NULL);
+    assert(version && version->minor_version >= 2);
+    free(version);
+
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    if (screen->root_depth != 24 || screen->width_in_pixels < 1000 ||
+        screen->height_in_pixels < 700) {
+        printf("Need a 24 bit screen of at least 1000x700\n");
+        exit(77);
+    }
+
+    {
+        uint32_t values[] = { BACKGROUND, XCB_GRAVITY_NORTH_WEST };
+
+        win = xcb_generate_id(c);
+        xcb_create_window(c, 24, win, screen->root, 10, 10, 64, 64, 0,
+                          XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                          screen->root_visual,
+                          XCB_CW_BACK_PIXEL | XCB_CW_BIT_GRAVITY, values);
+    }
+    xcb_composite_redirect_window(c, win, XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+    xcb_map_window(c, win);
+
+    {
+        uint32_t values[] = { RED };
+
+        gc = xcb_generate_id(c);
+        xcb_create_gc(c, gc, win, XCB_GC_FOREGROUND, values);
+    }
+    xcb_poly_fill_rectangle(c, win, gc, 1, &rect);
+
+    /* grow in small steps, then shrink back */
+    start = now();
+    for (int size = 64; size <= 640; size += 3, resizes++)
+        resize(c, win, size + 320, size);
+    for (int size = 640; size >= 64; size -= 3, resizes++)
+        resize(c, win, size + 320, size);
+    sync_server(c);
+    elapsed = now() - start;
+
+    printf("%d resizes in %.3f s: %.0f resizes/s\n", resizes, elapsed,
+           resizes / elapsed);
+
+    pass = check_area(c, win, 0, 0, 64, 64, RED) && pass;
+
+    /* the area the window grew by gets the background */
+    resize(c, win, 300, 300);
+    pass = check_area(c, win, 0, 0, 64, 64, RED) && pass;
+    pass = check_area(c, win, 0, 100, 300, 200, BACKGROUND) && pass;
+    pass = check_area(c, win, 100, 0, 200, 300, BACKGROUND) && pass;
+
+    /* a named pixmap must not change along with the window */
+    named = xcb_generate_id(c);
+    xcb_composite_name_window_pixmap(c, win, named);
+    resize(c, win, 310, 290);
+    geometry = xcb_get_geometry_reply(c, xcb_get_geometry(c, named), NULL);
+    assert(geometry);
+    if (geometry->width != 300 || geometry->height != 300) {
+        printf("named pixmap changed size to %dx%d\n",
+               geometry->width, geometry->height);
+        pass = false;
+    }
+    free(geometry);
+    pass = check_area(c, named, 0, 0, 64, 64, RED) && pass;
+    pass = check_area(c, win, 0, 0, 64, 64, RED) && pass;
+    xcb_free_pixmap(c, named);
+
+    xcb_disconnect(c);
+
+    exit(pass ? 0 : 1);
+}
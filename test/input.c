@@ -27,6 +27,7 @@
 #include <dix-config.h>
 
 #include <assert.h>
+#include <math.h>
 #include <stdint.h>
 #include <X11/X.h>
 #include <X11/Xproto.h>
@@ -162,6 +163,141 @@ dix_init_valuators(void)
     free(dev.last.scroll); /* sigh, allocated but not freed by the valuator functions */
 }
 
+/* append to a SD motion history the way updateMotionHistory() does */
+static void
+motion_history_append(DeviceIntPtr dev, CARD32 time, INT32 x, INT32 y)
+{
+    ValuatorClassPtr v = dev->valuator;
+    char *buff = (char *) v->motion +
+        (sizeof(Time) + 2 * sizeof(INT32)) * v->last_motion;
+
+    memcpy(buff, &time, sizeof(Time));
+    memcpy(buff + sizeof(Time), &x, sizeof(INT32));
+    memcpy(buff + sizeof(Time) + sizeof(INT32), &y, sizeof(INT32));
+
+    v->last_motion = (v->last_motion + 1) % v->numMotionEvents;
+    if (v->first_motion == v->last_motion)
+        v->first_motion = (v->first_motion + 1) % v->numMotionEvents;
+}
+
+static void
+dix_motion_history(void)
+{
+    DeviceIntRec dev;
+    ValuatorClassPtr val;
+    Atom atoms[MAX_VALUATORS] = { 0 };
+    const CARD32 times[] = { 10, 20, 30, 30, 40, 50 };
+    INT32 *buff = NULL;
+    CARD32 time;
+    int n;
+
+    memset(&dev, 0, sizeof(DeviceIntRec));
+    dev.type = MASTER_POINTER;  /* claim it's a master to stop ptracccel */
+    assert(InitValuatorClassDeviceStruct(&dev, 2, atoms, 0, Absolute));
+    dev.type = SLAVE;
+
+    val = dev.valuator;
+    assert(val->numMotionEvents == 0);
+    assert(val->motion == NULL);
+
+    /* 5 slots keep the last 4 events */
+    assert(SetMotionHistorySize(&dev, 5));
+    assert(val->numMotionEvents == 5);
+    assert(val->motion);
+
+    for (int i = 0; i < ARRAY_SIZE(times); i++)
+        motion_history_append(&dev, times[i], times[i], -times[i]);
+
+    /* everything, wrapping around the end of the ring */
+    n = GetMotionHistory(&dev, (xTimecoord **) &buff, 0, 100, NULL, FALSE);
+    assert(n == 4);
+    for (int i = 0; i < n; i++) {
+        memcpy(&time, &buff[i * 3], sizeof(CARD32));
+        assert(time == times[i + 2]);
+        assert(buff[i * 3 + 1] == times[i + 2]);
+        assert(buff[i * 3 + 2] == -times[i + 2]);
+    }
+    free(buff);
+    buff = NULL;
+
+    /* both bounds are inclusive */
+    n = GetMotionHistory(&dev, (xTimecoord **) &buff, 30, 30, NULL, FALSE);
+    assert(n == 2);
+    free(buff);
+    buff = NULL;
+
+    n = GetMotionHistory(&dev, (xTimecoord **) &buff, 31, 45, NULL, FALSE);
+    assert(n == 1);
+    memcpy(&time, &buff[0], sizeof(CARD32));
+    assert(time == 40);
+    free(buff);
+    buff = NULL;
+
+    /* nothing before the oldest or after the newest event */
+    assert(GetMotionHistory(&dev, (xTimecoord **) &buff, 0, 29, NULL, FALSE) == 0);
+    assert(GetMotionHistory(&dev, (xTimecoord **) &buff, 51, 100, NULL, FALSE) == 0);
+    assert(buff == NULL);
+
+    /* a size of 0 disables the history */
+    assert(SetMotionHistorySize(&dev, 0));
+    assert(val->motion == NULL);
+    assert(GetMotionHistory(&dev, (xTimecoord **) &buff, 0, 100, NULL, FALSE) == 0);
+    assert(!SetMotionHistorySize(&dev, -1));
+
+    FreeDeviceClass(ValuatorClass, (void**)&val);
+    free(dev.last.scroll);
+}
+
+/* the compiler may contract transform_point into FMA where pixman
+ * doesn't (or the other way round), so the last bits can differ */
+static Bool
+transform_close(double a, double b)
+{
+    return fabs(a - b) <= 1e-9 * max(1.0, fabs(b));
+}
+
+static void
+dix_transform_point(void)
+{
+    const double points[][2] = {
+        { 0, 0 }, { 1, 1 }, { -3.5, 7.25 }, { 1920, 1080 }, { 65535, 0.1 },
+        { -0.0, 12345.678 },
+    };
+    struct pixman_f_transform m[5];
+
+    /* identity, scale + translate, rotation, translation-free rotation
+     * (as used for relative motion) and a projective transformation */
+    pixman_f_transform_init_identity(&m[0]);
+    pixman_f_transform_init_scale(&m[1], 0.5, 1.0 / 3);
+    m[1].m[0][2] = 0.5;
+    m[1].m[1][2] = -17;
+    pixman_f_transform_init_rotate(&m[2], cos(0.3), sin(0.3));
+    m[2].m[0][2] = 100;
+    m[2].m[1][2] = 200;
+    pixman_f_transform_init_rotate(&m[3], cos(1.1), sin(1.1));
+    pixman_f_transform_init_identity(&m[4]);
+    m[4].m[2][0] = 0.001;
+    m[4].m[2][1] = 0.002;
+
+    assert(transform_is_identity(&m[0]));
+    for (int i = 1; i < ARRAY_SIZE(m); i++)
+        assert(!transform_is_identity(&m[i]));
+
+    /* the results must match pixman's */
+    for (int i = 0; i < ARRAY_SIZE(m); i++) {
+        for (int j = 0; j < ARRAY_SIZE(points); j++) {
+            struct pixman_f_vector p = {.v = {points[j][0], points[j][1], 1} };
+            double px = points[j][0], py = points[j][1];
+
+            transform_point(&m[i], &px, &py);
+
+            assert(pixman_f_transform_point(&m[i], &p));
+            assert(transform_close(px, p.v[0]));
+            assert(transform_close(py, p.v[1]));
+        }
+    }
+}
+
 /* just check the known success cases, and that error cases set the client's
  * error value correctly. */
 static void
@@ -1938,6 +2074,8 @@ input_test(void)
         dix_input_valuator_masks_unaccel,
         dix_input_attributes,
         dix_init_valuators,
+        dix_motion_history,
+        dix_transform_point,
         dix_event_to_core_conversion,
         dix_event_to_xi1_conversion,
         dix_check_grab_values,
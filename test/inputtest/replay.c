@@ -0,0 +1,282 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Runs inputtest-replay against a FIFO standing in for the evdev device and
+ * a socket standing in for the inputtest driver. Checks that SIGINT stops a
+ * recording blocked in read(), that the recording holds one inputtest event
+ * per change with the evdev timestamps, and that replay sends exactly those
+ * events and the sync and stats requests around them.
+ *
+ * Usage: inputtest-replay-test <path to inputtest-replay>
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <linux/input.h>
+
+#include "xf86-input-inputtest-protocol.h"
+
+#define MAGIC "XF86ITR1"
+
+static pid_t
+run(const char *tool, const char *mode, const char *arg1, const char *arg2)
+{
+    pid_t pid = fork();
+
+    assert(pid >= 0);
+    if (pid == 0) {
+        if (strcmp(mode, "replay") == 0)
+            execl(tool, tool, mode, "--speed", "0", arg1, arg2, NULL);
+        else
+            execl(tool, tool, mode, arg1, arg2, NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+static int
+wait_exit(pid_t pid, int sig)
+{
+    int status;
+
+    /* keep signalling, the first one may arrive before read() blocks */
+    for (int i = 0; i < 50; i++) {
+        if (sig)
+            kill(pid, sig);
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            assert(WIFEXITED(status));
+            return WEXITSTATUS(status);
+        }
+        usleep(100000);
+    }
+
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    assert(!"child did not exit");
+    return -1;
+}
+
+static void
+write_evdev(int fd, int usec, int type, int code, int value)
+{
+    struct input_event ev = {
+        .type = type,
+        .code = code,
+        .value = value,
+    };
+
+    ev.input_event_sec = 1;
+    ev.input_event_usec = usec;
+    assert(write(fd, &ev, sizeof(ev)) == sizeof(ev));
+}
+
+static void
+check_recording(const char *path)
+{
+    FILE *in = fopen(path, "rb");
+    char magic[sizeof(MAGIC) - 1];
+    xf86ITEventAny event;
+    uint64_t time;
+
+    assert(in);
+    assert(fread(magic, sizeof(magic), 1, in) == 1);
+    assert(memcmp(magic, MAGIC, sizeof(magic)) == 0);
+
+    assert(fread(&time, sizeof(time), 1, in) == 1);
+    assert(time == 0);
+    assert(fread(&event.motion, sizeof(event.motion), 1, in) == 1);
+    assert(event.header.type == XF86IT_EVENT_MOTION);
+    assert(!event.motion.is_absolute);
+    assert(event.motion.valuators.mask[0] == 0x3);
+    assert(event.motion.valuators.valuators[0] == 5);
+    assert(event.motion.valuators.valuators[1] == -3);
+
+    assert(fread(&time, sizeof(time), 1, in) == 1);
+    assert(time == 10000);
+    assert(fread(&event.button, sizeof(event.button), 1, in) == 1);
+    assert(event.header.type == XF86IT_EVENT_BUTTON);
+    assert(event.button.button == 1 && event.button.is_press);
+
+    /* the autorepeat is dropped */
+    assert(fread(&time, sizeof(time), 1, in) == 1);
+    assert(time == 20000);
+    assert(fread(&event.key, sizeof(event.key), 1, in) == 1);
+    assert(event.header.type == XF86IT_EVENT_KEY);
+    assert(event.key.key_code == KEY_A + 8 && event.key.is_press);
+
+    assert(fread(&time, sizeof(time), 1, in) == 0 && feof(in));
+    fclose(in);
+}
+
+static void
+test_record(const char *tool, const char *fifo, const char *recording)
+{
+    pid_t pid;
+    int fd, pending;
+
+    assert(mkfifo(fifo, 0600) == 0);
+    pid = run(tool, "record", fifo, recording);
+
+    fd = open(fifo, O_WRONLY);
+    assert(fd >= 0);
+
+    write_evdev(fd, 0, EV_REL, REL_X, 5);
+    write_evdev(fd, 0, EV_REL, REL_Y, -3);
+    write_evdev(fd, 0, EV_SYN, SYN_REPORT, 0);
+    write_evdev(fd, 10000, EV_KEY, BTN_LEFT, 1);
+    write_evdev(fd, 10000, EV_SYN, SYN_REPORT, 0);
+    write_evdev(fd, 20000, EV_KEY, KEY_A, 1);
+    write_evdev(fd, 20000, EV_KEY, KEY_A, 2);
+    write_evdev(fd, 20000, EV_SYN, SYN_REPORT, 0);
+
+    /* wait for the recorder to block in read(), with the FIFO still open
+     * so it does not see EOF */
+    do {
+        usleep(10000);
+        assert(ioctl(fd, FIONREAD, &pending) == 0);
+    } while (pending);
+
+    assert(wait_exit(pid, SIGINT) == 0);
+    close(fd);
+
+    check_recording(recording);
+}
+
+static void
+read_event(int fd, xf86ITEventAny *event, enum xf86ITEventType type)
+{
+    assert(read(fd, &event->header, sizeof(event->header)) ==
+           sizeof(event->header));
+    assert(event->header.type == type);
+    assert(event->header.length >= sizeof(event->header) &&
+           event->header.length <= sizeof(*event));
+    if (event->header.length > sizeof(event->header))
+        assert(read(fd, (char *) event + sizeof(event->header),
+                    event->header.length - sizeof(event->header)) ==
+               event->header.length - sizeof(event->header));
+}
+
+static void
+send_stats(int fd, uint32_t num_events)
+{
+    xf86ITResponseStats stats = {
+        .header.length = sizeof(stats),
+        .header.type = XF86IT_RESPONSE_STATS,
+        .num_events = num_events,
+        .num_drains = num_events ? 1 : 0,
+    };
+
+    assert(write(fd, &stats, sizeof(stats)) == sizeof(stats));
+}
+
+static void
+test_replay(const char *tool, const char *socket_path, const char *recording)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    xf86ITResponseServerVersion version = {
+        .header.length = sizeof(version),
+        .header.type = XF86IT_RESPONSE_SERVER_VERSION,
+        .major = XF86IT_PROTOCOL_VERSION_MAJOR,
+        .minor = XF86IT_PROTOCOL_VERSION_MINOR,
+    };
+    xf86ITResponseSyncFinished sync = {
+        .header.length = sizeof(sync),
+        .header.type = XF86IT_RESPONSE_SYNC_FINISHED,
+    };
+    xf86ITEventAny event;
+    pid_t pid;
+    int listener, fd;
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(listener >= 0);
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    assert(bind(listener, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    assert(listen(listener, 1) == 0);
+
+    pid = run(tool, "replay", socket_path, recording);
+
+    fd = accept(listener, NULL, NULL);
+    assert(fd >= 0);
+
+    read_event(fd, &event, XF86IT_EVENT_CLIENT_VERSION);
+    assert(event.version.major == XF86IT_PROTOCOL_VERSION_MAJOR);
+    assert(write(fd, &version, sizeof(version)) == sizeof(version));
+
+    read_event(fd, &event, XF86IT_EVENT_GET_STATS);
+    send_stats(fd, 0);
+
+    read_event(fd, &event, XF86IT_EVENT_MOTION);
+    assert(event.motion.valuators.valuators[0] == 5);
+    read_event(fd, &event, XF86IT_EVENT_BUTTON);
+    assert(event.button.button == 1);
+    read_event(fd, &event, XF86IT_EVENT_KEY);
+    assert(event.key.key_code == KEY_A + 8);
+
+    read_event(fd, &event, XF86IT_EVENT_WAIT_FOR_SYNC);
+    assert(write(fd, &sync, sizeof(sync)) == sizeof(sync));
+
+    read_event(fd, &event, XF86IT_EVENT_GET_STATS);
+    send_stats(fd, 3);
+
+    assert(wait_exit(pid, 0) == 0);
+    close(fd);
+    close(listener);
+}
+
+int
+main(int argc, char **argv)
+{
+    char dir[] = "/tmp/inputtest-replay-XXXXXX";
+    char fifo[64], recording[64], socket_path[64];
+
+    assert(argc == 2);
+    assert(mkdtemp(dir));
+    snprintf(fifo, sizeof(fifo), "%s/evdev", dir);
+    snprintf(recording, sizeof(recording), "%s/recording", dir);
+    snprintf(socket_path, sizeof(socket_path), "%s/socket", dir);
+
+    /* a hang is a failure, not a test timeout */
+    alarm(30);
+
+    test_record(argv[1], fifo, recording);
+    test_replay(argv[1], socket_path, recording);
+
+    unlink(fifo);
+    unlink(recording);
+    unlink(socket_path);
+    rmdir(dir);
+    return 0;
+}
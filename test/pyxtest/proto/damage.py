@@ -0,0 +1,108 @@
+# SPDX-License-Identifier: MIT
+#
+# DAMAGE and X-DAMAGE-AGE extension protocol request builders.
+
+import struct
+from dataclasses import dataclass
+
+# DAMAGE minor opcodes
+DamageQueryVersion = 0
+DamageCreate = 1
+DamageDestroy = 2
+DamageSubtract = 3
+DamageAdd = 4
+
+# X-DAMAGE-AGE minor opcodes
+DamageAgeQueryVersion = 0
+DamageAgeFetch = 1
+
+# Report levels
+DamageReportRawRegion = 0
+DamageReportDeltaRectangles = 1
+DamageReportBoundingBox = 2
+DamageReportNonEmpty = 3
+
+
+@dataclass
+class QueryVersionRequest:
+    """DamageQueryVersion request."""
+
+    opcode: int
+    major: int = 1
+    minor: int = 1
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH II",
+            self.opcode,
+            DamageQueryVersion,
+            3,
+            self.major,
+            self.minor,
+        )
+
+
+@dataclass
+class CreateRequest:
+    """DamageCreate request."""
+
+    opcode: int
+    damage: int
+    drawable: int
+    level: int = DamageReportNonEmpty
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH II B xxx",
+            self.opcode,
+            DamageCreate,
+            4,
+            self.damage,
+            self.drawable,
+            self.level,
+        )
+
+
+@dataclass
+class AgeQueryVersionRequest:
+    """X-DAMAGE-AGE QueryVersion request, required before Fetch."""
+
+    opcode: int
+    major: int = 1
+    minor: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH II",
+            self.opcode,
+            DamageAgeQueryVersion,
+            3,
+            self.major,
+            self.minor,
+        )
+
+
+@dataclass
+class AgeFetchRequest:
+    """X-DAMAGE-AGE Fetch request.
+
+    Ends the current frame and stores the damage since *frame* in
+    *region*. The reply carries the number of the frame just ended
+    at offset 8.
+    """
+
+    opcode: int
+    damage: int
+    region: int
+    frame: int
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH III",
+            self.opcode,
+            DamageAgeFetch,
+            4,
+            self.damage,
+            self.region,
+            self.frame,
+        )
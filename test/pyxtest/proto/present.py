@@ -1,6 +1,7 @@
 # SPDX-License-Identifier: MIT
 #
-# Present extension protocol request builders for byteswap testing.
+# Present and X-PRESENT-STATS extension protocol request builders for
+# byteswap testing.
 
 import struct
 from dataclasses import dataclass
@@ -12,6 +13,22 @@ PresentNotifyMSC = 2
 PresentSelectInput = 3
 PresentQueryCapabilities = 4
 
+# X-PRESENT-STATS minor opcodes
+PresentStatsQueryVersion = 0
+PresentStatsQueryFrameStats = 1
+
+# PresentPixmap options
+PresentOptionAsync = 1 << 0
+PresentOptionCopy = 1 << 1
+PresentOptionUST = 1 << 2
+
+# PresentQueryCapabilities bits
+PresentCapabilityUST = 1 << 2
+
+# Present event types and PresentSelectInput masks
+PresentCompleteNotify = 1
+PresentCompleteNotifyMask = 1 << 1
+
 
 @dataclass
 class QueryVersionRequest:
@@ -176,3 +193,43 @@ class NotifyMSCRequest:
             self.divisor,
             self.remainder,
         )
+
+
+@dataclass
+class StatsQueryVersionRequest:
+    """X-PRESENT-STATS QueryVersion request, required before QueryFrameStats."""
+
+    opcode: int
+    major: int = 1
+    minor: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBHII",
+            self.opcode,
+            PresentStatsQueryVersion,
+            3,
+            self.major,
+            self.minor,
+        )
+
+
+@dataclass
+class StatsQueryFrameStatsRequest:
+    """X-PRESENT-STATS QueryFrameStats request.
+
+    The reply carries presented, missed, queued, maxQueued, latency and
+    maxLatency as CARD32s from offset 8.
+    """
+
+    opcode: int
+    window: int
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH I",
+            self.opcode,
+            PresentStatsQueryFrameStats,
+            2,
+            self.window,
+        )
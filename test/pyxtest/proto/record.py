@@ -1,6 +1,6 @@
 # SPDX-License-Identifier: MIT
 #
-# RECORD extension protocol request builders
+# RECORD and X-RECORD-RING extension protocol request builders
 
 import struct
 from dataclasses import dataclass, field
@@ -13,6 +13,15 @@ RecordRegisterClients = 2
 RECORD_MAJOR = 1
 RECORD_MINOR = 13
 
+# X-RECORD-RING minor opcodes
+RecordRingQueryVersion = 0
+RecordRingEnableContext = 1
+
+# Client specifiers and reply categories
+RecordAllClients = 3
+RecordFromClient = 1
+RecordStartOfData = 4
+
 
 @dataclass
 class QueryVersionRequest:
@@ -80,3 +89,48 @@ class CreateContextRequest:
             n_ranges,
         )
         return header + client_data + self.ranges_data + b"\x00" * pad_len
+
+
+@dataclass
+class RingQueryVersionRequest:
+    """X-RECORD-RING QueryVersion request, required before EnableContext."""
+
+    opcode: int
+    major: int = 1
+    minor: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBHII",
+            self.opcode,
+            RecordRingQueryVersion,
+            3,
+            self.major,
+            self.minor,
+        )
+
+
+@dataclass
+class RingEnableContextRequest:
+    """X-RECORD-RING EnableContext request.
+
+    The reply passes the ring memory and an eventfd, and carries the
+    size and offset of the ring data as CARD32s from offset 8. The ring
+    memory starts with head, tail, waiting and dropped CARD32s in host
+    byte order; the records in it are laid out like RECORD EnableContext
+    replies, in the byte order of the recording client.
+    """
+
+    opcode: int
+    context: int
+    size: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH II",
+            self.opcode,
+            RecordRingEnableContext,
+            3,
+            self.context,
+            self.size,
+        )
@@ -10,18 +10,28 @@ CreateWindow = 1
 ChangeWindowAttributes = 2
 CreatePixmap = 53
 InternAtom = 16
+GetInputFocus = 43
 ListFonts = 49
 OpenFont = 45
 CloseFont = 46
+QueryTextExtents = 48
 SetFontPath = 51
 GetFontPath = 52
 CreateGC = 55
 ChangeGC = 56
+PolyFillRectangle = 70
 PolyText8 = 74
 ImageText8 = 76
+CreateColormap = 78
+AllocColor = 84
+FreeColors = 88
+CreateCursor = 93
+CreateGlyphCursor = 94
+FreeCursor = 95
 QueryExtension = 98
 ChangeKeyboardMapping = 100
 ForceScreenSaverOpcode = 115
+NoOperation = 127
 
 
 ScreenSaverReset = 0
@@ -231,6 +241,37 @@ class CreateGCRequest:
         )
 
 
+@dataclass
+class PolyFillRectangleRequest:
+    """X11 PolyFillRectangle request.
+
+    Wire format:
+        CARD8    opcode      (70)
+        CARD8    unused
+        CARD16   length
+        CARD32   drawable
+        CARD32   gc
+        LISTofRECTANGLE rectangles
+    """
+
+    drawable: int
+    gc: int
+    rects: list[tuple[int, int, int, int]] = field(default_factory=list)
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        data = struct.pack(
+            f"{byte_order}BBH II",
+            PolyFillRectangle,
+            0,
+            3 + 2 * len(self.rects),
+            self.drawable,
+            self.gc,
+        )
+        for rect in self.rects:
+            data += struct.pack(f"{byte_order}hhHH", *rect)
+        return data
+
+
 @dataclass
 class ImageText8Request:
     """X11 ImageText8 request.
@@ -375,6 +416,14 @@ class GetFontPathRequest:
         )
 
 
+@dataclass
+class NoOperationRequest:
+    """X11 NoOperation request (opcode 127)."""
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(f"{byte_order}BBH", NoOperation, 0, 1)
+
+
 @dataclass
 class GetFontPathReply:
     """Parsed xGetFontPathReply.
@@ -464,3 +513,277 @@ class ForceScreenSaver:
             self.mode,
             1,  # length = 1 word
         )
+
+
+@dataclass
+class ChangeWindowAttributesRequest:
+    """X11 ChangeWindowAttributes request.
+
+    Wire format:
+        CARD8    opcode      (2)
+        CARD8    unused
+        CARD16   length
+        CARD32   window
+        CARD32   value_mask
+        LISTofVALUE values
+    """
+
+    window: int
+    values: dict = field(default_factory=dict)
+
+    # window attribute mask bits
+    CWCursor = 1 << 14
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        mask_bits = sorted(self.values.keys())
+        value_mask = 0
+        value_data = b""
+        for bit in mask_bits:
+            value_mask |= bit
+            value_data += struct.pack(f"{byte_order}I", self.values[bit])
+
+        return (
+            struct.pack(
+                f"{byte_order}BBH II",
+                ChangeWindowAttributes,
+                0,
+                (12 + len(value_data)) // 4,
+                self.window,
+                value_mask,
+            )
+            + value_data
+        )
+
+
+@dataclass
+class GetInputFocusRequest:
+    """X11 GetInputFocus request, the usual round trip."""
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(f"{byte_order}BBH", GetInputFocus, 0, 1)
+
+
+@dataclass
+class QueryTextExtentsRequest:
+    """X11 QueryTextExtents request.
+
+    Wire format:
+        CARD8    opcode      (48)
+        BOOL     odd length
+        CARD16   length
+        CARD32   fid
+        STRING16 string      (padded to 4 bytes)
+    """
+
+    fid: int
+    string: str
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        chars = b"".join(
+            struct.pack(">H", c) for c in self.string.encode("latin-1")
+        )
+        padded = _pad(chars)
+        return (
+            struct.pack(
+                f"{byte_order}BBH I",
+                QueryTextExtents,
+                len(self.string) % 2,
+                (8 + len(padded)) // 4,
+                self.fid,
+            )
+            + padded
+        )
+
+
+@dataclass
+class CreateColormapRequest:
+    """X11 CreateColormap request.
+
+    Wire format:
+        CARD8    opcode      (78)
+        BYTE     alloc       (0 None, 1 All)
+        CARD16   length
+        CARD32   mid
+        CARD32   window
+        CARD32   visual
+    """
+
+    mid: int
+    window: int
+    visual: int
+    alloc: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH III",
+            CreateColormap,
+            self.alloc,
+            4,
+            self.mid,
+            self.window,
+            self.visual,
+        )
+
+
+@dataclass
+class AllocColorRequest:
+    """X11 AllocColor request.
+
+    Wire format:
+        CARD8    opcode      (84)
+        CARD8    unused
+        CARD16   length
+        CARD32   cmap
+        CARD16   red, green, blue
+        CARD16   unused
+    """
+
+    cmap: int
+    red: int
+    green: int
+    blue: int
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH I HHHxx",
+            AllocColor,
+            0,
+            4,
+            self.cmap,
+            self.red,
+            self.green,
+            self.blue,
+        )
+
+
+@dataclass
+class AllocColorReply:
+    """Parsed xAllocColorReply: the exact color of the cell, and its pixel."""
+
+    red: int
+    green: int
+    blue: int
+    pixel: int
+
+    @classmethod
+    def from_reply(cls, data: bytes, byte_order: str = "<") -> "AllocColorReply":
+        return cls(*struct.unpack_from(f"{byte_order}HHHxxI", data, 8))
+
+
+@dataclass
+class FreeColorsRequest:
+    """X11 FreeColors request.
+
+    Wire format:
+        CARD8    opcode      (88)
+        CARD8    unused
+        CARD16   length
+        CARD32   cmap
+        CARD32   plane_mask
+        LISTofCARD32 pixels
+    """
+
+    cmap: int
+    pixels: list[int] = field(default_factory=list)
+    plane_mask: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH II {len(self.pixels)}I",
+            FreeColors,
+            0,
+            3 + len(self.pixels),
+            self.cmap,
+            self.plane_mask,
+            *self.pixels,
+        )
+
+
+@dataclass
+class CreateCursorRequest:
+    """X11 CreateCursor request.
+
+    Wire format:
+        CARD8    opcode      (93)
+        CARD8    unused
+        CARD16   length
+        CARD32   cid
+        CARD32   source      (depth 1 pixmap)
+        CARD32   mask        (depth 1 pixmap or None)
+        CARD16   fore red, green, blue
+        CARD16   back red, green, blue
+        CARD16   x, y        (hotspot)
+    """
+
+    cid: int
+    source: int
+    mask: int = 0
+    fore: tuple[int, int, int] = (0, 0, 0)
+    back: tuple[int, int, int] = (0xFFFF, 0xFFFF, 0xFFFF)
+    x: int = 0
+    y: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH III HHH HHH HH",
+            CreateCursor,
+            0,
+            8,
+            self.cid,
+            self.source,
+            self.mask,
+            *self.fore,
+            *self.back,
+            self.x,
+            self.y,
+        )
+
+
+@dataclass
+class CreateGlyphCursorRequest:
+    """X11 CreateGlyphCursor request.
+
+    Wire format:
+        CARD8    opcode      (94)
+        CARD8    unused
+        CARD16   length
+        CARD32   cid
+        CARD32   source_font
+        CARD32   mask_font   (or None)
+        CARD16   source_char, mask_char
+        CARD16   fore red, green, blue
+        CARD16   back red, green, blue
+    """
+
+    cid: int
+    source_font: int
+    source_char: int
+    mask_font: int = 0
+    mask_char: int = 0
+    fore: tuple[int, int, int] = (0, 0, 0)
+    back: tuple[int, int, int] = (0xFFFF, 0xFFFF, 0xFFFF)
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH III HH HHH HHH",
+            CreateGlyphCursor,
+            0,
+            8,
+            self.cid,
+            self.source_font,
+            self.mask_font,
+            self.source_char,
+            self.mask_char,
+            *self.fore,
+            *self.back,
+        )
+
+
+@dataclass
+class FreeCursorRequest:
+    """X11 FreeCursor request."""
+
+    cursor: int
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(f"{byte_order}BBH I", FreeCursor, 0, 2, self.cursor)
@@ -0,0 +1,160 @@
+# SPDX-License-Identifier: MIT
+#
+# XFIXES and X-FIXES-REGIONS extension protocol request builders.
+
+import struct
+from dataclasses import dataclass, field
+
+# XFIXES minor opcodes
+XFixesQueryVersion = 0
+XFixesCreateRegion = 5
+XFixesDestroyRegion = 10
+XFixesFetchRegion = 19
+
+# X-FIXES-REGIONS minor opcodes
+XFixesRegionsQueryVersion = 0
+XFixesEvaluateRegions = 1
+
+# X-FIXES-REGIONS region program operations
+RegionOpLoad = 0
+RegionOpRectangle = 1
+RegionOpUnion = 2
+RegionOpTranslate = 6
+RegionOpStore = 8
+
+
+@dataclass
+class QueryVersionRequest:
+    """XFixesQueryVersion request."""
+
+    opcode: int
+    major: int = 5
+    minor: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH II",
+            self.opcode,
+            XFixesQueryVersion,
+            3,
+            self.major,
+            self.minor,
+        )
+
+
+@dataclass
+class CreateRegionRequest:
+    """XFixesCreateRegion request.
+
+    Followed by a list of (x, y, width, height) rectangles.
+    """
+
+    opcode: int
+    region: int
+    rects: list[tuple[int, int, int, int]] = field(default_factory=list)
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        data = struct.pack(
+            f"{byte_order}BBH I",
+            self.opcode,
+            XFixesCreateRegion,
+            2 + 2 * len(self.rects),
+            self.region,
+        )
+        for rect in self.rects:
+            data += struct.pack(f"{byte_order}hhHH", *rect)
+        return data
+
+
+@dataclass
+class FetchRegionRequest:
+    """XFixesFetchRegion request.
+
+    The reply carries the extents at offset 8 and the rectangles
+    from offset 32, both as (x, y, width, height).
+    """
+
+    opcode: int
+    region: int
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBH I",
+            self.opcode,
+            XFixesFetchRegion,
+            2,
+            self.region,
+        )
+
+
+@dataclass
+class RegionsQueryVersionRequest:
+    """X-FIXES-REGIONS QueryVersion request, required before EvaluateRegions."""
+
+    opcode: int
+    major: int = 1
+    minor: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBHII",
+            self.opcode,
+            XFixesRegionsQueryVersion,
+            3,
+            self.major,
+            self.minor,
+        )
+
+
+@dataclass
+class RegionOp:
+    """One operation of an EvaluateRegions program."""
+
+    op: int
+    dst: int = 0
+    src1: int = 0
+    src2: int = 0
+    region: int = 0
+    x: int = 0
+    y: int = 0
+    width: int = 0
+    height: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBBBIhhHH",
+            self.op,
+            self.dst,
+            self.src1,
+            self.src2,
+            self.region,
+            self.x,
+            self.y,
+            self.width,
+            self.height,
+        )
+
+
+@dataclass
+class EvaluateRegionsRequest:
+    """X-FIXES-REGIONS EvaluateRegions request.
+
+    The reply has the format of the FetchRegion reply, with the contents
+    of the result register.
+    """
+
+    opcode: int
+    result: int
+    ops: list[RegionOp] = field(default_factory=list)
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        data = struct.pack(
+            f"{byte_order}BBHBxxx",
+            self.opcode,
+            XFixesEvaluateRegions,
+            2 + 4 * len(self.ops),
+            self.result,
+        )
+        for op in self.ops:
+            data += op.to_bytes(byte_order)
+        return data
@@ -1,6 +1,7 @@
 # SPDX-License-Identifier: MIT
 #
-# X-Resource extension protocol request builders for byteswap testing.
+# X-Resource, X-CLIENT-STATS and X-CLIENT-SCHED extension protocol request
+# builders for byteswap testing.
 
 import struct
 from dataclasses import dataclass, field
@@ -13,6 +14,14 @@ XResQueryClientPixmapBytes = 3
 XResQueryClientIds = 4
 XResQueryResourceBytes = 5
 
+# X-CLIENT-STATS minor opcodes
+ClientStatsQueryVersion = 0
+ClientStatsQueryClientStats = 1
+
+# X-CLIENT-SCHED minor opcodes
+ClientSchedQueryVersion = 0
+ClientSchedSetWeight = 1
+
 
 @dataclass
 class QueryVersionRequest:
@@ -83,3 +92,80 @@ class QueryClientIdsRequest:
             num_specs,
         )
         return header + spec_data + b"\x00" * pad_len
+
+
+@dataclass
+class ClientStatsQueryVersionRequest:
+    """X-CLIENT-STATS QueryVersion request, required before QueryClientStats."""
+
+    opcode: int
+    major: int = 1
+    minor: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBHII",
+            self.opcode,
+            ClientStatsQueryVersion,
+            3,
+            self.major,
+            self.minor,
+        )
+
+
+@dataclass
+class QueryClientStatsRequest:
+    """X-CLIENT-STATS QueryClientStats request.
+
+    Followed by one CARD32 XID per client to report on; none reports on
+    all clients.
+    """
+
+    opcode: int
+    xids: list[int] = field(default_factory=list)
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBHI{len(self.xids)}I",
+            self.opcode,
+            ClientStatsQueryClientStats,
+            2 + len(self.xids),
+            len(self.xids),
+            *self.xids,
+        )
+
+
+@dataclass
+class ClientSchedQueryVersionRequest:
+    """X-CLIENT-SCHED QueryVersion request, required before SetWeight."""
+
+    opcode: int
+    major: int = 1
+    minor: int = 0
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBHII",
+            self.opcode,
+            ClientSchedQueryVersion,
+            3,
+            self.major,
+            self.minor,
+        )
+
+
+@dataclass
+class SetWeightRequest:
+    """X-CLIENT-SCHED SetWeight request, for the requesting client."""
+
+    opcode: int
+    weight: int
+
+    def to_bytes(self, byte_order: str = "<") -> bytes:
+        return struct.pack(
+            f"{byte_order}BBHI",
+            self.opcode,
+            ClientSchedSetWeight,
+            2,
+            self.weight,
+        )
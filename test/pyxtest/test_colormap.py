@@ -0,0 +1,78 @@
+# SPDX-License-Identifier: MIT
+#
+# Tests for AllocColor on static and dynamic colormaps.
+
+import pytest
+
+from proto import x11
+from xclient import X11Reply
+
+StaticGray, GrayScale, StaticColor, PseudoColor, TrueColor, DirectColor = range(6)
+
+COLORS = [
+    (0, 0, 0),
+    (0xFFFF, 0xFFFF, 0xFFFF),
+    (0x1234, 0x5678, 0x9ABC),
+    (0x8000, 0x0100, 0xFF00),
+]
+
+
+def _alloc_color(conn, cmap, rgb):
+    conn.send_request(x11.AllocColorRequest(cmap, *rgb))
+    resp = conn.recv_response(timeout=5.0)
+    assert isinstance(resp, X11Reply), f"AllocColor of {rgb} failed: {resp}"
+    return x11.AllocColorReply.from_reply(resp.data, ">" if conn.swapped else "<")
+
+
+def _sync(conn):
+    conn.send_request(x11.GetInputFocusRequest())
+    resp = conn.recv_response(timeout=5.0)
+    assert isinstance(resp, X11Reply), f"Unexpected error: {resp}"
+
+
+class TestAllocColor:
+    @pytest.mark.swapped_client
+    def test_default_colormap_swapped(self, xserver, xclient, xclient_swapped):
+        """
+        A byte-swapped client gets the same cells as a native one from the
+        default colormap, whose closest colors come from the static index
+        on TrueColor screens.
+        """
+        for rgb in COLORS:
+            native = _alloc_color(xclient, xclient.default_colormap, rgb)
+            swapped = _alloc_color(
+                xclient_swapped, xclient_swapped.default_colormap, rgb
+            )
+            assert swapped == native
+
+    @pytest.mark.swapped_client
+    def test_dynamic_colormap_shares_cells(self, xserver, xclient, xclient_swapped):
+        """
+        Read-only cells of a dynamic colormap are found again by color,
+        across clients of either byte order, and stay found until the
+        last client frees them.
+        """
+        visuals = [
+            visual
+            for visual, visual_class in xclient_swapped.visual_classes.items()
+            if visual_class in (PseudoColor, DirectColor)
+        ]
+        if not visuals:
+            pytest.skip("No PseudoColor or DirectColor visual")
+
+        cmap = xclient_swapped.alloc_id()
+        xclient_swapped.send_request(
+            x11.CreateColormapRequest(
+                mid=cmap, window=xclient_swapped.root_window, visual=visuals[0]
+            )
+        )
+
+        first = [_alloc_color(xclient_swapped, cmap, rgb) for rgb in COLORS]
+        assert len({reply.pixel for reply in first}) == len(COLORS)
+        assert [_alloc_color(xclient, cmap, rgb) for rgb in COLORS] == first
+
+        xclient_swapped.send_request(
+            x11.FreeColorsRequest(cmap=cmap, pixels=[reply.pixel for reply in first])
+        )
+        _sync(xclient_swapped)
+        assert [_alloc_color(xclient_swapped, cmap, rgb) for rgb in COLORS] == first
@@ -0,0 +1,130 @@
+# SPDX-License-Identifier: MIT
+#
+# Tests for cursors whose images the server shares between clients.
+
+import pytest
+
+from proto import x11
+from xclient import X11Error, X11Reply
+
+XC_LEFT_PTR = 68
+
+
+def _sync(conn):
+    """Returns the first error of the requests sent so far, if any."""
+    conn.send_request(x11.GetInputFocusRequest())
+    resp = conn.recv_response(timeout=5.0)
+    if isinstance(resp, X11Error):
+        assert isinstance(conn.recv_response(timeout=5.0), X11Reply)
+        return resp
+    assert isinstance(resp, X11Reply)
+    return None
+
+
+def _define_cursor(conn, cursor):
+    window = conn.alloc_id()
+    conn.send_request(
+        x11.CreateWindowRequest(
+            wid=window,
+            parent=conn.root_window,
+            x=0,
+            y=0,
+            width=10,
+            height=10,
+            depth=0,
+        )
+    )
+    conn.send_request(
+        x11.ChangeWindowAttributesRequest(
+            window=window,
+            values={x11.ChangeWindowAttributesRequest.CWCursor: cursor},
+        )
+    )
+    assert _sync(conn) is None
+
+
+def _bitmap_cursor(conn):
+    """A 16x16 cursor, its top half set."""
+    pixmap = conn.alloc_id()
+    cursor = conn.alloc_id()
+    conn.send_request(
+        x11.CreatePixmapRequest(
+            pid=pixmap, drawable=conn.root_window, width=16, height=16, depth=1
+        )
+    )
+    for pixel, height in [(0, 16), (1, 8)]:
+        gc = conn.alloc_id()
+        conn.send_request(
+            x11.CreateGCRequest(
+                cid=gc,
+                drawable=pixmap,
+                values={x11.CreateGCRequest.GCForeground: pixel},
+            )
+        )
+        conn.send_request(
+            x11.PolyFillRectangleRequest(
+                drawable=pixmap, gc=gc, rects=[(0, 0, 16, height)]
+            )
+        )
+    conn.send_request(
+        x11.CreateCursorRequest(cid=cursor, source=pixmap, mask=pixmap, x=8, y=8)
+    )
+    assert _sync(conn) is None
+    return cursor
+
+
+class TestSharedCursors:
+    @pytest.mark.swapped_client
+    def test_glyph_cursor_swapped(self, xserver, xclient, xclient_swapped):
+        """
+        The same glyph cursor created by a native and a byte-swapped client
+        stays usable by either after the other frees its own.
+        """
+        cursors = {}
+        for conn in (xclient, xclient_swapped):
+            font = conn.alloc_id()
+            conn.send_request(x11.OpenFontRequest(fid=font, name="cursor"))
+            if _sync(conn) is not None:
+                pytest.skip('No font "cursor"')
+            cursors[conn] = conn.alloc_id()
+            conn.send_request(
+                x11.CreateGlyphCursorRequest(
+                    cid=cursors[conn],
+                    source_font=font,
+                    source_char=XC_LEFT_PTR,
+                    mask_font=font,
+                    mask_char=XC_LEFT_PTR + 1,
+                )
+            )
+            assert _sync(conn) is None
+
+        xclient.send_request(x11.FreeCursorRequest(cursors[xclient]))
+        assert _sync(xclient) is None
+        _define_cursor(xclient_swapped, cursors[xclient_swapped])
+
+    @pytest.mark.swapped_client
+    def test_bitmap_cursor_swapped(self, xserver, xclient, xclient_swapped):
+        """
+        The same bitmap cursor created by a byte-swapped and a native
+        client stays usable by either after the other frees its own.
+        """
+        native = _bitmap_cursor(xclient)
+        swapped = _bitmap_cursor(xclient_swapped)
+
+        xclient_swapped.send_request(x11.FreeCursorRequest(swapped))
+        assert _sync(xclient_swapped) is None
+        _define_cursor(xclient, native)
+
+        swapped = _bitmap_cursor(xclient_swapped)
+        xclient.send_request(x11.FreeCursorRequest(native))
+        assert _sync(xclient) is None
+        _define_cursor(xclient_swapped, swapped)
+
+    @pytest.mark.swapped_client
+    def test_freed_cursor_refused(self, xserver, xclient_swapped):
+        """A cursor freed by its only user is gone."""
+        cursor = _bitmap_cursor(xclient_swapped)
+        xclient_swapped.send_request(x11.FreeCursorRequest(cursor))
+        xclient_swapped.send_request(x11.FreeCursorRequest(cursor))
+        error = _sync(xclient_swapped)
+        assert error is not None and error.resource_id == cursor
@@ -0,0 +1,164 @@
+# SPDX-License-Identifier: MIT
+#
+# Tests for the DAMAGE and X-DAMAGE-AGE extensions.
+
+import struct
+
+import pytest
+
+from proto import damage, xfixes
+from proto.x11 import CreateGCRequest, PolyFillRectangleRequest
+from xclient import BadRequest, Extension, X11Error, X11Reply
+
+WIDTH = 64
+HEIGHT = 48
+
+
+def _bo(conn):
+    return ">" if conn.swapped else "<"
+
+
+def _reply(conn):
+    """Return the next reply or error, skipping DamageNotify events."""
+    while True:
+        resp = conn.recv_response(timeout=5.0)
+        if resp is None or isinstance(resp, X11Error) or resp.response_type == 1:
+            return resp
+
+
+def _fetch_age(conn, opcode, dmg, region, frame):
+    conn.send_request(
+        damage.AgeFetchRequest(opcode=opcode, damage=dmg, region=region, frame=frame)
+    )
+    resp = _reply(conn)
+    assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+    return struct.unpack_from(f"{_bo(conn)}I", resp.data, 8)[0]
+
+
+def _fetch_region(conn, opcode, region):
+    conn.send_request(xfixes.FetchRegionRequest(opcode=opcode, region=region))
+    resp = _reply(conn)
+    assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+    nrects = resp.length // 2
+    return [
+        struct.unpack_from(f"{_bo(conn)}hhHH", resp.data, 32 + 8 * i)
+        for i in range(nrects)
+    ]
+
+
+def _setup(conn, query_age=True):
+    """A pixmap with a NonEmpty damage object, a GC and an empty region."""
+    ext = conn.query_extension(Extension.DAMAGE)
+    age = conn.query_extension(Extension.DAMAGE_AGE)
+    fixes = conn.query_extension(Extension.XFIXES)
+    if not ext or not age or not fixes:
+        pytest.skip("DAMAGE, X-DAMAGE-AGE or XFIXES extension not available")
+
+    conn.send_request(xfixes.QueryVersionRequest(opcode=fixes.opcode))
+    if not isinstance(_reply(conn), X11Reply):
+        pytest.skip("XFixes QueryVersion failed")
+
+    conn.send_request(damage.QueryVersionRequest(opcode=ext.opcode))
+    if not isinstance(_reply(conn), X11Reply):
+        pytest.skip("Damage QueryVersion failed")
+
+    if query_age:
+        conn.send_request(damage.AgeQueryVersionRequest(opcode=age.opcode))
+        resp = _reply(conn)
+        assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+        major, minor = struct.unpack_from(f"{_bo(conn)}II", resp.data, 8)
+        assert (major, minor) == (1, 0)
+
+    pixmap = conn.create_pixmap(width=WIDTH, height=HEIGHT)
+    gc = conn.alloc_id()
+    conn.send_request(CreateGCRequest(cid=gc, drawable=pixmap))
+    dmg = conn.alloc_id()
+    conn.send_request(
+        damage.CreateRequest(opcode=ext.opcode, damage=dmg, drawable=pixmap)
+    )
+    region = conn.alloc_id()
+    conn.send_request(xfixes.CreateRegionRequest(opcode=fixes.opcode, region=region))
+
+    return conn, age.opcode, fixes.opcode, pixmap, gc, dmg, region
+
+
+class TestDamageFetchAge:
+    def test_fetch_age(self, xserver, xclient):
+        """
+        Fetch returns everything drawn since the given frame, and the
+        whole drawable for a frame it no longer (or never) knew about.
+        """
+        conn, opcode, fixes, pixmap, gc, dmg, region = _setup(xclient)
+        full = [(0, 0, WIDTH, HEIGHT)]
+
+        # Frame 0 means no previous contents
+        frame = _fetch_age(conn, opcode, dmg, region, 0)
+        assert frame != 0
+        assert _fetch_region(conn, fixes, region) == full
+
+        conn.send_request(
+            PolyFillRectangleRequest(drawable=pixmap, gc=gc, rects=[(10, 12, 5, 7)])
+        )
+        next_frame = _fetch_age(conn, opcode, dmg, region, frame)
+        assert next_frame != frame
+        assert _fetch_region(conn, fixes, region) == [(10, 12, 5, 7)]
+
+        # Damage accumulates over several frames
+        conn.send_request(
+            PolyFillRectangleRequest(drawable=pixmap, gc=gc, rects=[(30, 2, 4, 4)])
+        )
+        _fetch_age(conn, opcode, dmg, region, next_frame)
+        _fetch_age(conn, opcode, dmg, region, frame)
+        assert sorted(_fetch_region(conn, fixes, region)) == [
+            (10, 12, 5, 7),
+            (30, 2, 4, 4),
+        ]
+
+        # Nothing drawn since the last frame
+        last = _fetch_age(conn, opcode, dmg, region, 0)
+        _fetch_age(conn, opcode, dmg, region, last)
+        assert _fetch_region(conn, fixes, region) == []
+
+        # A frame that fell out of the history
+        for _ in range(16):
+            _fetch_age(conn, opcode, dmg, region, 0)
+        _fetch_age(conn, opcode, dmg, region, frame)
+        assert _fetch_region(conn, fixes, region) == full
+
+        assert xserver.is_alive, "Server crashed"
+
+    def test_fetch_needs_query_version(self, xserver, xclient):
+        """Fetch is BadRequest until the client has sent QueryVersion."""
+        conn, opcode, fixes, pixmap, gc, dmg, region = _setup(
+            xclient, query_age=False
+        )
+
+        conn.send_request(
+            damage.AgeFetchRequest(opcode=opcode, damage=dmg, region=region, frame=0)
+        )
+        resp = _reply(conn)
+        assert isinstance(resp, X11Error), f"Expected error, got {resp}"
+        assert resp.error_code == BadRequest
+
+        assert xserver.is_alive, "Server crashed"
+
+    @pytest.mark.swapped_client
+    def test_fetch_age_swapped(self, xserver, xclient_swapped):
+        """
+        A byte-swapped client gets its damage, region and frame swapped
+        on the way in and the frame number swapped in the reply.
+        """
+        conn, opcode, fixes, pixmap, gc, dmg, region = _setup(xclient_swapped)
+
+        frame = _fetch_age(conn, opcode, dmg, region, 0)
+        assert frame != 0
+        assert _fetch_region(conn, fixes, region) == [(0, 0, WIDTH, HEIGHT)]
+
+        conn.send_request(
+            PolyFillRectangleRequest(drawable=pixmap, gc=gc, rects=[(3, 4, 9, 2)])
+        )
+        next_frame = _fetch_age(conn, opcode, dmg, region, frame)
+        assert next_frame == frame + 1
+        assert _fetch_region(conn, fixes, region) == [(3, 4, 9, 2)]
+
+        assert xserver.is_alive, "Server crashed"
@@ -1,14 +1,65 @@
 # SPDX-License-Identifier: MIT
 #
-# Security tests for font alias handling vulnerabilities.
+# Tests for core font handling: font alias vulnerabilities, the ListFonts
+# cache and text extents.
 
 import os
+import struct
 import time
 
 import pytest
 
 from proto import x11
-from xclient import X11Reply
+from xclient import X11Error, X11Reply
+
+
+def _bo(conn):
+    return ">" if conn.swapped else "<"
+
+
+def _list_fonts(conn, pattern, max_names=65535):
+    conn.send_request(x11.ListFontsRequest(pattern=pattern, max_names=max_names))
+    resp = conn.recv_response(timeout=5.0)
+    assert isinstance(resp, X11Reply)
+    count = struct.unpack_from(f"{_bo(conn)}H", resp.data, 8)[0]
+    names = []
+    offset = 32
+    for _ in range(count):
+        length = resp.data[offset]
+        names.append(resp.data[offset + 1 : offset + 1 + length].decode("latin-1"))
+        offset += 1 + length
+    return names
+
+
+def _get_font_path(conn):
+    conn.send_request(x11.GetFontPathRequest())
+    resp = conn.recv_response(timeout=5.0)
+    assert isinstance(resp, X11Reply), "GetFontPath failed"
+    return x11.GetFontPathReply.from_reply(resp.data).paths
+
+
+def _set_font_path(conn, paths):
+    conn.send_request(x11.SetFontPathRequest(paths=paths))
+    conn.send_request(x11.GetInputFocusRequest())
+    assert isinstance(conn.recv_response(timeout=5.0), X11Reply), "SetFontPath failed"
+
+
+def _open_font(conn, name):
+    fid = conn.alloc_id()
+    conn.send_request(x11.OpenFontRequest(fid=fid, name=name))
+    conn.send_request(x11.GetInputFocusRequest())
+    if isinstance(conn.recv_response(timeout=5.0), X11Error):
+        pytest.skip(f'No font "{name}"')
+    return fid
+
+
+def _text_extents(conn, fid, string):
+    """fontAscent, fontDescent, overallAscent, overallDescent, overallWidth,
+    overallLeft and overallRight of string in fid."""
+    conn.send_request(x11.QueryTextExtentsRequest(fid=fid, string=string))
+    resp = conn.recv_response(timeout=5.0)
+    assert isinstance(resp, X11Reply)
+    return struct.unpack_from(f"{_bo(conn)}hhhhiii", resp.data, 8)
 
 
 class TestFontAliasOverflow:
@@ -90,3 +141,61 @@ class TestFontAliasOverflow:
         req = x11.SetFontPathRequest(paths=original_paths)
         xclient.send_request(req.to_bytes())
         xclient.flush_responses(timeout=1.0)
+
+
+class TestListFontsCache:
+    """ListFonts answers served from the server's pattern cache."""
+
+    @pytest.mark.swapped_client
+    def test_list_fonts_swapped(self, xserver, xclient, xclient_swapped):
+        """
+        A byte-swapped client gets the same names as a native one, both
+        when the answer is computed and when it comes from the cache, and
+        maxNames still limits a cached answer.
+        """
+        names = _list_fonts(xclient_swapped, "*")
+        if not names:
+            pytest.skip("No fonts in the font path")
+
+        assert _list_fonts(xclient_swapped, "*") == names
+        assert _list_fonts(xclient, "*") == names
+        assert _list_fonts(xclient_swapped, "*", max_names=1) == names[:1]
+
+    def test_list_fonts_follows_font_path(self, xserver, xclient, tmp_path):
+        """
+        A cached answer doesn't outlive the font path it was computed for.
+        """
+        alias_dir = tmp_path / "aliases"
+        alias_dir.mkdir()
+        (alias_dir / "fonts.dir").write_text("0\n")
+        (alias_dir / "fonts.alias").write_text("pyxtest-alias fixed\n")
+
+        original_paths = _get_font_path(xclient)
+        assert _list_fonts(xclient, "pyxtest-alias") == []
+
+        _set_font_path(xclient, [str(alias_dir)] + original_paths)
+        assert _list_fonts(xclient, "pyxtest-alias") == ["pyxtest-alias"]
+
+        _set_font_path(xclient, original_paths)
+        assert _list_fonts(xclient, "pyxtest-alias") == []
+
+
+class TestTextExtents:
+    """QueryTextExtents served from the per-font metric tables."""
+
+    @pytest.mark.swapped_client
+    def test_query_text_extents_swapped(self, xserver, xclient, xclient_swapped):
+        """
+        A byte-swapped client gets the same extents as a native one, for
+        odd and even lengths, and the widths of a fixed-width font add up.
+        """
+        fid = _open_font(xclient, "fixed")
+        swapped_fid = _open_font(xclient_swapped, "fixed")
+
+        for string in ["M", "MMMM", "abc", "Hello, world"]:
+            extents = _text_extents(xclient, fid, string)
+            assert _text_extents(xclient_swapped, swapped_fid, string) == extents
+
+        width = _text_extents(xclient_swapped, swapped_fid, "M")[4]
+        assert width > 0
+        assert _text_extents(xclient_swapped, swapped_fid, "MMMM")[4] == 4 * width
@@ -2,10 +2,20 @@
 #
 # Tests for Present extension.
 
+import struct
+import time
+
 import pytest
 
 from proto import present
-from xclient import BadWindow, Extension, X11Error
+from xclient import (
+    BadRequest,
+    BadWindow,
+    Extension,
+    GenericEvent,
+    X11Error,
+    X11Reply,
+)
 
 
 class TestPresentSelectInput:
@@ -132,3 +142,199 @@ class TestPresentNotify:
             f"{bad_window_errors} - notify window IDs not "
             "byte-swapped in sproc_present_pixmap"
         )
+
+
+class TestPresentUST:
+    """Tests for PresentOptionUST targets and X-PRESENT-STATS.
+
+    Xvfb has no CRTCs, so this runs on the fake vblank path, which reports
+    vblanks at exact multiples of the frame interval. UST is the server's
+    CLOCK_MONOTONIC in microseconds, the same clock as time.monotonic().
+    """
+
+    @staticmethod
+    def _bo(conn):
+        return ">" if conn.swapped else "<"
+
+    @staticmethod
+    def _setup(conn, query_stats=True):
+        ext = conn.query_extension(Extension.PRESENT)
+        stats = conn.query_extension(Extension.PRESENT_STATS)
+        if not ext or not stats:
+            pytest.skip("Present or X-PRESENT-STATS extension not available")
+
+        conn.send_request(present.QueryVersionRequest(opcode=ext.opcode))
+        conn.recv_response(timeout=5.0)
+
+        if query_stats:
+            conn.send_request(present.StatsQueryVersionRequest(opcode=stats.opcode))
+            resp = conn.recv_response(timeout=5.0)
+            assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+            version = struct.unpack_from(f"{TestPresentUST._bo(conn)}II", resp.data, 8)
+            assert version == (1, 0)
+
+        return ext.opcode, stats.opcode
+
+    @staticmethod
+    def _query_stats(conn, opcode, window):
+        conn.send_request(
+            present.StatsQueryFrameStatsRequest(opcode=opcode, window=window)
+        )
+        resp = conn.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+        names = ("presented", "missed", "queued", "max_queued", "latency", "max_latency")
+        values = struct.unpack_from(f"{TestPresentUST._bo(conn)}6I", resp.data, 8)
+        return dict(zip(names, values))
+
+    @staticmethod
+    def _complete_ust(conn, opcode, serial):
+        """Wait for the PresentCompleteNotify of *serial*, return its UST."""
+        bo = TestPresentUST._bo(conn)
+        while True:
+            resp = conn.recv_response(timeout=5.0)
+            assert resp is not None, f"No CompleteNotify for serial {serial}"
+            if resp.response_type & 0x7F != GenericEvent or resp.data[1] != opcode:
+                continue
+            evtype, _, _, _, _, got_serial, ust = struct.unpack_from(
+                f"{bo}HBBIIIQ", resp.data, 8
+            )
+            if evtype == present.PresentCompleteNotify and got_serial == serial:
+                return ust
+
+    def _present_ust(self, conn, opcode, win, pixmap, serial, **kwargs):
+        conn.send_request(
+            present.PixmapRequest(
+                opcode=opcode,
+                window=win,
+                pixmap=pixmap,
+                serial=serial,
+                options=present.PresentOptionUST,
+                **kwargs,
+            )
+        )
+
+    def test_no_ust_capability(self, xserver, xclient):
+        """Xvfb has no driver support for UST and must not claim it."""
+        conn = xclient
+        opcode, _ = self._setup(conn, query_stats=False)
+
+        conn.send_request(
+            present.QueryCapabilitiesRequest(opcode=opcode, target=conn.root_window)
+        )
+        resp = conn.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+        capabilities = struct.unpack_from("<I", resp.data, 8)[0]
+        assert not capabilities & present.PresentCapabilityUST
+
+    def test_ust_targets(self, xserver, xclient):
+        """
+        A future target UST completes at the first vblank at or after
+        it. A past one with a divisor completes at the first vblank at
+        or after the next UST with ust % divisor == remainder.
+        """
+        conn = xclient
+        opcode, _ = self._setup(conn, query_stats=False)
+
+        win = conn.create_window()
+        pixmap = conn.create_pixmap()
+        eid = conn.alloc_id()
+        conn.send_request(
+            present.SelectInputRequest(
+                opcode=opcode,
+                eid=eid,
+                window=win,
+                event_mask=present.PresentCompleteNotifyMask,
+            )
+        )
+
+        # Xvfb fakes vblanks at 60Hz, allow for two frames
+        frame = 1_000_000 // 30
+
+        target = time.monotonic_ns() // 1000 + 150_000
+        self._present_ust(conn, opcode, win, pixmap, 1, target_msc=target)
+        ust = self._complete_ust(conn, opcode, 1)
+        assert target <= ust <= target + frame
+
+        divisor = 1_000_000
+        target = time.monotonic_ns() // 1000 + 150_000
+        self._present_ust(
+            conn,
+            opcode,
+            win,
+            pixmap,
+            2,
+            target_msc=1,
+            divisor=divisor,
+            remainder=target % divisor,
+        )
+        ust = self._complete_ust(conn, opcode, 2)
+        assert target <= ust <= target + frame
+
+        assert xserver.is_alive, "Server crashed"
+
+    def test_frame_stats(self, xserver, xclient):
+        """
+        Presentations are counted as queued until they execute and as
+        presented, not missed, once they complete on time.
+        """
+        conn = xclient
+        opcode, stats_opcode = self._setup(conn)
+
+        win = conn.create_window()
+        pixmap = conn.create_pixmap()
+
+        # Targets 100ms apart do not replace each other
+        now = time.monotonic_ns() // 1000
+        self._present_ust(conn, opcode, win, pixmap, 1, target_msc=now + 200_000)
+        self._present_ust(conn, opcode, win, pixmap, 2, target_msc=now + 300_000)
+
+        stats = self._query_stats(conn, stats_opcode, win)
+        assert stats["queued"] == 2
+        assert stats["max_queued"] == 2
+        assert stats["presented"] == 0
+
+        time.sleep(0.5)
+        stats = self._query_stats(conn, stats_opcode, win)
+        assert stats["queued"] == 0
+        assert stats["presented"] == 2
+        assert stats["missed"] == 0
+        assert stats["max_latency"] >= stats["latency"]
+
+        assert xserver.is_alive, "Server crashed"
+
+    def test_frame_stats_needs_query_version(self, xserver, xclient):
+        """QueryFrameStats is BadRequest until QueryVersion was sent."""
+        conn = xclient
+        _, stats_opcode = self._setup(conn, query_stats=False)
+
+        conn.send_request(
+            present.StatsQueryFrameStatsRequest(
+                opcode=stats_opcode, window=conn.root_window
+            )
+        )
+        resp = conn.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Error), f"Expected error, got {resp}"
+        assert resp.error_code == BadRequest
+
+    @pytest.mark.swapped_client
+    def test_frame_stats_swapped(self, xserver, xclient_swapped):
+        """A byte-swapped client gets its window and the reply swapped."""
+        conn = xclient_swapped
+        opcode, stats_opcode = self._setup(conn)
+
+        win = conn.create_window()
+        pixmap = conn.create_pixmap()
+
+        now = time.monotonic_ns() // 1000
+        self._present_ust(conn, opcode, win, pixmap, 1, target_msc=now + 100_000)
+
+        stats = self._query_stats(conn, stats_opcode, win)
+        assert stats["queued"] == 1
+        assert stats["max_queued"] == 1
+
+        time.sleep(0.3)
+        stats = self._query_stats(conn, stats_opcode, win)
+        assert stats["queued"] == 0
+        assert stats["presented"] == 1
+
+        assert xserver.is_alive, "Server crashed"
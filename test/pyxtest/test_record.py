@@ -1,13 +1,20 @@
 # SPDX-License-Identifier: MIT
 #
-# Security tests for RECORD extension vulnerabilities.
+# Tests for the RECORD and X-RECORD-RING extensions.
 
+import mmap
+import os
+import struct
 import time
 
 import pytest
 
 from proto import record
-from xclient import Extension
+from proto.x11 import GetFontPathRequest, NoOperation, NoOperationRequest
+from xclient import BadRequest, Extension, X11Error, X11Reply
+
+# One xRecordRange selecting the core NoOperation request only
+NOOP_RANGE = bytes([NoOperation, NoOperation]) + b"\x00" * 22
 
 
 @pytest.fixture
@@ -65,3 +72,119 @@ class TestRecordCreateContext:
         assert xserver.is_alive, (
             "Server crashed - integer underflow in SwapCreateRegister (CVE-2020-14362)"
         )
+
+
+class TestRecordRing:
+    """Tests for X-RECORD-RING, RECORD contexts recording into shared memory."""
+
+    @staticmethod
+    def _setup(conn, query_ring=True):
+        rec = conn.query_extension(Extension.RECORD)
+        ring = conn.query_extension(Extension.RECORD_RING)
+        if not rec or not ring:
+            pytest.skip("RECORD or X-RECORD-RING extension not available")
+        bo = ">" if conn.swapped else "<"
+
+        conn.send_request(record.QueryVersionRequest(opcode=rec.opcode))
+        assert isinstance(conn.recv_response(timeout=5.0), X11Reply)
+
+        context = conn.alloc_id()
+        conn.send_request(
+            record.CreateContextRequest(
+                opcode=rec.opcode,
+                context_id=context,
+                client_ids=[record.RecordAllClients],
+                ranges_data=NOOP_RANGE,
+                n_ranges_override=1,
+            )
+        )
+
+        if query_ring:
+            conn.send_request(record.RingQueryVersionRequest(opcode=ring.opcode))
+            resp = conn.recv_response(timeout=5.0)
+            assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+            assert struct.unpack_from(f"{bo}II", resp.data, 8) == (1, 0)
+
+        return ring.opcode, context, bo
+
+    @staticmethod
+    def _records(mem, offset, bo, want):
+        """Wait for *want* records in the ring, return their headers and data."""
+        deadline = time.monotonic() + 5.0
+        while True:
+            head = struct.unpack_from("=I", mem, 0)[0]
+            records = []
+            pos = 0
+            while pos < head:
+                rtype, category, _, length = struct.unpack_from(
+                    f"{bo}BBHI", mem, offset + pos
+                )
+                size = 32 + 4 * length
+                data = mem[offset + pos : offset + pos + size]
+                records.append((rtype, category, data))
+                pos += size
+            if len(records) >= want or time.monotonic() > deadline:
+                return records
+            time.sleep(0.01)
+
+    def test_enable_needs_query_version(self, xserver, xclient):
+        """EnableContext is BadRequest until QueryVersion was sent."""
+        opcode, context, _ = self._setup(xclient, query_ring=False)
+
+        xclient.send_request(
+            record.RingEnableContextRequest(opcode=opcode, context=context)
+        )
+        resp = xclient.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Error), f"Expected error, got {resp}"
+        assert resp.error_code == BadRequest
+
+    @pytest.mark.swapped_client
+    def test_ring_swapped(self, xserver, xclient, xclient_swapped):
+        """
+        A byte-swapped recorder gets the reply swapped and the records in
+        the ring in its own byte order, while the ring header stays in host
+        byte order. Only the selected request of the recorded native client
+        shows up.
+        """
+        recorder = xclient_swapped
+        opcode, context, bo = self._setup(recorder)
+
+        recorder.send_request(
+            record.RingEnableContextRequest(opcode=opcode, context=context)
+        )
+        resp, fds = recorder.recv_response_fds()
+        try:
+            assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+            assert resp.data[1] == 2
+            assert len(fds) == 2
+            size, offset = struct.unpack_from(f"{bo}II", resp.data, 8)
+            assert size and size & (size - 1) == 0
+
+            with mmap.mmap(fds[0], offset + size) as mem:
+                xclient.send_request(GetFontPathRequest())
+                xclient.send_request(NoOperationRequest())
+                xclient.send_request(GetFontPathRequest())
+                assert isinstance(xclient.recv_response(timeout=5.0), X11Reply)
+                assert isinstance(xclient.recv_response(timeout=5.0), X11Reply)
+
+                records = self._records(mem, offset, bo, 2)
+                assert [r[:2] for r in records] == [
+                    (1, record.RecordStartOfData),
+                    (1, record.RecordFromClient),
+                ]
+
+                data = records[1][2]
+                # the length in the recorder's byte order, the recorded
+                # client's request in its own
+                assert struct.unpack_from(f"{bo}I", data, 4)[0] == 1
+                assert data[9] == 1
+                assert data[32] == NoOperation
+
+                # the recording connection is still usable
+                recorder.send_request(GetFontPathRequest())
+                assert isinstance(recorder.recv_response(timeout=5.0), X11Reply)
+        finally:
+            for fd in fds:
+                os.close(fd)
+
+        assert xserver.is_alive, "Server crashed"
@@ -0,0 +1,153 @@
+# SPDX-License-Identifier: MIT
+#
+# Tests for the request trace (-trace) and test/scripts/xtrace-to-json.py.
+
+import json
+import os
+import struct
+import subprocess
+import sys
+from pathlib import Path
+
+import pytest
+
+from proto import x11
+from xclient import RawX11Connection, X11Reply
+from xserver import XServerProcess
+
+CONVERTER = (
+    Path(os.environ.get("XSERVER_DIR", Path(__file__).resolve().parents[2]))
+    / "test"
+    / "scripts"
+    / "xtrace-to-json.py"
+)
+
+
+@pytest.fixture
+def traced_xvfb(request, tmp_path):
+    """An Xvfb recording its request trace to tmp_path/xserver.trace."""
+    if request.config.getoption("--display") is not None:
+        pytest.skip("Needs a server started with -trace")
+
+    trace = tmp_path / "xserver.trace"
+    try:
+        server = XServerProcess(
+            server_type="xvfb",
+            server_path=request.config.getoption("--server-path"),
+            extra_args=["-trace", str(trace)],
+        )
+        server.start(timeout=15)
+    except (FileNotFoundError, RuntimeError) as e:
+        pytest.skip(f"Failed to start Xvfb: {e}")
+
+    yield server, trace
+    server.stop()
+
+
+def _convert(trace, tmp_path):
+    """Runs the converter on trace, returning its trace events."""
+    output = tmp_path / "xserver.json"
+    subprocess.run(
+        [sys.executable, str(CONVERTER), str(trace), str(output)],
+        check=True,
+        timeout=60,
+    )
+    with open(output) as f:
+        return json.load(f)["traceEvents"]
+
+
+def _record(rtype, data, body):
+    return struct.pack("<BBH", rtype, data, 4 + len(body)) + body
+
+
+class TestTrace:
+    def test_convert(self, tmp_path):
+        """
+        The converter names core and extension requests, turns clients
+        into threads and stops at a record cut short by a crash.
+        """
+        start = 1_000_000_000
+        trace = tmp_path / "xserver.trace"
+        trace.write_bytes(
+            struct.pack("<IIQQII", 0x43525458, 1, start, 0, 1234, 0)
+            + _record(2, 1, struct.pack("<IIIQ", 5, 4321, 0, start) + b"xterm\0")
+            + _record(3, 130, struct.pack("<HH", 0xFFFF, 0) + b"XFIXES\0")
+            + _record(
+                1,
+                53,
+                struct.pack("<HBBIIIIQQ", 0, 0, 1, 5, 1, 16, 0, start, start + 2000)
+                + struct.pack("<I", 0xA00001),
+            )
+            + _record(
+                1,
+                130,
+                struct.pack("<HBBIIIIQQ", 5, 0, 0, 5, 2, 8, 32, start, start + 1000),
+            )
+            # a GetInputFocus cut short
+            + struct.pack("<BBH", 1, 43, 40)
+            + b"\0" * 8
+        )
+
+        events = _convert(trace, tmp_path)
+
+        requests = [e for e in events if e.get("cat") == "request"]
+        assert [e["name"] for e in requests] == ["CreatePixmap", "XFIXES:5"]
+        assert requests[0]["tid"] == 5
+        assert requests[0]["dur"] == 2.0
+        assert requests[0]["args"]["resources"] == ["0xa00001"]
+        assert requests[1]["args"]["bytes_out"] == 32
+        assert {
+            "name": "thread_name",
+            "ph": "M",
+            "pid": 1234,
+            "tid": 5,
+            "args": {"name": "xterm (4321)"},
+        } in events
+
+    @pytest.mark.swapped_client
+    def test_trace_to_json(self, traced_xvfb, tmp_path):
+        """
+        Requests of native and byte-swapped clients end up in the trace,
+        with the resources they create, and the converter turns it into
+        one thread of request slices per client.
+        """
+        server, trace = traced_xvfb
+        pixmaps = {}
+
+        for swapped in (False, True):
+            with RawX11Connection(server.display_num, swapped=swapped) as conn:
+                pixmap = conn.alloc_id()
+                conn.send_request(
+                    x11.CreatePixmapRequest(
+                        pid=pixmap,
+                        drawable=conn.root_window,
+                        width=16,
+                        height=16,
+                        depth=conn.root_depth,
+                    )
+                )
+                conn.send_request(x11.NoOperationRequest())
+                conn.send_request(x11.GetInputFocusRequest())
+                assert isinstance(conn.recv_response(timeout=5.0), X11Reply)
+                pixmaps[swapped] = pixmap
+
+        # the trace is written out when the server goes down
+        server.stop()
+        events = _convert(trace, tmp_path)
+
+        requests = [e for e in events if e.get("cat") == "request"]
+        created = {
+            e["tid"]: e["args"]["resources"]
+            for e in requests
+            if e["name"] == "CreatePixmap"
+        }
+        assert sorted(created.values()) == sorted(
+            [[f"0x{pixmap:x}"] for pixmap in pixmaps.values()]
+        )
+
+        for tid in created:
+            names = [e["name"] for e in requests if e["tid"] == tid]
+            assert names[-3:] == ["CreatePixmap", "NoOperation", "GetInputFocus"]
+            assert any(
+                e["name"] == "thread_name" and e["tid"] == tid for e in events
+            )
@@ -0,0 +1,144 @@
+# SPDX-License-Identifier: MIT
+#
+# Tests for the X-FIXES-REGIONS extension.
+
+import struct
+
+import pytest
+
+from proto import xfixes
+from xclient import (
+    BadMatch,
+    BadRequest,
+    Extension,
+    RawX11Connection,
+    X11Error,
+    X11Reply,
+)
+
+RECT = (10, 20, 30, 40)
+
+
+def _bo(conn):
+    return ">" if conn.swapped else "<"
+
+
+def _rects(conn, resp):
+    """The extents and rectangles of a FetchRegion-style reply."""
+    bo = _bo(conn)
+    extents = struct.unpack_from(f"{bo}hhHH", resp.data, 8)
+    rects = [
+        struct.unpack_from(f"{bo}hhHH", resp.data, 32 + 8 * i)
+        for i in range(resp.length // 2)
+    ]
+    return extents, rects
+
+
+def _setup(conn, query_regions=True):
+    fixes = conn.query_extension(Extension.XFIXES)
+    regions = conn.query_extension(Extension.XFIXES_REGIONS)
+    if not fixes or not regions:
+        pytest.skip("XFIXES or X-FIXES-REGIONS extension not available")
+
+    conn.send_request(xfixes.QueryVersionRequest(opcode=fixes.opcode))
+    assert isinstance(conn.recv_response(timeout=5.0), X11Reply)
+
+    if query_regions:
+        conn.send_request(xfixes.RegionsQueryVersionRequest(opcode=regions.opcode))
+        resp = conn.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+        assert struct.unpack_from(f"{_bo(conn)}II", resp.data, 8) == (1, 0)
+
+    return fixes.opcode, regions.opcode
+
+
+class TestXFixesEvaluateRegions:
+    def test_evaluate_needs_query_version(self, xserver, xclient):
+        """EvaluateRegions is BadRequest until QueryVersion was sent."""
+        _, opcode = _setup(xclient, query_regions=False)
+
+        xclient.send_request(
+            xfixes.EvaluateRegionsRequest(
+                opcode=opcode,
+                result=0,
+                ops=[xfixes.RegionOp(xfixes.RegionOpRectangle, width=1, height=1)],
+            )
+        )
+        resp = xclient.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Error), f"Expected error, got {resp}"
+        assert resp.error_code == BadRequest
+
+    def test_registers_per_client(self, xserver, xclient):
+        """
+        Each client has its own registers: what one client's program left
+        in a register is not there for another client to read.
+        """
+        _, opcode = _setup(xclient)
+
+        xclient.send_request(
+            xfixes.EvaluateRegionsRequest(
+                opcode=opcode,
+                result=5,
+                ops=[xfixes.RegionOp(xfixes.RegionOpRectangle, 5, width=8, height=8)],
+            )
+        )
+        assert isinstance(xclient.recv_response(timeout=5.0), X11Reply)
+
+        # reading a register it never wrote is refused, whatever others did
+        with RawX11Connection(xserver.display_num) as other:
+            _setup(other)
+            other.send_request(
+                xfixes.EvaluateRegionsRequest(
+                    opcode=opcode,
+                    result=0,
+                    ops=[xfixes.RegionOp(xfixes.RegionOpUnion, 0, 5, 5)],
+                )
+            )
+            resp = other.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Error), f"Expected error, got {resp}"
+        assert resp.error_code == BadMatch
+
+    @pytest.mark.swapped_client
+    def test_evaluate_swapped(self, xserver, xclient_swapped):
+        """
+        The operations of a byte-swapped client's program are swapped,
+        including negative offsets, and the result comes back swapped, both
+        in the reply and stored into a region resource.
+        """
+        conn = xclient_swapped
+        fixes_opcode, opcode = _setup(conn)
+
+        region = conn.alloc_id()
+        conn.send_request(
+            xfixes.CreateRegionRequest(opcode=fixes_opcode, region=region)
+        )
+
+        x, y, width, height = RECT
+        conn.send_request(
+            xfixes.EvaluateRegionsRequest(
+                opcode=opcode,
+                result=3,
+                ops=[
+                    xfixes.RegionOp(
+                        xfixes.RegionOpRectangle,
+                        3,
+                        x=x,
+                        y=y,
+                        width=width,
+                        height=height,
+                    ),
+                    xfixes.RegionOp(xfixes.RegionOpTranslate, 3, 3, x=5, y=-25),
+                    xfixes.RegionOp(xfixes.RegionOpStore, src1=3, region=region),
+                ],
+            )
+        )
+        resp = conn.recv_response(timeout=5.0)
+        assert xserver.is_alive, "Server crashed"
+        assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+        moved = (x + 5, y - 25, width, height)
+        assert _rects(conn, resp) == (moved, [moved])
+
+        conn.send_request(xfixes.FetchRegionRequest(opcode=fixes_opcode, region=region))
+        resp = conn.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+        assert _rects(conn, resp) == (moved, [moved])
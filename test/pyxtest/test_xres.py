@@ -1,13 +1,13 @@
 # SPDX-License-Identifier: MIT
 #
-# Tests for X-Resource extension.
+# Tests for the X-Resource, X-CLIENT-STATS and X-CLIENT-SCHED extensions.
 
 import struct
 
 import pytest
 
 from proto import xres
-from xclient import Extension, X11Reply
+from xclient import BadRequest, BadValue, Extension, X11Error, X11Reply
 
 
 @pytest.fixture
@@ -137,3 +137,113 @@ class TestXResQueryClientIds:
             f"The swap check used client->swapped instead of "
             f"sendClient->swapped."
         )
+
+
+class TestClientStats:
+    """Tests for X-CLIENT-STATS, per-client accounting."""
+
+    # resource_base, output_high_water, then dispatch_ns, requests,
+    # bytes_read, bytes_written, blocked_us and pixmap_bytes
+    RECORD = "II6Q"
+
+    @staticmethod
+    def _opcode(conn):
+        ext = conn.query_extension(Extension.CLIENT_STATS)
+        if not ext:
+            pytest.skip("X-CLIENT-STATS extension not available")
+        return ext.opcode
+
+    def test_query_needs_query_version(self, xserver, xclient):
+        """QueryClientStats is BadRequest until QueryVersion was sent."""
+        opcode = self._opcode(xclient)
+
+        xclient.send_request(xres.QueryClientStatsRequest(opcode=opcode))
+        resp = xclient.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Error), f"Expected error, got {resp}"
+        assert resp.error_code == BadRequest
+
+    @pytest.mark.swapped_client
+    def test_query_client_stats_swapped(self, xserver, xclient_swapped, xclient):
+        """
+        A byte-swapped client gets the XIDs it asks about swapped back and
+        the per-client records in its own byte order, with the pixmap of a
+        native client accounted to that client.
+        """
+        conn = xclient_swapped
+        opcode = self._opcode(conn)
+
+        conn.send_request(xres.ClientStatsQueryVersionRequest(opcode=opcode))
+        resp = conn.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+        assert struct.unpack_from(">II", resp.data, 8) == (1, 0)
+
+        pixmap = xclient.create_pixmap(width=64, height=64)
+        # the round trip makes sure the pixmap exists before we ask
+        xclient.intern_atom("PRIMARY", only_if_exists=True)
+
+        conn.send_request(xres.QueryClientStatsRequest(opcode=opcode, xids=[pixmap]))
+        resp = conn.recv_response(timeout=5.0)
+        assert xserver.is_alive, "Server crashed"
+        assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+
+        record_size = struct.calcsize(f">{self.RECORD}")
+        length, num_clients = struct.unpack_from(">II", resp.data, 4)
+        assert num_clients == 1
+        assert length * 4 == record_size
+
+        fields = struct.unpack_from(f">{self.RECORD}", resp.data, 32)
+        resource_base, requests, pixmap_bytes = fields[0], fields[3], fields[7]
+        assert resource_base == xclient._resource_id_base
+        assert 0 < requests < 1 << 32, "requests not swapped"
+        assert pixmap_bytes >= 64 * 64, "pixmap bytes not accounted or swapped"
+
+
+class TestClientSched:
+    """Tests for X-CLIENT-SCHED, clients lowering their own weight."""
+
+    # SCHED_WEIGHT_DEFAULT
+    WEIGHT_DEFAULT = 1024
+
+    @staticmethod
+    def _opcode(conn):
+        ext = conn.query_extension(Extension.CLIENT_SCHED)
+        if not ext:
+            pytest.skip("X-CLIENT-SCHED extension not available")
+        return ext.opcode
+
+    def test_set_weight_needs_query_version(self, xserver, xclient):
+        """SetWeight is BadRequest until QueryVersion was sent."""
+        opcode = self._opcode(xclient)
+
+        xclient.send_request(xres.SetWeightRequest(opcode=opcode, weight=1))
+        resp = xclient.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Error), f"Expected error, got {resp}"
+        assert resp.error_code == BadRequest
+
+    @pytest.mark.swapped_client
+    def test_set_weight_swapped(self, xserver, xclient_swapped):
+        """
+        A byte-swapped client can lower its weight to the minimum, but not
+        raise it above the default. Unswapped, the minimum would read as a
+        weight far above the default and the raised one as a different value.
+        """
+        conn = xclient_swapped
+        opcode = self._opcode(conn)
+
+        conn.send_request(xres.ClientSchedQueryVersionRequest(opcode=opcode))
+        resp = conn.recv_response(timeout=5.0)
+        assert isinstance(resp, X11Reply), f"Expected reply, got {resp}"
+        assert struct.unpack_from(">II", resp.data, 8) == (1, 0)
+
+        conn.send_request(xres.SetWeightRequest(opcode=opcode, weight=1))
+        assert conn.intern_atom("PRIMARY", only_if_exists=True) == 1, (
+            "SetWeight to the minimum failed"
+        )
+
+        weight = self.WEIGHT_DEFAULT * 2
+        conn.send_request(xres.SetWeightRequest(opcode=opcode, weight=weight))
+        resp = conn.recv_response(timeout=5.0)
+        assert xserver.is_alive, "Server crashed"
+        assert isinstance(resp, X11Error), f"Expected error, got {resp}"
+        assert resp.error_code == BadValue
+        assert resp.resource_id == weight
@@ -50,8 +50,11 @@ class Extension(StrEnum):
     """X11 extension wire names as used in QueryExtension requests."""
 
     BIG_REQUESTS = "BIG-REQUESTS"
+    CLIENT_SCHED = "X-CLIENT-SCHED"
+    CLIENT_STATS = "X-CLIENT-STATS"
     COMPOSITE = "Composite"
     DAMAGE = "DAMAGE"
+    DAMAGE_AGE = "X-DAMAGE-AGE"
     DBE = "DOUBLE-BUFFER"
     DPMS = "DPMS"
     DRI2 = "DRI2"
@@ -61,8 +64,10 @@ class Extension(StrEnum):
     MIT_SCREEN_SAVER = "MIT-SCREEN-SAVER"
     MIT_SHM = "MIT-SHM"
     PRESENT = "Present"
+    PRESENT_STATS = "X-PRESENT-STATS"
     RANDR = "RANDR"
     RECORD = "RECORD"
+    RECORD_RING = "X-RECORD-RING"
     RENDER = "RENDER"
     SECURITY = "SECURITY"
     SHAPE = "SHAPE"
@@ -71,6 +76,7 @@ class Extension(StrEnum):
     XF86DGA = "XFree86-DGA"
     XF86VIDMODE = "XFree86-VidModeExtension"
     XFIXES = "XFIXES"
+    XFIXES_REGIONS = "X-FIXES-REGIONS"
     XI = "XInputExtension"
     XRES = "X-Resource"
     XINERAMA = "XINERAMA"
@@ -80,6 +86,9 @@ class Extension(StrEnum):
     XVIDEO_MC = "XVideo-MotionCompensation"
 
 
+# Event type carrying extension events longer than 32 bytes
+GenericEvent = 35
+
 # X11 core protocol error codes (from X.h)
 BadRequest = 1
 BadValue = 2
@@ -171,6 +180,8 @@ class RawX11Connection:
         self.root_window = 0
         self.root_visual = 0
         self.root_depth = 0
+        self.default_colormap = 0
+        self.visual_classes = {}  # visual id -> class, of the first screen
         self._resource_id_base = 0
         self._resource_id_mask = 0
         self._next_resource_id = 0
@@ -231,7 +242,7 @@ class RawX11Connection:
         if num_screens > 0 and offset + 40 <= len(data):
             (
                 self.root_window,
-                _,
+                self.default_colormap,
                 _,
                 _,
                 _,
@@ -245,7 +256,17 @@ class RawX11Connection:
                 _,
                 _,
                 self.root_depth,
-            ) = struct.unpack_from(f"{bo}IIIIIHHHHHHI BBB", data, offset)
+                num_depths,
+            ) = struct.unpack_from(f"{bo}IIIIIHHHHHHI BBBB", data, offset)
+
+            offset += 40
+            for _ in range(num_depths):
+                num_visuals = struct.unpack_from(f"{bo}xxH", data, offset)[0]
+                offset += 8
+                for _ in range(num_visuals):
+                    visual, visual_class = struct.unpack_from(f"{bo}IB", data, offset)
+                    self.visual_classes[visual] = visual_class
+                    offset += 24
 
     # --- Core protocol helpers ---
 
@@ -279,12 +300,42 @@ class RawX11Connection:
             return None
         if not header:
             return None
+        return self._recv_rest(header, timeout)
+
+    def recv_response_fds(
+        self, max_fds: int = 4, timeout: float = 5.0
+    ) -> tuple[X11Error | X11Reply | None, list[int]]:
+        """Like recv_response, also returning the fds passed with it.
+
+        The caller owns and must close the returned fds.
+        """
+        assert self.sock
+        ready = select.select([self.sock], [], [], timeout)
+        if not ready[0]:
+            return None, []
+        try:
+            header, ancdata, _, _ = self.sock.recvmsg(
+                32, socket.CMSG_SPACE(max_fds * 4)
+            )
+            fds = []
+            for level, kind, data in ancdata:
+                if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+                    n = len(data) // 4
+                    fds += struct.unpack(f"={n}i", data[: n * 4])
+            if not header:
+                return None, fds
+            if len(header) < 32:
+                header += self._recv_exact(32 - len(header), timeout=timeout)
+        except (ConnectionResetError, BrokenPipeError, OSError, X11ConnectionError):
+            return None, []
+        return self._recv_rest(header, timeout), fds
 
+    def _recv_rest(self, header: bytes, timeout: float) -> X11Error | X11Reply:
         rtype = header[0]
         bo = self._byte_order
         if rtype == 0:
             return X11Error.from_data(header, bo)
-        elif rtype == 1:
+        elif rtype == 1 or rtype & 0x7F == GenericEvent:
             extra_len = struct.unpack_from(f"{bo}I", header, 4)[0]
             if extra_len > 0:
                 try:
@@ -0,0 +1,306 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Records a second connection through a RECORD context enabled with
+ * X-RECORD-RING's EnableContext and checks that exactly the selected core and extension
+ * requests show up in the shared ring, that the eventfd wakes up a waiting
+ * reader and that disabling the context ends the data. Prints the rate at
+ * which recorded requests are processed.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define RECORD_CREATE_CONTEXT 1
+#define RECORD_DISABLE_CONTEXT 6
+
+#define RECORD_RING_ENABLE_CONTEXT 1
+
+#define CATEGORY_FROM_CLIENT 1
+#define CATEGORY_START_OF_DATA 4
+#define CATEGORY_END_OF_DATA 5
+
+#define ALL_CLIENTS 3
+#define REQUESTS 100000
+
+struct ring_header {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t waiting;
+    uint32_t dropped;
+};
+
+struct ring {
+    struct ring_header *header;
+    const uint8_t *data;
+    uint32_t size;
+    int efd;
+};
+
+struct counts {
+    int start, end, noop, query_version, other;
+};
+
+/**
+ * Creates a context that records NoOperation, and QueryVersion of RECORD
+ * itself, of all clients.
+ */
+static uint32_t
+create_context(xcb_connection_t *c, uint8_t record_opcode)
+{
+    struct {
+        uint8_t major, minor;
+        uint16_t length;
+        uint32_t context;
+        uint8_t element_header, pad[3];
+        uint32_t n_clients, n_ranges;
+        uint32_t client;
+        uint8_t range[24];
+    } req = {
+        .context = xcb_generate_id(c),
+        .n_clients = 1,
+        .n_ranges = 1,
+        .client = ALL_CLIENTS,
+    };
+    xcb_void_cookie_t cookie;
+
+    req.range[0] = req.range[1] = XCB_NO_OPERATION;
+    req.range[4] = req.range[5] = record_opcode;
+    /* extension minor opcodes 0 to 0, native byte order */
+    memset(&req.range[6], 0, 4);
+
+    cookie.sequence = send_ext_request(c, &record_id, RECORD_CREATE_CONTEXT,
+                                       &req, sizeof(req), true, 0);
+    assert(!xcb_request_check(c, cookie));
+    return req.context;
+}
+
+static struct ring
+enable_ring(xcb_connection_t *c, uint32_t context)
+{
+    struct {
+        uint8_t major, minor;
+        uint16_t length;
+        uint32_t context, size;
+    } req = { .context = context, .size = 4 << 20 };
+    struct {
+        uint8_t type, nfd;
+        uint16_t sequence;
+        uint32_t length, size, offset, pad[4];
+    } *reply;
+    xcb_generic_error_t *error = NULL;
+    struct ring ring;
+    int *fds;
+
+    /* EnableContext needs the version first */
+    assert(query_private_version(c, &record_ring_id, 1, 0) == 1);
+
+    reply = xcb_wait_for_reply(c, send_ext_request(c, &record_ring_id,
+                                                   RECORD_RING_ENABLE_CONTEXT,
+                                                   &req, sizeof(req), false,
+                                                   XCB_REQUEST_REPLY_FDS),
+                               &error);
+    assert(reply && !error);
+    assert(reply->nfd == 2);
+    fds = xcb_get_reply_fds(c, reply, sizeof(*reply) + 4 * reply->length);
+
+    ring.size = reply->size;
+    ring.header = mmap(NULL, reply->offset + reply->size,
+                       PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    assert(ring.header != MAP_FAILED);
+    ring.data = (const uint8_t *) ring.header + reply->offset;
+    ring.efd = fds[1];
+    close(fds[0]);
+    free(reply);
+    return ring;
+}
+
+static void
+ring_copy(const struct ring *ring, uint32_t pos, void *dst, uint32_t len)
+{
+    uint32_t offset = pos & (ring->size - 1);
+    uint32_t chunk = len < ring->size - offset ? len : ring->size - offset;
+
+    memcpy(dst, ring->data + offset, chunk);
+    memcpy((uint8_t *) dst + chunk, ring->data, len - chunk);
+}
+
+/**
+ * Consumes all published records, counting the recorded requests.
+ */
+static void
+drain(struct ring *ring, uint8_t record_opcode, struct counts *counts)
+{
+    uint32_t head = __atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->header->tail;
+
+    while (tail != head) {
+        uint8_t header[32];
+        uint32_t length;
+        uint8_t *data;
+
+        ring_copy(ring, tail, header, sizeof(header));
+        assert(header[0] == 1);     /* X_Reply */
+        memcpy(&length, header + 4, 4);
+        data = malloc(4 * length + 1);
+        ring_copy(ring, tail + 32, data, 4 * length);
+
+        switch (header[1]) {
+        case CATEGORY_START_OF_DATA:
+            counts->start++;
+            break;
+        case CATEGORY_END_OF_DATA:
+            counts->end++;
+            break;
+        case CATEGORY_FROM_CLIENT:
+            for (uint32_t off = 0; off < 4 * length;) {
+                uint16_t req_len;
+
+                memcpy(&req_len, data + off + 2, 2);
+                assert(req_len);
+                if (data[off] == XCB_NO_OPERATION)
+                    counts->noop++;
+                else if (data[off] == record_opcode && data[off + 1] == 0)
+                    counts->query_version++;
+                else
+                    counts->other++;
+                off += 4 * req_len;
+            }
+            break;
+        default:
+            counts->other++;
+            break;
+        }
+
+        free(data);
+        tail += 32 + 4 * length;
+    }
+    __atomic_store_n(&ring->header->tail, tail, __ATOMIC_RELEASE);
+}
+
+static void
+query_version(xcb_connection_t *c)
+{
+    struct {
+        uint8_t major, minor;
+        uint16_t length;
+        uint16_t major_version, minor_version;
+    } req = { .major_version = 1, .minor_version = 13 };
+
+    free(xcb_wait_for_reply(c, send_ext_request(c, &record_id, 0, &req,
+                                                sizeof(req), false, 0),
+                            NULL));
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *recorder = xcb_connect(NULL, NULL);
+    xcb_connection_t *recorded = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext =
+        xcb_get_extension_data(recorder, &record_id);
+    struct counts counts = { 0 };
+    struct pollfd pfd;
+    struct ring ring;
+    uint32_t context;
+    uint64_t value;
+    double start, elapsed;
+
+    if (!ext->present ||
+        !xcb_get_extension_data(recorder, &record_ring_id)->present) {
+        printf("No RECORD or X-RECORD-RING present\n");
+        exit(77);
+    }
+
+    context = create_context(recorder, ext->major_opcode);
+    ring = enable_ring(recorder, context);
+
+    /* the recording connection is still usable */
+    sync_server(recorder);
+    drain(&ring, ext->major_opcode, &counts);
+    assert(counts.start == 1);
+
+    start = now();
+    for (int i = 0; i < REQUESTS; i++)
+        xcb_no_operation(recorded);
+    sync_server(recorded);
+    elapsed = now() - start;
+
+    drain(&ring, ext->major_opcode, &counts);
+    printf("%d recorded requests in %.3f s: %.0f requests/s, %u dropped\n",
+           REQUESTS, elapsed, REQUESTS / elapsed, ring.header->dropped);
+    assert(counts.noop + ring.header->dropped > 0);
+    assert(ring.header->dropped || counts.noop == REQUESTS);
+    assert(counts.other == 0);
+
+    /* a reader that waits is woken up by the eventfd */
+    counts.noop = 0;
+    __atomic_store_n(&ring.header->waiting, 1, __ATOMIC_SEQ_CST);
+    drain(&ring, ext->major_opcode, &counts);
+    query_version(recorded);
+    pfd.fd = ring.efd;
+    pfd.events = POLLIN;
+    assert(poll(&pfd, 1, 5000) == 1);
+    assert(read(ring.efd, &value, sizeof(value)) == sizeof(value));
+    drain(&ring, ext->major_opcode, &counts);
+    assert(counts.query_version == 1);
+    assert(counts.other == 0);
+
+    /* GetInputFocus is not selected */
+    sync_server(recorded);
+    sync_server(recorder);
+    drain(&ring, ext->major_opcode, &counts);
+    assert(counts.other == 0);
+
+    {
+        struct {
+            uint8_t major, minor;
+            uint16_t length;
+            uint32_t context;
+        } req = { .context = context };
+        xcb_void_cookie_t cookie = {
+            send_ext_request(recorder, &record_id, RECORD_DISABLE_CONTEXT,
+                             &req, sizeof(req), true, 0)
+        };
+
+        assert(!xcb_request_check(recorder, cookie));
+    }
+    drain(&ring, ext->major_opcode, &counts);
+    assert(counts.end == 1);
+
+    xcb_disconnect(recorded);
+    xcb_disconnect(recorder);
+    exit(0);
+}
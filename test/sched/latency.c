@@ -0,0 +1,205 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Measures the round trip latency of an interactive client while another
+ * client floods the server with drawing requests, first with equal
+ * weights and then with the flooding client having lowered its own weight
+ * through X-CLIENT-SCHED. Prints the median, 99th percentile and worst
+ * latency of both runs; fails if the interactive client starves, or if a
+ * client can raise its weight above the default.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define CLIENT_SCHED_SET_WEIGHT 1
+
+#define WEIGHT_MIN 1
+#define WEIGHT_DEFAULT 1024
+
+#define ROUND_TRIPS 500
+#define FLOOD_SIZE 256
+#define STARVED 1.0
+
+static xcb_generic_error_t *
+set_weight(xcb_connection_t *c, uint32_t weight)
+{
+    struct {
+        uint8_t major, minor;
+        uint16_t length;
+        uint32_t weight;
+    } req = { 0, 0, 0, weight };
+    xcb_void_cookie_t cookie;
+
+    cookie.sequence = send_ext_request(c, &client_sched_id,
+                                       CLIENT_SCHED_SET_WEIGHT, &req,
+                                       sizeof(req), true, 0);
+    return xcb_request_check(c, cookie);
+}
+
+/**
+ * Keeps the server busy filling a pixmap until killed, at the given
+ * weight. Reports that it started through fd first.
+ */
+static void
+flood(int fd, uint32_t weight)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    char ready = 1;
+    xcb_rectangle_t rect = { 0, 0, FLOOD_SIZE, FLOOD_SIZE };
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_gcontext_t gc = xcb_generate_id(c);
+
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      FLOOD_SIZE, FLOOD_SIZE);
+    xcb_create_gc(c, gc, pixmap, 0, NULL);
+    if (weight != WEIGHT_DEFAULT) {
+        assert(query_private_version(c, &client_sched_id, 1, 0) == 1);
+        assert(!set_weight(c, weight));
+    }
+    sync_server(c);
+
+    assert(write(fd, &ready, sizeof(ready)) == sizeof(ready));
+    close(fd);
+
+    for (;;) {
+        for (int i = 0; i < 100; i++)
+            xcb_poly_fill_rectangle(c, pixmap, gc, 1, &rect);
+        if (xcb_flush(c) <= 0)
+            _exit(0);
+    }
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Does round trips at about 1 kHz, like a client reacting to input
+ * would, and prints the latency distribution. Returns the worst case.
+ */
+static double
+measure(xcb_connection_t *c, const char *what)
+{
+    static double latency[ROUND_TRIPS];
+    struct timespec pause = { 0, 1000000 };
+
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        double start = now();
+
+        sync_server(c);
+        latency[i] = now() - start;
+        nanosleep(&pause, NULL);
+    }
+
+    qsort(latency, ROUND_TRIPS, sizeof(double), compare_double);
+    printf("%s: round trip p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", what,
+           latency[ROUND_TRIPS / 2] * 1e3,
+           latency[ROUND_TRIPS * 99 / 100] * 1e3,
+           latency[ROUND_TRIPS - 1] * 1e3);
+    return latency[ROUND_TRIPS - 1];
+}
+
+/**
+ * Measures the latency while a client floods the server at the given
+ * weight. Returns the worst case.
+ */
+static double
+measure_flood(xcb_connection_t *c, const char *what, uint32_t weight)
+{
+    double worst;
+    int fds[2], status;
+    char ready;
+    pid_t pid;
+
+    assert(pipe(fds) == 0);
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        close(fds[0]);
+        flood(fds[1], weight);
+    }
+    close(fds[1]);
+    assert(read(fds[0], &ready, sizeof(ready)) == sizeof(ready));
+    close(fds[0]);
+
+    worst = measure(c, what);
+
+    kill(pid, SIGTERM);
+    assert(waitpid(pid, &status, 0) == pid);
+    return worst;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_generic_error_t *error;
+
+    assert(!xcb_connection_has_error(c));
+
+    assert(measure_flood(c, "equal weights", WEIGHT_DEFAULT) < STARVED);
+
+    if (xcb_get_extension_data(c, &client_sched_id)->present) {
+        /* refused until the client has said which version it speaks */
+        error = set_weight(c, WEIGHT_MIN);
+        assert(error && error->error_code == XCB_REQUEST);
+        free(error);
+
+        assert(query_private_version(c, &client_sched_id, 1, 0) == 1);
+        error = set_weight(c, 0);
+        assert(error && error->error_code == XCB_VALUE);
+        free(error);
+
+        /* nobody gets more than the default share */
+        error = set_weight(c, WEIGHT_DEFAULT + 1);
+        assert(error && error->error_code == XCB_VALUE);
+        free(error);
+
+        assert(measure_flood(c, "flood at minimum weight",
+                             WEIGHT_MIN) < STARVED);
+    }
+    else
+        printf("No X-CLIENT-SCHED, skipping weighted run\n");
+
+    xcb_disconnect(c);
+    exit(0);
+}
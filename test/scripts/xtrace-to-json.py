@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+#
+# Convert a request trace recorded by the X server (-trace) to
+# Chrome trace event JSON, for Perfetto (ui.perfetto.dev) or
+# chrome://tracing. Each client becomes a thread, each request a slice.
+#
+# The file format is described in dix/trace_priv.h.
+#
+# usage: xtrace-to-json.py trace-file [json-file]
+
+import json
+import struct
+import sys
+
+TRACE_MAGIC = 0x43525458
+TRACE_RECORD_REQUEST = 1
+TRACE_RECORD_CLIENT = 2
+TRACE_RECORD_NAME = 3
+TRACE_NAME_EXTENSION = 0xffff
+
+CORE_REQUESTS = [
+    None, "CreateWindow", "ChangeWindowAttributes", "GetWindowAttributes",
+    "DestroyWindow", "DestroySubwindows", "ChangeSaveSet", "ReparentWindow",
+    "MapWindow", "MapSubwindows", "UnmapWindow", "UnmapSubwindows",
+    "ConfigureWindow", "CirculateWindow", "GetGeometry", "QueryTree",
+    "InternAtom", "GetAtomName", "ChangeProperty", "DeleteProperty",
+    "GetProperty", "ListProperties", "SetSelectionOwner", "GetSelectionOwner",
+    "ConvertSelection", "SendEvent", "GrabPointer", "UngrabPointer",
+    "GrabButton", "UngrabButton", "ChangeActivePointerGrab", "GrabKeyboard",
+    "UngrabKeyboard", "GrabKey", "UngrabKey", "AllowEvents", "GrabServer",
+    "UngrabServer", "QueryPointer", "GetMotionEvents", "TranslateCoords",
+    "WarpPointer", "SetInputFocus", "GetInputFocus", "QueryKeymap",
+    "OpenFont", "CloseFont", "QueryFont", "QueryTextExtents", "ListFonts",
+    "ListFontsWithInfo", "SetFontPath", "GetFontPath", "CreatePixmap",
+    "FreePixmap", "CreateGC", "ChangeGC", "CopyGC", "SetDashes",
+    "SetClipRectangles", "FreeGC", "ClearArea", "CopyArea", "CopyPlane",
+    "PolyPoint", "PolyLine", "PolySegment", "PolyRectangle", "PolyArc",
+    "FillPoly", "PolyFillRectangle", "PolyFillArc", "PutImage", "GetImage",
+    "PolyText8", "PolyText16", "ImageText8", "ImageText16", "CreateColormap",
+    "FreeColormap", "CopyColormapAndFree", "InstallColormap",
+    "UninstallColormap", "ListInstalledColormaps", "AllocColor",
+    "AllocNamedColor", "AllocColorCells", "AllocColorPlanes", "FreeColors",
+    "StoreColors", "StoreNamedColor", "QueryColors", "LookupColor",
+    "CreateCursor", "CreateGlyphCursor", "FreeCursor", "RecolorCursor",
+    "QueryBestSize", "QueryExtension", "ListExtensions",
+    "ChangeKeyboardMapping", "GetKeyboardMapping", "ChangeKeyboardControl",
+    "GetKeyboardControl", "Bell", "ChangePointerControl",
+    "GetPointerControl", "SetScreenSaver", "GetScreenSaver", "ChangeHosts",
+    "ListHosts", "SetAccessControl", "SetCloseDownMode", "KillClient",
+    "RotateProperties", "ForceScreenSaver", "SetPointerMapping",
+    "GetPointerMapping", "SetModifierMapping", "GetModifierMapping",
+]
+CORE_REQUESTS += [None] * (128 - len(CORE_REQUESTS))
+CORE_REQUESTS[127] = "NoOperation"
+
+
+def read_records(data, endian):
+    pos = struct.calcsize(endian + "IIQQII")
+    while pos + 4 <= len(data):
+        rtype, rdata, length = struct.unpack_from(endian + "BBH", data, pos)
+        if length < 4 or pos + length > len(data):
+            break  # truncated by a crash
+        yield rtype, rdata, data[pos + 4:pos + length]
+        pos += length
+
+
+def c_string(data):
+    return data.split(b"\0", 1)[0].decode("utf-8", "replace")
+
+
+def convert(data):
+    endian = "<"
+    if struct.unpack_from("<I", data)[0] != TRACE_MAGIC:
+        endian = ">"
+        if struct.unpack_from(">I", data)[0] != TRACE_MAGIC:
+            raise ValueError("not an X server trace")
+    _, version, start, _, pid, _ = struct.unpack_from(endian + "IIQQII", data)
+    if version != 1:
+        raise ValueError("unsupported trace version %d" % version)
+
+    names, extensions, events = {}, {}, []
+
+    def request_name(major, minor):
+        if (major, minor) in names:
+            return names[(major, minor)]
+        if major in extensions:
+            return "%s:%d" % (extensions[major], minor)
+        if major < 128 and CORE_REQUESTS[major]:
+            return CORE_REQUESTS[major]
+        return "%d.%d" % (major, minor)
+
+    def us(ns):
+        return (ns - start) / 1000.0
+
+    req = struct.Struct(endian + "HBBIIIIQQ")
+    client = struct.Struct(endian + "IIIQ")
+    name = struct.Struct(endian + "HH")
+
+    for rtype, rdata, body in read_records(data, endian):
+        if rtype == TRACE_RECORD_REQUEST:
+            (minor, result, nres, cid, seq, bytes_in, bytes_out,
+             t0, t1) = req.unpack_from(body)
+            resources = struct.unpack_from(endian + "%dI" % nres, body,
+                                           req.size)
+            events.append({
+                "name": request_name(rdata, minor),
+                "cat": "request",
+                "ph": "X",
+                "pid": pid,
+                "tid": cid,
+                "ts": us(t0),
+                "dur": (t1 - t0) / 1000.0,
+                "args": {
+                    "major": rdata,
+                    "minor": minor,
+                    "sequence": seq,
+                    "result": result,
+                    "bytes_in": bytes_in,
+                    "bytes_out": bytes_out,
+                    "resources": ["0x%x" % r for r in resources],
+                },
+            })
+        elif rtype == TRACE_RECORD_CLIENT:
+            cid, cpid, _, t = client.unpack_from(body)
+            cname = c_string(body[client.size:]) or "client %d" % cid
+            if rdata:
+                events.append({"name": "thread_name", "ph": "M", "pid": pid,
+                               "tid": cid,
+                               "args": {"name": "%s (%d)" % (cname, cpid)}})
+            events.append({"name": "connected" if rdata else "gone",
+                           "cat": "client", "ph": "i", "s": "t", "pid": pid,
+                           "tid": cid, "ts": us(t)})
+        elif rtype == TRACE_RECORD_NAME:
+            minor, _ = name.unpack_from(body)
+            text = c_string(body[name.size:])
+            if minor == TRACE_NAME_EXTENSION:
+                extensions[rdata] = text
+            else:
+                names[(rdata, minor)] = text
+
+    events.append({"name": "process_name", "ph": "M", "pid": pid,
+                   "args": {"name": "X server"}})
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit("usage: %s trace-file [json-file]" % sys.argv[0])
+
+    with open(sys.argv[1], "rb") as f:
+        trace = convert(f.read())
+
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
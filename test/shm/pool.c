@@ -0,0 +1,289 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Compares the rate at which small SHM pixmaps can be created and
+ * destroyed with a segment per pixmap, with pixmaps carved out of one
+ * memfd pool attached once, and with the pool attached again for every
+ * pixmap. Checks that pixmaps at different offsets of the pool show the
+ * right contents, and that a read-only fd of the pool can't get at the
+ * writable mapping.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <xcb/shm.h>
+
+#include "xcb-test.h"
+
+#define SIZE 64
+#define PIXMAP_BYTES (SIZE * SIZE * 4)
+#define SLOTS 64
+#define ITERATIONS 2000
+
+static int
+create_memfd(size_t size)
+{
+    int fd = memfd_create("shm-pool-test", MFD_CLOEXEC);
+
+    assert(fd >= 0);
+    assert(ftruncate(fd, size) == 0);
+    return fd;
+}
+
+static void
+report(const char *name, double elapsed)
+{
+    printf("%-24s %8.0f pixmaps/s\n", name, ITERATIONS / elapsed);
+}
+
+/* attach a new memfd for every pixmap, as most toolkits do */
+static void
+bench_segment_per_pixmap(xcb_connection_t *c, xcb_window_t root)
+{
+    double start = now();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        xcb_shm_seg_t seg = xcb_generate_id(c);
+        xcb_pixmap_t pixmap = xcb_generate_id(c);
+
+        /* xcb closes the fd once it has been sent */
+        xcb_shm_attach_fd(c, seg, create_memfd(PIXMAP_BYTES), 0);
+        xcb_shm_create_pixmap(c, pixmap, root, SIZE, SIZE, 24, seg, 0);
+        xcb_free_pixmap(c, pixmap);
+        xcb_shm_detach(c, seg);
+    }
+    sync_server(c);
+
+    report("segment per pixmap", now() - start);
+}
+
+/* attach one pool and create the pixmaps at offsets into it */
+static void
+bench_pool(xcb_connection_t *c, xcb_window_t root, int fd)
+{
+    xcb_shm_seg_t seg = xcb_generate_id(c);
+    double start = now();
+
+    xcb_shm_attach_fd(c, seg, dup(fd), 0);
+    for (int i = 0; i < ITERATIONS; i++) {
+        xcb_pixmap_t pixmap = xcb_generate_id(c);
+
+        xcb_shm_create_pixmap(c, pixmap, root, SIZE, SIZE, 24, seg,
+                              (i % SLOTS) * PIXMAP_BYTES);
+        xcb_free_pixmap(c, pixmap);
+    }
+    xcb_shm_detach(c, seg);
+    sync_server(c);
+
+    report("pool", now() - start);
+}
+
+/* attach the same pool for every pixmap, sharing the server's mapping */
+static void
+bench_pool_reattach(xcb_connection_t *c, xcb_window_t root, int fd)
+{
+    double start = now();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        xcb_shm_seg_t seg = xcb_generate_id(c);
+        xcb_pixmap_t pixmap = xcb_generate_id(c);
+
+        xcb_shm_attach_fd(c, seg, dup(fd), 0);
+        xcb_shm_create_pixmap(c, pixmap, root, SIZE, SIZE, 24, seg,
+                              (i % SLOTS) * PIXMAP_BYTES);
+        xcb_free_pixmap(c, pixmap);
+        xcb_shm_detach(c, seg);
+    }
+    sync_server(c);
+
+    report("pool attached per pixmap", now() - start);
+}
+
+static bool
+check_pixmap(xcb_connection_t *c, xcb_pixmap_t pixmap, uint32_t value)
+{
+    xcb_get_image_reply_t *reply =
+        xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                             pixmap, 0, 0, SIZE, SIZE, ~0),
+                            NULL);
+    const uint32_t *pixels;
+    bool ok = true;
+
+    assert(reply);
+    pixels = (const uint32_t *) xcb_get_image_data(reply);
+    for (int i = 0; i < SIZE * SIZE && ok; i++)
+        ok = (pixels[i] & 0xffffff) == value;
+
+    free(reply);
+    return ok;
+}
+
+/*
+ * Fill each slot of the pool with its own value and check that pixmaps
+ * created through two attachments of the pool see their own slot.
+ */
+static bool
+check_pool(xcb_connection_t *c, xcb_window_t root, int fd)
+{
+    size_t size = SLOTS * PIXMAP_BYTES;
+    uint32_t *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          fd, 0);
+    xcb_shm_seg_t seg[2];
+    bool pass = true;
+
+    assert(data != MAP_FAILED);
+    for (int slot = 0; slot < SLOTS; slot++)
+        for (int i = 0; i < SIZE * SIZE; i++)
+            data[slot * SIZE * SIZE + i] = 0x010101 * slot;
+
+    for (int j = 0; j < 2; j++) {
+        seg[j] = xcb_generate_id(c);
+        xcb_shm_attach_fd(c, seg[j], dup(fd), 0);
+    }
+
+    for (int slot = 0; slot < SLOTS; slot++) {
+        xcb_pixmap_t pixmap = xcb_generate_id(c);
+
+        xcb_shm_create_pixmap(c, pixmap, root, SIZE, SIZE, 24, seg[slot & 1],
+                              slot * PIXMAP_BYTES);
+        pass = check_pixmap(c, pixmap, 0x010101 * slot) && pass;
+        xcb_free_pixmap(c, pixmap);
+    }
+
+    /* the pool stays usable through the second attachment */
+    xcb_shm_detach(c, seg[0]);
+    data[0] = 0x123456;
+    {
+        xcb_pixmap_t pixmap = xcb_generate_id(c);
+        xcb_get_image_reply_t *reply;
+
+        xcb_shm_create_pixmap(c, pixmap, root, SIZE, SIZE, 24, seg[1], 0);
+        reply = xcb_get_image_reply(c,
+                                    xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                                  pixmap, 0, 0, 1, 1, ~0),
+                                    NULL);
+        assert(reply);
+        pass = ((*(uint32_t *) xcb_get_image_data(reply)) & 0xffffff) ==
+            0x123456 && pass;
+        free(reply);
+        xcb_free_pixmap(c, pixmap);
+    }
+    xcb_shm_detach(c, seg[1]);
+
+    munmap(data, size);
+    return pass;
+}
+
+/*
+ * Attach the pool read-write, then a read-only fd of the same pool, which
+ * must not share the writable mapping.
+ */
+static bool
+check_access(xcb_connection_t *c, int fd)
+{
+    char path[64];
+    xcb_shm_seg_t seg = xcb_generate_id(c), ro = xcb_generate_id(c);
+    xcb_generic_error_t *error;
+    bool pass = true;
+    int rofd;
+
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    rofd = open(path, O_RDONLY | O_CLOEXEC);
+    if (rofd < 0) {
+        printf("Can't reopen the pool read-only, skipping access check\n");
+        return true;
+    }
+
+    assert(!xcb_request_check(c, xcb_shm_attach_fd_checked(c, seg, dup(fd),
+                                                           0)));
+
+    error = xcb_request_check(c, xcb_shm_attach_fd_checked(c, ro, dup(rofd),
+                                                           0));
+    pass = error && error->error_code == XCB_ACCESS && pass;
+    free(error);
+
+    /* read-only it may have */
+    error = xcb_request_check(c, xcb_shm_attach_fd_checked(c, ro, rofd, 1));
+    pass = !error && pass;
+    free(error);
+    xcb_shm_detach(c, ro);
+
+    xcb_shm_detach(c, seg);
+    sync_server(c);
+    return pass;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext =
+        xcb_get_extension_data(c, &xcb_shm_id);
+    xcb_shm_query_version_reply_t *version;
+    xcb_screen_t *screen;
+    bool pass;
+    int fd;
+
+    if (!ext->present) {
+        printf("No MIT-SHM present\n");
+        exit(77);
+    }
+
+    version = xcb_shm_query_version_reply(c, xcb_shm_query_version(c), NULL);
+    if (!version || version->major_version < 1 ||
+        (version->major_version == 1 && version->minor_version < 2) ||
+        !version->shared_pixmaps) {
+        printf("MIT-SHM 1.2 with shared pixmaps required\n");
+        exit(77);
+    }
+    free(version);
+
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    if (screen->root_depth != 24) {
+        printf("Root depth is %d, need 24\n", screen->root_depth);
+        exit(77);
+    }
+
+    fd = create_memfd(SLOTS * PIXMAP_BYTES);
+
+    pass = check_pool(c, screen->root, fd);
+    pass = check_access(c, fd) && pass;
+
+    bench_segment_per_pixmap(c, screen->root);
+    bench_pool(c, screen->root, fd);
+    bench_pool_reattach(c, screen->root, fd);
+
+    close(fd);
+    xcb_disconnect(c);
+
+    exit(pass ? 0 : 1);
+}
@@ -0,0 +1,179 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Puts 4K frames through MIT-SHM and checks that they arrive intact and that
+ * the completion event is only sent once the whole image is done, whether
+ * or not the server puts them in strips (-shmstrips). Prints the achieved
+ * throughput.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/shm.h>
+
+#include "xcb-test.h"
+
+#define WIDTH 3840
+#define HEIGHT 2160
+#define FRAMES 30
+
+static void
+fill_frame(uint32_t *data, int frame)
+{
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            data[y * WIDTH + x] = ((x + frame) & 0xff) |
+                (((y + frame) & 0xff) << 8) | ((frame & 0xff) << 16);
+}
+
+/**
+ * Waits for the completion event of a ShmPutImage, making sure nothing
+ * else arrives first.
+ */
+static void
+wait_for_completion(xcb_connection_t *c, uint8_t completion_type,
+                    xcb_shm_seg_t seg)
+{
+    xcb_generic_event_t *ev = xcb_wait_for_event(c);
+    xcb_shm_completion_event_t *completion;
+
+    assert(ev);
+    assert((ev->response_type & ~0x80) == completion_type);
+    completion = (xcb_shm_completion_event_t *) ev;
+    assert(completion->shmseg == seg);
+    free(ev);
+}
+
+/**
+ * Compares the rows [y0, y0 + h) and columns [x0, x0 + w) of the pixmap
+ * with the frame data, dx pixels to the right of where they are in the
+ * data.
+ */
+static bool
+check_rows(xcb_connection_t *c, xcb_pixmap_t pixmap, const uint32_t *data,
+           int x0, int w, int y0, int h, int dx)
+{
+    xcb_get_image_reply_t *reply =
+        xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                             pixmap, x0 + dx, y0, w, h, ~0),
+                            NULL);
+    const uint32_t *pixels;
+    bool ok = true;
+
+    assert(reply);
+    assert(xcb_get_image_data_length(reply) == 4 * w * h);
+    pixels = (const uint32_t *) xcb_get_image_data(reply);
+
+    for (int y = 0; y < h && ok; y++)
+        for (int x = 0; x < w && ok; x++)
+            ok = (pixels[y * w + x] & 0xffffff) ==
+                (data[(y0 + y) * WIDTH + x0 + x] & 0xffffff);
+
+    free(reply);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext =
+        xcb_get_extension_data(c, &xcb_shm_id);
+    xcb_screen_t *screen;
+    xcb_pixmap_t pixmap;
+    xcb_gcontext_t gc;
+    xcb_shm_seg_t seg;
+    size_t size = WIDTH * HEIGHT * 4;
+    uint32_t *data;
+    double start, elapsed;
+    bool pass = true;
+    int shmid;
+
+    if (!ext->present) {
+        printf("No MIT-SHM present\n");
+        exit(77);
+    }
+
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    if (screen->root_depth != 24) {
+        printf("Root depth is %d, need 24\n", screen->root_depth);
+        exit(77);
+    }
+
+    shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    assert(shmid >= 0);
+    data = shmat(shmid, NULL, 0);
+    assert(data != (void *) -1);
+
+    seg = xcb_generate_id(c);
+    assert(!xcb_request_check(c, xcb_shm_attach_checked(c, seg, shmid, 0)));
+    shmctl(shmid, IPC_RMID, NULL);
+
+    pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, 24, pixmap, screen->root, WIDTH, HEIGHT);
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, pixmap, 0, NULL);
+
+    start = now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        fill_frame(data, frame);
+        xcb_shm_put_image(c, pixmap, gc, WIDTH, HEIGHT, 0, 0, WIDTH, HEIGHT,
+                          0, 0, 24, XCB_IMAGE_FORMAT_Z_PIXMAP, 1, seg, 0);
+        xcb_flush(c);
+        /* the segment may only be reused once the server is done with it */
+        wait_for_completion(c, ext->first_event + XCB_SHM_COMPLETION, seg);
+    }
+    elapsed = now() - start;
+
+    /* the first, a middle and the last strip */
+    pass = check_rows(c, pixmap, data, 0, WIDTH, 0, 4, 0) && pass;
+    pass = check_rows(c, pixmap, data, 0, WIDTH, HEIGHT / 2, 4, 0) && pass;
+    pass = check_rows(c, pixmap, data, 0, WIDTH, HEIGHT - 4, 4, 0) && pass;
+
+    printf("%d frames of %dx%d in %.3f s: %.1f MB/s\n", FRAMES, WIDTH, HEIGHT,
+           elapsed, FRAMES * size / elapsed / (1 << 20));
+
+    /* a sub-rectangle takes the scratch pixmap path */
+    fill_frame(data, FRAMES);
+    xcb_shm_put_image(c, pixmap, gc, WIDTH, HEIGHT, 16, 8, WIDTH - 32,
+                      HEIGHT - 16, 16 + 5, 8, 24, XCB_IMAGE_FORMAT_Z_PIXMAP, 1,
+                      seg, 0);
+    xcb_flush(c);
+    wait_for_completion(c, ext->first_event + XCB_SHM_COMPLETION, seg);
+
+    pass = check_rows(c, pixmap, data, 16, WIDTH - 32, 8, 4, 5) && pass;
+    pass = check_rows(c, pixmap, data, 16, WIDTH - 32, HEIGHT - 12, 4, 5) && pass;
+
+    xcb_shm_detach(c, seg);
+    xcb_disconnect(c);
+    shmdt(data);
+
+    exit(pass ? 0 : 1);
+}
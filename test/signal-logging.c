@@ -408,12 +408,71 @@ static void logging_format(void)
 }
 #pragma GCC diagnostic pop /* "-Wformat-security" */
 
+#if INPUTTHREAD
+static void logging_async(void)
+{
+    const char *log_file_path = "/tmp/Xorg-logging-async-test.log";
+    char read_buf[2048];
+    char expected[30];
+    char *fname, *logmsg;
+    FILE *f;
+    int i;
+
+    xorgLogVerbosity = -1;
+    xorgLogAsync = TRUE;
+
+    fname = (char*)LogInit(log_file_path, NULL);
+    assert(fname != NULL);
+    assert((f = fopen(log_file_path, "r")));
+    free(fname);
+
+    /* more lines than fit into the ring at once */
+    for (i = 0; i < 2000; i++)
+        LogMessageVerb(X_INFO, 1, "line %d\n", i);
+
+    /* a message from a signal handler comes after everything queued */
+    inSignalContext = TRUE;
+    LogMessageVerb(X_ERROR, 1, "from signal handler\n");
+    inSignalContext = FALSE;
+
+    for (i = 0; i < 2000; i++) {
+        assert(fgets(read_buf, sizeof(read_buf), f));
+        logmsg = strchr(read_buf, ']');
+        assert(logmsg);
+        sprintf(expected, "(II) line %d\n", i);
+        assert(strcmp(logmsg + 2, expected) == 0);
+    }
+    assert(fgets(read_buf, sizeof(read_buf), f));
+    assert(strcmp(read_buf, "(EE) from signal handler\n") == 0);
+
+    /* then lines go through the ring again, still in order when it fills */
+    for (i = 0; i < 2000; i++)
+        LogMessageVerb(X_INFO, 1, "again %d\n", i);
+    LogClose(EXIT_NO_ERROR);
+
+    for (i = 0; i < 2000; i++) {
+        assert(fgets(read_buf, sizeof(read_buf), f));
+        logmsg = strchr(read_buf, ']');
+        assert(logmsg);
+        sprintf(expected, "(II) again %d\n", i);
+        assert(strcmp(logmsg + 2, expected) == 0);
+    }
+
+    fclose(f);
+    unlink(log_file_path);
+    xorgLogAsync = FALSE;
+}
+#endif
+
 const testfunc_t*
 signal_logging_test(void)
 {
     static const testfunc_t testfuncs[] = {
         number_formatting,
         logging_format,
+#if INPUTTHREAD
+        logging_async,
+#endif
         NULL,
     };
     return testfuncs;
@@ -0,0 +1,210 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Allocates colors on the 8 bit PseudoColor and StaticColor visuals and
+ * prints the AllocColor rate. Checks that colors already in a PseudoColor
+ * map get their cell back, and that a StaticColor map answers with the
+ * closest cell, the lowest one of equally close cells.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define COLORS 200
+#define ROUNDS 50
+
+static xcb_visualid_t
+find_visual(xcb_screen_t *screen, uint8_t class)
+{
+    for (xcb_depth_iterator_t d = xcb_screen_allowed_depths_iterator(screen);
+         d.rem; xcb_depth_next(&d)) {
+        if (d.data->depth != 8)
+            continue;
+        for (xcb_visualtype_iterator_t v = xcb_depth_visuals_iterator(d.data);
+             v.rem; xcb_visualtype_next(&v))
+            if (v.data->_class == class && v.data->colormap_entries == 256)
+                return v.data->visual_id;
+    }
+    return 0;
+}
+
+/* A color the server doesn't need to round for an 8 bit visual */
+static void
+random_color(uint16_t rgb[3])
+{
+    for (int i = 0; i < 3; i++)
+        rgb[i] = (rand() & 0xff) * 257;
+}
+
+/** Allocates the colors all at once, returns the time it took */
+static double
+alloc_colors(xcb_connection_t *c, xcb_colormap_t cmap, uint16_t (*rgb)[3],
+             int n, uint32_t *pixels)
+{
+    xcb_alloc_color_cookie_t *cookies = calloc(n, sizeof(*cookies));
+    double start = now();
+
+    assert(cookies);
+    for (int i = 0; i < n; i++)
+        cookies[i] = xcb_alloc_color(c, cmap, rgb[i][0], rgb[i][1], rgb[i][2]);
+    for (int i = 0; i < n; i++) {
+        xcb_alloc_color_reply_t *reply =
+            xcb_alloc_color_reply(c, cookies[i], NULL);
+
+        assert(reply);
+        pixels[i] = reply->pixel;
+        free(reply);
+    }
+    free(cookies);
+    return now() - start;
+}
+
+static void
+test_pseudo(xcb_connection_t *c, xcb_screen_t *screen, xcb_visualid_t visual)
+{
+    xcb_colormap_t cmap = xcb_generate_id(c);
+    uint16_t (*rgb)[3] = calloc(COLORS * ROUNDS, sizeof(*rgb));
+    uint32_t first[COLORS], *pixels = calloc(COLORS * ROUNDS, sizeof(uint32_t));
+    double elapsed;
+
+    assert(rgb && pixels);
+    xcb_create_colormap(c, XCB_COLORMAP_ALLOC_NONE, cmap, screen->root, visual);
+
+    /* distinct colors, each gets a cell of its own */
+    for (int i = 0; i < COLORS; i++) {
+        rgb[i][0] = i * 257;
+        rgb[i][1] = (255 - i) * 257;
+        rgb[i][2] = (i * 7 & 0xff) * 257;
+    }
+    elapsed = alloc_colors(c, cmap, rgb, COLORS, first);
+    printf("PseudoColor: %d new colors in %.3f ms\n", COLORS, elapsed * 1e3);
+    for (int i = 0; i < COLORS; i++)
+        for (int j = 0; j < i; j++)
+            assert(first[i] != first[j]);
+
+    /* the same colors again, they share the cells */
+    for (int i = 0; i < COLORS * ROUNDS; i++) {
+        rgb[i][0] = rgb[i % COLORS][0];
+        rgb[i][1] = rgb[i % COLORS][1];
+        rgb[i][2] = rgb[i % COLORS][2];
+    }
+    elapsed = alloc_colors(c, cmap, rgb, COLORS * ROUNDS, pixels);
+    for (int i = 0; i < COLORS * ROUNDS; i++)
+        assert(pixels[i] == first[i % COLORS]);
+    printf("PseudoColor: %.0f AllocColor/s of allocated colors\n",
+           COLORS * ROUNDS / elapsed);
+
+    /* all references to the cell gone, it is free for a new color */
+    for (int i = 0; i <= ROUNDS; i++)
+        xcb_free_colors(c, cmap, 0, 1, &first[0]);
+    rgb[0][0] = rgb[0][1] = rgb[0][2] = 0x1111;
+    alloc_colors(c, cmap, rgb, 1, pixels);
+    assert(pixels[0] == first[0]);
+    rgb[0][0] = 0;
+    rgb[0][1] = 255 * 257;
+    rgb[0][2] = 0;
+    alloc_colors(c, cmap, rgb, 1, pixels);
+    assert(pixels[0] != first[0]);
+
+    xcb_free_colormap(c, cmap);
+    free(rgb);
+    free(pixels);
+}
+
+static void
+test_static(xcb_connection_t *c, xcb_screen_t *screen, xcb_visualid_t visual)
+{
+    xcb_colormap_t cmap = xcb_generate_id(c);
+    uint16_t (*rgb)[3] = calloc(COLORS * ROUNDS, sizeof(*rgb));
+    uint32_t *pixels = calloc(COLORS * ROUNDS, sizeof(uint32_t));
+    uint32_t all[256];
+    xcb_query_colors_reply_t *cells;
+    xcb_rgb_t *cell;
+    double elapsed;
+
+    assert(rgb && pixels);
+    xcb_create_colormap(c, XCB_COLORMAP_ALLOC_NONE, cmap, screen->root, visual);
+    for (int i = 0; i < 256; i++)
+        all[i] = i;
+    cells = xcb_query_colors_reply(c, xcb_query_colors(c, cmap, 256, all), NULL);
+    assert(cells && xcb_query_colors_colors_length(cells) == 256);
+    cell = xcb_query_colors_colors(cells);
+
+    for (int i = 0; i < COLORS * ROUNDS; i++)
+        random_color(rgb[i]);
+    elapsed = alloc_colors(c, cmap, rgb, COLORS * ROUNDS, pixels);
+    printf("StaticColor: %.0f AllocColor/s\n", COLORS * ROUNDS / elapsed);
+
+    for (int i = 0; i < COLORS * ROUNDS; i++) {
+        uint64_t best = UINT64_MAX;
+        uint32_t pixel = 0;
+
+        for (int p = 0; p < 256; p++) {
+            int64_t dr = (int64_t) cell[p].red - rgb[i][0];
+            int64_t dg = (int64_t) cell[p].green - rgb[i][1];
+            int64_t db = (int64_t) cell[p].blue - rgb[i][2];
+            uint64_t d = dr * dr + dg * dg + db * db;
+
+            if (d < best) {
+                best = d;
+                pixel = p;
+            }
+        }
+        assert(pixels[i] == pixel);
+    }
+
+    xcb_free_colormap(c, cmap);
+    free(cells);
+    free(rgb);
+    free(pixels);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    xcb_visualid_t pseudo = find_visual(screen, XCB_VISUAL_CLASS_PSEUDO_COLOR);
+    xcb_visualid_t stat = find_visual(screen, XCB_VISUAL_CLASS_STATIC_COLOR);
+
+    if (!pseudo && !stat) {
+        printf("No 8 bit PseudoColor or StaticColor visual\n");
+        exit(77);
+    }
+
+    srand(1);
+    if (pseudo)
+        test_pseudo(c, screen, pseudo);
+    if (stat)
+        test_static(c, screen, stat);
+
+    xcb_disconnect(c);
+    exit(0);
+}
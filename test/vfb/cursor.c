@@ -0,0 +1,191 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/** @file
+ *
+ * Creates the same cursors from several clients, bitmap and glyph ones,
+ * and frees them in different orders while the others stay in use, which
+ * the server shares the images of. Prints how long creating a cursor took.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define SIZE 32
+#define ROUNDS 500
+
+static xcb_pixmap_t
+make_bitmap(xcb_connection_t *c, xcb_window_t root, int shift)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint8_t data[SIZE * SIZE / 8];
+
+    for (int i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t) (0x5a >> shift) ^ i;
+
+    xcb_create_pixmap(c, 1, pixmap, root, SIZE, SIZE);
+    xcb_create_gc(c, gc, pixmap, 0, NULL);
+    xcb_put_image(c, XCB_IMAGE_FORMAT_XY_PIXMAP, pixmap, gc, SIZE, SIZE, 0, 0,
+                  0, 1, sizeof(data), data);
+    xcb_free_gc(c, gc);
+    return pixmap;
+}
+
+static xcb_cursor_t
+make_cursor(xcb_connection_t *c, xcb_window_t root, int shift, uint16_t fore)
+{
+    xcb_pixmap_t source = make_bitmap(c, root, shift);
+    xcb_pixmap_t mask = make_bitmap(c, root, shift + 1);
+    xcb_cursor_t cursor = xcb_generate_id(c);
+
+    assert(!xcb_request_check(c, xcb_create_cursor_checked(c, cursor, source,
+                                                           mask, fore, 0, 0,
+                                                           0xffff, 0xffff,
+                                                           0xffff, 2, 3)));
+    xcb_free_pixmap(c, source);
+    xcb_free_pixmap(c, mask);
+    return cursor;
+}
+
+static xcb_cursor_t
+make_glyph_cursor(xcb_connection_t *c, xcb_font_t font, uint16_t glyph)
+{
+    xcb_cursor_t cursor = xcb_generate_id(c);
+
+    assert(!xcb_request_check(c, xcb_create_glyph_cursor_checked(c, cursor,
+                                                                 font, font,
+                                                                 glyph,
+                                                                 glyph + 1,
+                                                                 0, 0, 0,
+                                                                 0xffff,
+                                                                 0xffff,
+                                                                 0xffff)));
+    return cursor;
+}
+
+static xcb_window_t
+make_window(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_window_t window = xcb_generate_id(c);
+
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, screen->root, 0, 0,
+                      100, 100, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      screen->root_visual, 0, NULL);
+    xcb_map_window(c, window);
+    return window;
+}
+
+static void
+set_cursor(xcb_connection_t *c, xcb_window_t window, xcb_cursor_t cursor)
+{
+    assert(!xcb_request_check(c,
+                              xcb_change_window_attributes_checked(c, window,
+                                                                   XCB_CW_CURSOR,
+                                                                   &cursor)));
+}
+
+static xcb_font_t
+open_font(xcb_connection_t *c, const char *name)
+{
+    xcb_font_t font = xcb_generate_id(c);
+
+    if (xcb_request_check(c, xcb_open_font_checked(c, font, strlen(name), name)))
+        return XCB_NONE;
+    return font;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *a = xcb_connect(NULL, NULL);
+    xcb_connection_t *b = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(b)).data;
+    xcb_window_t wa = make_window(a, screen), wb = make_window(b, screen);
+    xcb_cursor_t ca, cb, cother;
+    xcb_font_t fa, fb;
+    double start, elapsed;
+
+    /* same image from both clients, b's outlives a's */
+    ca = make_cursor(a, screen->root, 0, 0);
+    cb = make_cursor(b, screen->root, 0, 0x8000);
+    cother = make_cursor(b, screen->root, 2, 0);
+    set_cursor(a, wa, ca);
+    set_cursor(b, wb, cb);
+    xcb_free_cursor(a, ca);
+    xcb_disconnect(a);
+
+    xcb_recolor_cursor(b, cb, 0xffff, 0, 0, 0, 0, 0xffff);
+    set_cursor(b, wb, cother);
+    set_cursor(b, wb, cb);
+    xcb_free_cursor(b, cb);
+    set_cursor(b, wb, cother);
+    set_cursor(b, wb, XCB_NONE);
+    xcb_free_cursor(b, cother);
+
+    /* the same glyphs through two fonts and two clients */
+    a = xcb_connect(NULL, NULL);
+    fa = open_font(a, "cursor");
+    fb = open_font(b, "cursor");
+    if (fa == XCB_NONE || fb == XCB_NONE) {
+        printf("No cursor font\n");
+        exit(77);
+    }
+    ca = make_glyph_cursor(a, fa, 68);
+    cb = make_glyph_cursor(b, fb, 68);
+    xcb_close_font(a, fa);
+    xcb_close_font(b, fb);
+    wa = make_window(a, screen);
+    set_cursor(a, wa, ca);
+    set_cursor(b, wb, cb);
+    xcb_free_cursor(b, cb);
+    fb = open_font(b, "cursor");
+    cb = make_glyph_cursor(b, fb, 68);
+    set_cursor(b, wb, cb);
+    xcb_disconnect(a);
+    xcb_free_cursor(b, cb);
+    xcb_close_font(b, fb);
+
+    /* every client of a desktop loads the same theme */
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) {
+        a = xcb_connect(NULL, NULL);
+        ca = make_cursor(a, screen->root, i % 4, i);
+        set_cursor(a, wb, ca);
+        xcb_disconnect(a);
+    }
+    elapsed = now() - start;
+    printf("%d clients creating a cursor in %.3f s\n", ROUNDS, elapsed);
+
+    /* the server is still fine */
+    sync_server(b);
+    assert(!xcb_connection_has_error(b));
+    xcb_disconnect(b);
+    exit(0);
+}
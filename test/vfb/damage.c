@@ -0,0 +1,197 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/** @file
+ *
+ * Draws into screen 0 of an Xvfb started with -fbdir and follows the
+ * damage like a consumer of the framebuffer file would: sleeps on the
+ * Xvfb_screen0.wakeup FIFO with the waiting flag set, then checks that
+ * the rectangles published in Xvfb_screen0.damage cover what was drawn
+ * and that the framebuffer file holds the new pixels there.
+ *
+ * Usage: vfb-damage <framebuffer directory>
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+/* Xvfb_screen<n>.damage, see hw/vfb/InitOutput.c */
+#define DAMAGE_MAGIC 0x58766644
+#define DAMAGE_VERSION 1
+#define DAMAGE_RECTS_OFFSET 64
+
+struct damage_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t waiting;
+    uint64_t frame;
+    uint64_t head;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct damage_rect {
+    uint64_t frame;
+    int16_t x, y;
+    uint16_t width, height;
+};
+
+/* XWD header fields, all CARD32 in big endian */
+#define XWD_HEADER_SIZE 0
+#define XWD_BITS_PER_PIXEL 11
+#define XWD_BYTES_PER_LINE 12
+#define XWD_NCOLORS 19
+#define XWD_COLOR_SIZE 12
+
+#define PIXEL 0x123456
+
+static int
+overlap(int a1, int a2, int b1, int b2)
+{
+    int lo = a1 > b1 ? a1 : b1, hi = a2 < b2 ? a2 : b2;
+
+    return hi > lo ? hi - lo : 0;
+}
+
+/** Reads the pixel at x, y from the framebuffer file. */
+static uint32_t
+read_pixel(int fd, int x, int y)
+{
+    uint32_t xwd[20], pixel;
+    off_t offset;
+
+    assert(pread(fd, xwd, sizeof(xwd), 0) == sizeof(xwd));
+    assert(ntohl(xwd[XWD_BITS_PER_PIXEL]) == 32);
+    offset = ntohl(xwd[XWD_HEADER_SIZE]) +
+        ntohl(xwd[XWD_NCOLORS]) * XWD_COLOR_SIZE +
+        (off_t) y * ntohl(xwd[XWD_BYTES_PER_LINE]) + x * 4;
+    assert(pread(fd, &pixel, sizeof(pixel), offset) == sizeof(pixel));
+    return pixel & 0xffffff;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    /* well away from the cursor in the middle of the screen */
+    xcb_rectangle_t rect = { 100, 50, 64, 32 };
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint32_t pixel = PIXEL;
+    struct damage_header *header;
+    struct damage_rect *rects;
+    struct pollfd wakeup;
+    uint64_t frame, head, covered = 0;
+    char path[4096], byte;
+    size_t size;
+    int fd, fb;
+
+    assert(argc == 2);
+
+    snprintf(path, sizeof(path), "%s/Xvfb_screen0.damage", argv[1]);
+    fd = open(path, O_RDWR);
+    assert(fd >= 0);
+    header = mmap(NULL, DAMAGE_RECTS_OFFSET, PROT_READ | PROT_WRITE,
+                  MAP_SHARED, fd, 0);
+    assert(header != MAP_FAILED);
+    assert(header->magic == DAMAGE_MAGIC);
+    assert(header->version == DAMAGE_VERSION);
+    size = DAMAGE_RECTS_OFFSET + header->size * sizeof(struct damage_rect);
+    munmap(header, DAMAGE_RECTS_OFFSET);
+    header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    assert(header != MAP_FAILED);
+    close(fd);
+    rects = (struct damage_rect *) ((char *) header + DAMAGE_RECTS_OFFSET);
+
+    snprintf(path, sizeof(path), "%s/Xvfb_screen0.wakeup", argv[1]);
+    wakeup.fd = open(path, O_RDONLY | O_NONBLOCK);
+    wakeup.events = POLLIN;
+    assert(wakeup.fd >= 0);
+
+    snprintf(path, sizeof(path), "%s/Xvfb_screen0", argv[1]);
+    fb = open(path, O_RDONLY);
+    assert(fb >= 0);
+
+    xcb_create_gc(c, gc, screen->root, XCB_GC_FOREGROUND, &pixel);
+    sync_server(c);
+
+    assert(header->width == screen->width_in_pixels);
+    assert(header->height == screen->height_in_pixels);
+    assert(read_pixel(fb, rect.x, rect.y) != PIXEL);
+
+    /* go to sleep the way the ring asks consumers to */
+    while (read(wakeup.fd, &byte, 1) == 1)
+        ;
+    __atomic_store_n(&header->waiting, 1, __ATOMIC_SEQ_CST);
+    frame = __atomic_load_n(&header->frame, __ATOMIC_ACQUIRE);
+    head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+
+    xcb_poly_fill_rectangle(c, screen->root, gc, 1, &rect);
+    xcb_flush(c);
+
+    assert(poll(&wakeup, 1, 5000) == 1);
+    assert(read(wakeup.fd, &byte, 1) == 1);
+    assert(__atomic_load_n(&header->waiting, __ATOMIC_SEQ_CST) == 0);
+
+    /* the fill may be spread over more than one frame */
+    sync_server(c);
+    usleep(100000);
+
+    assert(__atomic_load_n(&header->frame, __ATOMIC_ACQUIRE) > frame);
+    assert(header->head > head && header->head - head <= header->size);
+    for (uint64_t i = head; i < header->head; i++) {
+        struct damage_rect *r = &rects[i % header->size];
+
+        assert(r->frame > frame && r->frame <= header->frame);
+        covered += (uint64_t) overlap(r->x, r->x + r->width,
+                                      rect.x, rect.x + rect.width) *
+            overlap(r->y, r->y + r->height, rect.y, rect.y + rect.height);
+    }
+    assert(covered >= (uint64_t) rect.width * rect.height);
+
+    /* the damaged pages made it to the file, corners included */
+    assert(read_pixel(fb, rect.x, rect.y) == PIXEL);
+    assert(read_pixel(fb, rect.x + rect.width - 1,
+                      rect.y + rect.height - 1) == PIXEL);
+
+    printf("%d rectangles in %d frames\n", (int) (header->head - head),
+           (int) (header->frame - frame));
+
+    close(fb);
+    close(wakeup.fd);
+    munmap(header, size);
+    xcb_disconnect(c);
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/** @file
+ *
+ * Fills the whole screen over and over and prints the throughput, to
+ * compare the framebuffer backings of Xvfb. If given the path of the
+ * -memfd socket, also checks that the framebuffer handed out there shows
+ * what was drawn.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define FRAMES 200
+
+/* what the server sends on the -memfd socket, one per screen */
+struct memfd_info {
+    uint32_t magic;
+    uint32_t screen;
+    uint32_t num_screens;
+    uint32_t stride;
+    uint64_t size;
+    uint64_t fb_offset;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bits_per_pixel;
+    uint32_t depth;
+};
+
+#define MEMFD_MAGIC 0x5876664d
+
+/** Receives screen 0's framebuffer from the -memfd socket and maps it. */
+static uint8_t *
+map_memfd(const char *path, struct memfd_info *info)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    union {
+        struct cmsghdr cmsg;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct iovec iov = { .iov_base = info, .iov_len = sizeof(*info) };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    struct cmsghdr *cmsg;
+    void *map;
+    int sock, fd;
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(sock >= 0);
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    assert(connect(sock, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+
+    assert(recvmsg(sock, &msg, 0) == sizeof(*info));
+    close(sock);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    assert(cmsg && cmsg->cmsg_type == SCM_RIGHTS);
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+    assert(info->magic == MEMFD_MAGIC);
+    assert(info->screen == 0);
+    assert(info->fb_offset + info->stride * info->height <= info->size);
+
+    map = mmap(NULL, info->size, PROT_READ, MAP_SHARED, fd, 0);
+    assert(map != MAP_FAILED);
+    close(fd);
+
+    return map;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    xcb_rectangle_t rect = { 0, 0, screen->width_in_pixels,
+                             screen->height_in_pixels };
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    double start, elapsed;
+    uint32_t pixel = 0;
+
+    xcb_create_gc(c, gc, screen->root, 0, NULL);
+
+    start = now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        pixel = (frame * 0x010203) & 0xffffff;
+        xcb_change_gc(c, gc, XCB_GC_FOREGROUND, &pixel);
+        xcb_poly_fill_rectangle(c, screen->root, gc, 1, &rect);
+    }
+    sync_server(c);
+    elapsed = now() - start;
+
+    printf("%d fills of %dx%d in %.3f s: %.1f MB/s\n", FRAMES,
+           rect.width, rect.height, elapsed,
+           FRAMES * rect.width * rect.height * 4.0 / elapsed / (1 << 20));
+
+    if (argc > 1) {
+        struct memfd_info info;
+        uint8_t *map = map_memfd(argv[1], &info);
+
+        assert(info.width == rect.width && info.height == rect.height);
+        if (info.bits_per_pixel == 32) {
+            const uint32_t *fb = (const uint32_t *) (map + info.fb_offset);
+
+            assert((fb[0] & 0xffffff) == pixel);
+            fb = (const uint32_t *) (map + info.fb_offset +
+                                     (info.height - 1) * info.stride);
+            assert((fb[info.width - 1] & 0xffffff) == pixel);
+        }
+        munmap(map, info.size);
+    }
+
+    xcb_disconnect(c);
+    return 0;
+}
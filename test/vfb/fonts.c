@@ -0,0 +1,185 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Lists and opens fonts repeatedly and checks that the answers the server
+ * serves from its caches are the ones it computed the first time, also
+ * across a SetFontPath. Prints how long the first and the later rounds
+ * took.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define ROUNDS 50
+
+static xcb_list_fonts_reply_t *
+list_fonts(xcb_connection_t *c, const char *pattern)
+{
+    xcb_list_fonts_reply_t *reply =
+        xcb_list_fonts_reply(c, xcb_list_fonts(c, 1000, strlen(pattern),
+                                               pattern), NULL);
+
+    assert(reply);
+    return reply;
+}
+
+static int
+same_list(xcb_list_fonts_reply_t *a, xcb_list_fonts_reply_t *b)
+{
+    return a->names_len == b->names_len && a->length == b->length &&
+        memcmp(a + 1, b + 1, a->length * 4) == 0;
+}
+
+/** The names and font infos of a ListFontsWithInfo, one after the other */
+static size_t
+list_fonts_with_info(xcb_connection_t *c, const char *pattern, char **out)
+{
+    xcb_list_fonts_with_info_cookie_t cookie =
+        xcb_list_fonts_with_info(c, 100, strlen(pattern), pattern);
+    xcb_list_fonts_with_info_reply_t *reply;
+    size_t size = 0;
+
+    *out = NULL;
+    while ((reply = xcb_list_fonts_with_info_reply(c, cookie, NULL))) {
+        size_t len = 32 + reply->length * 4;
+
+        if (reply->name_len == 0) {
+            free(reply);
+            break;
+        }
+        *out = realloc(*out, size + len);
+        assert(*out);
+        /* the sequence number differs */
+        reply->sequence = 0;
+        memcpy(*out + size, reply, len);
+        size += len;
+        free(reply);
+    }
+    return size;
+}
+
+static void
+check_font(xcb_connection_t *c, const char *name,
+           xcb_query_font_reply_t **first)
+{
+    xcb_font_t font = xcb_generate_id(c);
+    xcb_query_font_reply_t *reply;
+
+    assert(!xcb_request_check(c, xcb_open_font_checked(c, font, strlen(name),
+                                                       name)));
+    reply = xcb_query_font_reply(c, xcb_query_font(c, font), NULL);
+    assert(reply);
+    xcb_close_font(c, font);
+
+    reply->sequence = 0;
+    if (!*first)
+        *first = reply;
+    else {
+        assert(reply->length == (*first)->length);
+        assert(memcmp(reply, *first, 32 + reply->length * 4) == 0);
+        free(reply);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_list_fonts_reply_t *first, *upper, *reply;
+    xcb_get_font_path_reply_t *path;
+    xcb_query_font_reply_t *fixed = NULL;
+    char *info, *info2;
+    size_t size;
+    double start, t_first, t_rest;
+
+    first = list_fonts(c, "*");
+    if (first->names_len == 0) {
+        printf("No fonts\n");
+        exit(77);
+    }
+
+    reply = list_fonts(c, "*");
+    assert(same_list(first, reply));
+    free(reply);
+
+    /* patterns are case insensitive, the cache must not tell */
+    upper = list_fonts(c, "FIXED");
+    reply = list_fonts(c, "fixed");
+    assert(same_list(upper, reply));
+    free(upper);
+    free(reply);
+
+    start = now();
+    free(list_fonts(c, "-*-*-*-*-*-*-*-*-*-*-*-*-*-*"));
+    t_first = now() - start;
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) {
+        reply = list_fonts(c, "-*-*-*-*-*-*-*-*-*-*-*-*-*-*");
+        free(reply);
+    }
+    t_rest = (now() - start) / ROUNDS;
+    printf("ListFonts: first %.3f ms, then %.3f ms\n", t_first * 1e3,
+           t_rest * 1e3);
+
+    size = list_fonts_with_info(c, "fixed", &info);
+    for (int i = 0; i < 3; i++) {
+        assert(list_fonts_with_info(c, "fixed", &info2) == size);
+        assert(size == 0 || memcmp(info, info2, size) == 0);
+        free(info2);
+    }
+
+    start = now();
+    check_font(c, "fixed", &fixed);
+    t_first = now() - start;
+    start = now();
+    for (int i = 0; i < ROUNDS; i++)
+        check_font(c, "fixed", &fixed);
+    t_rest = (now() - start) / ROUNDS;
+    printf("OpenFont: first %.3f ms, then %.3f ms\n", t_first * 1e3,
+           t_rest * 1e3);
+
+    /* setting the font path starts over */
+    path = xcb_get_font_path_reply(c, xcb_get_font_path(c), NULL);
+    assert(path);
+    assert(!xcb_request_check(c, xcb_set_font_path_checked(c,
+                                   xcb_get_font_path_path_length(path),
+                                   xcb_get_font_path_path_iterator(path).data)));
+    reply = list_fonts(c, "*");
+    assert(same_list(first, reply));
+    free(reply);
+    check_font(c, "fixed", &fixed);
+
+    free(path);
+    free(first);
+    free(fixed);
+    free(info);
+    xcb_disconnect(c);
+    exit(0);
+}
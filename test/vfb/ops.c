@@ -0,0 +1,220 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/** @file
+ *
+ * Measures the rate of small PolyFillRectangle and CopyArea requests on
+ * a few dozen windows, where the cost is dominated by the per-request work
+ * in the server rather than by the pixels touched: looking up the window,
+ * GC and pixmap privates of every layer that wraps the drawing functions.
+ * If the kernel lets us, the cache misses the server takes meanwhile are
+ * counted as well.  The vfb-ops-nolayoutprivates test runs it against a
+ * server started with -nolayoutprivates, to compare the two layouts.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+/* struct ucred */
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+
+#define WINDOWS 32
+#define SIZE 64
+#define OPS 200000
+
+/**
+ * Opens a counter of the cache misses of the server process at the other
+ * end of the connection, or returns -1.
+ */
+static int
+open_cache_misses(xcb_connection_t *c)
+{
+#if defined(__linux__) && defined(SO_PEERCRED)
+    struct perf_event_attr attr = {
+        .type = PERF_TYPE_HARDWARE,
+        .size = sizeof(attr),
+        .config = PERF_COUNT_HW_CACHE_MISSES,
+        .disabled = 1,
+        .exclude_kernel = 1,
+        .exclude_hv = 1,
+    };
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(xcb_get_file_descriptor(c), SOL_SOCKET, SO_PEERCRED,
+                   &cred, &len) < 0 || cred.pid <= 0)
+        return -1;
+
+    return syscall(SYS_perf_event_open, &attr, cred.pid, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void
+counter_enable(int fd, int enable)
+{
+#ifdef __linux__
+    if (fd < 0)
+        return;
+    if (enable)
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+static uint64_t
+counter_read(int fd)
+{
+    uint64_t value = 0;
+
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value))
+        return 0;
+    return value;
+}
+
+/** Waits for the server to process everything sent so far. */
+static void
+report(const char *name, int counter, uint64_t misses, double elapsed)
+{
+    if (counter >= 0)
+        printf("%-10s %8.0f requests/s, %.2f cache misses/request\n", name,
+               OPS / elapsed, (double) misses / OPS);
+    else
+        printf("%-10s %8.0f requests/s\n", name, OPS / elapsed);
+}
+
+static uint32_t
+get_pixel(xcb_connection_t *c, xcb_drawable_t drawable, int x, int y)
+{
+    xcb_get_image_reply_t *reply =
+        xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                             drawable, x, y, 1, 1, ~0),
+                            NULL);
+    uint32_t pixel;
+
+    assert(reply);
+    assert(xcb_get_image_data_length(reply) == 4);
+    memcpy(&pixel, xcb_get_image_data(reply), sizeof(pixel));
+    free(reply);
+    return pixel & 0xffffff;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_window_t windows[WINDOWS];
+    xcb_gcontext_t gcs[WINDOWS];
+    xcb_pixmap_t pixmap;
+    double start;
+    uint64_t misses;
+    int counter;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    if (screen->root_depth != 24) {
+        printf("Root depth is %d, need 24\n", screen->root_depth);
+        exit(77);
+    }
+
+    for (int i = 0; i < WINDOWS; i++) {
+        uint32_t background = 0;
+
+        windows[i] = xcb_generate_id(c);
+        xcb_create_window(c, XCB_COPY_FROM_PARENT, windows[i], screen->root,
+                          (i % 8) * SIZE, (i / 8) * SIZE, SIZE, SIZE, 0,
+                          XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                          XCB_CW_BACK_PIXEL, &background);
+        xcb_map_window(c, windows[i]);
+
+        gcs[i] = xcb_generate_id(c);
+        xcb_create_gc(c, gcs[i], windows[i], 0, NULL);
+    }
+    pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, 24, pixmap, screen->root, SIZE, SIZE);
+    sync_server(c);
+
+    counter = open_cache_misses(c);
+    if (counter < 0)
+        printf("Cannot count the server's cache misses, rates only\n");
+
+    /* 4x4 fills, each in another window with its own GC */
+    counter_enable(counter, 1);
+    start = now();
+    for (int i = 0; i < OPS; i++) {
+        int w = i % WINDOWS;
+        uint32_t foreground = i & 0xffffff;
+        xcb_rectangle_t rect = { (i / WINDOWS) % (SIZE - 4), 0, 4, 4 };
+
+        if (i >= OPS - WINDOWS)
+            foreground = 0x123456;
+        xcb_change_gc(c, gcs[w], XCB_GC_FOREGROUND, &foreground);
+        xcb_poly_fill_rectangle(c, windows[w], gcs[w], 1, &rect);
+    }
+    sync_server(c);
+    counter_enable(counter, 0);
+    misses = counter_read(counter);
+    report("fill", counter, misses, now() - start);
+
+    for (int i = 0; i < WINDOWS; i++)
+        assert(get_pixel(c, windows[i], ((OPS - WINDOWS + i) / WINDOWS) %
+                         (SIZE - 4), 0) == 0x123456);
+
+    /* 8x8 copies from window to window, and to a pixmap */
+    counter_enable(counter, 1);
+    start = now();
+    for (int i = 0; i < OPS; i++) {
+        int w = i % WINDOWS;
+        xcb_drawable_t dst = (i & 1) ? pixmap : windows[(w + 1) % WINDOWS];
+
+        xcb_copy_area(c, windows[w], dst, gcs[w], 0, 0,
+                      8 + (i / WINDOWS) % (SIZE - 16), 8, 8, 8);
+    }
+    sync_server(c);
+    counter_enable(counter, 0);
+    misses = counter_read(counter);
+    report("copy", counter, misses, now() - start);
+
+    if (counter >= 0)
+        close(counter);
+    xcb_disconnect(c);
+
+    exit(0);
+}
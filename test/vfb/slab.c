@@ -0,0 +1,184 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/** @file
+ *
+ * Measures how fast GCs and windows are created and freed, then plays a
+ * long synthetic session: several clients keeping a fluctuating set of
+ * GCs and windows with mixed lifetimes. Prints the create/free rates and
+ * the server's resident memory at the end; how full the slabs were is
+ * logged by the server at -verbose 3 when it exits.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+/* struct ucred */
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define BATCH 1000
+#define ROUNDS 100
+#define CLIENTS 4
+#define SESSION_STEPS 400000
+#define MAX_LIVE 20000
+
+/** Resident memory of the server at the other end, in kB, or 0 */
+static long
+server_rss(xcb_connection_t *c)
+{
+#ifdef SO_PEERCRED
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    char path[64], line[256];
+    long rss = 0;
+    FILE *status;
+
+    if (getsockopt(xcb_get_file_descriptor(c), SOL_SOCKET, SO_PEERCRED,
+                   &cred, &len) < 0 || cred.pid <= 0)
+        return 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/status", cred.pid);
+    status = fopen(path, "r");
+    if (!status)
+        return 0;
+    while (fgets(line, sizeof(line), status))
+        if (sscanf(line, "VmRSS: %ld", &rss) == 1)
+            break;
+    fclose(status);
+    return rss;
+#else
+    return 0;
+#endif
+}
+
+static void
+create_object(xcb_connection_t *c, xcb_screen_t *screen, uint32_t id,
+              int window)
+{
+    if (window)
+        xcb_create_window(c, XCB_COPY_FROM_PARENT, id, screen->root,
+                          0, 0, 16, 16, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                          screen->root_visual, 0, NULL);
+    else
+        xcb_create_gc(c, id, screen->root, 0, NULL);
+}
+
+static void
+free_object(xcb_connection_t *c, uint32_t id, int window)
+{
+    if (window)
+        xcb_destroy_window(c, id);
+    else
+        xcb_free_gc(c, id);
+}
+
+/** Creates and frees BATCH objects ROUNDS times, returns objects/s */
+static double
+churn(xcb_connection_t *c, xcb_screen_t *screen, int window)
+{
+    uint32_t ids[BATCH];
+    double start = now();
+
+    for (int i = 0; i < BATCH; i++)
+        ids[i] = xcb_generate_id(c);
+
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < BATCH; i++)
+            create_object(c, screen, ids[i], window);
+        for (int i = 0; i < BATCH; i++)
+            free_object(c, ids[i], window);
+    }
+    sync_server(c);
+
+    return BATCH * ROUNDS / (now() - start);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_connection_t *clients[CLIENTS];
+    static struct {
+        uint32_t id;
+        int client, window;
+    } live[MAX_LIVE];
+    int num_live = 0;
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    long rss_before = server_rss(c), rss;
+
+    printf("GCs:     %8.0f created and freed/s\n", churn(c, screen, 0));
+    printf("windows: %8.0f created and freed/s\n", churn(c, screen, 1));
+
+    /* a session: the live set grows to MAX_LIVE and shrinks again a few
+     * times, with most objects short lived and some outliving the rest */
+    for (int i = 0; i < CLIENTS; i++) {
+        clients[i] = xcb_connect(NULL, NULL);
+        assert(!xcb_connection_has_error(clients[i]));
+    }
+    srand(1);
+    for (int step = 0; step < SESSION_STEPS; step++) {
+        int phase = (step / (SESSION_STEPS / 8)) & 1;
+        int grow = rand() % 100 < (phase ? 30 : 70);
+
+        if (grow && num_live < MAX_LIVE) {
+            int client = rand() % CLIENTS;
+            int window = rand() % 4 == 0;
+
+            live[num_live].client = client;
+            live[num_live].window = window;
+            live[num_live].id = xcb_generate_id(clients[client]);
+            create_object(clients[client], screen, live[num_live].id, window);
+            num_live++;
+        }
+        else if (num_live) {
+            /* the newer objects die first, more often than not */
+            int i = rand() % 4 ? num_live - 1 - rand() % (num_live < 64 ? num_live : 64)
+                               : rand() % num_live;
+
+            free_object(clients[live[i].client], live[i].id, live[i].window);
+            live[i] = live[--num_live];
+        }
+    }
+    for (int i = 0; i < CLIENTS; i++)
+        sync_server(clients[i]);
+
+    rss = server_rss(c);
+
+    printf("%d objects left after the session\n", num_live);
+    if (rss && rss_before)
+        printf("server RSS %ld kB, %+ld kB since the start\n", rss,
+               rss - rss_before);
+
+    for (int i = 0; i < CLIENTS; i++)
+        xcb_disconnect(clients[i]);
+    xcb_disconnect(c);
+
+    exit(0);
+}
@@ -0,0 +1,171 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Draws core font text in a loop and prints the PolyText8 throughput.
+ * Checks QueryTextExtents against the per-character metrics from
+ * QueryFont, and that text drawn twice comes out the same.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define WIDTH 1024
+#define HEIGHT 768
+#define ROUNDS 20000
+
+static const char text[] = "The quick brown fox jumps over the lazy dog 0123456789";
+
+/** Sums up the extents of the string from the QueryFont metrics */
+static void
+expected_extents(xcb_query_font_reply_t *font, const char *s, int len,
+                 int *width, int *left, int *right)
+{
+    xcb_charinfo_t *ci = xcb_query_font_char_infos(font);
+    int x = 0;
+
+    *left = *right = 0;
+    for (int i = 0; i < len; i++) {
+        xcb_charinfo_t *c;
+        unsigned char ch = s[i];
+
+        if (ch < font->min_char_or_byte2 || ch > font->max_char_or_byte2)
+            ch = font->default_char;
+        if (xcb_query_font_char_infos_length(font) == 0)
+            c = &font->max_bounds;
+        else
+            c = &ci[ch - font->min_char_or_byte2];
+        if (i == 0 || x + c->left_side_bearing < *left)
+            *left = x + c->left_side_bearing;
+        if (i == 0 || x + c->right_side_bearing > *right)
+            *right = x + c->right_side_bearing;
+        x += c->character_width;
+    }
+    *width = x;
+}
+
+static xcb_get_image_reply_t *
+get_image(xcb_connection_t *c, xcb_pixmap_t pixmap)
+{
+    xcb_get_image_reply_t *image =
+        xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                             pixmap, 0, 0, WIDTH, HEIGHT, ~0),
+                            NULL);
+
+    assert(image);
+    return image;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    xcb_font_t font = xcb_generate_id(c);
+    xcb_query_font_reply_t *info;
+    xcb_query_text_extents_reply_t *extents;
+    xcb_char2b_t chars[sizeof(text) - 1];
+    xcb_get_image_reply_t *first, *second;
+    xcb_pixmap_t pixmap;
+    xcb_gcontext_t gc;
+    uint8_t item[2 + sizeof(text) - 1];
+    int len = sizeof(text) - 1;
+    int width, left, right;
+    double start, elapsed;
+    uint32_t values[3];
+
+    if (xcb_request_check(c, xcb_open_font_checked(c, font, 5, "fixed"))) {
+        printf("No font \"fixed\"\n");
+        exit(77);
+    }
+
+    info = xcb_query_font_reply(c, xcb_query_font(c, font), NULL);
+    assert(info);
+    if (info->min_byte1 || info->max_byte1) {
+        printf("\"fixed\" is a matrix font\n");
+        exit(77);
+    }
+
+    for (int i = 0; i < len; i++) {
+        chars[i].byte1 = 0;
+        chars[i].byte2 = text[i];
+    }
+    expected_extents(info, text, len, &width, &left, &right);
+    for (int i = 0; i < 2; i++) {
+        extents = xcb_query_text_extents_reply(c,
+                    xcb_query_text_extents(c, font, len, chars), NULL);
+        assert(extents);
+        assert(extents->overall_width == width);
+        assert(extents->overall_left == left);
+        assert(extents->overall_right == right);
+        free(extents);
+    }
+
+    pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      WIDTH, HEIGHT);
+    gc = xcb_generate_id(c);
+    values[0] = screen->black_pixel;
+    values[1] = screen->white_pixel;
+    values[2] = font;
+    xcb_create_gc(c, gc, pixmap,
+                  XCB_GC_FOREGROUND | XCB_GC_BACKGROUND | XCB_GC_FONT, values);
+
+    item[0] = len;
+    item[1] = 0;
+    memcpy(item + 2, text, len);
+
+    xcb_image_text_8(c, len, pixmap, gc, 10, 20, text);
+    xcb_poly_text_8(c, pixmap, gc, 10, 40, sizeof(item), item);
+    first = get_image(c, pixmap);
+
+    start = now();
+    for (int i = 0; i < ROUNDS; i++)
+        xcb_poly_text_8(c, pixmap, gc, i % (WIDTH / 2),
+                        60 + i % (HEIGHT - 80), sizeof(item), item);
+    sync_server(c);
+    elapsed = now() - start;
+    printf("PolyText8: %.0f strings/s, %.0f glyphs/s\n", ROUNDS / elapsed,
+           ROUNDS * len / elapsed);
+
+    /* the same text over the same spots, now with the glyphs looked up */
+    xcb_image_text_8(c, len, pixmap, gc, 10, 20, text);
+    xcb_poly_text_8(c, pixmap, gc, 10, 40, sizeof(item), item);
+    second = get_image(c, pixmap);
+    /* the loop stays below the first 32 rows */
+    assert(memcmp(xcb_get_image_data(first), xcb_get_image_data(second),
+                  xcb_get_image_data_length(first) / HEIGHT * 32) == 0);
+
+    free(first);
+    free(second);
+    free(info);
+    xcb_close_font(c, font);
+    xcb_disconnect(c);
+    exit(0);
+}
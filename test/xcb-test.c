@@ -0,0 +1,115 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "xcb-test.h"
+
+xcb_extension_t client_sched_id = { "X-CLIENT-SCHED", 0 };
+xcb_extension_t client_stats_id = { "X-CLIENT-STATS", 0 };
+xcb_extension_t record_id = { "RECORD", 0 };
+xcb_extension_t record_ring_id = { "X-RECORD-RING", 0 };
+xcb_extension_t xfixes_regions_id = { "X-FIXES-REGIONS", 0 };
+
+double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void
+sync_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+void
+require_extension(xcb_connection_t *c, xcb_extension_t *ext)
+{
+    if (!xcb_get_extension_data(c, ext)->present) {
+        printf("No %s present\n", ext->name);
+        exit(77);
+    }
+}
+
+unsigned int
+send_ext_request_iov(xcb_connection_t *c, xcb_extension_t *ext, int opcode,
+                     const struct iovec *parts, int count, bool isvoid,
+                     int flags)
+{
+    xcb_protocol_request_t xcb_req = {
+        .count = count,
+        .ext = ext,
+        .opcode = opcode,
+        .isvoid = isvoid,
+    };
+    /* libxcb wants two parts of room in front */
+    struct iovec vec[2 + 4];
+
+    assert(count <= 4);
+    for (int i = 0; i < count; i++)
+        vec[2 + i] = parts[i];
+    return xcb_send_request(c, XCB_REQUEST_CHECKED | flags, vec + 2, &xcb_req);
+}
+
+unsigned int
+send_ext_request(xcb_connection_t *c, xcb_extension_t *ext, int opcode,
+                 void *req, size_t len, bool isvoid, int flags)
+{
+    struct iovec part = { .iov_base = req, .iov_len = len };
+
+    return send_ext_request_iov(c, ext, opcode, &part, 1, isvoid, flags);
+}
+
+uint32_t
+query_private_version(xcb_connection_t *c, xcb_extension_t *ext,
+                      uint32_t major, uint32_t minor)
+{
+    struct {
+        uint8_t major, minor;
+        uint16_t length;
+        uint32_t client_major, client_minor;
+    } req = { 0, 0, 0, major, minor };
+    struct {
+        uint8_t response_type, pad0;
+        uint16_t sequence;
+        uint32_t length;
+        uint32_t server_major, server_minor;
+    } *reply;
+    uint32_t server_major;
+
+    reply = xcb_wait_for_reply(c, send_ext_request(c, ext, 0, &req,
+                                                   sizeof(req), false, 0),
+                               NULL);
+    assert(reply);
+    server_major = reply->server_major;
+    free(reply);
+    return server_major;
+}
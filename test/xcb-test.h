@@ -0,0 +1,79 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Helpers shared by the tests that talk to the server through libxcb:
+ * timing, round trips, and requests of the extensions libxcb has no
+ * bindings for.
+ */
+
+#ifndef XCB_TEST_H
+#define XCB_TEST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+
+/* extensions without libxcb bindings */
+extern xcb_extension_t client_sched_id;
+extern xcb_extension_t client_stats_id;
+extern xcb_extension_t record_id;
+extern xcb_extension_t record_ring_id;
+extern xcb_extension_t xfixes_regions_id;
+
+/** Monotonic time in seconds. */
+double now(void);
+
+/** Waits until the server has processed everything sent on c. */
+void sync_server(xcb_connection_t *c);
+
+/** Exits with the skip status 77 unless the server has ext. */
+void require_extension(xcb_connection_t *c, xcb_extension_t *ext);
+
+/**
+ * Sends a request of ext, made of count parts. The first part starts with
+ * the four bytes of request header, which libxcb fills in. The request is
+ * checked: errors go to xcb_wait_for_reply() or, for requests without a
+ * reply (isvoid), to xcb_request_check(). flags are added to
+ * XCB_REQUEST_CHECKED, e.g. XCB_REQUEST_REPLY_FDS. Returns the sequence
+ * number.
+ */
+unsigned int send_ext_request_iov(xcb_connection_t *c, xcb_extension_t *ext,
+                                  int opcode, const struct iovec *parts,
+                                  int count, bool isvoid, int flags);
+
+/** send_ext_request_iov() of a request in one part. */
+unsigned int send_ext_request(xcb_connection_t *c, xcb_extension_t *ext,
+                              int opcode, void *req, size_t len, bool isvoid,
+                              int flags);
+
+/**
+ * QueryVersion of the server-private X-* extensions, minor opcode 0 with
+ * CARD32 major and minor versions. Returns the server's major version.
+ */
+uint32_t query_private_version(xcb_connection_t *c, xcb_extension_t *ext,
+                               uint32_t major, uint32_t minor);
+
+#endif /* XCB_TEST_H */
@@ -0,0 +1,322 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Computes a compositor's per-frame damage, the union of the windows'
+ * damage moved to their positions, clipped to the screen and minus what
+ * opaque windows on top cover, once with the usual sequence of XFixes
+ * region requests and once as a single X-FIXES-REGIONS EvaluateRegions
+ * program. Checks that both agree, that malformed programs are refused
+ * and that EvaluateRegions needs QueryVersion first, and prints the frame
+ * rate of both.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+#include <xcb/xfixes.h>
+
+#include "xcb-test.h"
+
+#define XFIXES_EVALUATE_REGIONS 1
+
+enum {
+    OP_LOAD,
+    OP_RECTANGLE,
+    OP_UNION,
+    OP_INTERSECT,
+    OP_SUBTRACT,
+    OP_INVERT,
+    OP_TRANSLATE,
+    OP_EXTENTS,
+    OP_STORE,
+};
+
+#define WINDOWS 32
+#define FRAMES 2000
+#define SCREEN_WIDTH 1920
+#define SCREEN_HEIGHT 1080
+
+struct region_op {
+    uint8_t op, dst, src1, src2;
+    uint32_t region;
+    int16_t x, y;
+    uint16_t width, height;
+};
+
+struct window {
+    xcb_rectangle_t damage;     /* window relative */
+    int16_t x, y;
+    xcb_rectangle_t opaque;     /* screen relative, empty if none */
+};
+
+static struct window windows[WINDOWS];
+
+static void
+make_windows(int frame)
+{
+    srand(frame);
+    for (int i = 0; i < WINDOWS; i++) {
+        struct window *w = &windows[i];
+
+        w->x = rand() % SCREEN_WIDTH - 100;
+        w->y = rand() % SCREEN_HEIGHT - 100;
+        w->damage = (xcb_rectangle_t) { rand() % 200, rand() % 200,
+                                        1 + rand() % 400, 1 + rand() % 300 };
+        if (i % 4 == 0)
+            w->opaque = (xcb_rectangle_t) { w->x, w->y, 200, 150 };
+        else
+            w->opaque = (xcb_rectangle_t) { 0, 0, 0, 0 };
+    }
+}
+
+/**
+ * The damage the way compositors compute it today: a region resource for
+ * every rectangle, combined step by step.
+ */
+static xcb_xfixes_fetch_region_reply_t *
+damage_by_requests(xcb_connection_t *c)
+{
+    xcb_rectangle_t screen_rect = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+    xcb_xfixes_region_t damage = xcb_generate_id(c);
+    xcb_xfixes_region_t screen = xcb_generate_id(c);
+    xcb_xfixes_region_t tmp = xcb_generate_id(c);
+    xcb_xfixes_fetch_region_reply_t *reply;
+
+    xcb_xfixes_create_region(c, damage, 0, NULL);
+    xcb_xfixes_create_region(c, screen, 1, &screen_rect);
+    for (int i = 0; i < WINDOWS; i++) {
+        xcb_xfixes_create_region(c, tmp, 1, &windows[i].damage);
+        xcb_xfixes_translate_region(c, tmp, windows[i].x, windows[i].y);
+        xcb_xfixes_union_region(c, damage, tmp, damage);
+        xcb_xfixes_destroy_region(c, tmp);
+    }
+    xcb_xfixes_intersect_region(c, damage, screen, damage);
+    for (int i = 0; i < WINDOWS; i++) {
+        if (!windows[i].opaque.width)
+            continue;
+        xcb_xfixes_create_region(c, tmp, 1, &windows[i].opaque);
+        xcb_xfixes_subtract_region(c, damage, tmp, damage);
+        xcb_xfixes_destroy_region(c, tmp);
+    }
+    reply = xcb_xfixes_fetch_region_reply(c, xcb_xfixes_fetch_region(c, damage),
+                                          NULL);
+    xcb_xfixes_destroy_region(c, damage);
+    xcb_xfixes_destroy_region(c, screen);
+    return reply;
+}
+
+static xcb_xfixes_fetch_region_reply_t *
+evaluate(xcb_connection_t *c, struct region_op *ops, int n, uint8_t result,
+         xcb_generic_error_t **error)
+{
+    struct {
+        uint8_t major, minor;
+        uint16_t length;
+        uint8_t result, pad[3];
+    } req = { 0, 0, 0, result };
+    struct iovec parts[2] = {
+        { .iov_base = &req, .iov_len = sizeof(req) },
+        { .iov_base = ops, .iov_len = n * sizeof(*ops) },
+    };
+
+    return xcb_wait_for_reply(c, send_ext_request_iov(c, &xfixes_regions_id,
+                                                      XFIXES_EVALUATE_REGIONS,
+                                                      parts, 2, false, 0),
+                              error);
+}
+
+/**
+ * The same damage as one program: r0 holds the screen, r1 the damage and
+ * r2 is scratch.
+ */
+static xcb_xfixes_fetch_region_reply_t *
+damage_by_program(xcb_connection_t *c)
+{
+    static struct region_op ops[3 + 3 * WINDOWS + 2 * WINDOWS];
+    int n = 0;
+
+    ops[n++] = (struct region_op) { OP_RECTANGLE, 0, .width = SCREEN_WIDTH,
+                                    .height = SCREEN_HEIGHT };
+    ops[n++] = (struct region_op) { OP_RECTANGLE, 1 };
+    for (int i = 0; i < WINDOWS; i++) {
+        xcb_rectangle_t *r = &windows[i].damage;
+
+        ops[n++] = (struct region_op) { OP_RECTANGLE, 2, .x = r->x, .y = r->y,
+                                        .width = r->width,
+                                        .height = r->height };
+        ops[n++] = (struct region_op) { OP_TRANSLATE, 2, 2, .x = windows[i].x,
+                                        .y = windows[i].y };
+        ops[n++] = (struct region_op) { OP_UNION, 1, 1, 2 };
+    }
+    ops[n++] = (struct region_op) { OP_INTERSECT, 1, 1, 0 };
+    for (int i = 0; i < WINDOWS; i++) {
+        xcb_rectangle_t *r = &windows[i].opaque;
+
+        if (!r->width)
+            continue;
+        ops[n++] = (struct region_op) { OP_RECTANGLE, 2, .x = r->x, .y = r->y,
+                                        .width = r->width,
+                                        .height = r->height };
+        ops[n++] = (struct region_op) { OP_SUBTRACT, 1, 1, 2 };
+    }
+    return evaluate(c, ops, n, 1, NULL);
+}
+
+static bool
+same_region(xcb_xfixes_fetch_region_reply_t *a,
+            xcb_xfixes_fetch_region_reply_t *b)
+{
+    int n = xcb_xfixes_fetch_region_rectangles_length(a);
+
+    return n == xcb_xfixes_fetch_region_rectangles_length(b) &&
+        memcmp(&a->extents, &b->extents, sizeof(a->extents)) == 0 &&
+        memcmp(xcb_xfixes_fetch_region_rectangles(a),
+               xcb_xfixes_fetch_region_rectangles(b),
+               n * sizeof(xcb_rectangle_t)) == 0;
+}
+
+static void
+check_errors(xcb_connection_t *c)
+{
+    xcb_rectangle_t rect = { 10, 20, 30, 40 };
+    xcb_xfixes_region_t region = xcb_generate_id(c);
+    xcb_xfixes_fetch_region_reply_t *reply, *fetched;
+    xcb_generic_error_t *error;
+    struct region_op ops[3];
+
+    xcb_xfixes_create_region(c, region, 1, &rect);
+
+    /* refused until the client has said which version it speaks */
+    ops[0] = (struct region_op) { OP_RECTANGLE, 0, .width = 1, .height = 1 };
+    reply = evaluate(c, ops, 1, 0, &error);
+    assert(!reply && error && error->error_code == XCB_REQUEST);
+    free(error);
+
+    assert(query_private_version(c, &xfixes_regions_id, 1, 0) == 1);
+
+    /* load, move and store back into the resource */
+    ops[0] = (struct region_op) { OP_LOAD, 3, .region = region };
+    ops[1] = (struct region_op) { OP_TRANSLATE, 3, 3, .x = 5, .y = -5 };
+    ops[2] = (struct region_op) { OP_STORE, 0, 3, .region = region };
+    reply = evaluate(c, ops, 3, 3, &error);
+    assert(reply && !error);
+    fetched = xcb_xfixes_fetch_region_reply(c, xcb_xfixes_fetch_region(c, region),
+                                            NULL);
+    assert(fetched && same_region(reply, fetched));
+    assert(fetched->extents.x == 15 && fetched->extents.y == 15);
+    free(reply);
+    free(fetched);
+
+    /* registers can't be read before they are written */
+    ops[0] = (struct region_op) { OP_UNION, 0, 4, 4 };
+    reply = evaluate(c, ops, 1, 0, &error);
+    assert(!reply && error && error->error_code == XCB_MATCH);
+    free(error);
+
+    /* nor can the result */
+    ops[0] = (struct region_op) { OP_RECTANGLE, 0, .width = 1, .height = 1 };
+    reply = evaluate(c, ops, 1, 1, &error);
+    assert(!reply && error && error->error_code == XCB_MATCH);
+    free(error);
+
+    ops[0] = (struct region_op) { 99 };
+    reply = evaluate(c, ops, 1, 0, &error);
+    assert(!reply && error && error->error_code == XCB_VALUE);
+    free(error);
+
+    ops[0] = (struct region_op) { OP_RECTANGLE, 16 };
+    reply = evaluate(c, ops, 1, 0, &error);
+    assert(!reply && error && error->error_code == XCB_VALUE);
+    free(error);
+
+    /* nothing is stored when a later operation is bad */
+    ops[0] = (struct region_op) { OP_RECTANGLE, 0, .width = 1, .height = 1 };
+    ops[1] = (struct region_op) { OP_STORE, 0, 0, .region = region };
+    ops[2] = (struct region_op) { OP_LOAD, 1, .region = region + 1 };
+    reply = evaluate(c, ops, 3, 0, &error);
+    assert(!reply && error);
+    free(error);
+    fetched = xcb_xfixes_fetch_region_reply(c, xcb_xfixes_fetch_region(c, region),
+                                            NULL);
+    assert(fetched && fetched->extents.width == 30);
+    free(fetched);
+
+    xcb_xfixes_destroy_region(c, region);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_xfixes_query_version_reply_t *version;
+    double start, by_requests, by_program;
+
+    if (!xcb_get_extension_data(c, &xcb_xfixes_id)->present ||
+        !xcb_get_extension_data(c, &xfixes_regions_id)->present) {
+        printf("No XFIXES or X-FIXES-REGIONS present\n");
+        exit(77);
+    }
+
+    version = xcb_xfixes_query_version_reply(c,
+                                             xcb_xfixes_query_version(c, 6, 0),
+                                             NULL);
+    assert(version && version->major_version >= 2);
+    free(version);
+
+    check_errors(c);
+
+    for (int frame = 0; frame < 100; frame++) {
+        xcb_xfixes_fetch_region_reply_t *a, *b;
+
+        make_windows(frame);
+        a = damage_by_requests(c);
+        b = damage_by_program(c);
+        assert(a && b && same_region(a, b));
+        free(a);
+        free(b);
+    }
+
+    make_windows(0);
+    start = now();
+    for (int frame = 0; frame < FRAMES; frame++)
+        free(damage_by_requests(c));
+    by_requests = now() - start;
+
+    start = now();
+    for (int frame = 0; frame < FRAMES; frame++)
+        free(damage_by_program(c));
+    by_program = now() - start;
+
+    printf("%d windows: %.0f frames/s with region requests, "
+           "%.0f frames/s with EvaluateRegions\n", WINDOWS,
+           FRAMES / by_requests, FRAMES / by_program);
+
+    xcb_disconnect(c);
+    exit(0);
+}
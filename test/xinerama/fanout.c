@@ -0,0 +1,208 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Draws into windows on a Xinerama desktop of SCREEN_WIDTH wide screens laid
+ * out left to right, the number of which is given on the command line.
+ * Checks that drawing lands on the right screens, including windows and
+ * root window areas that straddle a screen edge, and prints the throughput
+ * of small PolyFillRectangle requests into a window on the first screen.
+ *
+ * Skipping the screens a window is clipped away on has no visible effect,
+ * so with four screens or more it is checked by cost instead: wide partial
+ * arcs cost about the same clipped or not, so drawing them into a window
+ * on the first screen must be well under half as expensive per screen as
+ * drawing them into a pixmap, which every screen holds a copy of.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define SCREEN_WIDTH 640
+#define REQUESTS 20000
+#define RECTS_PER_REQUEST 16
+#define ARC_REQUESTS 50
+#define ARCS_PER_REQUEST 8
+
+static xcb_window_t
+create_window(xcb_connection_t *c, xcb_screen_t *screen, int x, int y,
+              int w, int h)
+{
+    xcb_window_t window = xcb_generate_id(c);
+    uint32_t values[] = { screen->black_pixel };
+
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, screen->root, x, y,
+                      w, h, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      XCB_COPY_FROM_PARENT, XCB_CW_BACK_PIXEL, values);
+    xcb_map_window(c, window);
+    return window;
+}
+
+static void
+fill(xcb_connection_t *c, xcb_drawable_t drawable, xcb_gcontext_t gc,
+     uint32_t pixel, int x, int y, int w, int h)
+{
+    xcb_rectangle_t rect = { x, y, w, h };
+
+    xcb_change_gc(c, gc, XCB_GC_FOREGROUND, &pixel);
+    xcb_poly_fill_rectangle(c, drawable, gc, 1, &rect);
+}
+
+static uint32_t
+get_pixel(xcb_connection_t *c, xcb_drawable_t drawable, int x, int y)
+{
+    xcb_get_image_reply_t *reply =
+        xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                             drawable, x, y, 1, 1, ~0),
+                            NULL);
+    uint32_t pixel;
+
+    assert(reply);
+    pixel = *(uint32_t *) xcb_get_image_data(reply) & 0xffffff;
+    free(reply);
+    return pixel;
+}
+
+static double
+time_arcs(xcb_connection_t *c, xcb_drawable_t drawable, xcb_gcontext_t gc)
+{
+    xcb_arc_t arcs[ARCS_PER_REQUEST];
+    double best = 0;
+
+    for (int i = 0; i < ARCS_PER_REQUEST; i++) {
+        arcs[i].x = 16 + i * 4;
+        arcs[i].y = 16 + i * 4;
+        arcs[i].width = 200;
+        arcs[i].height = 180;
+        arcs[i].angle1 = i * 10 * 64;
+        arcs[i].angle2 = 270 * 64;
+    }
+
+    /* the best of three, to keep other load out of it */
+    for (int run = 0; run < 3; run++) {
+        double start = now(), elapsed;
+
+        for (int i = 0; i < ARC_REQUESTS; i++)
+            xcb_poly_arc(c, drawable, gc, ARCS_PER_REQUEST, arcs);
+        sync_server(c);
+        elapsed = now() - start;
+        if (!run || elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_rectangle_t rects[RECTS_PER_REQUEST];
+    xcb_screen_t *screen;
+    xcb_window_t local, straddle;
+    xcb_gcontext_t gc;
+    double start, elapsed;
+    bool pass = true;
+    int nscreens;
+
+    assert(argc == 2);
+    nscreens = atoi(argv[1]);
+
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    if (screen->root_depth != 24 ||
+        screen->width_in_pixels != nscreens * SCREEN_WIDTH) {
+        printf("Need a depth 24 Xinerama desktop of %d screens\n", nscreens);
+        exit(77);
+    }
+
+    local = create_window(c, screen, 64, 64, 256, 256);
+    straddle = create_window(c, screen, SCREEN_WIDTH - 64, 64, 128, 128);
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, local, 0, NULL);
+    sync_server(c);
+
+    /* either side of the edge between the first two screens */
+    fill(c, straddle, gc, 0x0000ff, 16, 16, 16, 16);
+    fill(c, straddle, gc, 0xff0000, 96, 16, 16, 16);
+    pass = get_pixel(c, straddle, 20, 20) == 0x0000ff && pass;
+    pass = get_pixel(c, straddle, 100, 20) == 0xff0000 && pass;
+
+    /* root coordinates are desktop coordinates, on the last screen */
+    fill(c, screen->root, gc, 0x00ff00,
+         nscreens * SCREEN_WIDTH - 32, 300, 16, 16);
+    pass = get_pixel(c, screen->root,
+                     nscreens * SCREEN_WIDTH - 24, 308) == 0x00ff00 && pass;
+
+    /* and across an edge */
+    fill(c, screen->root, gc, 0xffff00, SCREEN_WIDTH - 8, 400, 16, 16);
+    pass = get_pixel(c, screen->root, SCREEN_WIDTH - 4, 404) == 0xffff00 &&
+        pass;
+    pass = get_pixel(c, screen->root, SCREEN_WIDTH + 4, 404) == 0xffff00 &&
+        pass;
+
+    for (int i = 0; i < RECTS_PER_REQUEST; i++) {
+        rects[i].x = (i % 4) * 32;
+        rects[i].y = (i / 4) * 32;
+        rects[i].width = 8;
+        rects[i].height = 8;
+    }
+
+    start = now();
+    for (int i = 0; i < REQUESTS; i++)
+        xcb_poly_fill_rectangle(c, local, gc, RECTS_PER_REQUEST, rects);
+    sync_server(c);
+    elapsed = now() - start;
+
+    printf("%d screens: %d PolyFillRectangle requests in %.3f s: "
+           "%.0f requests/s\n", nscreens, REQUESTS, elapsed,
+           REQUESTS / elapsed);
+
+    pass = get_pixel(c, local, 2, 2) == 0xffff00 && pass;
+
+    if (nscreens >= 4) {
+        xcb_pixmap_t pixmap = xcb_generate_id(c);
+        uint32_t width = 24;
+        double window_time, pixmap_time;
+
+        xcb_create_pixmap(c, screen->root_depth, pixmap, local, 256, 256);
+        xcb_change_gc(c, gc, XCB_GC_LINE_WIDTH, &width);
+
+        window_time = time_arcs(c, local, gc);
+        pixmap_time = time_arcs(c, pixmap, gc);
+        printf("%d screens: wide arcs into a window %.3f s, into a pixmap "
+               "%.3f s\n", nscreens, window_time, pixmap_time);
+
+        /* about 1/nscreens when culled, close to 1 when not */
+        pass = window_time * nscreens / 2 < pixmap_time && pass;
+        xcb_free_pixmap(c, pixmap);
+    }
+
+    xcb_disconnect(c);
+
+    exit(pass ? 0 : 1);
+}
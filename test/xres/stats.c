@@ -0,0 +1,173 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Checks that X-CLIENT-STATS QueryClientStats accounts requests,
+ * connection I/O, dispatch time and pixmap memory to the client that
+ * caused them, that it needs QueryVersion first and that only existing
+ * clients can be queried. Prints the rate at which
+ * the statistics of all clients can be queried.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "xcb-test.h"
+
+#define CLIENT_STATS_QUERY_CLIENT_STATS 1
+
+#define REQUESTS 10000
+#define PIXMAP_SIZE 256
+#define QUERIES 1000
+
+struct client_stats {
+    uint32_t resource_base;
+    uint32_t output_high_water;
+    uint64_t dispatch_ns;
+    uint64_t requests;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t blocked_us;
+    uint64_t pixmap_bytes;
+};
+
+struct stats_reply {
+    uint8_t response_type, pad0;
+    uint16_t sequence;
+    uint32_t length, num_clients, pad[5];
+    struct client_stats clients[];
+};
+
+/**
+ * Queries the statistics of the client owning xid, or of all clients if
+ * xid is 0. Returns NULL and sets *error if the server refused.
+ */
+static struct stats_reply *
+query_stats(xcb_connection_t *c, uint32_t xid, xcb_generic_error_t **error)
+{
+    struct {
+        uint8_t major, minor;
+        uint16_t length;
+        uint32_t num_clients;
+        uint32_t xid;
+    } req = { 0, 0, 0, xid ? 1 : 0, xid };
+    struct stats_reply *reply;
+
+    *error = NULL;
+    reply = xcb_wait_for_reply(c,
+                               send_ext_request(c, &client_stats_id,
+                                                CLIENT_STATS_QUERY_CLIENT_STATS,
+                                                &req, xid ? 12 : 8, false, 0),
+                               error);
+    if (reply)
+        assert(reply->length * 4 ==
+               reply->num_clients * sizeof(struct client_stats));
+    return reply;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_connection_t *busy = xcb_connect(NULL, NULL);
+    uint32_t busy_base = xcb_get_setup(busy)->resource_id_base;
+    xcb_screen_t *screen;
+    xcb_pixmap_t pixmap;
+    struct stats_reply *reply;
+    struct client_stats before, after;
+    xcb_generic_error_t *error;
+    double start, elapsed;
+    bool found = false;
+
+    require_extension(c, &client_stats_id);
+
+    /* refused until the client has said which version it speaks */
+    reply = query_stats(c, 0, &error);
+    assert(!reply && error && error->error_code == XCB_REQUEST);
+    free(error);
+
+    assert(query_private_version(c, &client_stats_id, 1, 0) == 1);
+
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    reply = query_stats(c, busy_base, &error);
+    assert(reply && reply->num_clients == 1);
+    before = reply->clients[0];
+    free(reply);
+    assert(before.resource_base == busy_base);
+
+    /* keep the busy client busy, then make sure it's all been dispatched */
+    for (int i = 0; i < REQUESTS; i++)
+        xcb_no_operation(busy);
+    pixmap = xcb_generate_id(busy);
+    xcb_create_pixmap(busy, 24, pixmap, screen->root, PIXMAP_SIZE,
+                      PIXMAP_SIZE);
+    sync_server(busy);
+
+    reply = query_stats(c, pixmap, &error);
+    assert(reply && reply->num_clients == 1);
+    after = reply->clients[0];
+    free(reply);
+
+    assert(after.resource_base == busy_base);
+    assert(after.requests - before.requests >= REQUESTS + 2);
+    assert(after.bytes_read - before.bytes_read >= REQUESTS * 4);
+    assert(after.bytes_written - before.bytes_written >= 32);
+    assert(after.dispatch_ns > before.dispatch_ns);
+    assert(after.output_high_water >= 32);
+    assert(after.pixmap_bytes >= PIXMAP_SIZE * PIXMAP_SIZE * 4);
+
+    /* IDs of clients that don't exist are refused; with the default client
+     * limit, this is the last client slot */
+    reply = query_stats(c, 255u << 21, &error);
+    assert(!reply && error && error->error_code == XCB_VALUE);
+    free(error);
+
+    /* no IDs at all lists every client, including ourselves */
+    reply = query_stats(c, 0, &error);
+    assert(reply && reply->num_clients >= 2);
+    for (uint32_t i = 0; i < reply->num_clients; i++)
+        found = found || reply->clients[i].resource_base == busy_base;
+    assert(found);
+    free(reply);
+
+    start = now();
+    for (int i = 0; i < QUERIES; i++) {
+        reply = query_stats(c, 0, &error);
+        assert(reply);
+        free(reply);
+    }
+    elapsed = now() - start;
+    printf("%d QueryClientStats of all clients in %.3f s: %.0f queries/s\n",
+           QUERIES, elapsed, QUERIES / elapsed);
+
+    xcb_disconnect(busy);
+    xcb_disconnect(c);
+    exit(0);
+}